@@ -0,0 +1,23 @@
+#ifndef RECTROW_H
+#define RECTROW_H
+
+#include <QtGlobal>
+
+#include "myrect.h"
+
+/**
+ * @brief Строка таблицы rectangle: первичный ключ + данные прямоугольника.
+ *
+ * MyRect описывает только сам прямоугольник; при чтении из БД (снимки, сканы, экспорт)
+ * нужен ещё id строки.
+ */
+struct RectRow
+{
+    /// Первичный ключ (rectangle.id).
+    qint64 id { 0 };
+
+    /// Данные прямоугольника.
+    MyRect rect;
+};
+
+#endif // RECTROW_H
@@ -0,0 +1,158 @@
+#include "busyretry.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+
+#include "logger.h"
+
+namespace {
+
+// Первичный код SQLite (расширенные коды QSQLITE не включает).
+constexpr int kSqliteBusy = 5;
+
+} // namespace
+
+BusyRetry::BusyRetry(const Policy& policy)
+    : m_policy(policy)
+    , m_sleep([](int ms) { QThread::msleep(ulong(ms)); })
+    , m_rng(QRandomGenerator::global()->generate())
+{
+}
+
+BusyRetry::Policy BusyRetry::policyFromEnvironment(const Policy& fallback)
+{
+    Policy p = fallback;
+    bool ok = false;
+    const int timeout = qEnvironmentVariable(kEnvBusyTimeoutMs).toInt(&ok);
+    if (ok && timeout >= 0)
+        p.busyTimeoutMs = timeout;
+    const int retries = qEnvironmentVariable(kEnvMaxRetries).toInt(&ok);
+    if (ok && retries >= 0)
+        p.maxRetries = retries;
+    const int maxWait = qEnvironmentVariable(kEnvMaxWaitMs).toInt(&ok);
+    if (ok && maxWait >= 0)
+        p.maxWaitMs = maxWait;
+    return p;
+}
+
+bool BusyRetry::applyBusyTimeout(QSqlDatabase db) const
+{
+    QSqlQuery q(db);
+    if (!q.exec(QString("PRAGMA busy_timeout = %1;").arg(qMax(0, m_policy.busyTimeoutMs)))) {
+        LAB2_WARNING(lcDb()) << "BusyRetry: PRAGMA busy_timeout failed:" << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool BusyRetry::exec(QSqlQuery& q)
+{
+    return run_("exec", [&q] { return q.exec(); }, [&q] { return q.lastError(); });
+}
+
+bool BusyRetry::exec(QSqlQuery& q, const QString& sql)
+{
+    return run_("exec", [&q, &sql] { return q.exec(sql); }, [&q] { return q.lastError(); });
+}
+
+bool BusyRetry::transaction(QSqlDatabase db)
+{
+    return run_("BEGIN", [&db] { return db.transaction(); }, [&db] { return db.lastError(); });
+}
+
+bool BusyRetry::commit(QSqlDatabase db)
+{
+    // При SQLITE_BUSY на COMMIT транзакция остаётся открытой — COMMIT можно повторить.
+    return run_("COMMIT", [&db] { return db.commit(); }, [&db] { return db.lastError(); });
+}
+
+bool BusyRetry::isLockError(const QSqlError& error)
+{
+    if (!error.isValid())
+        return false;
+    bool ok = false;
+    const int code = error.nativeErrorCode().toInt(&ok);
+    if (ok)
+        return code == kSqliteBusy;
+    // Драйвер без кода ошибки — по тексту SQLite (у SQLITE_LOCKED текст "database table is locked").
+    return error.databaseText().contains("database is locked");
+}
+
+int BusyRetry::delayFor(int retry)
+{
+    const qint64 base = qMax(1, m_policy.baseDelayMs);
+    const qint64 d = qMin<qint64>(qMax(1, m_policy.maxDelayMs), base << qBound(0, retry, 20));
+    // "Equal jitter": половина паузы гарантирована, половина случайна.
+    return int(d / 2 + m_rng.bounded(int(d - d / 2 + 1)));
+}
+
+bool BusyRetry::run_(const char* what, const std::function<bool()>& attempt,
+                     const std::function<QSqlError()>& error)
+{
+    ++m_stats.operations;
+
+    QElapsedTimer timer;
+    timer.start();
+    bool contended = false;
+
+    const auto recordWait = [&] {
+        if (!contended)
+            return;
+        const qint64 ms = timer.elapsed();
+        m_stats.waitMsTotal += ms;
+        m_stats.waitMsMax = qMax(m_stats.waitMsMax, ms);
+    };
+
+    for (int retry = 0;; ++retry) {
+        if (attempt()) {
+            recordWait();
+            if (contended)
+                LAB2_DEBUG(lcDb()) << "BusyRetry:" << what << "succeeded after" << retry << "retries,"
+                                   << timer.elapsed() << "ms";
+            return true;
+        }
+
+        const QSqlError e = error();
+        if (!isLockError(e)) {
+            recordWait();
+            return false;
+        }
+
+        if (!contended) {
+            contended = true;
+            ++m_stats.contended;
+        }
+        // Пауза, выходящая за maxWaitMs, не начинается: окно не должно замирать дольше срока.
+        const int delay = retry < m_policy.maxRetries ? delayFor(retry) : 0;
+        if (retry >= m_policy.maxRetries || timer.elapsed() + delay > m_policy.maxWaitMs) {
+            ++m_stats.failures;
+            recordWait();
+            LAB2_WARNING(lcDb()) << "BusyRetry:" << what << "still locked after" << retry << "retries,"
+                                 << timer.elapsed() << "ms:" << e.text();
+            return false;
+        }
+
+        ++m_stats.retries;
+        m_sleep(delay);
+    }
+}
+
+QJsonObject BusyRetry::toJson() const
+{
+    QJsonObject policy;
+    policy["busy_timeout_ms"] = m_policy.busyTimeoutMs;
+    policy["max_retries"] = m_policy.maxRetries;
+    policy["base_delay_ms"] = m_policy.baseDelayMs;
+    policy["max_delay_ms"] = m_policy.maxDelayMs;
+    policy["max_wait_ms"] = m_policy.maxWaitMs;
+
+    QJsonObject o;
+    o["policy"] = policy;
+    o["operations"] = m_stats.operations;
+    o["contended"] = m_stats.contended;
+    o["retries"] = m_stats.retries;
+    o["failures"] = m_stats.failures;
+    o["wait_ms_total"] = m_stats.waitMsTotal;
+    o["wait_ms_max"] = m_stats.waitMsMax;
+    return o;
+}
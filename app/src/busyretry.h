@@ -0,0 +1,120 @@
+#ifndef BUSYRETRY_H
+#define BUSYRETRY_H
+
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QString>
+
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include <functional>
+
+/**
+ * @brief Ожидание блокировок SQLite: busy timeout соединения + повтор с экспоненциальной паузой.
+ *
+ * С файлом rectangle_data.sqlite работают несколько процессов (читатели и писатель).
+ * Без busy timeout SQLite возвращает SQLITE_BUSY ("database is locked") сразу,
+ * как только файл заблокирован другим процессом.
+ *
+ * Два уровня ожидания:
+ *  - PRAGMA busy_timeout (applyBusyTimeout()) — SQLite сам ждёт до busyTimeoutMs внутри шага;
+ *  - если блокировка не снялась, exec()/transaction()/commit() повторяют операцию до maxRetries раз
+ *    с паузой baseDelayMs * 2^k (не больше maxDelayMs), из которой случайна половина (jitter):
+ *    процессы, упёршиеся в одну блокировку, не просыпаются одновременно.
+ *
+ * Операции идут из потока окна, поэтому общее ожидание одной операции ограничено maxWaitMs:
+ * новая попытка не начинается, если пауза перед ней выходит за этот срок. Каждая попытка сама
+ * ждёт до busyTimeoutMs, так что окно замирает не дольше maxWaitMs + busyTimeoutMs; по умолчанию
+ * busy timeout короткий, а основное ожидание — паузы между попытками.
+ *
+ * Метрики (Stats): сколько операций наткнулось на блокировку, сколько было повторов и отказов,
+ * суммарное и максимальное ожидание. Ожидание считается по операциям, получившим SQLITE_BUSY
+ * хотя бы раз: от первой попытки до итога, включая ожидание внутри busy timeout.
+ * Окончательный отказ пишется в лог предупреждением с числом попыток и временем ожидания.
+ *
+ * Повторяется только SQLITE_BUSY (файл заблокирован другим соединением). SQLITE_LOCKED —
+ * конфликт внутри того же соединения (например, DROP TABLE при открытом курсоре по таблице)
+ * или общего кэша: ожидание его не снимет, поэтому ошибка возвращается сразу.
+ *
+ * @note Класс не потокобезопасен: экземпляр принадлежит одному потоку (соединению).
+ */
+class BusyRetry
+{
+public:
+    /// Параметры ожидания.
+    struct Policy
+    {
+        int busyTimeoutMs = 250;
+        int maxRetries = 5;
+        int baseDelayMs = 20;
+        int maxDelayMs = 1000;
+        /// Предел общего ожидания операции (мс), включая все попытки и паузы.
+        int maxWaitMs = 2000;
+    };
+
+    /// Метрики конкуренции за блокировку.
+    struct Stats
+    {
+        qint64 operations = 0;  ///< Все операции через exec()/transaction()/commit().
+        qint64 contended = 0;   ///< Получили SQLITE_BUSY хотя бы раз.
+        qint64 retries = 0;
+        qint64 failures = 0;    ///< Блокировка не снялась за maxRetries повторов или maxWaitMs.
+        qint64 waitMsTotal = 0;
+        qint64 waitMsMax = 0;
+    };
+
+    static constexpr const char* kEnvBusyTimeoutMs = "LAB2_DB_BUSY_TIMEOUT_MS";
+    static constexpr const char* kEnvMaxRetries = "LAB2_DB_RETRIES";
+    static constexpr const char* kEnvMaxWaitMs = "LAB2_DB_MAX_WAIT_MS";
+
+    /// Пауза перед повтором (мс); по умолчанию QThread::msleep(), тесты подменяют.
+    using Sleeper = std::function<void(int ms)>;
+
+    explicit BusyRetry(const Policy& policy = Policy());
+
+    const Policy& policy() const { return m_policy; }
+    void setPolicy(const Policy& policy) { m_policy = policy; }
+
+    /// Policy с значениями из kEnvBusyTimeoutMs / kEnvMaxRetries / kEnvMaxWaitMs (остальное — из fallback).
+    static Policy policyFromEnvironment(const Policy& fallback = Policy());
+
+    void setSleeper(Sleeper sleeper) { m_sleep = std::move(sleeper); }
+    void setRandomSeed(quint32 seed) { m_rng.seed(seed); }
+
+    /// PRAGMA busy_timeout = policy().busyTimeoutMs для открытого соединения.
+    bool applyBusyTimeout(QSqlDatabase db) const;
+
+    /// q.exec() (подготовленный запрос) с повтором при блокировке.
+    bool exec(QSqlQuery& q);
+
+    /// q.exec(sql) с повтором при блокировке.
+    bool exec(QSqlQuery& q, const QString& sql);
+
+    bool transaction(QSqlDatabase db);
+    bool commit(QSqlDatabase db);
+
+    /// SQLITE_BUSY (SQLITE_LOCKED — нет, см. описание класса).
+    static bool isLockError(const QSqlError& error);
+
+    /// Пауза перед повтором номер retry (с 0): случайная в [d/2, d], d = min(base * 2^retry, max).
+    int delayFor(int retry);
+
+    const Stats& stats() const { return m_stats; }
+    void resetStats() { m_stats = Stats(); }
+
+    /// Policy и Stats в JSON (для лога).
+    QJsonObject toJson() const;
+
+private:
+    bool run_(const char* what, const std::function<bool()>& attempt, const std::function<QSqlError()>& error);
+
+private:
+    Policy m_policy;
+    Stats m_stats;
+    Sleeper m_sleep;
+    QRandomGenerator m_rng;
+};
+
+#endif // BUSYRETRY_H
@@ -0,0 +1,132 @@
+#include "changeexporter.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include "logger.h"
+
+ChangeExporter::ChangeExporter(QSqlDatabase db)
+    : m_db(std::move(db))
+{
+}
+
+qint64 ChangeExporter::latestSeq() const
+{
+    QSqlQuery q(m_db);
+    if (!q.exec(QString("SELECT COALESCE(MAX(seq), 0) FROM %1;").arg(kChangesTable)) || !q.next())
+        return -1;
+    return q.value(0).toLongLong();
+}
+
+ChangeExporter::Result ChangeExporter::exportSince(qint64 sinceSeq, const QString& filePath) const
+{
+    Result r;
+    r.fromSeq = sinceSeq;
+    r.toSeq = sinceSeq;
+
+    const qint64 upTo = latestSeq();
+    if (upTo < 0) {
+        r.error = "change log is not available (run BD -> Create table to migrate the schema)";
+        return r;
+    }
+
+    QSaveFile out(filePath);
+    if (!out.open(QIODevice::WriteOnly)) {
+        r.error = "cannot open " + filePath + ": " + out.errorString();
+        return r;
+    }
+
+    QSqlQuery q(m_db);
+    q.setForwardOnly(true);
+    q.prepare(QString("SELECT seq, op, row_id, pencolor, penstyle, penwidth, left, top, width, height, changed_at "
+                      "FROM %1 WHERE seq > ? AND seq <= ? ORDER BY seq;").arg(kChangesTable));
+    q.addBindValue(sinceSeq);
+    q.addBindValue(upTo);
+    if (!q.exec()) {
+        r.error = "SELECT failed: " + q.lastError().text();
+        out.cancelWriting();
+        return r;
+    }
+
+    while (q.next()) {
+        QJsonObject o;
+        o["seq"] = q.value(0).toLongLong();
+        o["op"] = q.value(1).toString();
+        o["id"] = q.value(2).toLongLong();
+        if (!q.value(3).isNull()) {
+            o["pencolor"] = q.value(3).toString();
+            o["penstyle"] = q.value(4).toInt();
+            o["penwidth"] = q.value(5).toInt();
+            o["left"] = q.value(6).toInt();
+            o["top"] = q.value(7).toInt();
+            o["width"] = q.value(8).toInt();
+            o["height"] = q.value(9).toInt();
+        }
+        o["changed_at"] = q.value(10).toLongLong();
+
+        out.write(QJsonDocument(o).toJson(QJsonDocument::Compact));
+        out.write("\n");
+
+        r.toSeq = q.value(0).toLongLong();
+        ++r.changes;
+    }
+
+    if (!out.commit()) {
+        r.error = "cannot write " + filePath + ": " + out.errorString();
+        r.toSeq = sinceSeq;
+        r.changes = 0;
+        return r;
+    }
+
+    r.ok = true;
+    return r;
+}
+
+qint64 ChangeExporter::cursor(const QString& consumer) const
+{
+    QSqlQuery q(m_db);
+    q.prepare("SELECT seq FROM cdc_cursor WHERE consumer = ?;");
+    q.addBindValue(consumer);
+    if (!q.exec() || !q.next())
+        return 0;
+    return q.value(0).toLongLong();
+}
+
+bool ChangeExporter::setCursor(const QString& consumer, qint64 seq)
+{
+    QSqlQuery q(m_db);
+    q.prepare("INSERT OR REPLACE INTO cdc_cursor (consumer, seq) VALUES (?, ?);");
+    q.addBindValue(consumer);
+    q.addBindValue(seq);
+    if (!q.exec()) {
+        LAB2_WARNING(lcDb()) << "ChangeExporter: cannot save cursor" << consumer << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+ChangeExporter::Result ChangeExporter::exportIncremental(const QString& consumer, const QString& filePath)
+{
+    const qint64 since = cursor(consumer);
+
+    // Нет новых изменений — не плодим пустые файлы.
+    const qint64 latest = latestSeq();
+    if (latest >= 0 && latest <= since) {
+        Result r;
+        r.ok = true;
+        r.fromSeq = since;
+        r.toSeq = since;
+        return r;
+    }
+
+    Result r = exportSince(since, filePath);
+    if (r.ok && r.changes > 0 && !setCursor(consumer, r.toSeq)) {
+        r.ok = false;
+        r.error = "export written, but cursor was not saved";
+    }
+    return r;
+}
@@ -0,0 +1,72 @@
+#ifndef CHANGEEXPORTER_H
+#define CHANGEEXPORTER_H
+
+#include <QString>
+
+#include <QtSql/QSqlDatabase>
+
+/**
+ * @brief Инкрементальный экспорт журнала изменений таблицы rectangle.
+ *
+ * Журнал rectangle_changes ведут триггеры (миграция v2 в SchemaMigrator):
+ * каждая вставка/правка/удаление получает монотонный seq.
+ * Экспортёр выгружает в файл только изменения с seq > sinceSeq — в формате JSON Lines,
+ * по одной записи на строку:
+ *
+ *   {"seq":12,"op":"U","id":5,"pencolor":"#ff0000","penstyle":1,...,"changed_at":1760000000}
+ *
+ * op: "I" — вставка, "U" — изменение (новое состояние), "D" — удаление (последнее состояние),
+ * "X" — таблица удалена целиком (onDropTable).
+ *
+ * Для потребителей, которым не нужно помнить seq самим, есть курсоры (таблица cdc_cursor):
+ * exportIncremental() выгружает изменения после курсора и сдвигает его только после
+ * успешной записи файла.
+ */
+class ChangeExporter
+{
+public:
+    /// Результат экспорта.
+    struct Result
+    {
+        bool ok = false;
+        qint64 fromSeq = 0;  ///< Экспорт начат после этого seq.
+        qint64 toSeq = 0;    ///< Последний выгруженный seq (== fromSeq, если изменений нет).
+        qint64 changes = 0;  ///< Количество выгруженных записей.
+        QString error;
+    };
+
+    /// Таблица журнала.
+    static constexpr const char* kChangesTable = "rectangle_changes";
+
+    explicit ChangeExporter(QSqlDatabase db);
+
+    /// Последний seq в журнале (0 — журнал пуст, -1 — ошибка/журнала нет).
+    qint64 latestSeq() const;
+
+    /**
+     * @brief Выгружает изменения с seq в (sinceSeq, latestSeq()] в файл (JSON Lines).
+     *
+     * Верхняя граница фиксируется в начале, поэтому изменения, пришедшие во время экспорта,
+     * попадут в следующую выгрузку. Чтение forward-only, память не зависит от объёма журнала.
+     * Файл пишется через QSaveFile: при ошибке старое содержимое не портится.
+     */
+    Result exportSince(qint64 sinceSeq, const QString& filePath) const;
+
+    /// Курсор потребителя (0, если потребитель ещё ничего не выгружал).
+    qint64 cursor(const QString& consumer) const;
+
+    /// Сохраняет курсор потребителя.
+    bool setCursor(const QString& consumer, qint64 seq);
+
+    /**
+     * @brief exportSince(cursor(consumer)) + сдвиг курсора на toSeq после успешной записи.
+     *
+     * Если новых изменений нет, файл не создаётся (Result::changes == 0).
+     */
+    Result exportIncremental(const QString& consumer, const QString& filePath);
+
+private:
+    QSqlDatabase m_db;
+};
+
+#endif // CHANGEEXPORTER_H
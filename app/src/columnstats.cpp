@@ -0,0 +1,404 @@
+#include "columnstats.h"
+
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlRecord>
+#include <QtSql/QSqlTableModel>
+
+#include <limits>
+
+#include "logger.h"
+#include "parallelscanner.h"
+#include "penpalette.h"
+#include "rectangleschema.h"
+#include "rectrowdecoder.h"
+
+static_assert(rectschema::Area - rectschema::PenWidth + 1 == ColumnStats::NumericCount,
+              "ColumnStats numeric columns must follow rectschema order from penwidth to area");
+
+namespace {
+
+int floorLog2(quint64 v)
+{
+    return 63 - qCountLeadingZeroBits(v);
+}
+
+/// Модуль без переполнения на INT64_MIN.
+quint64 magnitude(qint64 v)
+{
+    return v < 0 ? quint64(0) - quint64(v) : quint64(v);
+}
+
+} // namespace
+
+// ---- ColumnStats::Numeric ----
+
+void ColumnStats::Numeric::add(qint64 v)
+{
+    if (count == 0) {
+        min = max = v;
+        minCount = maxCount = 1;
+        minStale = maxStale = false;
+    } else {
+        // Устаревшая граница — строгая оценка: все строки лежат за ней,
+        // поэтому значение не дальше неё — точный новый экстремум.
+        if (minStale ? v <= min : v < min) {
+            min = v;
+            minCount = 1;
+            minStale = false;
+        } else if (!minStale && v == min) {
+            ++minCount;
+        }
+        if (maxStale ? v >= max : v > max) {
+            max = v;
+            maxCount = 1;
+            maxStale = false;
+        } else if (!maxStale && v == max) {
+            ++maxCount;
+        }
+    }
+    ++count;
+    sum += v;
+    ++bins[binOf(v)];
+}
+
+void ColumnStats::Numeric::remove(qint64 v)
+{
+    if (count <= 0)
+        return;
+
+    --count;
+    sum -= v;
+    --bins[binOf(v)];
+
+    if (count == 0) {
+        min = max = 0;
+        minCount = maxCount = 0;
+        minStale = maxStale = false;
+        return;
+    }
+    if (!minStale && v == min && --minCount == 0)
+        minStale = true;
+    if (!maxStale && v == max && --maxCount == 0)
+        maxStale = true;
+}
+
+void ColumnStats::Numeric::merge(const Numeric& o)
+{
+    if (o.count == 0) return;
+    if (count == 0) {
+        *this = o;
+        return;
+    }
+
+    // Граница — ближняя из двух; точна, если её даёт хотя бы одна неустаревшая сторона.
+    const qint64 lo = qMin(min, o.min);
+    const qint64 loCount = (!minStale && min == lo ? minCount : 0) + (!o.minStale && o.min == lo ? o.minCount : 0);
+    min = lo;
+    minCount = loCount;
+    minStale = loCount == 0;
+
+    const qint64 hi = qMax(max, o.max);
+    const qint64 hiCount = (!maxStale && max == hi ? maxCount : 0) + (!o.maxStale && o.max == hi ? o.maxCount : 0);
+    max = hi;
+    maxCount = hiCount;
+    maxStale = hiCount == 0;
+
+    count += o.count;
+    sum += o.sum;
+    for (int b = 0; b < kBins; ++b)
+        bins[b] += o.bins[b];
+}
+
+// ---- ColumnStats ----
+
+void ColumnStats::add(const MyRect& r)
+{
+    const auto v = values(r);
+    for (int c = 0; c < NumericCount; ++c)
+        m_numeric[c].add(v[c]);
+    ++m_colors[r.penColor.rgb()];
+    ++m_styles[int(r.penStyle)];
+    ++m_rows;
+}
+
+void ColumnStats::remove(const MyRect& r)
+{
+    if (m_rows <= 0) return;
+
+    const auto v = values(r);
+    for (int c = 0; c < NumericCount; ++c)
+        m_numeric[c].remove(v[c]);
+
+    const QRgb rgb = r.penColor.rgb();
+    if (--m_colors[rgb] <= 0)
+        m_colors.remove(rgb);
+    if (--m_styles[int(r.penStyle)] <= 0)
+        m_styles.remove(int(r.penStyle));
+    --m_rows;
+}
+
+void ColumnStats::merge(const ColumnStats& o)
+{
+    for (int c = 0; c < NumericCount; ++c)
+        m_numeric[c].merge(o.m_numeric[c]);
+    for (auto it = o.m_colors.cbegin(); it != o.m_colors.cend(); ++it)
+        m_colors[it.key()] += it.value();
+    for (auto it = o.m_styles.cbegin(); it != o.m_styles.cend(); ++it)
+        m_styles[it.key()] += it.value();
+    m_rows += o.m_rows;
+}
+
+bool ColumnStats::hasStaleExtremes() const
+{
+    for (const Numeric& n : m_numeric) {
+        if (n.isStale())
+            return true;
+    }
+    return false;
+}
+
+bool ColumnStats::refreshExtremes(QSqlDatabase db, const QString& table, QString* error)
+{
+    QSqlQuery q(db);
+
+    // Значение границы и число строк с ним одним запросом.
+    auto fetch = [&](int column, const char* aggregate, qint64* value, qint64* rows) {
+        const QString col = columnName(column);
+        const QString sql = QString("SELECT MIN(\"%1\"), COUNT(*) FROM %2 WHERE \"%1\" = (SELECT %3(\"%1\") FROM %2);")
+                .arg(col, table, aggregate);
+        if (!q.exec(sql) || !q.next()) {
+            if (error) *error = q.lastError().text();
+            LAB2_WARNING(lcDb()) << "ColumnStats: refresh failed:" << col << q.lastError().text();
+            return false;
+        }
+        *value = q.value(0).toLongLong();
+        *rows = q.value(1).toLongLong();
+        return true;
+    };
+
+    for (int c = 0; c < NumericCount; ++c) {
+        Numeric& n = m_numeric[c];
+        if (n.minStale) {
+            if (!fetch(c, "MIN", &n.min, &n.minCount)) return false;
+            n.minStale = false;
+        }
+        if (n.maxStale) {
+            if (!fetch(c, "MAX", &n.max, &n.maxCount)) return false;
+            n.maxStale = false;
+        }
+    }
+    return true;
+}
+
+const char* ColumnStats::columnName(int column)
+{
+    return rectschema::kColumns[rectschema::PenWidth + column].name;
+}
+
+int ColumnStats::binOf(qint64 v)
+{
+    if (v == 0) return kZeroBin;
+    if (v > 0) return kZeroBin + 1 + floorLog2(quint64(v));
+    return kZeroBin - 1 - floorLog2(magnitude(v));
+}
+
+qint64 ColumnStats::binLow(int bin)
+{
+    if (bin == kZeroBin) return 0;
+    if (bin > kZeroBin) return qint64(1) << (bin - kZeroBin - 1);
+    const int k = kZeroBin - 1 - bin;
+    return k == 63 ? std::numeric_limits<qint64>::min() : -((qint64(1) << (k + 1)) - 1);
+}
+
+qint64 ColumnStats::binHigh(int bin)
+{
+    if (bin == kZeroBin) return 0;
+    if (bin < kZeroBin) {
+        const int k = kZeroBin - 1 - bin;
+        return k == 63 ? std::numeric_limits<qint64>::min() : -(qint64(1) << k);
+    }
+    const int k = bin - kZeroBin - 1;
+    return k == 62 ? std::numeric_limits<qint64>::max() : (qint64(1) << (k + 1)) - 1;
+}
+
+std::array<qint64, ColumnStats::NumericCount> ColumnStats::values(const MyRect& r)
+{
+    return { r.penWidth,
+             r.left,
+             r.top,
+             r.width,
+             r.height,
+             qint64(r.left) + r.width,
+             qint64(r.top) + r.height,
+             qint64(r.width) * r.height };
+}
+
+// ---- ColumnStatsTracker ----
+
+ColumnStatsTracker::ColumnStatsTracker(QSqlDatabase db, const QString& table, QObject* parent)
+    : QObject(parent)
+    , m_db(db)
+    , m_table(table)
+{
+}
+
+void ColumnStatsTracker::setDatabase(QSqlDatabase db)
+{
+    m_db = db;
+    m_stats.clear();
+    m_initialized = false;
+    m_updates = 0;
+    emit changed();
+}
+
+void ColumnStatsTracker::clear()
+{
+    m_stats.clear();
+    m_updates = 0;
+    emit changed();
+}
+
+void ColumnStatsTracker::addRows(const ColumnStats& rows)
+{
+    if (!m_initialized || rows.rows() == 0) return;
+
+    m_stats.merge(rows);
+    m_updates += quint64(rows.rows());
+    emit changed();
+}
+
+void ColumnStatsTracker::attach(QSqlTableModel* model)
+{
+    if (!model) return;
+
+    // Модель может переключаться между таблицами (Model -> Select table): имя проверяется на каждой правке.
+    connect(model, &QSqlTableModel::beforeInsert, this, [this, model](QSqlRecord& record) {
+        if (model->tableName() == m_table) onBeforeInsert_(record);
+    });
+    connect(model, &QSqlTableModel::beforeUpdate, this, [this, model](int row, QSqlRecord& record) {
+        if (model->tableName() == m_table) onBeforeUpdate_(model, row, record);
+    });
+    connect(model, &QSqlTableModel::beforeDelete, this, [this, model](int row) {
+        if (model->tableName() == m_table) onBeforeDelete_(model, row);
+    });
+}
+
+bool ColumnStatsTracker::rescan(const QString& dbPath, QString* error)
+{
+    ParallelScanner scanner(dbPath);
+    ColumnStats stats;
+    const bool ok = scanner.aggregate(stats,
+                                      [](ColumnStats& acc, const RectRow& row) { acc.add(row.rect); },
+                                      [](ColumnStats& acc, const ColumnStats& part) { acc.merge(part); });
+    if (!ok) {
+        if (error) *error = scanner.lastError();
+        LAB2_WARNING(lcPerf()) << "ColumnStatsTracker: scan failed:" << scanner.lastError();
+        return false;
+    }
+
+    m_stats = stats;
+    m_initialized = true;
+    m_updates = 0;
+    LAB2_INFO(lcPerf()) << "ColumnStatsTracker: scanned" << scanner.rowsScanned() << "rows in"
+                        << scanner.partitionCount() << "partitions";
+    emit changed();
+    return true;
+}
+
+bool ColumnStatsTracker::refreshExtremes(QString* error)
+{
+    if (!m_stats.hasStaleExtremes())
+        return true;
+    return m_stats.refreshExtremes(m_db, m_table, error);
+}
+
+void ColumnStatsTracker::onBeforeInsert_(QSqlRecord& record)
+{
+    if (!m_initialized) return;
+
+    m_stats.add(fromRecord_(record));
+    ++m_updates;
+    emit changed();
+}
+
+void ColumnStatsTracker::onBeforeUpdate_(QSqlTableModel* model, int row, QSqlRecord& record)
+{
+    if (!m_initialized) return;
+
+    MyRect before;
+    if (!loadRow_(model->record(row).value(rectschema::kColumns[rectschema::Id].name), &before))
+        return;
+
+    // В record отмечены (isGenerated) только изменённые поля — остальные берём из старой строки.
+    MyRect after = before;
+    const MyRect changedValues = fromRecord_(record);
+    auto isChanged = [&record](rectschema::Column c) {
+        const int i = record.indexOf(rectschema::kColumns[c].name);
+        return i >= 0 && record.isGenerated(i);
+    };
+    if (isChanged(rectschema::PenColor)) after.penColor = changedValues.penColor;
+    if (isChanged(rectschema::PenStyle)) after.penStyle = changedValues.penStyle;
+    if (isChanged(rectschema::PenWidth)) after.penWidth = changedValues.penWidth;
+    if (isChanged(rectschema::Left)) after.left = changedValues.left;
+    if (isChanged(rectschema::Top)) after.top = changedValues.top;
+    if (isChanged(rectschema::Width)) after.width = changedValues.width;
+    if (isChanged(rectschema::Height)) after.height = changedValues.height;
+
+    m_stats.remove(before);
+    m_stats.add(after);
+    ++m_updates;
+    emit changed();
+}
+
+void ColumnStatsTracker::onBeforeDelete_(QSqlTableModel* model, int row)
+{
+    if (!m_initialized) return;
+
+    MyRect before;
+    if (!loadRow_(model->record(row).value(rectschema::kColumns[rectschema::Id].name), &before))
+        return;
+
+    m_stats.remove(before);
+    ++m_updates;
+    emit changed();
+}
+
+MyRect ColumnStatsTracker::fromRecord_(const QSqlRecord& record) const
+{
+    // Поле, не попавшее в INSERT, остаётся NULL — скан читает его как 0 (и цвет как неизвестный id).
+    auto value = [&record](rectschema::Column c) {
+        const int i = record.indexOf(rectschema::kColumns[c].name);
+        return i >= 0 && record.isGenerated(i) ? record.value(i).toInt() : 0;
+    };
+
+    MyRect r;
+    r.penColor = m_palette ? m_palette->color(value(rectschema::PenColor)) : QColor();
+    r.penStyle = static_cast<Qt::PenStyle>(value(rectschema::PenStyle));
+    r.penWidth = value(rectschema::PenWidth);
+    r.left = value(rectschema::Left);
+    r.top = value(rectschema::Top);
+    r.width = value(rectschema::Width);
+    r.height = value(rectschema::Height);
+    return r;
+}
+
+bool ColumnStatsTracker::loadRow_(const QVariant& id, MyRect* out) const
+{
+    QSqlQuery q(m_db);
+    q.prepare(QString(rectschema::kSelectValuesSql) + " WHERE id = ?;");
+    q.addBindValue(id);
+    if (!q.exec()) {
+        LAB2_WARNING(lcModel()) << "ColumnStatsTracker: cannot read row" << id << q.lastError().text();
+        return false;
+    }
+    if (!q.next()) {
+        LAB2_DEBUG(lcModel()) << "ColumnStatsTracker: row" << id << "not found";
+        return false;
+    }
+
+    // Цвет — через словарь, а не таблицу цветов декодера: color() перечитает словарь для нового id.
+    *out = RectRowDecoder().decode(q).rect;
+    out->penColor = m_palette ? m_palette->color(q.value(rectschema::PenColor).toInt()) : QColor();
+    return true;
+}
@@ -0,0 +1,201 @@
+#ifndef COLUMNSTATS_H
+#define COLUMNSTATS_H
+
+#include <QColor>
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+#include <QtSql/QSqlDatabase>
+
+#include <array>
+
+#include "myrect.h"
+#include "rectangleschema.h"
+
+class PenPalette;
+class QSqlRecord;
+class QSqlTableModel;
+
+/**
+ * @brief Сводка по колонкам таблицы rectangle: count/min/max/mean и гистограммы числовых колонок,
+ *        частоты цветов и стилей пера.
+ *
+ * Считается один раз полным сканом (add() + merge() — подходит для ParallelScanner::aggregate()),
+ * дальше поддерживается инкрементально: вставка — add(), удаление — remove(), правка — remove(старая)
+ * + add(новая). Пересчитывать агрегаты SQL по всей таблице на каждую правку не нужно.
+ *
+ * Гистограммы — логарифмические корзины (0, ±[2^k, 2^(k+1))): раскладка корзин не зависит
+ * от данных, поэтому частичные сводки складываются без пересчёта, а вставки не требуют перестройки.
+ *
+ * min/max при удалении: для каждого экстремума хранится число строк с этим значением.
+ * Если удалена последняя такая строка, экстремум помечается устаревшим (isStale()) и
+ * уточняется refreshExtremes() — запросом MIN/MAX только по устаревшим колонкам.
+ * Вставка значения за старой границей снимает пометку сама: такое значение — точный новый экстремум.
+ */
+class ColumnStats
+{
+public:
+    /// Числовые колонки сводки (right/bottom/area — вычисляемые колонки схемы v3).
+    enum NumericColumn { PenWidth, Left, Top, Width, Height, Right, Bottom, Area, NumericCount };
+
+    /// Корзин гистограммы: 64 отрицательных, ноль, 63 положительных (весь диапазон qint64).
+    static constexpr int kBins = 128;
+    /// Корзина значения 0.
+    static constexpr int kZeroBin = 64;
+
+    /// Сводка одной числовой колонки.
+    struct Numeric
+    {
+        qint64 count = 0;
+        qint64 sum = 0;
+        qint64 min = 0;
+        qint64 max = 0;
+        /// Число строк со значением min/max (для удаления без пересчёта).
+        qint64 minCount = 0;
+        qint64 maxCount = 0;
+        /// Экстремум удалён, новое значение неизвестно (см. ColumnStats::refreshExtremes()).
+        bool minStale = false;
+        bool maxStale = false;
+        std::array<qint64, kBins> bins {};
+
+        void add(qint64 v);
+        void remove(qint64 v);
+        void merge(const Numeric& o);
+
+        double mean() const { return count ? double(sum) / double(count) : 0.0; }
+        bool isStale() const { return minStale || maxStale; }
+    };
+
+    void add(const MyRect& r);
+    void remove(const MyRect& r);
+
+    /// Добавляет сводку другой части скана.
+    void merge(const ColumnStats& o);
+
+    /// Сбрасывает сводку (пустая таблица).
+    void clear() { *this = ColumnStats(); }
+
+    qint64 rows() const { return m_rows; }
+
+    const Numeric& numeric(int column) const { return m_numeric[column]; }
+
+    /// Частоты цветов (QRgb) и стилей пера.
+    const QHash<QRgb, qint64>& colors() const { return m_colors; }
+    const QHash<int, qint64>& styles() const { return m_styles; }
+
+    /// Есть колонки с устаревшим min/max?
+    bool hasStaleExtremes() const;
+
+    /**
+     * @brief Уточняет устаревшие min/max запросами к table (по одному на устаревший экстремум).
+     *
+     * Для right/bottom/area есть индексы (схема v3) — запрос быстрый; для остальных колонок
+     * это полный проход, но он нужен только после удаления последней строки-экстремума.
+     * @return false при ошибке запроса (экстремум остаётся устаревшим).
+     */
+    bool refreshExtremes(QSqlDatabase db, const QString& table, QString* error = nullptr);
+
+    /// Имя колонки в таблице rectangle.
+    static const char* columnName(int column);
+
+    /// Корзина гистограммы для значения v.
+    static int binOf(qint64 v);
+    /// Границы корзины bin (включительно).
+    static qint64 binLow(int bin);
+    static qint64 binHigh(int bin);
+
+    /// Значения числовых колонок прямоугольника в порядке NumericColumn.
+    static std::array<qint64, NumericCount> values(const MyRect& r);
+
+private:
+    qint64 m_rows = 0;
+    std::array<Numeric, NumericCount> m_numeric {};
+    QHash<QRgb, qint64> m_colors;
+    QHash<int, qint64> m_styles;
+};
+
+/**
+ * @brief Поддерживает ColumnStats по правкам моделей таблицы (Model -> Column statistics).
+ *
+ * Подписывается на beforeInsert/beforeUpdate/beforeDelete моделей (attach()). Старое состояние
+ * изменяемой или удаляемой строки читается из БД по id (поиск по первичному ключу) через
+ * соединение модели — с учётом незафиксированных правок GroupCommitter.
+ *
+ * Полный скан (rescan()) — ParallelScanner по файлу БД. Строки, вставленные в обход моделей
+ * (Insert into, импорт), добавляются addRows() по сводке вставленных строк; rescan() нужен
+ * только после изменений, о которых сводка ничего не знает (миграция, сбой посреди вставки).
+ *
+ * @note Сигналы моделей приходят до выполнения SQL: если запись затем не удалась,
+ *       сводка расходится с таблицей до следующего rescan().
+ */
+class ColumnStatsTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param db Соединение, через которое работают модели (для чтения старых строк).
+     * @param table Отслеживаемая таблица (правки моделей других таблиц игнорируются).
+     */
+    explicit ColumnStatsTracker(QSqlDatabase db = QSqlDatabase(), const QString& table = rectschema::kTable,
+                                QObject* parent = nullptr);
+
+    /// Переключает трекер на другое соединение (сводка сбрасывается до следующего rescan()).
+    void setDatabase(QSqlDatabase db);
+
+    /// Словарь цветов для колонки pen_id (владение не передаётся).
+    void setPalette(PenPalette* palette) { m_palette = palette; }
+
+    /// Подписывается на правки модели.
+    void attach(QSqlTableModel* model);
+
+    /// Полный параллельный скан файла dbPath. @return false при ошибке (сводка не меняется).
+    bool rescan(const QString& dbPath, QString* error = nullptr);
+
+    /// Таблица опустела целиком (DROP TABLE): сводка обнуляется без скана.
+    void clear();
+
+    /// Добавляет строки, вставленные в обход моделей (их сводку). До первого rescan() ничего не делает.
+    void addRows(const ColumnStats& rows);
+
+    /// Сводка инициализирована сканом?
+    bool isInitialized() const { return m_initialized; }
+
+    const ColumnStats& stats() const { return m_stats; }
+
+    /**
+     * @brief Уточняет устаревшие min/max (см. ColumnStats::refreshExtremes()).
+     *
+     * Вызывается при показе сводки, а не на каждой правке: несколько удалений подряд
+     * обходятся одним запросом. changed() не испускается.
+     */
+    bool refreshExtremes(QString* error = nullptr);
+
+    /// Правок применено с последнего rescan().
+    quint64 updatesApplied() const { return m_updates; }
+
+signals:
+    /// Сводка изменилась (скан или правка).
+    void changed();
+
+private:
+    void onBeforeInsert_(QSqlRecord& record);
+    void onBeforeUpdate_(QSqlTableModel* model, int row, QSqlRecord& record);
+    void onBeforeDelete_(QSqlTableModel* model, int row);
+
+    /// Прямоугольник из записи модели (цвет — через словарь для pen_id).
+    MyRect fromRecord_(const QSqlRecord& record) const;
+    /// Текущая строка таблицы по id.
+    bool loadRow_(const QVariant& id, MyRect* out) const;
+
+private:
+    QSqlDatabase m_db;
+    QString m_table;
+    PenPalette* m_palette = nullptr;
+    ColumnStats m_stats;
+    bool m_initialized = false;
+    quint64 m_updates = 0;
+};
+
+#endif // COLUMNSTATS_H
@@ -0,0 +1,133 @@
+#include "columnstatspanel.h"
+
+#include <QHeaderView>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+#include "columnstats.h"
+#include "logger.h"
+#include "mydelegate.h"
+
+namespace {
+
+enum TreeColumn { NameColumn, CountColumn, MinColumn, MaxColumn, MeanColumn, TreeColumnCount };
+
+/// Удаляет дочерние узлы item.
+void clearChildren(QTreeWidgetItem* item)
+{
+    qDeleteAll(item->takeChildren());
+}
+
+/// Частоты по убыванию (при равенстве — по ключу, чтобы порядок не прыгал).
+template <typename Key>
+QVector<QPair<Key, qint64>> byFrequency(const QHash<Key, qint64>& freq)
+{
+    QVector<QPair<Key, qint64>> items;
+    items.reserve(freq.size());
+    for (auto it = freq.cbegin(); it != freq.cend(); ++it)
+        items.append(qMakePair(it.key(), it.value()));
+    std::sort(items.begin(), items.end(), [](const QPair<Key, qint64>& a, const QPair<Key, qint64>& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    return items;
+}
+
+QString percent(qint64 part, qint64 total)
+{
+    return total ? QString("%1%").arg(100.0 * double(part) / double(total), 0, 'f', 1) : QString();
+}
+
+} // namespace
+
+ColumnStatsPanel::ColumnStatsPanel(ColumnStatsTracker* tracker, QWidget* parent)
+    : QWidget(parent)
+    , m_tracker(tracker)
+{
+    m_tree = new QTreeWidget(this);
+    m_tree->setObjectName("columnStatsTree");
+    m_tree->setColumnCount(TreeColumnCount);
+    m_tree->setHeaderLabels({ "Column", "Count", "Min", "Max", "Mean / share" });
+    m_tree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_tree->setUniformRowHeights(true);
+
+    for (int c = 0; c < ColumnStats::NumericCount; ++c)
+        m_numericItems << new QTreeWidgetItem(m_tree, QStringList(ColumnStats::columnName(c)));
+    m_colorsItem = new QTreeWidgetItem(m_tree, QStringList("pen color"));
+    m_stylesItem = new QTreeWidgetItem(m_tree, QStringList("pen style"));
+
+    auto* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(m_tree);
+
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    m_timer->setInterval(kRefreshMs);
+    connect(m_timer, &QTimer::timeout, this, &ColumnStatsPanel::refresh);
+
+    if (m_tracker)
+        connect(m_tracker, &ColumnStatsTracker::changed, this, &ColumnStatsPanel::scheduleRefresh_);
+    refresh();
+}
+
+void ColumnStatsPanel::scheduleRefresh_()
+{
+    if (!m_timer->isActive())
+        m_timer->start();
+}
+
+void ColumnStatsPanel::refresh()
+{
+    m_timer->stop();
+    if (!m_tracker) return;
+
+    QString error;
+    if (!m_tracker->refreshExtremes(&error))
+        LAB2_WARNING(lcModel()) << "ColumnStatsPanel: cannot refresh min/max:" << error;
+
+    const ColumnStats& st = m_tracker->stats();
+    const bool known = m_tracker->isInitialized();
+
+    for (int c = 0; c < ColumnStats::NumericCount; ++c) {
+        const ColumnStats::Numeric& n = st.numeric(c);
+        QTreeWidgetItem* item = m_numericItems.at(c);
+        clearChildren(item);
+
+        item->setText(CountColumn, known ? QString::number(n.count) : QString());
+        item->setText(MinColumn, known && n.count ? (n.minStale ? ">" : "") + QString::number(n.min) : QString());
+        item->setText(MaxColumn, known && n.count ? (n.maxStale ? "<" : "") + QString::number(n.max) : QString());
+        item->setText(MeanColumn, known && n.count ? QString::number(n.mean(), 'f', 2) : QString());
+
+        for (int b = 0; b < ColumnStats::kBins; ++b) {
+            if (n.bins[b] == 0) continue;
+            const qint64 lo = ColumnStats::binLow(b);
+            const qint64 hi = ColumnStats::binHigh(b);
+            auto* bin = new QTreeWidgetItem(item);
+            bin->setText(NameColumn, lo == hi ? QString::number(lo) : QString("%1 .. %2").arg(lo).arg(hi));
+            bin->setText(CountColumn, QString::number(n.bins[b]));
+            bin->setText(MeanColumn, percent(n.bins[b], n.count));
+        }
+    }
+
+    clearChildren(m_colorsItem);
+    m_colorsItem->setText(CountColumn, known ? QString::number(st.colors().size()) : QString());
+    for (const auto& c : byFrequency(st.colors())) {
+        const QColor color = QColor::fromRgb(c.first);
+        auto* item = new QTreeWidgetItem(m_colorsItem);
+        item->setText(NameColumn, color.name());
+        item->setData(NameColumn, Qt::DecorationRole, color);
+        item->setText(CountColumn, QString::number(c.second));
+        item->setText(MeanColumn, percent(c.second, st.rows()));
+    }
+
+    clearChildren(m_stylesItem);
+    m_stylesItem->setText(CountColumn, known ? QString::number(st.styles().size()) : QString());
+    for (const auto& s : byFrequency(st.styles())) {
+        auto* item = new QTreeWidgetItem(m_stylesItem);
+        item->setText(NameColumn, MyDelegate::penStyleToText(s.first));
+        item->setText(CountColumn, QString::number(s.second));
+        item->setText(MeanColumn, percent(s.second, st.rows()));
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef COLUMNSTATSPANEL_H
+#define COLUMNSTATSPANEL_H
+
+#include <QWidget>
+
+class ColumnStatsTracker;
+class QTimer;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+/**
+ * @brief Панель сводки по колонкам (Model -> Column statistics).
+ *
+ * Дерево: числовые колонки (count/min/max/mean, внутри — непустые корзины гистограммы),
+ * затем частоты цветов и стилей пера. Данные — из ColumnStatsTracker.
+ *
+ * Перерисовка по ColumnStatsTracker::changed() откладывается на kRefreshMs: пачка правок
+ * (submitAll(), вставка строк подряд) даёт одну перестройку дерева. Устаревшие min/max
+ * уточняются там же, перед показом.
+ */
+class ColumnStatsPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    /// Задержка перерисовки после изменения сводки (мс).
+    static constexpr int kRefreshMs = 200;
+
+    explicit ColumnStatsPanel(ColumnStatsTracker* tracker, QWidget* parent = nullptr);
+
+    /// Дерево сводки (для тестов и сохранения состояния раскрытия).
+    QTreeWidget* tree() const { return m_tree; }
+
+public slots:
+    /// Перестраивает дерево сейчас (без задержки).
+    void refresh();
+
+private:
+    void scheduleRefresh_();
+
+private:
+    ColumnStatsTracker* m_tracker = nullptr;
+    QTreeWidget* m_tree = nullptr;
+    QTimer* m_timer = nullptr;
+    /// Узлы верхнего уровня: числовые колонки, цвета, стили (раскрытие сохраняется между перерисовками).
+    QList<QTreeWidgetItem*> m_numericItems;
+    QTreeWidgetItem* m_colorsItem = nullptr;
+    QTreeWidgetItem* m_stylesItem = nullptr;
+};
+
+#endif // COLUMNSTATSPANEL_H
@@ -0,0 +1,77 @@
+// lab2_dbdiff: сравнение таблиц rectangle двух файлов БД (проверка реплик и резервных копий).
+//
+//   lab2_dbdiff [--summary] [--threads N] base.sqlite other.sqlite
+//
+// Вывод: "+ <строка>" — есть только в other, "- <строка>" — только в base,
+// "~ <id>" и пара строк "-"/"+" — изменённая строка. Итог — в stderr.
+// Код возврата как у diff: 0 — одинаковые, 1 — есть отличия, 2 — ошибка.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+#include "mydelegate.h"
+#include "rectdiff.h"
+
+namespace {
+
+QString formatRow(const RectRow& r)
+{
+    return QString("%1 %2 %3 %4 %5 %6 %7 %8")
+            .arg(r.id)
+            .arg(r.rect.penColor.isValid() ? r.rect.penColor.name() : QString("-"))
+            .arg(MyDelegate::penStyleToText(int(r.rect.penStyle)))
+            .arg(r.rect.penWidth)
+            .arg(r.rect.left)
+            .arg(r.rect.top)
+            .arg(r.rect.width)
+            .arg(r.rect.height);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("lab2_dbdiff");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares the rectangle tables of two database files.");
+    parser.addHelpOption();
+    const QCommandLineOption summaryOption("summary", "Print only the counts.");
+    const QCommandLineOption threadsOption("threads", "Worker threads (0 = number of cores).", "N", "0");
+    parser.addOption(summaryOption);
+    parser.addOption(threadsOption);
+    parser.addPositionalArgument("base", "Base database file (deleted rows come from it).");
+    parser.addPositionalArgument("other", "Database file to compare (inserted rows come from it).");
+    parser.process(app);
+
+    const QStringList files = parser.positionalArguments();
+    QTextStream err(stderr);
+    if (files.size() != 2) {
+        err << parser.helpText();
+        return 2;
+    }
+
+    RectDiff diff(files.at(0), files.at(1), parser.value(threadsOption).toInt());
+    const RectDiff::Result res = diff.run();
+    if (!res.ok) {
+        err << "lab2_dbdiff: " << res.error << "\n";
+        return 2;
+    }
+
+    if (!parser.isSet(summaryOption)) {
+        QTextStream out(stdout);
+        for (const RectRow& r : res.deleted)
+            out << "- " << formatRow(r) << "\n";
+        for (const RectRow& r : res.inserted)
+            out << "+ " << formatRow(r) << "\n";
+        for (const RectDiff::Modified& m : res.modified)
+            out << "~ " << m.before.id << "\n  - " << formatRow(m.before) << "\n  + " << formatRow(m.after) << "\n";
+    }
+
+    err << QString("inserted %1, deleted %2, modified %3 (levels %4, ranges %5, rows compared %6, %7 ms)\n")
+           .arg(res.inserted.size()).arg(res.deleted.size()).arg(res.modified.size())
+           .arg(res.levels).arg(res.rangesHashed).arg(res.rowsCompared).arg(res.elapsedMs);
+    return res.identical() ? 0 : 1;
+}
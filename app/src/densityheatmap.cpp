@@ -0,0 +1,246 @@
+#include "densityheatmap.h"
+
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QThread>
+
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "logger.h"
+#include "rectsnapshot.h"
+
+namespace {
+
+/// Меньше стольких строк на часть — отдельный поток не окупается.
+constexpr qint64 kMinRowsPerPart = 64 * 1024;
+
+/// Запускает fn(0..n-1) параллельно и ждёт все задачи.
+template <typename Fn>
+void runParallel(int n, Fn fn)
+{
+    QVector<QFuture<void>> futures;
+    futures.reserve(n);
+    for (int i = 0; i < n; ++i)
+        futures.append(QtConcurrent::run([fn, i] { fn(i); }));
+    for (QFuture<void>& f : futures)
+        f.waitForFinished();
+}
+
+/// Граница i-й из n равных частей отрезка [0, total).
+qint64 boundary(qint64 total, int n, int i)
+{
+    return total * i / n;
+}
+
+double msSince(const QElapsedTimer& t)
+{
+    return double(t.nsecsElapsed()) / 1e6;
+}
+
+} // namespace
+
+DensityHeatmap::Columns DensityHeatmap::columnsOf(const RectSnapshot& snapshot)
+{
+    Columns c;
+    if (!snapshot.isOpen()) return c;
+    c.left = snapshot.intColumn(RectSnapshot::Left);
+    c.top = snapshot.intColumn(RectSnapshot::Top);
+    c.width = snapshot.intColumn(RectSnapshot::Width);
+    c.height = snapshot.intColumn(RectSnapshot::Height);
+    c.count = snapshot.rowCount();
+    return c;
+}
+
+DensityHeatmap::DensityHeatmap(int threads)
+    : m_threads(threads > 0 ? threads : qMax(1, QThread::idealThreadCount()))
+{
+    for (int i = 0; i < int(m_palette.size()); ++i)
+        m_palette[i] = colorAt(double(i) / double(m_palette.size() - 1));
+}
+
+bool DensityHeatmap::render(const Columns& columns, const QRectF& world, const QSize& size)
+{
+    if (size.isEmpty() || !(world.width() > 0) || !(world.height() > 0))
+        return false;
+
+    const int w = size.width();
+    const int h = size.height();
+    m_size = size;
+    m_world = world;
+    m_stride = w + 1;
+    const qint64 cells = qint64(h + 1) * m_stride;
+
+    const int parts = int(qBound<qint64>(1, columns.count / kMinRowsPerPart, m_threads));
+    m_grids.resize(parts);
+    if (m_image.size() != size)
+        m_image = QImage(size, QImage::Format_ARGB32);
+
+    // Указатели берём до запуска потоков: QVector/QImage не должны отсоединяться в рабочих потоках.
+    QVector<qint32*> grids(parts);
+    for (int p = 0; p < parts; ++p) {
+        m_grids[p].resize(int(cells));
+        grids[p] = m_grids[p].data();
+    }
+    uchar* const bits = m_image.bits();
+    const qint64 bytesPerLine = m_image.bytesPerLine();
+    const int stride = m_stride;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 1. Части строк таблицы -> свои сетки разностей.
+    const double sx = w / world.width();
+    const double sy = h / world.height();
+    const double wl = world.left();
+    const double wt = world.top();
+    QVector<qint64> visible(parts, 0);
+    qint64* const visibleOut = visible.data();
+
+    runParallel(parts, [=](int p) {
+        qint32* g = grids[p];
+        std::fill(g, g + cells, 0);
+
+        const qint64 begin = boundary(columns.count, parts, p);
+        const qint64 end = boundary(columns.count, parts, p + 1);
+        qint64 n = 0;
+        for (qint64 i = begin; i < end; ++i) {
+            const double l = (columns.left[i] - wl) * sx;
+            const double r = (double(columns.left[i]) + columns.width[i] - wl) * sx;
+            const double t = (columns.top[i] - wt) * sy;
+            const double b = (double(columns.top[i]) + columns.height[i] - wt) * sy;
+            // Правый/нижний край не входит; вырожденный прямоугольник на краю области виден.
+            if (l >= w || t >= h || r < 0 || b < 0 || (r == 0 && l < 0) || (b == 0 && t < 0))
+                continue;
+
+            const int x0 = l < 0 ? 0 : int(l);
+            const int y0 = t < 0 ? 0 : int(t);
+            const int x1 = r >= w ? w : qMax(x0 + 1, int(std::ceil(r)));
+            const int y1 = b >= h ? h : qMax(y0 + 1, int(std::ceil(b)));
+
+            g[qint64(y0) * stride + x0] += 1;
+            g[qint64(y0) * stride + x1] -= 1;
+            g[qint64(y1) * stride + x0] -= 1;
+            g[qint64(y1) * stride + x1] += 1;
+            ++n;
+        }
+        visibleOut[p] = n;
+    });
+    m_timing.rasterMs = msSince(timer);
+    timer.restart();
+
+    m_visibleRows = 0;
+    for (qint64 n : visible)
+        m_visibleRows += n;
+
+    // 2. Полосы строк: сумма сеток частей + префиксная сумма по строке.
+    const int bands = qMin(h, m_threads);
+    runParallel(bands, [=](int band) {
+        const int yEnd = int(boundary(h, bands, band + 1));
+        for (int y = int(boundary(h, bands, band)); y < yEnd; ++y) {
+            qint32* row = grids[0] + qint64(y) * stride;
+            for (int p = 1; p < parts; ++p)
+                spanAdd(row, grids[p] + qint64(y) * stride, w);
+            for (int x = 1; x < w; ++x)
+                row[x] += row[x - 1];
+        }
+    });
+
+    // 3. Полосы столбцов: префиксная сумма сверху вниз (спан-сложение строк) и максимум.
+    const int strips = qMin(w, m_threads);
+    QVector<qint32> stripMax(strips, 0);
+    qint32* const stripMaxOut = stripMax.data();
+    runParallel(strips, [=](int strip) {
+        const int x0 = int(boundary(w, strips, strip));
+        const int n = int(boundary(w, strips, strip + 1)) - x0;
+        qint32 mx = 0;
+        for (int y = 0; y < h; ++y) {
+            qint32* row = grids[0] + qint64(y) * stride + x0;
+            if (y > 0)
+                spanAdd(row, row - stride, n);
+            for (int x = 0; x < n; ++x)
+                mx = qMax(mx, row[x]);
+        }
+        stripMaxOut[strip] = mx;
+    });
+    m_maxCount = 0;
+    for (qint32 mx : stripMax)
+        m_maxCount = qMax(m_maxCount, mx);
+    m_timing.resolveMs = msSince(timer);
+    timer.restart();
+
+    // 4. Цвет: логарифмическая шкала, чтобы редкие покрытия были видны рядом с "горячими" местами.
+    const double k = m_maxCount > 0 ? double(m_palette.size() - 1) / std::log1p(double(m_maxCount)) : 0.0;
+    const QRgb* palette = m_palette.data();
+    runParallel(bands, [=](int band) {
+        const int yEnd = int(boundary(h, bands, band + 1));
+        for (int y = int(boundary(h, bands, band)); y < yEnd; ++y) {
+            const qint32* row = grids[0] + qint64(y) * stride;
+            QRgb* out = reinterpret_cast<QRgb*>(bits + y * bytesPerLine);
+            for (int x = 0; x < w; ++x)
+                out[x] = row[x] > 0 ? palette[int(std::log1p(double(row[x])) * k + 0.5)] : 0;
+        }
+    });
+    m_timing.colorMs = msSince(timer);
+
+    LAB2_DEBUG(lcPerf()) << "DensityHeatmap:" << m_visibleRows << "of" << columns.count << "rows," << size
+                         << "max" << m_maxCount << "raster" << m_timing.rasterMs << "ms, resolve"
+                         << m_timing.resolveMs << "ms, color" << m_timing.colorMs << "ms";
+    return true;
+}
+
+qint32 DensityHeatmap::countAt(int x, int y) const
+{
+    if (m_grids.isEmpty() || x < 0 || y < 0 || x >= m_size.width() || y >= m_size.height())
+        return 0;
+    return m_grids.first().at(y * m_stride + x);
+}
+
+void DensityHeatmap::spanAdd(qint32* dst, const qint32* src, int n)
+{
+    int i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_add_epi32(a, b));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    for (; i + 4 <= n; i += 4) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_add_epi32(a, b));
+    }
+#endif
+    // Хвост (и вся строка на платформах без SSE2 — здесь компилятор векторизует сам).
+    for (; i < n; ++i)
+        dst[i] += src[i];
+}
+
+QRgb DensityHeatmap::colorAt(double t)
+{
+    struct Stop { double t; int r, g, b; };
+    static const Stop kStops[] = {
+        { 0.00,  20,  20, 110 },
+        { 0.35, 190,  30,  70 },
+        { 0.70, 255, 190,   0 },
+        { 1.00, 255, 255, 255 },
+    };
+
+    t = qBound(0.0, t, 1.0);
+    int i = 1;
+    while (i < 3 && t > kStops[i].t)
+        ++i;
+    const Stop& a = kStops[i - 1];
+    const Stop& b = kStops[i];
+    const double f = (t - a.t) / (b.t - a.t);
+    return qRgb(int(a.r + (b.r - a.r) * f), int(a.g + (b.g - a.g) * f), int(a.b + (b.b - a.b) * f));
+}
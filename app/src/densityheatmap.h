@@ -0,0 +1,106 @@
+#ifndef DENSITYHEATMAP_H
+#define DENSITYHEATMAP_H
+
+#include <QImage>
+#include <QRectF>
+#include <QSize>
+#include <QVector>
+
+#include <array>
+
+class RectSnapshot;
+
+/**
+ * @brief Тепловая карта покрытия: сколько прямоугольников накрывает каждую ячейку сетки.
+ *
+ * Вход — колонки left/top/width/height (указатели, без копирования), обычно прямо из
+ * отображённого в память RectSnapshot. Растеризация не рисует прямоугольники по пикселям,
+ * а считает сетку разностей: каждый прямоугольник — четыре инкремента в углах (+1, -1, -1, +1),
+ * покрытие получается двумерной префиксной суммой. Цена — O(строк + ячеек), независимо
+ * от размеров прямоугольников, поэтому 10M строк перерисовываются за десятки миллисекунд.
+ *
+ * Работа разбита по потокам в четыре прохода (каждый — набор независимых задач QtConcurrent::run):
+ *  1. строки таблицы делятся на части; у каждой части своя сетка разностей (без синхронизации);
+ *  2. полосы строк сетки (тайлы): сложение сеток частей и префиксная сумма по строке;
+ *  3. полосы столбцов: префиксная сумма сверху вниз — сложение предыдущей строки с текущей,
+ *     т.е. спан-сложение векторов int32 (spanAdd(), SSE2/AVX2);
+ *  4. полосы строк: покрытие -> цвет по таблице (логарифмическая шкала) в QImage.
+ *
+ * Буферы переиспользуются между вызовами render() с тем же размером — для интерактивной
+ * прокрутки и масштабирования.
+ *
+ * @note Прямоугольник занимает хотя бы одну ячейку, даже если меньше её (на мелком масштабе
+ *       не пропадают мелкие прямоугольники).
+ */
+class DensityHeatmap
+{
+public:
+    /// Колонки геометрии (count строк в каждой).
+    struct Columns
+    {
+        const qint32* left = nullptr;
+        const qint32* top = nullptr;
+        const qint32* width = nullptr;
+        const qint32* height = nullptr;
+        qint64 count = 0;
+    };
+
+    /// Время проходов последнего render() (мс).
+    struct Timing
+    {
+        double rasterMs = 0;
+        double resolveMs = 0;
+        double colorMs = 0;
+    };
+
+    /// Колонки открытого снимка.
+    static Columns columnsOf(const RectSnapshot& snapshot);
+
+    /// @param threads Потоков (частей строк и полос сетки); 0 — по числу ядер.
+    explicit DensityHeatmap(int threads = 0);
+
+    /**
+     * @brief Считает покрытие области world в сетке size и раскрашивает её.
+     * @return false, если size пуст или world вырожден.
+     */
+    bool render(const Columns& columns, const QRectF& world, const QSize& size);
+
+    /// Раскрашенная карта последнего render() (ARGB32; непокрытые ячейки прозрачны).
+    const QImage& image() const { return m_image; }
+
+    QSize size() const { return m_size; }
+    QRectF world() const { return m_world; }
+
+    /// Покрытие ячейки (x, y) последнего render() (0 вне сетки).
+    qint32 countAt(int x, int y) const;
+
+    /// Наибольшее покрытие последнего render().
+    qint32 maxCount() const { return m_maxCount; }
+
+    /// Строк попало в область world последнего render().
+    qint64 visibleRows() const { return m_visibleRows; }
+
+    const Timing& timing() const { return m_timing; }
+
+    /// dst[i] += src[i] для i < n (векторно, если есть SSE2/AVX2).
+    static void spanAdd(qint32* dst, const qint32* src, int n);
+
+    /// Цвет доли t in [0, 1] (тёмно-синий -> красный -> жёлтый -> белый).
+    static QRgb colorAt(double t);
+
+private:
+    QSize m_size;
+    QRectF m_world;
+    int m_threads = 1;
+    /// Ширина строки сетки разностей: size.width() + 1 (правые края прямоугольников).
+    int m_stride = 0;
+    /// Сетки разностей частей, (height + 1) * stride каждая; после render() в m_grids[0] — покрытие.
+    QVector<QVector<qint32>> m_grids;
+    QImage m_image;
+    qint32 m_maxCount = 0;
+    qint64 m_visibleRows = 0;
+    Timing m_timing;
+    std::array<QRgb, 256> m_palette {};
+};
+
+#endif // DENSITYHEATMAP_H
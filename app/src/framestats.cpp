@@ -0,0 +1,154 @@
+#include "framestats.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <algorithm>
+
+namespace {
+
+constexpr double kNsPerMs = 1000000.0;
+
+} // namespace
+
+FrameStats::FrameStats()
+    : m_histogram(kBucketCount, 0)
+{
+}
+
+void FrameStats::beginFrame()
+{
+    m_inFrame = true;
+    m_frameDataNs = 0;
+    m_frameTimer.start();
+}
+
+void FrameStats::endFrame()
+{
+    if (!m_inFrame) return;
+    m_inFrame = false;
+
+    const qint64 fetchNs = m_pendingFetchNs;
+    m_pendingFetchNs = 0;
+    recordFrame(m_frameTimer.nsecsElapsed(), m_frameDataNs, fetchNs);
+}
+
+void FrameStats::addDataTime(qint64 ns)
+{
+    m_frameDataNs += ns;
+}
+
+void FrameStats::addFetchStall(qint64 ns)
+{
+    ++m_fetchStalls;
+    m_pendingFetchNs += ns;
+}
+
+void FrameStats::recordFrame(qint64 frameNs, qint64 dataNs, qint64 fetchNs)
+{
+    // Задержка из-за fetchMore() — часть времени, которое пользователь ждал этот кадр.
+    const qint64 totalNs = frameNs + fetchNs;
+
+    const qint64 bucket = std::min<qint64>(totalNs / (kBucketUs * 1000LL), kBucketCount - 1);
+    ++m_histogram[static_cast<int>(bucket)];
+
+    ++m_frames;
+    if (totalNs / kNsPerMs > m_jankMs)
+        ++m_jankFrames;
+
+    m_maxFrameNs = std::max(m_maxFrameNs, totalNs);
+    m_totalFrameNs += frameNs;
+    m_totalDataNs += dataNs;
+    m_totalFetchNs += fetchNs;
+}
+
+double FrameStats::percentileMs_(double p) const
+{
+    if (m_frames == 0) return 0.0;
+
+    const qint64 target = std::max<qint64>(1, static_cast<qint64>(p * m_frames + 0.999999));
+    qint64 seen = 0;
+    for (int i = 0; i < m_histogram.size(); ++i) {
+        seen += m_histogram[i];
+        if (seen >= target)
+            return (i + 1) * kBucketUs / 1000.0;
+    }
+    return m_maxFrameNs / kNsPerMs;
+}
+
+FrameStats::Summary FrameStats::summary() const
+{
+    Summary s;
+    s.frames = m_frames;
+    s.jankFrames = m_jankFrames;
+    s.fetchStalls = m_fetchStalls;
+    s.p50Ms = percentileMs_(0.50);
+    s.p99Ms = percentileMs_(0.99);
+    s.maxMs = m_maxFrameNs / kNsPerMs;
+    s.meanMs = m_frames ? (m_totalFrameNs + m_totalFetchNs) / kNsPerMs / m_frames : 0.0;
+    s.paintMsTotal = (m_totalFrameNs - m_totalDataNs) / kNsPerMs;
+    s.dataMsTotal = m_totalDataNs / kNsPerMs;
+    s.fetchMsTotal = m_totalFetchNs / kNsPerMs;
+    return s;
+}
+
+QJsonObject FrameStats::toJson() const
+{
+    const Summary s = summary();
+
+    QJsonObject o;
+    o["frames"] = s.frames;
+    o["jank_frames"] = s.jankFrames;
+    o["jank_threshold_ms"] = m_jankMs;
+    o["fetch_stalls"] = s.fetchStalls;
+    o["p50_ms"] = s.p50Ms;
+    o["p99_ms"] = s.p99Ms;
+    o["max_ms"] = s.maxMs;
+    o["mean_ms"] = s.meanMs;
+    o["paint_ms_total"] = s.paintMsTotal;
+    o["data_ms_total"] = s.dataMsTotal;
+    o["fetch_ms_total"] = s.fetchMsTotal;
+
+    // Гистограмма: только непустые корзины, [верхняя граница мс, количество].
+    QJsonArray hist;
+    for (int i = 0; i < m_histogram.size(); ++i) {
+        if (m_histogram[i] == 0) continue;
+        hist.append(QJsonArray{ (i + 1) * kBucketUs / 1000.0, static_cast<qint64>(m_histogram[i]) });
+    }
+    o["histogram"] = hist;
+    return o;
+}
+
+bool FrameStats::exportJson(const QString& path) const
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return f.write(QJsonDocument(toJson()).toJson()) >= 0;
+}
+
+QString FrameStats::shortText() const
+{
+    const Summary s = summary();
+    return QString("Frames: %1, p50 %2 ms, p99 %3 ms, jank %4")
+            .arg(s.frames)
+            .arg(s.p50Ms, 0, 'f', 1)
+            .arg(s.p99Ms, 0, 'f', 1)
+            .arg(s.jankFrames);
+}
+
+void FrameStats::reset()
+{
+    std::fill(m_histogram.begin(), m_histogram.end(), 0u);
+    m_inFrame = false;
+    m_frameDataNs = 0;
+    m_pendingFetchNs = 0;
+    m_frames = 0;
+    m_jankFrames = 0;
+    m_fetchStalls = 0;
+    m_maxFrameNs = 0;
+    m_totalFrameNs = 0;
+    m_totalDataNs = 0;
+    m_totalFetchNs = 0;
+}
@@ -0,0 +1,112 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Статистика времени кадров отрисовки таблицы.
+ *
+ * Один "кадр" — это один paintEvent() viewport'а QTableView. Для каждого кадра учитывается:
+ *  - полное время отрисовки (делегаты + служебная работа view),
+ *  - время, проведённое в model->data(),
+ *  - время подгрузок fetchMore() ("fetch stall"), которые задержали этот кадр.
+ *
+ * Распределение времени кадров хранится гистограммой с шагом kBucketUs,
+ * поэтому память постоянна при любой длине сессии, а p50/p99 считаются по всей сессии.
+ *
+ * @note Класс не потокобезопасен: все вызовы идут из GUI-потока.
+ */
+class FrameStats
+{
+public:
+    /// Порог "подвисшего" кадра по умолчанию: дольше двух кадров при 60 Гц.
+    static constexpr double kDefaultJankMs = 33.3;
+
+    /// Шаг гистограммы (мкс).
+    static constexpr int kBucketUs = 100;
+
+    /// Число корзин гистограммы (покрывает 0..1 с; всё дольше — в последней корзине).
+    static constexpr int kBucketCount = 10000;
+
+    /// Сводка по сессии.
+    struct Summary
+    {
+        qint64 frames = 0;
+        qint64 jankFrames = 0;
+        qint64 fetchStalls = 0;
+        double p50Ms = 0.0;
+        double p99Ms = 0.0;
+        double maxMs = 0.0;
+        double meanMs = 0.0;
+        double paintMsTotal = 0.0; ///< Отрисовка без учёта data() (делегаты, стиль, view).
+        double dataMsTotal = 0.0;  ///< Суммарное время model->data().
+        double fetchMsTotal = 0.0; ///< Суммарное время fetchMore().
+    };
+
+    FrameStats();
+
+    /// Начало кадра (вызывается view в начале paintEvent()).
+    void beginFrame();
+
+    /// Конец кадра (вызывается view в конце paintEvent()).
+    void endFrame();
+
+    /// true между beginFrame() и endFrame().
+    bool inFrame() const { return m_inFrame; }
+
+    /// Добавляет время вызова model->data() к текущему кадру.
+    void addDataTime(qint64 ns);
+
+    /**
+     * @brief Учитывает подгрузку строк моделью.
+     *
+     * Подгрузка обычно происходит при прокрутке, до отрисовки,
+     * поэтому время приписывается ближайшему следующему кадру.
+     */
+    void addFetchStall(qint64 ns);
+
+    /// Записывает готовый кадр (используется endFrame() и тестами).
+    void recordFrame(qint64 frameNs, qint64 dataNs, qint64 fetchNs);
+
+    Summary summary() const;
+
+    /// Сводка + гистограмма (только непустые корзины) в JSON.
+    QJsonObject toJson() const;
+
+    /// Сохраняет toJson() в файл. Возвращает false при ошибке записи.
+    bool exportJson(const QString& path) const;
+
+    /// Краткая строка для статус-бара.
+    QString shortText() const;
+
+    void reset();
+
+    double jankThresholdMs() const { return m_jankMs; }
+    void setJankThresholdMs(double ms) { m_jankMs = ms; }
+
+private:
+    /// Верхняя граница перцентиля p (0..1) по гистограмме, мс.
+    double percentileMs_(double p) const;
+
+private:
+    QVector<quint32> m_histogram;
+    QElapsedTimer m_frameTimer;
+    bool m_inFrame = false;
+    double m_jankMs = kDefaultJankMs;
+
+    qint64 m_frameDataNs = 0;
+    qint64 m_pendingFetchNs = 0;
+
+    qint64 m_frames = 0;
+    qint64 m_jankFrames = 0;
+    qint64 m_fetchStalls = 0;
+    qint64 m_maxFrameNs = 0;
+    qint64 m_totalFrameNs = 0;
+    qint64 m_totalDataNs = 0;
+    qint64 m_totalFetchNs = 0;
+};
+
+#endif // FRAMESTATS_H
@@ -0,0 +1,608 @@
+#include "groupbymodel.h"
+
+#include <QTimer>
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include <algorithm>
+
+#include "changeexporter.h"
+#include "logger.h"
+#include "mydelegate.h"
+#include "penpalette.h"
+#include "rectangleschema.h"
+#include "scopedconnection.h"
+
+namespace {
+
+/// Выражение измерения над таблицей rectangle.
+QString tableExpr(GroupByModel::Dimension d, int bucket)
+{
+    switch (d) {
+    case GroupByModel::PenColor: return "pen_id";
+    case GroupByModel::PenStyle: return "penstyle";
+    case GroupByModel::PenWidth: return bucket > 1 ? QString("(penwidth / %1) * %1").arg(bucket) : QString("penwidth");
+    default:                     return "0";
+    }
+}
+
+/// То же над журналом: цвет там хранится строкой, переводим его в id словаря.
+QString journalExpr(GroupByModel::Dimension d, int bucket)
+{
+    return d == GroupByModel::PenColor ? QString("(SELECT id FROM pen_palette WHERE color = pencolor)")
+                                       : tableExpr(d, bucket);
+}
+
+qint64 keyOf(const QVariant& v)
+{
+    return v.isNull() ? GroupByModel::kNullKey : v.toLongLong();
+}
+
+QVariant bindOf(qint64 key)
+{
+    return key == GroupByModel::kNullKey ? QVariant(QVariant::LongLong) : QVariant(key);
+}
+
+} // namespace
+
+GroupByModel::GroupByModel(const QString& dbPath, QObject* parent)
+    : QAbstractTableModel(parent)
+    , m_dbPath(dbPath)
+{
+    connect(&m_watcher, &QFutureWatcher<Result>::finished, this, &GroupByModel::onFinished_);
+}
+
+GroupByModel::~GroupByModel()
+{
+    m_watcher.waitForFinished();
+}
+
+void GroupByModel::setSpec(const Spec& spec)
+{
+    Spec s = spec;
+    s.widthBucket = qMax(1, s.widthBucket);
+    if (s == m_spec)
+        return;
+
+    beginResetModel();
+    m_spec = s;
+    m_groups.clear();
+    m_index.clear();
+    m_pivotRows.clear();
+    m_pivotColumns.clear();
+    m_seq = kUnknownSeq;
+    ++m_generation;
+    endResetModel();
+
+    reload();
+}
+
+void GroupByModel::setAutoRefresh(int ms)
+{
+    if (!m_timer) {
+        m_timer = new QTimer(this);
+        connect(m_timer, &QTimer::timeout, this, &GroupByModel::refresh);
+    }
+    if (ms > 0)
+        m_timer->start(ms);
+    else
+        m_timer->stop();
+}
+
+void GroupByModel::refresh()
+{
+    if (m_watcher.isRunning()) {
+        m_pending = true;
+        return;
+    }
+    // Без журнала (seq -1) или до первого расчёта — только полный пересчёт.
+    start_(m_seq < 0);
+}
+
+void GroupByModel::reload()
+{
+    if (m_watcher.isRunning()) {
+        m_pending = true;
+        m_pendingFull = true;
+        return;
+    }
+    start_(true);
+}
+
+void GroupByModel::start_(bool full)
+{
+    m_runGeneration = m_generation;
+    m_runChanged = 0;
+    m_seen.clear();
+
+    const QString path = m_dbPath;
+    const Spec spec = m_spec;
+    const qint64 since = full ? -1 : m_seq;
+    const int generation = m_generation;
+
+    // Порции полного пересчёта уходят в GUI-поток по мере чтения результата.
+    const ChunkSink sink = [this, generation](const QVector<Group>& chunk, const QVector<QColor>& colors) {
+        QMetaObject::invokeMethod(this, [this, generation, chunk, colors] {
+            if (generation != m_generation)
+                return;
+            m_colors = colors;
+            m_runChanged += applyGroups_(chunk);
+        }, Qt::QueuedConnection);
+    };
+
+    m_watcher.setFuture(QtConcurrent::run([path, spec, since, sink] { return run_(path, spec, since, sink); }));
+}
+
+void GroupByModel::onFinished_()
+{
+    const Result r = m_watcher.result();
+
+    // Итог расчёта для прежней группировки не нужен: setSpec() уже запросил новый.
+    if (m_runGeneration == m_generation) {
+        if (!r.ok) {
+            LAB2_WARNING(lcModel()) << "GroupByModel:" << r.error;
+            emit failed(r.error);
+        } else {
+            if (!r.colors.isEmpty())
+                m_colors = r.colors;
+            m_runChanged += applyGroups_(r.groups);
+            if (r.full)
+                removeUnseen_();
+            m_seq = r.seq;
+            LAB2_DEBUG(lcModel()) << "GroupByModel:" << (r.full ? "full" : "delta") << "refresh," << m_runChanged
+                                  << "groups changed, seq" << m_seq;
+            emit refreshed(r.full, m_runChanged);
+        }
+    }
+
+    if (m_pending) {
+        const bool full = m_pendingFull;
+        m_pending = m_pendingFull = false;
+        if (full)
+            reload();
+        else
+            refresh();
+    }
+}
+
+int GroupByModel::applyGroups_(const QVector<Group>& groups)
+{
+    if (groups.isEmpty())
+        return 0;
+    for (const Group& g : groups)
+        m_seen.insert(g.key);
+
+    int changed = 0;
+    if (!isPivot_()) {
+        for (const Group& g : groups)
+            changed += mergeGroup_(g, true);
+        return changed;
+    }
+
+    // Сводная таблица: новые или исчезающие значения измерений меняют колонки — сброс модели,
+    // иначе меняются только числа в ячейках.
+    bool axesChange = false;
+    for (const Group& g : groups) {
+        if (g.count == 0 || !std::binary_search(m_pivotRows.cbegin(), m_pivotRows.cend(), g.key.first)
+                || !std::binary_search(m_pivotColumns.cbegin(), m_pivotColumns.cend(), g.key.second))
+            axesChange = true;
+    }
+
+    if (axesChange)
+        beginResetModel();
+    for (const Group& g : groups)
+        changed += mergeGroup_(g, false);
+    if (axesChange) {
+        rebuildPivot_();
+        endResetModel();
+    } else if (changed > 0) {
+        emit dataChanged(index(0, 1), index(rowCount() - 1, columnCount() - 1));
+    }
+    return changed;
+}
+
+int GroupByModel::mergeGroup_(const Group& g, bool notify)
+{
+    const auto it = m_index.constFind(g.key);
+    if (it != m_index.cend()) {
+        const int row = it.value();
+        if (g.count == 0) {
+            if (notify) beginRemoveRows(QModelIndex(), row, row);
+            m_groups.remove(row);
+            rebuildIndex_();
+            if (notify) endRemoveRows();
+            return 1;
+        }
+
+        Group& cur = m_groups[row];
+        if (cur.count == g.count && cur.area == g.area)
+            return 0;
+        cur.count = g.count;
+        cur.area = g.area;
+        if (notify)
+            emit dataChanged(index(row, keyColumns_()), index(row, columnCount() - 1));
+        return 1;
+    }
+
+    if (g.count == 0)
+        return 0;
+
+    const auto pos = std::lower_bound(m_groups.begin(), m_groups.end(), g.key,
+                                      [](const Group& a, const Key& k) { return a.key < k; });
+    const int row = int(pos - m_groups.begin());
+    if (notify) beginInsertRows(QModelIndex(), row, row);
+    m_groups.insert(row, g);
+    // Полный пересчёт идёт по порядку ключей — обычно это добавление в конец.
+    if (row == m_groups.size() - 1)
+        m_index.insert(g.key, row);
+    else
+        rebuildIndex_();
+    if (notify) endInsertRows();
+    return 1;
+}
+
+void GroupByModel::removeUnseen_()
+{
+    QVector<int> gone;
+    for (int i = 0; i < m_groups.size(); ++i) {
+        if (!m_seen.contains(m_groups.at(i).key))
+            gone << i;
+    }
+    if (gone.isEmpty())
+        return;
+    m_runChanged += gone.size();
+
+    if (isPivot_()) {
+        beginResetModel();
+        for (int k = gone.size() - 1; k >= 0; --k)
+            m_groups.remove(gone.at(k));
+        rebuildIndex_();
+        rebuildPivot_();
+        endResetModel();
+        return;
+    }
+
+    for (int k = gone.size() - 1; k >= 0; --k) {
+        beginRemoveRows(QModelIndex(), gone.at(k), gone.at(k));
+        m_groups.remove(gone.at(k));
+        endRemoveRows();
+    }
+    rebuildIndex_();
+}
+
+void GroupByModel::rebuildIndex_()
+{
+    m_index.clear();
+    m_index.reserve(m_groups.size());
+    for (int i = 0; i < m_groups.size(); ++i)
+        m_index.insert(m_groups.at(i).key, i);
+}
+
+void GroupByModel::rebuildPivot_()
+{
+    QSet<qint64> columns;
+    m_pivotRows.clear();
+    for (const Group& g : m_groups) {
+        // m_groups упорядочены по ключу — значения rows идут по возрастанию.
+        if (m_pivotRows.isEmpty() || m_pivotRows.last() != g.key.first)
+            m_pivotRows << g.key.first;
+        columns.insert(g.key.second);
+    }
+    m_pivotColumns = columns.values().toVector();
+    std::sort(m_pivotColumns.begin(), m_pivotColumns.end());
+}
+
+QString GroupByModel::dimensionName(Dimension d)
+{
+    switch (d) {
+    case PenColor: return "pen color";
+    case PenStyle: return "pen style";
+    case PenWidth: return "pen width";
+    default:       return QString();
+    }
+}
+
+QString GroupByModel::keyText(Dimension d, qint64 key) const
+{
+    if (key == kNullKey)
+        return "(null)";
+
+    switch (d) {
+    case PenColor: {
+        const QColor c = key > 0 && key < m_colors.size() ? m_colors.at(int(key)) : QColor();
+        return c.isValid() ? c.name() : QString("pen_id %1").arg(key);
+    }
+    case PenStyle:
+        return MyDelegate::penStyleToText(int(key));
+    case PenWidth:
+        return m_spec.widthBucket > 1 ? QString("%1..%2").arg(key).arg(key + m_spec.widthBucket - 1)
+                                      : QString::number(key);
+    default:
+        return QString();
+    }
+}
+
+int GroupByModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    return isPivot_() ? m_pivotRows.size() : m_groups.size();
+}
+
+int GroupByModel::columnCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    // Сводная: значение rows, по колонке на значение columns, итог. Список: ключи, count, area, mean.
+    return isPivot_() ? m_pivotColumns.size() + 2 : keyColumns_() + 3;
+}
+
+QVariant GroupByModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount())
+        return {};
+
+    const auto keyCell = [&](Dimension d, qint64 key) -> QVariant {
+        if (role == Qt::DisplayRole)
+            return keyText(d, key);
+        if (role == Qt::DecorationRole && d == PenColor && key > 0 && key < m_colors.size())
+            return m_colors.at(int(key));
+        return {};
+    };
+    const int col = index.column();
+
+    if (isPivot_()) {
+        const qint64 a = m_pivotRows.at(index.row());
+        if (col == 0)
+            return keyCell(m_spec.rows, a);
+
+        qint64 count = 0, area = 0;
+        for (int c = 0; c < m_pivotColumns.size(); ++c) {
+            if (col != c + 1 && col != m_pivotColumns.size() + 1)
+                continue;
+            const int i = m_index.value(Key(a, m_pivotColumns.at(c)), -1);
+            if (i >= 0) {
+                count += m_groups.at(i).count;
+                area += m_groups.at(i).area;
+            }
+        }
+        switch (role) {
+        case Qt::DisplayRole:       return count ? QVariant(count) : QVariant();
+        case Qt::ToolTipRole:       return count ? QVariant(QString("area %1").arg(area)) : QVariant();
+        case Qt::TextAlignmentRole: return int(Qt::AlignRight | Qt::AlignVCenter);
+        default:                    return {};
+        }
+    }
+
+    const Group& g = m_groups.at(index.row());
+    if (col == 0)
+        return keyCell(m_spec.rows, g.key.first);
+    if (col == 1 && keyColumns_() == 2)
+        return keyCell(m_spec.columns, g.key.second);
+
+    if (role == Qt::TextAlignmentRole)
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    if (role != Qt::DisplayRole)
+        return {};
+    switch (col - keyColumns_()) {
+    case 0:  return g.count;
+    case 1:  return g.area;
+    default: return QString::number(g.count ? double(g.area) / double(g.count) : 0.0, 'f', 1);
+    }
+}
+
+QVariant GroupByModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    if (isPivot_()) {
+        if (section == 0)
+            return dimensionName(m_spec.rows) + " \\ " + dimensionName(m_spec.columns);
+        if (section <= m_pivotColumns.size())
+            return keyText(m_spec.columns, m_pivotColumns.at(section - 1));
+        return "Total";
+    }
+
+    if (section == 0)
+        return dimensionName(m_spec.rows);
+    if (section == 1 && keyColumns_() == 2)
+        return dimensionName(m_spec.columns);
+    switch (section - keyColumns_()) {
+    case 0:  return "Count";
+    case 1:  return "Area";
+    default: return "Mean area";
+    }
+}
+
+GroupByModel::Result GroupByModel::run_(const QString& dbPath, const Spec& spec, qint64 since, const ChunkSink& sink)
+{
+    Result r;
+
+    ScopedConnection conn(dbPath, "groupby", true);
+    if (!conn.isOpen()) {
+        r.error = "cannot open " + dbPath + ": " + conn.error();
+        return r;
+    }
+
+    // При ошибке транзакцию завершает закрытие соединения (деструктор ScopedConnection).
+    {
+        QSqlDatabase db = conn.db();
+        const QStringList tables = db.tables();
+        if (!tables.contains(rectschema::kTable)) {
+            // Таблица удалена — групп нет.
+            r.ok = r.full = true;
+            return r;
+        }
+        const bool journal = tables.contains(ChangeExporter::kChangesTable);
+
+        // Одна читающая транзакция: seq журнала и агрегаты видят одно состояние.
+        if (!db.transaction()) {
+            r.error = "BEGIN failed: " + db.lastError().text();
+            return r;
+        }
+
+        r.colors = PenPalette::loadColors(db, &r.error);
+        if (!r.error.isEmpty())
+            return r;
+
+        r.seq = -1;
+        if (journal) {
+            QSqlQuery q(db);
+            if (!q.exec("SELECT IFNULL(MAX(seq), 0) FROM rectangle_changes;") || !q.next()) {
+                r.error = "SELECT MAX(seq) failed: " + q.lastError().text();
+                return r;
+            }
+            r.seq = q.value(0).toLongLong();
+        }
+
+        bool full = since < 0 || !journal;
+        QSet<Key> keys;
+        if (!full && !changedKeys_(db, spec, since, &keys, &full, &r.error))
+            return r;
+
+        const QString a = tableExpr(spec.rows, spec.widthBucket);
+        const QString b = tableExpr(spec.columns, spec.widthBucket);
+        QString sql = QString("SELECT %1, %2, COUNT(*), SUM(area) FROM %3").arg(a, b, rectschema::kTable);
+        QVector<Key> keyList;
+        if (!full) {
+            keyList = keys.values().toVector();
+            QStringList terms;
+            for (int i = 0; i < keyList.size(); ++i)
+                terms << QString("(%1 IS ? AND %2 IS ?)").arg(a, b);
+            sql += " WHERE " + terms.join(" OR ");
+        }
+        sql += " GROUP BY 1, 2 ORDER BY 1, 2;";
+
+        if (full || !keyList.isEmpty()) {
+            QSqlQuery q(db);
+            q.setForwardOnly(true);
+            if (!q.prepare(sql)) {
+                r.error = q.lastError().text();
+                return r;
+            }
+            for (int i = 0; i < keyList.size(); ++i) {
+                q.bindValue(2 * i, bindOf(keyList.at(i).first));
+                q.bindValue(2 * i + 1, bindOf(keyList.at(i).second));
+            }
+            if (!q.exec()) {
+                r.error = q.lastError().text();
+                return r;
+            }
+
+            QVector<Group> chunk;
+            QSet<Key> found;
+            while (q.next()) {
+                Group g;
+                g.key = Key(keyOf(q.value(0)), keyOf(q.value(1)));
+                g.count = q.value(2).toLongLong();
+                g.area = q.value(3).toLongLong();
+                if (full) {
+                    chunk << g;
+                    if (chunk.size() >= kChunkGroups) {
+                        sink(chunk, r.colors);
+                        chunk.clear();
+                    }
+                } else {
+                    r.groups << g;
+                    found.insert(g.key);
+                }
+            }
+            if (q.lastError().isValid()) {
+                r.error = q.lastError().text();
+                return r;
+            }
+            if (!chunk.isEmpty())
+                sink(chunk, r.colors);
+
+            // Затронутые группы, которых больше нет.
+            for (const Key& k : keyList) {
+                if (!found.contains(k)) {
+                    Group gone;
+                    gone.key = k;
+                    r.groups << gone;
+                }
+            }
+        }
+
+        db.commit();
+        r.full = full;
+    }
+
+    r.ok = true;
+    return r;
+}
+
+bool GroupByModel::changedKeys_(QSqlDatabase db, const Spec& spec, qint64 since,
+                                QSet<Key>* keys, bool* needFull, QString* error)
+{
+    const QString ja = journalExpr(spec.rows, spec.widthBucket);
+    const QString jb = journalExpr(spec.columns, spec.widthBucket);
+
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+
+    // seq — первичный ключ журнала: подсчёт хвоста дешёвый.
+    q.prepare("SELECT COUNT(*) FROM rectangle_changes WHERE seq > ?;");
+    q.addBindValue(since);
+    if (!q.exec() || !q.next()) {
+        *error = "journal count failed: " + q.lastError().text();
+        return false;
+    }
+    if (q.value(0).toLongLong() > kMaxDeltaChanges) {
+        *needFull = true;
+        return true;
+    }
+
+    QSqlQuery prev(db);
+    prev.setForwardOnly(true);
+    if (!prev.prepare(QString("SELECT %1, %2 FROM rectangle_changes"
+                              " WHERE row_id = ? AND seq < ? AND op <> 'X' ORDER BY seq DESC LIMIT 1;").arg(ja, jb))
+            || !q.prepare(QString("SELECT seq, op, row_id, %1, %2 FROM rectangle_changes"
+                                  " WHERE seq > ? ORDER BY seq;").arg(ja, jb))) {
+        *error = prev.lastError().isValid() ? prev.lastError().text() : q.lastError().text();
+        return false;
+    }
+    q.addBindValue(since);
+    if (!q.exec()) {
+        *error = q.lastError().text();
+        return false;
+    }
+
+    while (q.next()) {
+        const QString op = q.value(1).toString();
+        if (op == "X") {
+            // Таблицу удаляли и создавали заново.
+            *needFull = true;
+            return true;
+        }
+        keys->insert(Key(keyOf(q.value(3)), keyOf(q.value(4))));
+
+        if (op == "U") {
+            // Журнал хранит новое состояние; старое — в предыдущей записи о строке.
+            prev.bindValue(0, q.value(2));
+            prev.bindValue(1, q.value(0));
+            if (!prev.exec()) {
+                *error = prev.lastError().text();
+                return false;
+            }
+            if (!prev.next()) {
+                // Строка старше журнала: прежняя группа неизвестна.
+                *needFull = true;
+                return true;
+            }
+            keys->insert(Key(keyOf(prev.value(0)), keyOf(prev.value(1))));
+            prev.finish();
+        }
+
+        if (keys->size() > kMaxDeltaKeys) {
+            *needFull = true;
+            return true;
+        }
+    }
+    if (q.lastError().isValid()) {
+        *error = q.lastError().text();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,184 @@
+#ifndef GROUPBYMODEL_H
+#define GROUPBYMODEL_H
+
+#include <QAbstractTableModel>
+#include <QColor>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QVector>
+
+#include <QtSql/QSqlDatabase>
+
+#include <functional>
+#include <limits>
+
+class QTimer;
+
+/**
+ * @brief Группировка таблицы rectangle: число строк и сумма площадей по одному-двум измерениям
+ *        (цвет пера x стиль, корзины толщины пера и т.п.), списком или сводной таблицей.
+ *
+ * Агрегаты считает SQLite (GROUP BY) в фоновом потоке, в собственном соединении
+ * (ScopedConnection), внутри одной читающей транзакции — seq журнала и группы согласованы.
+ * Группы полного пересчёта приходят в модель порциями по kChunkGroups по мере чтения
+ * результата: вид заполняется, пока запрос ещё идёт.
+ *
+ * Обновление инкрементальное. По журналу rectangle_changes (seq > последнего учтённого)
+ * определяются затронутые группы: новое состояние строки (I/U), старое (D, а для U —
+ * предыдущая запись журнала о той же строке). Пересчитываются только они (один запрос
+ * с условием по ключам), модель меняет только их строки. Полный пересчёт — если журнала нет,
+ * таблицу удаляли, строка старше журнала или изменений больше kMaxDeltaChanges/kMaxDeltaKeys.
+ *
+ * Модель не знает, кто меняет файл (эта программа или другой процесс), поэтому refresh()
+ * вызывается по таймеру (setAutoRefresh()); без изменений он стоит одного MAX(seq).
+ */
+class GroupByModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    /// Измерение группировки.
+    enum Dimension {
+        NoDimension = -1,
+        PenColor = 0,
+        PenStyle,
+        PenWidth,
+        DimensionCount
+    };
+
+    /// Что и как группировать.
+    struct Spec
+    {
+        Dimension rows = PenColor;
+        Dimension columns = PenStyle;  ///< NoDimension — группировка по одному измерению.
+        int widthBucket = 1;           ///< Ширина корзины PenWidth: [k*b, (k+1)*b).
+        bool pivot = false;            ///< Сводная таблица: значения columns — колонки, в ячейках — число строк.
+
+        bool operator==(const Spec& o) const
+        {
+            return rows == o.rows && columns == o.columns && widthBucket == o.widthBucket && pivot == o.pivot;
+        }
+        bool operator!=(const Spec& o) const { return !(*this == o); }
+    };
+
+    /// Ключ группы: значения измерений (kNullKey — NULL).
+    using Key = QPair<qint64, qint64>;
+
+    struct Group
+    {
+        Key key;
+        qint64 count = 0;
+        qint64 area = 0;
+    };
+
+    static constexpr qint64 kNullKey = std::numeric_limits<qint64>::min();
+    /// Размер порции потоковой выдачи полного пересчёта.
+    static constexpr int kChunkGroups = 256;
+    /// Больше стольких записей журнала или затронутых групп — дешевле полный пересчёт.
+    static constexpr int kMaxDeltaChanges = 1024;
+    static constexpr int kMaxDeltaKeys = 64;
+    static constexpr int kDefaultAutoRefreshMs = 1000;
+
+    explicit GroupByModel(const QString& dbPath, QObject* parent = nullptr);
+    ~GroupByModel() override;
+
+    QString dbPath() const { return m_dbPath; }
+
+    const Spec& spec() const { return m_spec; }
+    /// Меняет группировку: модель очищается, запускается полный пересчёт.
+    void setSpec(const Spec& spec);
+
+    /// Группы в порядке ключей (как ORDER BY в SQL).
+    const QVector<Group>& groups() const { return m_groups; }
+
+    /// seq журнала, по который учтены изменения (-1 — журнала нет, kUnknownSeq — ещё не считано).
+    qint64 seq() const { return m_seq; }
+    static constexpr qint64 kUnknownSeq = -2;
+
+    bool isRunning() const { return m_watcher.isRunning(); }
+    void waitForFinished() { m_watcher.waitForFinished(); }
+
+    /// Период автообновления (мс); 0 — выключено.
+    void setAutoRefresh(int ms);
+
+    /// Текст значения измерения (цвет — "#rrggbb", стиль — имя Qt::PenStyle, корзина — "lo..hi").
+    QString keyText(Dimension d, qint64 key) const;
+    static QString dimensionName(Dimension d);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+public slots:
+    /// Обновляет группы: по журналу, если можно, иначе полностью. Во время расчёта — откладывается.
+    void refresh();
+
+    /// Полный пересчёт.
+    void reload();
+
+signals:
+    /// Расчёт применён: full — полный пересчёт, groupsChanged — сколько групп изменилось/появилось/исчезло.
+    void refreshed(bool full, int groupsChanged);
+    void failed(const QString& error);
+
+private:
+    /// Итог фонового расчёта (группы полного пересчёта приходят порциями, а не здесь).
+    struct Result
+    {
+        bool ok = false;
+        bool full = false;
+        qint64 seq = kUnknownSeq;
+        QVector<Group> groups;
+        QVector<QColor> colors;
+        QString error;
+    };
+
+    using ChunkSink = std::function<void(const QVector<Group>&, const QVector<QColor>&)>;
+
+    void start_(bool full);
+    void onFinished_();
+    /// Применяет группы; возвращает число изменённых строк модели.
+    int applyGroups_(const QVector<Group>& groups);
+    int mergeGroup_(const Group& g, bool notify);
+    void removeUnseen_();
+    void rebuildIndex_();
+    void rebuildPivot_();
+    bool isPivot_() const { return m_spec.pivot && m_spec.columns != NoDimension; }
+    int keyColumns_() const { return m_spec.columns == NoDimension ? 1 : 2; }
+
+    /// Фоновый расчёт: since < 0 — полный, иначе по журналу с seq > since.
+    static Result run_(const QString& dbPath, const Spec& spec, qint64 since, const ChunkSink& sink);
+    /// Затронутые группы по журналу; *needFull — если по журналу их не определить.
+    static bool changedKeys_(QSqlDatabase db, const Spec& spec, qint64 since,
+                             QSet<Key>* keys, bool* needFull, QString* error);
+
+private:
+    QString m_dbPath;
+    Spec m_spec;
+    QVector<Group> m_groups;
+    QHash<Key, int> m_index;
+    QVector<QColor> m_colors;
+    qint64 m_seq = kUnknownSeq;
+
+    /// Номер текущего расчёта: порции и итоги устаревших (после setSpec()) отбрасываются.
+    int m_generation = 0;
+    int m_runGeneration = 0;
+    bool m_runFull = false;
+    bool m_pending = false;
+    bool m_pendingFull = false;
+    /// Ключи, пришедшие в текущем полном пересчёте (остальные группы исчезли).
+    QSet<Key> m_seen;
+    int m_runChanged = 0;
+
+    /// Сводная таблица: значения измерений rows и columns (по возрастанию).
+    QVector<qint64> m_pivotRows;
+    QVector<qint64> m_pivotColumns;
+
+    QFutureWatcher<Result> m_watcher;
+    QTimer* m_timer = nullptr;
+};
+
+#endif // GROUPBYMODEL_H
@@ -0,0 +1,94 @@
+#include "groupbypanel.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QSpinBox>
+#include <QTableView>
+#include <QVBoxLayout>
+
+#include "groupbymodel.h"
+
+GroupByPanel::GroupByPanel(GroupByModel* model, QWidget* parent)
+    : QWidget(parent)
+    , m_model(model)
+{
+    m_rows = new QComboBox(this);
+    m_rows->setObjectName("groupByRows");
+    m_columns = new QComboBox(this);
+    m_columns->setObjectName("groupByColumns");
+    m_columns->addItem("(none)", int(GroupByModel::NoDimension));
+    for (int d = 0; d < GroupByModel::DimensionCount; ++d) {
+        const QString name = GroupByModel::dimensionName(GroupByModel::Dimension(d));
+        m_rows->addItem(name, d);
+        m_columns->addItem(name, d);
+    }
+
+    m_bucket = new QSpinBox(this);
+    m_bucket->setObjectName("groupByBucket");
+    m_bucket->setRange(1, 1000);
+    m_bucket->setPrefix("width bucket ");
+
+    m_pivot = new QCheckBox("Pivot", this);
+    m_pivot->setObjectName("groupByPivot");
+
+    m_status = new QLabel(this);
+
+    m_view = new QTableView(this);
+    m_view->setObjectName("groupByView");
+    m_view->setModel(m_model);
+    m_view->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_view->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_view->verticalHeader()->hide();
+
+    // Текущая группировка модели.
+    const GroupByModel::Spec& spec = m_model->spec();
+    m_rows->setCurrentIndex(m_rows->findData(int(spec.rows)));
+    m_columns->setCurrentIndex(m_columns->findData(int(spec.columns)));
+    m_bucket->setValue(spec.widthBucket);
+    m_pivot->setChecked(spec.pivot);
+
+    auto* controls = new QHBoxLayout();
+    controls->addWidget(m_rows);
+    controls->addWidget(new QLabel("x", this));
+    controls->addWidget(m_columns);
+    controls->addWidget(m_bucket);
+    controls->addWidget(m_pivot);
+    controls->addStretch();
+
+    auto* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(controls);
+    layout->addWidget(m_view);
+    layout->addWidget(m_status);
+
+    connect(m_rows, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &GroupByPanel::applySpec_);
+    connect(m_columns, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &GroupByPanel::applySpec_);
+    connect(m_bucket, QOverload<int>::of(&QSpinBox::valueChanged), this, &GroupByPanel::applySpec_);
+    connect(m_pivot, &QCheckBox::toggled, this, &GroupByPanel::applySpec_);
+    connect(m_model, &GroupByModel::refreshed, this, &GroupByPanel::onRefreshed_);
+    connect(m_model, &GroupByModel::failed, m_status, &QLabel::setText);
+}
+
+void GroupByPanel::applySpec_()
+{
+    GroupByModel::Spec spec;
+    spec.rows = GroupByModel::Dimension(m_rows->currentData().toInt());
+    spec.columns = GroupByModel::Dimension(m_columns->currentData().toInt());
+    if (spec.columns == spec.rows)
+        spec.columns = GroupByModel::NoDimension;
+    spec.widthBucket = m_bucket->value();
+    spec.pivot = m_pivot->isChecked();
+    m_model->setSpec(spec);
+}
+
+void GroupByPanel::onRefreshed_(bool full, int groupsChanged)
+{
+    m_status->setText(QString("%1 groups, %2 refresh: %3 changed, seq %4")
+                          .arg(m_model->groups().size())
+                          .arg(full ? "full" : "incremental")
+                          .arg(groupsChanged)
+                          .arg(m_model->seq()));
+}
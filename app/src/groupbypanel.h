@@ -0,0 +1,43 @@
+#ifndef GROUPBYPANEL_H
+#define GROUPBYPANEL_H
+
+#include <QWidget>
+
+class GroupByModel;
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QSpinBox;
+class QTableView;
+
+/**
+ * @brief Панель группировки (Model -> Group by): выбор измерений и таблица GroupByModel.
+ *
+ * Строки — первое измерение, второе — колонки ключа или, в режиме "Pivot", колонки
+ * сводной таблицы. Корзина толщины пера применяется к измерению "pen width".
+ */
+class GroupByPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit GroupByPanel(GroupByModel* model, QWidget* parent = nullptr);
+
+    QTableView* view() const { return m_view; }
+
+private:
+    /// Собирает GroupByModel::Spec из элементов управления.
+    void applySpec_();
+    void onRefreshed_(bool full, int groupsChanged);
+
+private:
+    GroupByModel* m_model = nullptr;
+    QComboBox* m_rows = nullptr;
+    QComboBox* m_columns = nullptr;
+    QSpinBox* m_bucket = nullptr;
+    QCheckBox* m_pivot = nullptr;
+    QLabel* m_status = nullptr;
+    QTableView* m_view = nullptr;
+};
+
+#endif // GROUPBYPANEL_H
@@ -0,0 +1,91 @@
+#include "groupcommitter.h"
+
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlTableModel>
+
+#include "busyretry.h"
+#include "logger.h"
+
+GroupCommitter::GroupCommitter(QSqlDatabase db, QObject* parent)
+    : QObject(parent)
+    , m_db(std::move(db))
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &GroupCommitter::flush);
+}
+
+GroupCommitter::~GroupCommitter()
+{
+    flush();
+}
+
+void GroupCommitter::attach(QSqlTableModel* model)
+{
+    // Сигналы испускаются до выполнения INSERT/UPDATE/DELETE — транзакция успевает открыться.
+    connect(model, &QSqlTableModel::beforeInsert, this, &GroupCommitter::noteChange);
+    connect(model, &QSqlTableModel::beforeUpdate, this, &GroupCommitter::noteChange);
+    connect(model, &QSqlTableModel::beforeDelete, this, &GroupCommitter::noteChange);
+    m_models.append(model);
+}
+
+void GroupCommitter::setEnabled(bool enabled)
+{
+    if (!enabled)
+        flush();
+    m_enabled = enabled;
+}
+
+void GroupCommitter::noteChange()
+{
+    if (!m_enabled || !m_db.isOpen()) return;
+
+    if (!m_inTransaction) {
+        if (!(m_retry ? m_retry->transaction(m_db) : m_db.transaction())) {
+            LAB2_WARNING(lcDb()) << "GroupCommitter: BEGIN failed, edit goes in autocommit:"
+                                 << m_db.lastError().text();
+            return;
+        }
+        m_inTransaction = true;
+        m_timer.start(m_windowMs);
+    }
+
+    // Сама правка выполнится после возврата из сигнала, поэтому фиксируем из цикла событий.
+    if (++m_pending >= m_maxChanges && !m_flushScheduled) {
+        m_flushScheduled = true;
+        QTimer::singleShot(0, this, &GroupCommitter::flush);
+    }
+}
+
+bool GroupCommitter::flush()
+{
+    m_flushScheduled = false;
+    m_timer.stop();
+    if (!m_inTransaction) return true;
+
+    m_inTransaction = false;
+    const int changes = m_pending;
+    m_pending = 0;
+
+    if (!(m_retry ? m_retry->commit(m_db) : m_db.commit())) {
+        const QString error = m_db.lastError().text();
+        LAB2_WARNING(lcDb()) << "GroupCommitter: COMMIT failed, rolling back" << changes << "edits:" << error;
+        m_db.rollback();
+        ++m_rollbacks;
+
+        // Кэш моделей всё ещё содержит откаченные правки — перечитываем из БД.
+        m_models.removeAll(QPointer<QSqlTableModel>());
+        for (const QPointer<QSqlTableModel>& model : qAsConst(m_models)) {
+            if (!model->select())
+                LAB2_WARNING(lcModel()) << "GroupCommitter: select() after rollback failed:"
+                                        << model->lastError().text();
+        }
+        emit rolledBack(changes, error);
+        return false;
+    }
+
+    ++m_groups;
+    m_changes += quint64(changes);
+    LAB2_DEBUG(lcDb()) << "GroupCommitter: committed" << changes << "edits";
+    emit committed(changes);
+    return true;
+}
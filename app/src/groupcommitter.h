@@ -0,0 +1,103 @@
+#ifndef GROUPCOMMITTER_H
+#define GROUPCOMMITTER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+#include <QtSql/QSqlDatabase>
+
+class BusyRetry;
+class QSqlTableModel;
+
+/**
+ * @brief Групповая фиксация правок модели: одна транзакция на окно времени или на N изменений.
+ *
+ * С OnRowChange/OnFieldChange каждая маленькая правка в таблице (делегаты цвета/стиля,
+ * вставка/удаление строк) — отдельная автокоммит-транзакция со своим fsync.
+ * GroupCommitter ловит beforeInsert/beforeUpdate/beforeDelete модели и перед первой правкой
+ * открывает транзакцию; фиксирует её
+ *  - через windowMs после первой правки группы (задержка фиксации ограничена),
+ *  - или сразу после maxChanges правок,
+ *  - или по явному flush() (перед любой другой работой с БД, закрытием соединения и т.п.).
+ *
+ * Модель читает через то же соединение, поэтому видит свои незафиксированные правки
+ * (read-your-writes); другие соединения видят группу целиком после фиксации.
+ *
+ * BEGIN и COMMIT идут через BusyRetry (setBusyRetry()): COMMIT, упёршийся в блокировку
+ * другого процесса, повторяется. Если COMMIT всё же не прошёл, группа откатывается,
+ * подключённые модели перечитываются (иначе они показывали бы откатившиеся правки)
+ * и испускается rolledBack().
+ *
+ * @note При аварийном завершении теряются правки последнего окна (не более windowMs).
+ */
+class GroupCommitter : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int kDefaultWindowMs = 50;
+    static constexpr int kDefaultMaxChanges = 100;
+
+    explicit GroupCommitter(QSqlDatabase db, QObject* parent = nullptr);
+    ~GroupCommitter() override;
+
+    /// Подписывается на правки модели (модель должна работать через то же соединение).
+    void attach(QSqlTableModel* model);
+
+    /// BEGIN/COMMIT с повтором при блокировке (nullptr — без повторов). Владение не передаётся.
+    void setBusyRetry(BusyRetry* retry) { m_retry = retry; }
+
+    void setWindowMs(int ms) { m_windowMs = qMax(0, ms); }
+    int windowMs() const { return m_windowMs; }
+
+    void setMaxChanges(int n) { m_maxChanges = qMax(1, n); }
+    int maxChanges() const { return m_maxChanges; }
+
+    /// Выключенный коммиттер не открывает транзакций (каждая правка — автокоммит).
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+
+    /// Есть открытая группа?
+    bool hasPending() const { return m_inTransaction; }
+    int pendingChanges() const { return m_pending; }
+
+    quint64 groupsCommitted() const { return m_groups; }
+    quint64 changesCommitted() const { return m_changes; }
+    quint64 groupsRolledBack() const { return m_rollbacks; }
+
+public slots:
+    /// Отмечает правку: открывает группу при необходимости.
+    void noteChange();
+
+    /**
+     * @brief Фиксирует открытую группу.
+     * @return false при ошибке COMMIT: группа откатывается, модели перечитываются, испускается rolledBack().
+     */
+    bool flush();
+
+signals:
+    /// Группа зафиксирована.
+    void committed(int changes);
+
+    /// COMMIT не прошёл: changes правок группы откачены, модели перечитаны.
+    void rolledBack(int changes, const QString& error);
+
+private:
+    QSqlDatabase m_db;
+    BusyRetry* m_retry = nullptr;
+    QVector<QPointer<QSqlTableModel>> m_models;
+    QTimer m_timer;
+    int m_windowMs = kDefaultWindowMs;
+    int m_maxChanges = kDefaultMaxChanges;
+    bool m_enabled = true;
+    bool m_inTransaction = false;
+    bool m_flushScheduled = false;
+    int m_pending = 0;
+    quint64 m_groups = 0;
+    quint64 m_changes = 0;
+    quint64 m_rollbacks = 0;
+};
+
+#endif // GROUPCOMMITTER_H
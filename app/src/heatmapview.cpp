@@ -0,0 +1,179 @@
+#include "heatmapview.h"
+
+#include <QHelpEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QToolTip>
+#include <QWheelEvent>
+
+#include <cmath>
+
+HeatmapView::HeatmapView(QWidget* parent)
+    : QWidget(parent)
+{
+    setMouseTracking(true);
+    setMinimumSize(64, 64);
+}
+
+bool HeatmapView::load(const QString& path, QString* error)
+{
+    if (!m_snapshot.open(path, error)) {
+        m_dirty = true;
+        update();
+        return false;
+    }
+    resetView();
+    return true;
+}
+
+void HeatmapView::unload()
+{
+    m_snapshot.close();
+    m_dirty = true;
+    update();
+}
+
+void HeatmapView::setWorld(const QRectF& world)
+{
+    if (!(world.width() > 0) || !(world.height() > 0))
+        return;
+    m_world = world;
+    m_dirty = true;
+    update();
+}
+
+void HeatmapView::resetView()
+{
+    QRectF bounds = m_snapshot.isOpen() ? QRectF(m_snapshot.analytics().bounds()) : QRectF();
+    if (bounds.isEmpty())
+        bounds = QRectF(bounds.topLeft(), QSizeF(qMax(1.0, bounds.width()), qMax(1.0, bounds.height())));
+    setWorld(fitAspect_(bounds));
+}
+
+void HeatmapView::ensureRendered()
+{
+    if (!m_dirty)
+        return;
+    m_dirty = false;
+    if (m_snapshot.isOpen())
+        m_heatmap.render(DensityHeatmap::columnsOf(m_snapshot), m_world, size());
+}
+
+void HeatmapView::paintEvent(QPaintEvent*)
+{
+    QPainter p(this);
+    p.fillRect(rect(), Qt::black);
+
+    if (!m_snapshot.isOpen()) {
+        p.setPen(Qt::gray);
+        p.drawText(rect(), Qt::AlignCenter, "No snapshot");
+        return;
+    }
+
+    ensureRendered();
+    p.drawImage(0, 0, m_heatmap.image());
+
+    const DensityHeatmap::Timing& t = m_heatmap.timing();
+    const QString info = QString("max %1 | %2 of %3 rows | %4 ms")
+            .arg(m_heatmap.maxCount())
+            .arg(m_heatmap.visibleRows())
+            .arg(m_snapshot.rowCount())
+            .arg(t.rasterMs + t.resolveMs + t.colorMs, 0, 'f', 1);
+    p.setPen(Qt::white);
+    p.drawText(rect().adjusted(6, 4, -6, -4), Qt::AlignLeft | Qt::AlignTop, info);
+}
+
+void HeatmapView::resizeEvent(QResizeEvent*)
+{
+    // Масштаб сохраняется: меняется только охват области.
+    if (!m_world.isEmpty())
+        m_world = fitAspect_(m_world);
+    m_dirty = true;
+}
+
+void HeatmapView::wheelEvent(QWheelEvent* event)
+{
+    const int steps = event->angleDelta().y() / 120;
+    if (steps == 0 || m_world.isEmpty())
+        return;
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    const QPointF pos = event->position();
+#else
+    const QPointF pos = event->pos();
+#endif
+    // Точка под курсором остаётся на месте.
+    const QPointF anchor = toWorld_(pos);
+    const double f = std::pow(kZoomStep, -steps);
+    setWorld(QRectF(anchor.x() - (anchor.x() - m_world.left()) * f,
+                    anchor.y() - (anchor.y() - m_world.top()) * f,
+                    m_world.width() * f,
+                    m_world.height() * f));
+    event->accept();
+}
+
+void HeatmapView::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton) {
+        m_dragging = true;
+        m_dragPos = event->pos();
+        setCursor(Qt::ClosedHandCursor);
+    }
+}
+
+void HeatmapView::mouseMoveEvent(QMouseEvent* event)
+{
+    if (!m_dragging || width() <= 0 || height() <= 0)
+        return;
+
+    const QPoint d = event->pos() - m_dragPos;
+    m_dragPos = event->pos();
+    setWorld(m_world.translated(-d.x() * m_world.width() / width(), -d.y() * m_world.height() / height()));
+}
+
+void HeatmapView::mouseReleaseEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton) {
+        m_dragging = false;
+        unsetCursor();
+    }
+}
+
+bool HeatmapView::event(QEvent* event)
+{
+    if (event->type() == QEvent::ToolTip) {
+        auto* help = static_cast<QHelpEvent*>(event);
+        if (m_snapshot.isOpen() && !m_dirty) {
+            const QPointF w = toWorld_(help->pos());
+            QToolTip::showText(help->globalPos(),
+                               QString("(%1, %2): %3")
+                                   .arg(qRound(w.x()))
+                                   .arg(qRound(w.y()))
+                                   .arg(m_heatmap.countAt(help->pos().x(), help->pos().y())),
+                               this);
+        } else {
+            QToolTip::hideText();
+        }
+        return true;
+    }
+    return QWidget::event(event);
+}
+
+QPointF HeatmapView::toWorld_(const QPointF& pos) const
+{
+    if (width() <= 0 || height() <= 0)
+        return m_world.topLeft();
+    return QPointF(m_world.left() + pos.x() * m_world.width() / width(),
+                   m_world.top() + pos.y() * m_world.height() / height());
+}
+
+QRectF HeatmapView::fitAspect_(const QRectF& world) const
+{
+    if (width() <= 0 || height() <= 0)
+        return world;
+
+    // Одна единица на пиксель по обеим осям: берём больший из масштабов.
+    const double scale = qMax(world.width() / width(), world.height() / height());
+    const QSizeF s(width() * scale, height() * scale);
+    return QRectF(world.center() - QPointF(s.width() / 2, s.height() / 2), s);
+}
@@ -0,0 +1,75 @@
+#ifndef HEATMAPVIEW_H
+#define HEATMAPVIEW_H
+
+#include <QWidget>
+
+#include "densityheatmap.h"
+#include "rectsnapshot.h"
+
+/**
+ * @brief Интерактивная тепловая карта снимка (Model -> Density heatmap).
+ *
+ * Держит свой RectSnapshot (колонки читаются прямо из отображённого файла) и DensityHeatmap
+ * размером с виджет: один пиксель — одна ячейка. Колесо мыши масштабирует вокруг курсора,
+ * перетаскивание сдвигает область, подсказка показывает покрытие под курсором.
+ *
+ * Пересчёт ленивый: изменения области и размера только помечают карту устаревшей,
+ * а render() выполняется в paintEvent() — серия событий колеса даёт один пересчёт на кадр.
+ */
+class HeatmapView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    /// Шаг масштаба на одно деление колеса.
+    static constexpr double kZoomStep = 1.25;
+
+    explicit HeatmapView(QWidget* parent = nullptr);
+
+    /// Открывает снимок (предыдущий закрывается) и показывает его целиком.
+    bool load(const QString& path, QString* error = nullptr);
+
+    /// Закрывает снимок, например перед заменой файла.
+    void unload();
+
+    const RectSnapshot& snapshot() const { return m_snapshot; }
+    const DensityHeatmap& heatmap() const { return m_heatmap; }
+
+    /// Видимая область в координатах прямоугольников.
+    QRectF world() const { return m_world; }
+    void setWorld(const QRectF& world);
+
+    /// Показывает весь снимок (охватывающий прямоугольник из analytics()).
+    void resetView();
+
+    /// Пересчитывает карту, если она устарела (paintEvent() делает это сам).
+    void ensureRendered();
+
+    QSize sizeHint() const override { return QSize(480, 360); }
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    bool event(QEvent* event) override;
+
+private:
+    /// Точка виджета -> координаты прямоугольников.
+    QPointF toWorld_(const QPointF& pos) const;
+
+    /// Область с пропорциями виджета вокруг центра world (пиксели квадратные).
+    QRectF fitAspect_(const QRectF& world) const;
+
+private:
+    RectSnapshot m_snapshot;
+    DensityHeatmap m_heatmap;
+    QRectF m_world;
+    bool m_dirty = true;
+    bool m_dragging = false;
+    QPoint m_dragPos;
+};
+
+#endif // HEATMAPVIEW_H
@@ -0,0 +1,20 @@
+#include "instrumentedtableview.h"
+
+#include "framestats.h"
+
+InstrumentedTableView::InstrumentedTableView(QWidget* parent)
+    : QTableView(parent)
+{
+}
+
+void InstrumentedTableView::paintEvent(QPaintEvent* event)
+{
+    if (!m_stats) {
+        QTableView::paintEvent(event);
+        return;
+    }
+
+    m_stats->beginFrame();
+    QTableView::paintEvent(event);
+    m_stats->endFrame();
+}
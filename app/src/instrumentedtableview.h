@@ -0,0 +1,34 @@
+#ifndef INSTRUMENTEDTABLEVIEW_H
+#define INSTRUMENTEDTABLEVIEW_H
+
+#include <QTableView>
+
+class FrameStats;
+
+/**
+ * @brief QTableView, замеряющий время каждого кадра отрисовки.
+ *
+ * paintEvent() обрамляется вызовами FrameStats::beginFrame()/endFrame(),
+ * поэтому в кадр попадают отрисовка делегатами и все вызовы model->data() из неё.
+ * Без подключённой статистики ведёт себя как обычный QTableView.
+ *
+ * @note Используется в mainwindow.ui как promoted-виджет для tableView.
+ */
+class InstrumentedTableView : public QTableView
+{
+    Q_OBJECT
+public:
+    explicit InstrumentedTableView(QWidget* parent = nullptr);
+
+    /// Подключает статистику кадров (nullptr — отключить). Владение не передаётся.
+    void setFrameStats(FrameStats* stats) { m_stats = stats; }
+    FrameStats* frameStats() const { return m_stats; }
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    FrameStats* m_stats = nullptr;
+};
+
+#endif // INSTRUMENTEDTABLEVIEW_H
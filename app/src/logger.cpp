@@ -0,0 +1,310 @@
+#include "logger.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QVector>
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#include "ringbuffer.h"
+
+LAB2_LOG_CATEGORY(lcDb, "db")
+LAB2_LOG_CATEGORY(lcModel, "model")
+LAB2_LOG_CATEGORY(lcPerf, "perf")
+
+namespace lab2log {
+
+const char* levelTag(Level level)
+{
+    switch (level) {
+    case Level::Debug:   return "D";
+    case Level::Info:    return "I";
+    case Level::Warning: return "W";
+    case Level::Error:   return "E";
+    }
+    return "?";
+}
+
+// -------------------- LogCategory --------------------
+
+LogCategory::LogCategory(const char* name)
+    : m_name(name)
+    , m_minLevel(static_cast<int>(Level::Info))
+{
+    Logger::instance().registerCategory(this);
+}
+
+// -------------------- Logger --------------------
+
+struct Logger::Impl
+{
+    MpmcRingBuffer<LogRecord> ring { static_cast<std::size_t>(kCapacity) };
+
+    std::atomic<quint64> pushed { 0 };
+    std::atomic<quint64> written { 0 };
+    std::atomic<quint64> dropped { 0 };
+    std::atomic<bool> stop { false };
+
+    // Писатель спит на wakeCv, пока буфер пуст; производители будят его, только если он спит.
+    // Производители при полном буфере и flush() ждут на progressCv, писатель будит их после записи.
+    std::mutex waitMutex;
+    std::condition_variable wakeCv;
+    std::condition_variable progressCv;
+    std::atomic<bool> writerSleeping { false };
+    std::atomic<int> waiters { 0 };
+
+    std::mutex sinkMutex;
+    Sink sink;
+    QFile file;
+
+    std::mutex categoriesMutex;
+    QVector<LogCategory*> categories;
+    Level defaultLevel = Level::Info;
+    QHash<QString, Level> rules;
+
+    std::thread writer;
+
+    void writeDefault(const LogRecord& r)
+    {
+        const QByteArray line =
+                (QDateTime::fromMSecsSinceEpoch(r.timestampMs).toString("hh:mm:ss.zzz")
+                 + QString(" [%1] %2: ").arg(levelTag(r.level), r.category)
+                 + r.text + '\n').toLocal8Bit();
+
+        std::fputs(line.constData(), stderr);
+        if (file.isOpen())
+            file.write(line);
+    }
+
+    void write(const LogRecord& r)
+    {
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        if (sink)
+            sink(r);
+        else
+            writeDefault(r);
+    }
+
+    /// Будит ждущих места в буфере / flush(), если такие есть.
+    void notifyProgress()
+    {
+        // Пара с барьером после waiters.fetch_add(): либо ждущий увидит свободное место, либо мы — его.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            progressCv.notify_all();
+        }
+    }
+
+    /// Будит писателя, если он спит (вызывается после tryPush).
+    void wakeWriter()
+    {
+        // Пара с барьером в run(): либо писатель увидит новую запись, либо мы увидим, что он спит.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (writerSleeping.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            wakeCv.notify_one();
+        }
+    }
+
+    void drain()
+    {
+        LogRecord r;
+        while (ring.tryPop(r)) {
+            write(r);
+            written.fetch_add(1);
+            notifyProgress();
+        }
+        if (file.isOpen())
+            file.flush();
+    }
+
+    void run()
+    {
+        for (;;) {
+            drain();
+            std::unique_lock<std::mutex> lock(waitMutex);
+            writerSleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            wakeCv.wait(lock, [this] { return !ring.emptyApprox() || stop.load(); });
+            writerSleeping.store(false, std::memory_order_relaxed);
+            if (stop.load()) {
+                lock.unlock();
+                drain();
+                return;
+            }
+        }
+    }
+};
+
+Logger& Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : d(new Impl)
+{
+    Level level = Level::Info;
+    if (parseLevel(qEnvironmentVariable("LAB2_LOG_LEVEL"), &level))
+        d->defaultLevel = level;
+
+    // LAB2_LOG_RULES="db=debug;model=warning"
+    const QStringList rules = qEnvironmentVariable("LAB2_LOG_RULES").split(';', Qt::SkipEmptyParts);
+    for (const QString& rule : rules) {
+        const QStringList kv = rule.split('=');
+        if (kv.size() == 2 && parseLevel(kv[1].trimmed(), &level))
+            d->rules.insert(kv[0].trimmed(), level);
+    }
+
+    const QString filePath = qEnvironmentVariable("LAB2_LOG_FILE");
+    if (!filePath.isEmpty()) {
+        d->file.setFileName(filePath);
+        if (!d->file.open(QIODevice::WriteOnly | QIODevice::Append))
+            std::fputs(qPrintable("LAB2_LOG_FILE: cannot open " + filePath + ": " + d->file.errorString() + '\n'),
+                       stderr);
+    }
+
+    d->writer = std::thread([this] { d->run(); });
+}
+
+Logger::~Logger()
+{
+    {
+        std::lock_guard<std::mutex> lock(d->waitMutex);
+        d->stop.store(true);
+        d->wakeCv.notify_one();
+        d->progressCv.notify_all();
+    }
+    if (d->writer.joinable())
+        d->writer.join();
+    d->file.close();
+}
+
+void Logger::push(LogRecord&& record)
+{
+    if (d->ring.tryPush(std::move(record))) {
+        d->pushed.fetch_add(1);
+        d->wakeWriter();
+        return;
+    }
+
+    // Буфер полон. Отладочный и информационный вывод не должен ждать stderr — запись отбрасывается.
+    // Сам писатель ждать себя не может (sink, который пишет в лог) — тоже.
+    if (record.level < Level::Warning || std::this_thread::get_id() == d->writer.get_id()) {
+        d->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Предупреждения и ошибки ждут, пока писатель освободит место: они не теряются и идут по порядку.
+    std::unique_lock<std::mutex> lock(d->waitMutex);
+    d->waiters.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    d->wakeCv.notify_one();
+    bool queued = false;
+    d->progressCv.wait(lock, [&] {
+        queued = d->ring.tryPush(std::move(record));
+        return queued || d->stop.load();
+    });
+    d->waiters.fetch_sub(1);
+    lock.unlock();
+
+    if (queued) {
+        d->pushed.fetch_add(1);
+        d->wakeWriter();
+    } else {
+        // Логгер останавливается (выход из программы) — пишем сами.
+        d->write(record);
+    }
+}
+
+void Logger::flush()
+{
+    const quint64 target = d->pushed.load();
+    std::unique_lock<std::mutex> lock(d->waitMutex);
+    d->waiters.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    d->wakeCv.notify_one();
+    d->progressCv.wait(lock, [&] { return d->written.load() >= target || d->stop.load(); });
+    d->waiters.fetch_sub(1);
+}
+
+void Logger::setSink(Sink sink)
+{
+    std::lock_guard<std::mutex> lock(d->sinkMutex);
+    d->sink = std::move(sink);
+}
+
+void Logger::setLevel(Level level)
+{
+    std::lock_guard<std::mutex> lock(d->categoriesMutex);
+    d->defaultLevel = level;
+    d->rules.clear();
+    for (LogCategory* c : d->categories)
+        c->setMinLevel(level);
+}
+
+void Logger::setCategoryLevel(const char* name, Level level)
+{
+    std::lock_guard<std::mutex> lock(d->categoriesMutex);
+    d->rules.insert(QString::fromLatin1(name), level);
+    for (LogCategory* c : d->categories) {
+        if (qstrcmp(c->name(), name) == 0)
+            c->setMinLevel(level);
+    }
+}
+
+quint64 Logger::droppedCount() const
+{
+    return d->dropped.load(std::memory_order_relaxed);
+}
+
+void Logger::registerCategory(LogCategory* category)
+{
+    std::lock_guard<std::mutex> lock(d->categoriesMutex);
+    d->categories.push_back(category);
+    category->setMinLevel(d->rules.value(QString::fromLatin1(category->name()), d->defaultLevel));
+}
+
+bool Logger::parseLevel(const QString& text, Level* out)
+{
+    const QString t = text.trimmed().toLower();
+    if (t == "debug")   { *out = Level::Debug;   return true; }
+    if (t == "info")    { *out = Level::Info;    return true; }
+    if (t == "warning") { *out = Level::Warning; return true; }
+    if (t == "error")   { *out = Level::Error;   return true; }
+    return false;
+}
+
+// -------------------- LogLine --------------------
+
+LogLine::LogLine(Level level, const LogCategory& category)
+    : m_level(level)
+    , m_category(category.name())
+{
+    m_stream.emplace(&m_text);
+}
+
+LogLine::~LogLine()
+{
+    // QDebug дописывает текст в строку при разрушении — поэтому сначала закрываем поток.
+    m_stream.reset();
+    // QDebug(QString*) пишет пробел после каждого аргумента прямо в строку, а при разрушении
+    // убирает его только из своего буфера.
+    if (m_text.endsWith(QLatin1Char(' ')))
+        m_text.chop(1);
+
+    LogRecord r;
+    r.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    r.level = m_level;
+    r.category = m_category;
+    r.text = std::move(m_text);
+    Logger::instance().push(std::move(r));
+}
+
+} // namespace lab2log
@@ -0,0 +1,200 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <QDebug>
+#include <QString>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+
+/**
+ * @brief Минимальный уровень, который вообще компилируется в бинарник.
+ *
+ * 0 — Debug, 1 — Info, 2 — Warning, 3 — Error.
+ * Вызовы ниже этого уровня вырезаются компилятором целиком (условие — константа),
+ * поэтому, например, LAB2_DEBUG в сборке с LAB2_LOG_MIN_LEVEL=1 не стоит ничего.
+ * Задаётся из CMake (опция LAB2_LOG_MIN_LEVEL).
+ */
+#ifndef LAB2_LOG_MIN_LEVEL
+#define LAB2_LOG_MIN_LEVEL 0
+#endif
+
+namespace lab2log {
+
+/// Уровень сообщения.
+enum class Level : int
+{
+    Debug = 0,
+    Info = 1,
+    Warning = 2,
+    Error = 3
+};
+
+/// Короткое имя уровня ("D", "I", "W", "E").
+const char* levelTag(Level level);
+
+/**
+ * @brief Категория логирования (аналог QLoggingCategory).
+ *
+ * Хранит собственный порог уровня, который проверяется одной relaxed-загрузкой атомика,
+ * поэтому проверка "включено ли" в горячем цикле практически бесплатна.
+ * Категории создаются макросом LAB2_LOG_CATEGORY и регистрируются в Logger.
+ */
+class LogCategory
+{
+public:
+    explicit LogCategory(const char* name);
+
+    const char* name() const { return m_name; }
+
+    bool isEnabled(Level level) const
+    {
+        return static_cast<int>(level) >= m_minLevel.load(std::memory_order_relaxed);
+    }
+
+    void setMinLevel(Level level) { m_minLevel.store(static_cast<int>(level), std::memory_order_relaxed); }
+
+private:
+    const char* m_name;
+    std::atomic<int> m_minLevel;
+};
+
+/// Одна запись лога в кольцевом буфере.
+struct LogRecord
+{
+    qint64 timestampMs = 0;
+    Level level = Level::Info;
+    const char* category = nullptr;
+    QString text;
+};
+
+/**
+ * @brief Асинхронный логгер: производители кладут записи в lock-free кольцевой буфер,
+ *        фоновый поток-писатель забирает их и выводит в sink (по умолчанию stderr).
+ *
+ * Пока в буфере есть место, производитель не ждёт. Если буфер полон (массовый вывод,
+ * например BD -> Print table), Debug/Info отбрасываются и считаются в droppedCount():
+ * скорость stderr не должна тормозить горячие циклы, которые пишут в лог.
+ * Warning/Error не теряются: производитель ждёт, пока писатель освободит место.
+ * Писатель спит на condition variable, пока буфер пуст, и не опрашивает его по таймеру.
+ *
+ * Настройка из окружения (читается при первом обращении):
+ *  - LAB2_LOG_LEVEL=debug|info|warning|error — порог для всех категорий (по умолчанию info),
+ *  - LAB2_LOG_RULES="db=debug;model=warning" — пороги отдельных категорий,
+ *  - LAB2_LOG_FILE=path — дублировать вывод в файл.
+ */
+class Logger
+{
+public:
+    using Sink = std::function<void(const LogRecord&)>;
+
+    /// Ёмкость кольцевого буфера (записей).
+    static constexpr int kCapacity = 8192;
+
+    static Logger& instance();
+
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /// Кладёт запись в буфер (вызывается из LogLine). Буфер полон: Debug/Info отбрасываются,
+    /// Warning/Error ждут места.
+    void push(LogRecord&& record);
+
+    /// Ждёт, пока писатель выведет всё, что было в буфере на момент вызова.
+    void flush();
+
+    /// Заменяет sink (nullptr — вернуть вывод по умолчанию). Вызывается писателем под мьютексом.
+    void setSink(Sink sink);
+
+    /// Порог для всех зарегистрированных категорий.
+    void setLevel(Level level);
+
+    /// Порог для одной категории по имени.
+    void setCategoryLevel(const char* name, Level level);
+
+    /// Количество отброшенных записей: Debug/Info при полном буфере, а также записи,
+    /// которые sink в потоке писателя сам кладёт в полный буфер (ждать себя писатель не может).
+    quint64 droppedCount() const;
+
+    /// Регистрирует категорию и применяет к ней текущие правила. Вызывается из LogCategory.
+    void registerCategory(LogCategory* category);
+
+    /// Разбирает "debug"/"info"/"warning"/"error". false — неизвестное имя.
+    static bool parseLevel(const QString& text, Level* out);
+
+private:
+    Logger();
+
+    struct Impl;
+    std::unique_ptr<Impl> d;
+};
+
+/**
+ * @brief Строка лога: собирает текст через QDebug и при разрушении кладёт запись в Logger.
+ *
+ * Форматирование такое же, как у qDebug() (пробелы между аргументами, кавычки у строк),
+ * поэтому замена qDebug() << ... на LAB2_INFO(cat) << ... не меняет вид сообщений.
+ */
+class LogLine
+{
+public:
+    LogLine(Level level, const LogCategory& category);
+    ~LogLine();
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    template <typename T>
+    LogLine& operator<<(const T& value)
+    {
+        *m_stream << value;
+        return *this;
+    }
+
+private:
+    Level m_level;
+    const char* m_category;
+    QString m_text;
+    std::optional<QDebug> m_stream;
+};
+
+} // namespace lab2log
+
+/// Объявляет функцию-категорию (в заголовке).
+#define LAB2_DECLARE_LOG_CATEGORY(fn) ::lab2log::LogCategory& fn();
+
+/// Определяет функцию-категорию (в .cpp). Объект создаётся при первом обращении.
+#define LAB2_LOG_CATEGORY(fn, categoryName) \
+    ::lab2log::LogCategory& fn() \
+    { \
+        static ::lab2log::LogCategory category(categoryName); \
+        return category; \
+    }
+
+/**
+ * @brief Базовый макрос. Аргументы << вычисляются только если уровень включён.
+ *
+ * Первая часть условия — константа времени компиляции (LAB2_LOG_MIN_LEVEL),
+ * вторая — атомарная проверка порога категории.
+ */
+#define LAB2_LOG(level, category) \
+    if (static_cast<int>(level) < LAB2_LOG_MIN_LEVEL || !(category).isEnabled(level)) {} \
+    else ::lab2log::LogLine((level), (category))
+
+#define LAB2_DEBUG(category)   LAB2_LOG(::lab2log::Level::Debug, category)
+#define LAB2_INFO(category)    LAB2_LOG(::lab2log::Level::Info, category)
+#define LAB2_WARNING(category) LAB2_LOG(::lab2log::Level::Warning, category)
+#define LAB2_ERROR(category)   LAB2_LOG(::lab2log::Level::Error, category)
+
+/// База данных: соединение, DDL, запросы.
+LAB2_DECLARE_LOG_CATEGORY(lcDb)
+/// Модель/представление.
+LAB2_DECLARE_LOG_CATEGORY(lcModel)
+/// Производительность: память, кадры, бенчмарки.
+LAB2_DECLARE_LOG_CATEGORY(lcPerf)
+
+#endif // LOGGER_H
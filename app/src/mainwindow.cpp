@@ -4,16 +4,46 @@
 // Реализация MainWindow: меню + операции с SQLite (QtSql) + отображение через QSqlTableModel.
 
 #include <QAction>
-#include <QDebug>
+#include <QDockWidget>
+#include <QFile>
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QInputDialog>
+#include <QLabel>
 #include <QMenu>
 #include <QMenuBar>
+#include <QScrollBar>
+#include <QStatusBar>
+#include <QTimer>
 
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlRecord>
 
+#include "changeexporter.h"
+#include "columnstats.h"
+#include "columnstatspanel.h"
+#include "groupbymodel.h"
+#include "groupbypanel.h"
+#include "groupcommitter.h"
+#include "heatmapview.h"
+#include "instrumentedtableview.h"
+#include "logger.h"
 #include "mydelegate.h"
 #include "myrect.h"
+#include "parallelscanner.h"
+#include "pipelineimporter.h"
+#include "rectanalytics.h"
+#include "rectangleschema.h"
+#include "rectangletablemodel.h"
+#include "rectarchive.h"
+#include "rectpdfreport.h"
+#include "rectrowdecoder.h"
+#include "rectsnapshot.h"
+#include "schemamigrator.h"
+#include "snapshotrefresher.h"
+#include "snapshottablemodel.h"
+#include "tilepyramid.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -22,10 +52,40 @@ MainWindow::MainWindow(QWidget *parent)
     ui->setupUi(this);
     this->setWindowTitle("lab2-qt20-db");
     setupMenus_();
+
+    m_memoryBudget.setLimitBytes(MemoryBudget::limitFromEnvironment());
+    m_busyRetry.setPolicy(BusyRetry::policyFromEnvironment());
+    m_palette.setBusyRetry(&m_busyRetry);
+
+    m_memoryLabel = new QLabel(this);
+    m_memoryLabel->setObjectName("memoryLabel");
+    statusBar()->addPermanentWidget(m_memoryLabel);
+    updateMemoryLabel_();
+
+    ui->tableView->setFrameStats(&m_frameStats);
+    // Делегаты цвета и стиля пера привязаны к колонкам представления и переживают смену модели.
+    ui->tableView->setItemDelegateForColumn(rectschema::PenColor, new MyDelegate(this));
+    ui->tableView->setItemDelegateForColumn(rectschema::PenStyle, new MyDelegate(this));
+    connect(ui->tableView->verticalScrollBar(), &QAbstractSlider::actionTriggered,
+            this, &MainWindow::onTableScrollAction_);
+
+    m_frameLabel = new QLabel(this);
+    m_frameLabel->setObjectName("frameLabel");
+    statusBar()->addPermanentWidget(m_frameLabel);
+    updateFrameLabel_();
+
+    auto* frameTimer = new QTimer(this);
+    connect(frameTimer, &QTimer::timeout, this, &MainWindow::updateFrameLabel_);
+    frameTimer->start(kFrameLabelRefreshMs_);
+
+    // Соединение задаётся в onCreateConnection(); до первого скана трекер правки не считает.
+    m_columnStats = new ColumnStatsTracker(QSqlDatabase(), kTable_, this);
+    m_columnStats->setPalette(&m_palette);
 }
 
 MainWindow::~MainWindow()
 {
+    flushPendingEdits_();
     delete ui;
 }
 
@@ -40,16 +100,345 @@ MainWindow::~MainWindow()
 bool MainWindow::ensureDbOpen_(const char* caller) const
 {
     if (!m_db.isValid()) {
-        qDebug() << caller << ": DB is not valid. Call BD -> Create connection.";
+        LAB2_WARNING(lcDb()) << caller << ": DB is not valid. Call BD -> Create connection.";
         return false;
     }
     if (!m_db.isOpen()) {
-        qDebug() << caller << ": DB is not open. Call BD -> Create connection.";
+        LAB2_WARNING(lcDb()) << caller << ": DB is not open. Call BD -> Create connection.";
+        return false;
+    }
+    return true;
+}
+
+bool MainWindow::ensureDbReady_(const char* caller)
+{
+    if (!ensureDbOpen_(caller)) return false;
+    flushPendingEdits_();
+    return true;
+}
+
+void MainWindow::flushPendingEdits_()
+{
+    if (m_groupCommit)
+        m_groupCommit->flush();
+}
+
+void MainWindow::onGroupRolledBack_(int changes, const QString& error)
+{
+    // Цвета, добавленные idFor() в откаченной группе, в pen_palette больше нет.
+    m_palette.invalidate();
+    for (auto& p : m_schemaPalettes)
+        p.second->invalidate();
+
+    // Сводка по колонкам уже учла откаченные правки (трекер применяет их до фиксации).
+    rescanColumnStats_("onGroupRolledBack_");
+
+    // Модели GroupCommitter уже перечитал; пользователю — что правки не сохранились.
+    statusBar()->showMessage(QString("Edits not saved (%1 rolled back): %2").arg(changes).arg(error));
+}
+
+void MainWindow::scheduleBudgetCheck_()
+{
+    m_memoryBudget.touch(m_modelCacheId);
+
+    if (m_budgetCheckPending) return;
+    m_budgetCheckPending = true;
+    QTimer::singleShot(0, this, &MainWindow::enforceMemoryBudget_);
+}
+
+void MainWindow::enforceMemoryBudget_()
+{
+    m_budgetCheckPending = false;
+
+    const qint64 freed = m_memoryBudget.enforce();
+    if (freed > 0) {
+        LAB2_INFO(lcPerf()) << "memory budget: evicted" << MemoryBudget::formatBytes(freed)
+                 << "limit=" << MemoryBudget::formatBytes(m_memoryBudget.limitBytes());
+    }
+    updateMemoryLabel_();
+}
+
+void MainWindow::updateMemoryLabel_()
+{
+    if (!m_memoryLabel) return;
+
+    QStringList details;
+    for (const auto& u : m_memoryBudget.usage())
+        details << QString("%1: %2").arg(u.name, MemoryBudget::formatBytes(u.bytes));
+
+    m_memoryLabel->setText(QString("Cache: %1 / %2")
+                           .arg(MemoryBudget::formatBytes(m_memoryBudget.totalBytes()),
+                                MemoryBudget::formatBytes(m_memoryBudget.limitBytes())));
+    m_memoryLabel->setToolTip(details.join('\n'));
+}
+
+void MainWindow::updateFrameLabel_()
+{
+    if (!m_frameLabel) return;
+    m_frameLabel->setText(m_frameStats.shortText());
+}
+
+void MainWindow::showModel_(QAbstractItemModel* model)
+{
+    if (ui->tableView->model() != model)
+        ui->tableView->setModel(model);
+
+    // временно скрыть id (как в методичке)
+    ui->tableView->hideColumn(rectschema::Id);
+
+    ui->tableView->resizeColumnsToContents();
+}
+
+bool MainWindow::viewShowsTableModel_() const
+{
+    return m_model && ui->tableView->model() == m_model;
+}
+
+QString MainWindow::currentTable() const
+{
+    return viewShowsTableModel_() ? m_model->tableName() : QString();
+}
+
+RectangleTableModel* MainWindow::createTableModel_()
+{
+    auto* model = new RectangleTableModel(this, m_db);
+    model->setFrameStats(&m_frameStats);
+
+    // Правки из таблицы (делегаты, вставка/удаление строк) фиксируются группами.
+    if (!m_groupCommit) {
+        m_groupCommit = new GroupCommitter(m_db, this);
+        m_groupCommit->setBusyRetry(&m_busyRetry);
+        connect(m_groupCommit, &GroupCommitter::rolledBack, this, &MainWindow::onGroupRolledBack_);
+    }
+    m_groupCommit->attach(model);
+
+    // Сводка по колонкам обновляется по тем же правкам.
+    m_columnStats->attach(model);
+
+    // Кэш строк текущей модели растёт при прокрутке (fetchMore) — ставим его на учёт в бюджете.
+    // Запаркованные модели учитывает m_warmModels.
+    if (m_modelCacheId == 0) {
+        m_modelCacheId = m_memoryBudget.registerConsumer(
+                    "table model rows",
+                    [this] {
+                        return m_model ? MemoryBudget::estimateRowCacheBytes(m_model->rowCount(),
+                                                                             m_model->columnCount())
+                                       : 0;
+                    },
+                    [this](qint64 bytesToFree) { return evictModelCache_(bytesToFree); });
+    }
+
+    connect(model, &QAbstractItemModel::rowsInserted, this, &MainWindow::scheduleBudgetCheck_);
+    connect(model, &QAbstractItemModel::modelReset,   this, &MainWindow::updateMemoryLabel_);
+    return model;
+}
+
+bool MainWindow::activateModel_(const QString& table, WarmModelCache::Entry* warm)
+{
+    *warm = WarmModelCache::Entry();
+    if (m_model && m_model->tableName() == table)
+        return true;
+
+    // Текущая модель другой таблицы остаётся тёплой: строки, ORDER BY и состояние вида сохраняются.
+    if (m_model && !m_model->tableName().isEmpty()) {
+        if (m_model->isDirty() && !m_model->submitAll()) {
+            LAB2_WARNING(lcModel()) << "selectTable: cannot save edits of" << m_model->tableName() << ":"
+                                    << m_model->lastError().text();
+            return false;
+        }
+        const WarmModelCache::ViewState state = viewShowsTableModel_() ? captureViewState_()
+                                                                       : WarmModelCache::ViewState();
+        if (!m_warmModels.park(m_model->tableName(), m_model, state)) {
+            LAB2_WARNING(lcModel()) << "selectTable: cannot park model of" << m_model->tableName();
+            return false;
+        }
+        m_model = nullptr;
+    }
+
+    *warm = m_warmModels.take(table);
+    if (warm->model) {
+        // Пустая модель (после clear()) больше не нужна; view переключится на тёплую модель.
+        if (m_model)
+            m_model->deleteLater();
+        m_model = static_cast<RectangleTableModel*>(warm->model);
+    } else if (!m_model) {
+        m_model = createTableModel_();
+    }
+    return true;
+}
+
+bool MainWindow::loadModel_(const QString& table, const char* caller)
+{
+    m_model->setPalette(paletteFor_(table));
+    m_model->setTable(table);
+
+    // стратегия редактирования (методичка: можно выбрать)
+    // 0: OnFieldChange — сразу пишет в БД
+    // 1: OnRowChange — пишет при уходе со строки (default)
+    // 2: OnManualSubmit — по submitAll()
+    m_model->setEditStrategy(QSqlTableModel::OnRowChange);
+
+    if (!m_model->select()) {
+        LAB2_WARNING(lcModel()) << caller << ": select() failed:" << m_model->lastError().text();
         return false;
     }
+
+    // Заголовки (setHeaderData унаследован от QAbstractItemModel) — из описания схемы
+    for (int c = 0; c < rectschema::ColumnCount && c < m_model->columnCount(); ++c)
+        m_model->setHeaderData(c, Qt::Horizontal, rectschema::kColumns[c].header);
+
+    showModel_(m_model);
+
+    enforceMemoryBudget_();
+
+    LAB2_INFO(lcModel()) << caller << ": loaded" << table << "rows=" << m_model->rowCount();
     return true;
 }
 
+PenPalette* MainWindow::paletteFor_(const QString& table)
+{
+    const QString schema = RectangleTableModel::schemaOf(table);
+    if (schema.isEmpty())
+        return &m_palette;
+
+    // pen_id таблицы присоединённой БД ссылается на pen_palette той же БД.
+    std::unique_ptr<PenPalette>& palette = m_schemaPalettes[schema];
+    if (!palette) {
+        palette = std::make_unique<PenPalette>(m_db, schema);
+        palette->setBusyRetry(&m_busyRetry);
+    }
+    return palette.get();
+}
+
+WarmModelCache::ViewState MainWindow::captureViewState_() const
+{
+    const QTableView* view = ui->tableView;
+    WarmModelCache::ViewState s;
+    s.verticalScroll = view->verticalScrollBar()->value();
+    s.horizontalScroll = view->horizontalScrollBar()->value();
+
+    const QModelIndex cur = view->currentIndex();
+    if (cur.isValid()) {
+        s.currentRow = cur.row();
+        s.currentColumn = cur.column();
+    }
+
+    const QHeaderView* header = view->horizontalHeader();
+    if (header->isSortIndicatorShown()) {
+        s.sortColumn = header->sortIndicatorSection();
+        s.sortOrder = header->sortIndicatorOrder();
+    }
+    return s;
+}
+
+void MainWindow::restoreViewState_(const WarmModelCache::ViewState& s)
+{
+    QTableView* view = ui->tableView;
+
+    QHeaderView* header = view->horizontalHeader();
+    header->setSortIndicatorShown(s.sortColumn >= 0);
+    if (s.sortColumn >= 0)
+        header->setSortIndicator(s.sortColumn, s.sortOrder);
+
+    if (s.currentRow >= 0 && s.currentRow < m_model->rowCount())
+        view->setCurrentIndex(m_model->index(s.currentRow, s.currentColumn));
+
+    // Диапазоны полос прокрутки после setModel() пересчитываются отложенно —
+    // раскладываем сразу, иначе setValue() обрежет позицию до нуля.
+    view->doItemsLayout();
+    view->verticalScrollBar()->setValue(s.verticalScroll);
+    view->horizontalScrollBar()->setValue(s.horizontalScroll);
+}
+
+qint64 MainWindow::evictModelCache_(qint64 /*bytesToFree*/)
+{
+    if (!m_model || m_model->isDirty() || m_modelWindowMoving) return 0;
+
+    const auto cacheBytes = [this] {
+        return MemoryBudget::estimateRowCacheBytes(m_model->rowCount(), m_model->columnCount());
+    };
+
+    // Видимая область (вид может показывать не m_model — тогда держим только запас).
+    QTableView* view = ui->tableView;
+    int first = 0;
+    int visible = 0;
+    if (viewShowsTableModel_() && m_model->rowCount() > 0) {
+        first = qMax(0, view->rowAt(0));
+        int last = view->rowAt(view->viewport()->height() - 1);
+        if (last < 0) last = m_model->rowCount() - 1;
+        visible = qMax(0, last - first + 1);
+    }
+
+    const int drop = qMax(0, first - kModelWindowMargin_);
+    const int keep = first - drop + visible + kModelWindowMargin_;
+    if (m_model->rowCount() - keep < kModelWindowMargin_)
+        return 0; // всё загруженное и так рядом с видимой областью
+
+    const qint64 before = cacheBytes();
+    if (!moveModelWindow_(m_model->windowOffset() + drop, kModelWindowMargin_))
+        return 0;
+    LAB2_DEBUG(lcModel()) << "evictModelCache_: window offset" << m_model->windowOffset()
+                          << "rows" << m_model->rowCount();
+    return qMax<qint64>(0, before - cacheBytes());
+}
+
+bool MainWindow::moveModelWindow_(int offset, int margin)
+{
+    QTableView* view = ui->tableView;
+    const bool shown = viewShowsTableModel_();
+
+    // Позиции в сквозной нумерации выборки: после смены окна индексы строк модели сдвигаются.
+    const int oldOffset = m_model->windowOffset();
+    const int firstAbs = oldOffset + (shown ? qMax(0, view->rowAt(0)) : 0);
+    int visible = 0;
+    if (shown) {
+        const int last = view->rowAt(view->viewport()->height() - 1);
+        visible = last < 0 ? m_model->rowCount() - (firstAbs - oldOffset) : last - (firstAbs - oldOffset) + 1;
+    }
+    const QModelIndex cur = shown ? view->currentIndex() : QModelIndex();
+    const int curAbs = cur.isValid() ? oldOffset + cur.row() : -1;
+    const int hScroll = view->horizontalScrollBar()->value();
+
+    m_modelWindowMoving = true;
+    m_model->setWindowOffset(offset);
+    const bool ok = m_model->select();
+    if (!ok) {
+        LAB2_WARNING(lcModel()) << "moveModelWindow_: select() failed:" << m_model->lastError().text();
+    } else {
+        const int top = qMax(0, firstAbs - offset);
+        while (m_model->rowCount() < top + qMax(0, visible) + margin && m_model->canFetchMore())
+            m_model->fetchMore();
+
+        if (shown && m_model->rowCount() > 0) {
+            if (curAbs >= offset && curAbs - offset < m_model->rowCount())
+                view->setCurrentIndex(m_model->index(curAbs - offset, cur.column()));
+            view->doItemsLayout();
+            view->scrollTo(m_model->index(qMin(top, m_model->rowCount() - 1), 1), QAbstractItemView::PositionAtTop);
+            view->horizontalScrollBar()->setValue(hScroll);
+        }
+    }
+    m_modelWindowMoving = false;
+    return ok;
+}
+
+void MainWindow::onTableScrollAction_(int /*action*/)
+{
+    if (m_modelWindowMoving || !viewShowsTableModel_() || m_model->windowOffset() == 0)
+        return;
+    const QScrollBar* bar = ui->tableView->verticalScrollBar();
+    // Значение ещё не применено (actionTriggered) — смотрим sliderPosition(), сдвиг окна — после.
+    if (bar->sliderPosition() <= bar->minimum())
+        QTimer::singleShot(0, this, &MainWindow::shiftModelWindowUp_);
+}
+
+void MainWindow::shiftModelWindowUp_()
+{
+    if (m_modelWindowMoving || !viewShowsTableModel_() || m_model->isDirty() || m_model->windowOffset() == 0)
+        return;
+    if (moveModelWindow_(qMax(0, m_model->windowOffset() - kModelWindowStep_), kModelWindowMargin_))
+        scheduleBudgetCheck_();
+}
+
 // -------------------- BD --------------------
 
 /**
@@ -63,117 +452,198 @@ void MainWindow::onCreateConnection()
     // Создаём/переиспользуем именованное соединение
     if (QSqlDatabase::contains(kConnName_)) {
         m_db = QSqlDatabase::database(kConnName_);
-        qDebug() << "onCreateConnection: reuse connection" << m_db.connectionName();
+        LAB2_INFO(lcDb()) << "onCreateConnection: reuse connection" << m_db.connectionName();
     } else {
         m_db = QSqlDatabase::addDatabase("QSQLITE", kConnName_);
-        qDebug() << "onCreateConnection: addDatabase QSQLITE conn=" << kConnName_;
+        LAB2_INFO(lcDb()) << "onCreateConnection: addDatabase QSQLITE conn=" << kConnName_;
     }
 
     if (!m_db.isValid()) {
-        qDebug() << "onCreateConnection: invalid connection";
-        qDebug() << "lastError:" << m_db.lastError().text();
+        LAB2_WARNING(lcDb()) << "onCreateConnection: invalid connection";
+        LAB2_WARNING(lcDb()) << "lastError:" << m_db.lastError().text();
         return;
     }
 
     m_db.setDatabaseName(kDbFile_);
 
     if (!m_db.open()) {
-        qDebug() << "onCreateConnection: open() failed";
-        qDebug() << "lastError:" << m_db.lastError().text();
+        LAB2_WARNING(lcDb()) << "onCreateConnection: open() failed";
+        LAB2_WARNING(lcDb()) << "lastError:" << m_db.lastError().text();
         return;
     }
 
-    qDebug() << "onCreateConnection: OK. db=" << m_db.databaseName();
-    qDebug() << "tables:" << m_db.tables();
+    // Другие процессы (читатели, писатель) держат блокировки файла — ждём, а не падаем сразу.
+    m_busyRetry.applyBusyTimeout(m_db);
+
+    m_palette.setDatabase(m_db);
+    m_columnStats->setDatabase(m_db);
+    for (auto& p : m_schemaPalettes)
+        p.second->invalidate();
+
+    LAB2_INFO(lcDb()) << "onCreateConnection: OK. db=" << m_db.databaseName();
+    LAB2_INFO(lcDb()) << "tables:" << m_db.tables();
 }
 
 void MainWindow::onCloseConnection()
 {
     if (!m_db.isValid()) {
-        qDebug() << "onCloseConnection: DB is not valid";
+        LAB2_WARNING(lcDb()) << "onCloseConnection: DB is not valid";
         return;
     }
 
     if (m_db.isOpen()) {
+        flushPendingEdits_();
+        // Тёплые модели держат открытые SELECT по этому соединению.
+        m_warmModels.clear();
         m_db.close();
-        qDebug() << "onCloseConnection: closed";
+        LAB2_INFO(lcDb()) << "onCloseConnection: closed";
     } else {
-        qDebug() << "onCloseConnection: already closed";
+        LAB2_INFO(lcDb()) << "onCloseConnection: already closed";
     }
 }
 
 void MainWindow::onCreateTable()
 {
-    if (!ensureDbOpen_("onCreateTable")) return;
-
-    // Если таблица уже была — удаляем (как требует задание)
-    if (m_db.tables().contains(kTable_)) {
-        qDebug() << "onCreateTable: table exists, dropping first...";
-        onDropTable();
-        if (!ensureDbOpen_("onCreateTable(after drop)")) return;
+    if (!ensureDbReady_("onCreateTable")) return;
+
+    // Схема доводится миграциями до последней версии; существующие данные сохраняются.
+    SchemaMigrator migrator(m_db);
+    migrator.setBusyRetry(&m_busyRetry);
+    const int from = migrator.currentVersion();
+    const bool fresh = !m_db.tables().contains(kTable_);
+    if (from >= migrator.targetVersion() && !fresh) {
+        LAB2_INFO(lcDb()) << "onCreateTable: schema is up to date, version" << from;
+        return;
     }
 
-    const QString sql =
-            "CREATE TABLE rectangle ("
-            " id INTEGER PRIMARY KEY AUTOINCREMENT,"
-            " pencolor VARCHAR,"
-            " penstyle INTEGER,"
-            " penwidth INTEGER,"
-            " left INTEGER,"
-            " top INTEGER,"
-            " width INTEGER,"
-            " height INTEGER"
-            ");";
-
-    QSqlQuery q(m_db);
-    if (!q.exec(sql)) {
-        qDebug() << "onCreateTable: CREATE TABLE failed:" << q.lastError().text();
+    // Перестройка таблицы не пройдёт, пока модели держат открытый SELECT по ней.
+    const QString reloadTable = m_model ? m_model->tableName() : QString();
+    if (!reloadTable.isEmpty())
+        m_model->clear();
+    m_warmModels.clear();
+
+    const bool ok = migrator.migrate(-1, [this](int version, qint64 done, qint64 total) {
+        const QString msg = QString("Migrating schema to v%1: %2 / %3 rows").arg(version).arg(done).arg(total);
+        LAB2_INFO(lcDb()) << "onCreateTable:" << msg;
+        statusBar()->showMessage(msg);
+    });
+    statusBar()->clearMessage();
+
+    if (!ok) {
+        LAB2_WARNING(lcDb()) << "onCreateTable: migration failed:" << migrator.lastError();
         return;
     }
 
-    qDebug() << "onCreateTable: OK";
-    qDebug() << "tables:" << m_db.tables();
+    // Миграция могла создать или заполнить словарь цветов.
+    m_palette.invalidate();
+
+    // Новая пустая таблица: отметки прежних импортов указывают на строки, которых в ней нет.
+    if (fresh)
+        PipelineImporter::clearAllProgress(m_db);
+
+    LAB2_INFO(lcDb()) << "onCreateTable: OK, schema version" << migrator.currentVersion();
+    LAB2_INFO(lcDb()) << "tables:" << m_db.tables();
+
+    rescanColumnStats_("onCreateTable");
+
+    if (!reloadTable.isEmpty())
+        selectTable(reloadTable);
 }
 
 void MainWindow::onDropTable()
 {
-    if (!ensureDbOpen_("onDropTable")) return;
+    if (!ensureDbReady_("onDropTable")) return;
 
     if (!m_db.tables().contains(kTable_)) {
-        qDebug() << "onDropTable: table does not exist";
+        LAB2_WARNING(lcDb()) << "onDropTable: table does not exist";
+        return;
+    }
+
+    // DROP TABLE не пройдёт, пока тёплая модель держит открытый SELECT по таблице.
+    m_warmModels.remove(kTable_);
+
+    // Маркер журнала, DROP и сброс версии — одна транзакция: потребитель журнала не увидит 'X'
+    // при живой таблице, а таблица не пропадёт без маркера.
+    if (!m_busyRetry.transaction(m_db)) {
+        LAB2_WARNING(lcDb()) << "onDropTable: BEGIN failed:" << m_db.lastError().text();
         return;
     }
 
     QSqlQuery q(m_db);
-    if (!q.exec("DROP TABLE rectangle;")) {
-        qDebug() << "onDropTable: DROP TABLE failed:" << q.lastError().text();
+    const auto abort = [this, &q](const char* what) {
+        LAB2_WARNING(lcDb()) << "onDropTable:" << what << "failed:" << q.lastError().text();
+        q.finish();
+        m_db.rollback();
+    };
+
+    // Для потребителей журнала изменений: таблица удалена целиком (op = 'X').
+    if (m_db.tables().contains(ChangeExporter::kChangesTable)
+            && !m_busyRetry.exec(q, "INSERT INTO rectangle_changes (op, row_id) VALUES ('X', 0);")) {
+        abort("change log marker");
+        return;
+    }
+
+    if (!m_busyRetry.exec(q, "DROP TABLE rectangle;")) {
+        abort("DROP TABLE");
+        return;
+    }
+
+    // Схема удалена — следующий Create table должен пройти все миграции заново.
+    if (!m_busyRetry.exec(q, "PRAGMA user_version = 0;")) {
+        abort("reset user_version");
+        return;
+    }
+
+    // Данные удалены вместе с таблицей — прерванный импорт продолжать некуда.
+    if (!PipelineImporter::clearAllProgress(m_db)) {
+        abort("clear import progress");
+        return;
+    }
+
+    q.finish();
+    if (!m_busyRetry.commit(m_db)) {
+        LAB2_WARNING(lcDb()) << "onDropTable: COMMIT failed:" << m_db.lastError().text();
+        m_db.rollback();
         return;
     }
 
-    qDebug() << "onDropTable: OK";
-    qDebug() << "tables:" << m_db.tables();
+    m_columnStats->clear();
+
+    LAB2_INFO(lcDb()) << "onDropTable: OK";
+    LAB2_INFO(lcDb()) << "tables:" << m_db.tables();
 }
 
 void MainWindow::onInsertInto()
 {
-    if (!ensureDbOpen_("onInsertInto")) return;
+    if (!ensureDbReady_("onInsertInto")) return;
 
     if (!m_db.tables().contains(kTable_)) {
-        qDebug() << "onInsertInto: table does not exist. Call BD -> Create table first.";
+        LAB2_WARNING(lcDb()) << "onInsertInto: table does not exist. Call BD -> Create table first.";
+        return;
+    }
+
+    // Цвет в таблице — id из словаря pen_palette (новые цвета словарь добавляет сам).
+    const int redId = m_palette.idFor(QColor("#ff0000"));
+    if (redId < 0) {
+        LAB2_WARNING(lcDb()) << "onInsertInto: palette failed:" << m_palette.lastError();
         return;
     }
 
+    // Сводка по колонкам получает ровно вставленные строки (и при ошибке на полпути) — без скана.
+    ColumnStats added;
+
     // 1) Один прямоугольник: INSERT ... VALUES
     {
         QSqlQuery q(m_db);
-        const QString sql =
-                "INSERT INTO rectangle (pencolor, penstyle, penwidth, left, top, width, height) "
-                "VALUES ('#ff0000', 1, 3, 10, 20, 60, 60);";
-        if (!q.exec(sql)) {
-            qDebug() << "onInsertInto: simple INSERT failed:" << q.lastError().text();
+        const QString sql = QString("INSERT INTO %1 (%2) VALUES (%3, 1, 3, 10, 20, 60, 60);")
+                .arg(rectschema::kTable, rectschema::kInsertColumns)
+                .arg(redId);
+        if (!m_busyRetry.exec(q, sql)) {
+            LAB2_WARNING(lcDb()) << "onInsertInto: simple INSERT failed:" << q.lastError().text();
             return;
         }
-        qDebug() << "onInsertInto: simple INSERT OK";
+        added.add(MyRect(QColor("#ff0000"), Qt::SolidLine, 3, 10, 20, 60, 60));
+        LAB2_INFO(lcDb()) << "onInsertInto: simple INSERT OK";
     }
 
     // Данные (MyRect из ЛР1)
@@ -183,41 +653,53 @@ void MainWindow::onInsertInto()
         MyRect(QColor("#aaaaaa"), Qt::DotLine,   4, 50, 70,  30,  90),
     };
 
+    QVector<int> penIds;
+    for (const auto& r : rects) {
+        penIds << m_palette.idFor(r.penColor);
+        if (penIds.last() < 0) {
+            LAB2_WARNING(lcDb()) << "onInsertInto: palette failed:" << m_palette.lastError();
+            m_columnStats->addRows(added);
+            return;
+        }
+    }
+
     // 2) prepare + bindValue(":name", ...)
     {
         QSqlQuery q(m_db);
-        q.prepare(
-                    "INSERT INTO rectangle (pencolor, penstyle, penwidth, left, top, width, height) "
-                    "VALUES (:pencolor, :penstyle, :penwidth, :left, :top, :width, :height)"
-                    );
-
-        for (const auto& r : rects) {
-            q.bindValue(":pencolor", r.penColor.name());
-            q.bindValue(":penstyle", static_cast<int>(r.penStyle));
-            q.bindValue(":penwidth", r.penWidth);
-            q.bindValue(":left",     r.left);
-            q.bindValue(":top",      r.top);
-            q.bindValue(":width",    r.width);
-            q.bindValue(":height",   r.height);
-
-            if (!q.exec()) {
-                qDebug() << "onInsertInto: named bindValue failed:" << q.lastError().text();
+        q.prepare(rectschema::kNamedInsertSql);
+
+        // ":pen_id", ":penstyle", ... — имена параметров совпадают с именами колонок
+        using namespace rectschema;
+        const auto param = [](Column c) { return QString(":") + kColumns[c].name; };
+
+        for (int i = 0; i < rects.size(); ++i) {
+            const MyRect& r = rects.at(i);
+            q.bindValue(param(PenColor), penIds.at(i));
+            q.bindValue(param(PenStyle), static_cast<int>(r.penStyle));
+            q.bindValue(param(PenWidth), r.penWidth);
+            q.bindValue(param(Left),     r.left);
+            q.bindValue(param(Top),      r.top);
+            q.bindValue(param(Width),    r.width);
+            q.bindValue(param(Height),   r.height);
+
+            if (!m_busyRetry.exec(q)) {
+                LAB2_WARNING(lcDb()) << "onInsertInto: named bindValue failed:" << q.lastError().text();
+                m_columnStats->addRows(added);
                 return;
             }
+            added.add(r);
         }
-        qDebug() << "onInsertInto: named bindValue OK";
+        LAB2_INFO(lcDb()) << "onInsertInto: named bindValue OK";
     }
 
     // 3) prepare + addBindValue (позиционные '?')
     {
         QSqlQuery q(m_db);
-        q.prepare(
-                    "INSERT INTO rectangle (pencolor, penstyle, penwidth, left, top, width, height) "
-                    "VALUES (?,?,?,?,?,?,?)"
-                    );
+        q.prepare(rectschema::kInsertSql);
 
-        for (const auto& r : rects) {
-            q.addBindValue(r.penColor.name());
+        for (int i = 0; i < rects.size(); ++i) {
+            const MyRect& r = rects.at(i);
+            q.addBindValue(penIds.at(i));
             q.addBindValue(static_cast<int>(r.penStyle));
             q.addBindValue(r.penWidth);
             q.addBindValue(r.left);
@@ -225,144 +707,338 @@ void MainWindow::onInsertInto()
             q.addBindValue(r.width);
             q.addBindValue(r.height);
 
-            if (!q.exec()) {
-                qDebug() << "onInsertInto: addBindValue failed:" << q.lastError().text();
+            if (!m_busyRetry.exec(q)) {
+                LAB2_WARNING(lcDb()) << "onInsertInto: addBindValue failed:" << q.lastError().text();
+                m_columnStats->addRows(added);
                 return;
             }
+            added.add(r);
         }
-        qDebug() << "onInsertInto: addBindValue OK";
+        LAB2_INFO(lcDb()) << "onInsertInto: addBindValue OK";
     }
 
     // 4) prepare + bindValue(pos, ...) (позиционный bindValue)
     {
         QSqlQuery q(m_db);
-        q.prepare(
-                    "INSERT INTO rectangle (pencolor, penstyle, penwidth, left, top, width, height) "
-                    "VALUES (?,?,?,?,?,?,?)"
-                    );
-
-        for (const auto& r : rects) {
-            q.bindValue(0, r.penColor.name());
-            q.bindValue(1, static_cast<int>(r.penStyle));
-            q.bindValue(2, r.penWidth);
-            q.bindValue(3, r.left);
-            q.bindValue(4, r.top);
-            q.bindValue(5, r.width);
-            q.bindValue(6, r.height);
-
-            if (!q.exec()) {
-                qDebug() << "onInsertInto: positional bindValue failed:" << q.lastError().text();
+        q.prepare(rectschema::kInsertSql);
+
+        for (int i = 0; i < rects.size(); ++i) {
+            const MyRect& r = rects.at(i);
+            using namespace rectschema;
+            q.bindValue(insertPosition(PenColor), penIds.at(i));
+            q.bindValue(insertPosition(PenStyle), static_cast<int>(r.penStyle));
+            q.bindValue(insertPosition(PenWidth), r.penWidth);
+            q.bindValue(insertPosition(Left),     r.left);
+            q.bindValue(insertPosition(Top),      r.top);
+            q.bindValue(insertPosition(Width),    r.width);
+            q.bindValue(insertPosition(Height),   r.height);
+
+            if (!m_busyRetry.exec(q)) {
+                LAB2_WARNING(lcDb()) << "onInsertInto: positional bindValue failed:" << q.lastError().text();
+                m_columnStats->addRows(added);
                 return;
             }
+            added.add(r);
         }
-        qDebug() << "onInsertInto: positional bindValue OK";
+        LAB2_INFO(lcDb()) << "onInsertInto: positional bindValue OK";
     }
 
-    qDebug() << "onInsertInto: DONE";
+    LAB2_INFO(lcDb()) << "onInsertInto: DONE";
+
+    m_columnStats->addRows(added);
 }
 
 void MainWindow::onPrintTable()
 {
-    if (!ensureDbOpen_("onPrintTable")) return;
+    if (!ensureDbReady_("onPrintTable")) return;
 
     if (!m_db.tables().contains(kTable_)) {
-        qDebug() << "onPrintTable: table does not exist. Call BD -> Create table first.";
+        LAB2_WARNING(lcDb()) << "onPrintTable: table does not exist. Call BD -> Create table first.";
         return;
     }
 
+    // forward-only: драйвер не кэширует уже прочитанные строки (память не растёт с размером таблицы)
     QSqlQuery q(m_db);
-    if (!q.exec("SELECT * FROM rectangle;")) {
-        qDebug() << "onPrintTable: SELECT failed:" << q.lastError().text();
+    q.setForwardOnly(true);
+    if (!m_busyRetry.exec(q, "SELECT * FROM rectangle;")) {
+        LAB2_WARNING(lcDb()) << "onPrintTable: SELECT failed:" << q.lastError().text();
         return;
     }
 
-    // SELECT * -> индексы по именам через record().indexOf()
-    const QSqlRecord rec = q.record();
-    const int idCol       = rec.indexOf("id");
-    const int colorCol    = rec.indexOf("pencolor");
-    const int styleCol    = rec.indexOf("penstyle");
-    const int penWidthCol = rec.indexOf("penwidth");
-    const int leftCol     = rec.indexOf("left");
-    const int topCol      = rec.indexOf("top");
-    const int widthCol    = rec.indexOf("width");
-    const int heightCol   = rec.indexOf("height");
+    // Словарь читается из БД, а не из m_palette: импорты добавляют цвета своим PenPalette.
+    QString paletteError;
+    const QVector<QColor> colors = PenPalette::loadColors(m_db, &paletteError);
+    if (!paletteError.isEmpty()) {
+        LAB2_WARNING(lcDb()) << "onPrintTable: cannot read pen palette:" << paletteError;
+        return;
+    }
+
+    // SELECT * -> индексы по именам ищутся один раз (RectRowDecoder), дальше строки читаются по ним
+    RectRowDecoder decoder(q.record(), colors);
+    if (!decoder.isValid()) {
+        LAB2_WARNING(lcDb()) << "onPrintTable: missing columns:" << decoder.missingColumns();
+        return;
+    }
 
-    qDebug() << "onPrintTable: rows:";
+    LAB2_INFO(lcDb()) << "onPrintTable: rows:";
+    RectRow row;
+    qint64 printed = 0;
     while (q.next()) {
-        qDebug()
-                << "id="    << q.value(idCol).toInt()
-                << "color=" << q.value(colorCol).toString()
-                << "style=" << q.value(styleCol).toInt()
-                << "pW="    << q.value(penWidthCol).toInt()
-                << "rect=(" << q.value(leftCol).toInt()
-                << ","      << q.value(topCol).toInt()
-                << ","      << q.value(widthCol).toInt()
-                << ","      << q.value(heightCol).toInt()
+        // Info при полном буфере логгера отбрасывается; печать — явный запрос, поэтому ждём писателя
+        // каждые полбуфера строк.
+        if (++printed % (lab2log::Logger::kCapacity / 2) == 0)
+            lab2log::Logger::instance().flush();
+        decoder.decode(q, row);
+        LAB2_INFO(lcDb())
+                << "id="    << row.id
+                << "color=" << row.rect.penColor.name()
+                << "style=" << int(row.rect.penStyle)
+                << "pW="    << row.rect.penWidth
+                << "rect=(" << row.rect.left
+                << ","      << row.rect.top
+                << ","      << row.rect.width
+                << ","      << row.rect.height
                 << ")";
     }
 }
 
-// -------------------- Model (пока заглушки) --------------------
+void MainWindow::onExportChanges()
+{
+    if (!ensureDbReady_("onExportChanges")) return;
 
-void MainWindow::onInitTableModel() {
-    if (!ensureDbOpen_("onInitTableModel")) return;
+    ChangeExporter exporter(m_db);
+    const qint64 since = exporter.cursor(kCdcConsumer_);
+    const qint64 latest = exporter.latestSeq();
+    if (latest < 0) {
+        LAB2_WARNING(lcDb()) << "onExportChanges: change log does not exist. Call BD -> Create table first.";
+        return;
+    }
+
+    const QString file = QString("rectangle_changes_%1-%2.jsonl").arg(since + 1).arg(latest);
+    const ChangeExporter::Result r = exporter.exportIncremental(kCdcConsumer_, file);
+    if (!r.ok) {
+        LAB2_WARNING(lcDb()) << "onExportChanges: failed:" << r.error;
+        return;
+    }
+    if (r.changes == 0) {
+        LAB2_INFO(lcDb()) << "onExportChanges: no new changes since seq" << since;
+        return;
+    }
+
+    LAB2_INFO(lcDb()) << "onExportChanges: exported" << r.changes << "changes, seq"
+                      << r.fromSeq + 1 << ".." << r.toSeq << "->" << file;
+}
+
+void MainWindow::onPrintPdf()
+{
+    if (!ensureDbReady_("onPrintPdf")) return;
 
     if (!m_db.tables().contains(kTable_)) {
-        qDebug() << "onInitTableModel: table does not exist. Call BD -> Create table first.";
+        LAB2_WARNING(lcDb()) << "onPrintPdf: table does not exist. Call BD -> Create table first.";
         return;
     }
 
-    if (!m_model) {
-        m_model = new QSqlTableModel(this, m_db);
-        ui->tableView->setModel(m_model);
+    const RectPdfReport::Stats st = RectPdfReport(m_db).exportTo(kPdfReportFile_);
+    if (!st.ok) {
+        LAB2_WARNING(lcDb()) << "onPrintPdf: failed:" << st.error;
+        return;
     }
+    LAB2_INFO(lcDb()) << "onPrintPdf:" << st.rows << "rows," << st.pages << "pages ->" << kPdfReportFile_;
+}
 
-    m_model->setTable(kTable_);
+void MainWindow::onExportArchive()
+{
+    if (!ensureDbReady_("onExportArchive")) return;
 
-    // стратегия редактирования (методичка: можно выбрать)
-    // 0: OnFieldChange — сразу пишет в БД
-    // 1: OnRowChange — пишет при уходе со строки (default)
-    // 2: OnManualSubmit — по submitAll()
-    m_model->setEditStrategy(QSqlTableModel::OnRowChange);
+    if (!m_db.tables().contains(kTable_)) {
+        LAB2_WARNING(lcDb()) << "onExportArchive: table does not exist. Call BD -> Create table first.";
+        return;
+    }
 
-    if (!m_model->select()) {
-        qDebug() << "onInitTableModel: select() failed:" << m_model->lastError().text();
+    const RectArchive::Stats st = RectArchive(m_db).exportTo(kArchiveFile_);
+    if (!st.ok) {
+        LAB2_WARNING(lcDb()) << "onExportArchive: failed:" << st.error;
         return;
     }
+    LAB2_INFO(lcDb()) << "onExportArchive:" << st.rows << "rows," << st.blocks << "blocks,"
+                      << MemoryBudget::formatBytes(st.rawBytes) << "->"
+                      << MemoryBudget::formatBytes(st.compressedBytes) << "->" << kArchiveFile_;
+}
 
-    // Заголовки (setHeaderData унаследован от QAbstractItemModel)
-    m_model->setHeaderData(0, Qt::Horizontal, "ID");
-    m_model->setHeaderData(1, Qt::Horizontal, "Color");
-    m_model->setHeaderData(2, Qt::Horizontal, "Style");
-    m_model->setHeaderData(3, Qt::Horizontal, "PenWidth");
-    m_model->setHeaderData(4, Qt::Horizontal, "Left");
-    m_model->setHeaderData(5, Qt::Horizontal, "Top");
-    m_model->setHeaderData(6, Qt::Horizontal, "Width");
-    m_model->setHeaderData(7, Qt::Horizontal, "Height");
+void MainWindow::onLockContention()
+{
+    const BusyRetry::Stats& st = m_busyRetry.stats();
+    LAB2_INFO(lcDb()) << "onLockContention:" << st.operations << "operations," << st.contended << "contended,"
+                      << st.retries << "retries," << st.failures << "failed, wait" << st.waitMsTotal
+                      << "ms total," << st.waitMsMax << "ms max";
+}
 
-    // временно скрыть id (как в методичке)
-    ui->tableView->hideColumn(0);
+void MainWindow::onImportArchive()
+{
+    if (!ensureDbReady_("onImportArchive")) return;
 
-    // делегаты (ВАЖНО: индексы смещены на +1 из-за id)
-    ui->tableView->setItemDelegateForColumn(1, new MyDelegate(this));
-    ui->tableView->setItemDelegateForColumn(2, new MyDelegate(this));
+    if (!m_db.tables().contains(kTable_)) {
+        LAB2_WARNING(lcDb()) << "onImportArchive: table does not exist. Call BD -> Create table first.";
+        return;
+    }
 
-    ui->tableView->resizeColumnsToContents();
+    RectArchive archive(m_db);
+    archive.setBusyRetry(&m_busyRetry);
+    ColumnStats added;
+    if (m_columnStats->isInitialized())
+        archive.setRowObserver([&added](const RectRow& r) { added.add(r.rect); });
+    const RectArchive::Stats st = archive.importFrom(kArchiveFile_);
+    if (!st.ok) {
+        LAB2_WARNING(lcDb()) << "onImportArchive: failed:" << st.error;
+        return;
+    }
+    LAB2_INFO(lcDb()) << "onImportArchive:" << st.rows << "rows from" << kArchiveFile_;
+
+    m_warmModels.remove(kTable_);
+    m_columnStats->addRows(added);
+
+    if (m_model && !m_model->tableName().isEmpty() && !m_model->isDirty())
+        m_model->select();
+}
+
+void MainWindow::onImportCsv()
+{
+    if (!ensureDbReady_("onImportCsv")) return;
+
+    if (!m_db.tables().contains(kTable_)) {
+        LAB2_WARNING(lcDb()) << "onImportCsv: table does not exist. Call BD -> Create table first.";
+        return;
+    }
+
+    PipelineImporter importer(m_db);
+    importer.setBusyRetry(&m_busyRetry);
+    ColumnStats added;
+    if (m_columnStats->isInitialized()) {
+        importer.setCommittedRows([&added](const QVector<MyRect>& rows) {
+            for (const MyRect& r : rows)
+                added.add(r);
+        });
+    }
+    const PipelineImporter::Stats st = importer.importCsv(kCsvImportFile_);
+    if (st.badLines > 0)
+        LAB2_WARNING(lcDb()) << "onImportCsv: skipped" << st.badLines << "bad lines, first:" << st.firstBadLine;
+    if (!st.ok) {
+        // Закоммиченные порции отмечены в import_progress: повторный Import CSV продолжит с них.
+        LAB2_WARNING(lcDb()) << "onImportCsv: failed after" << st.rows << "rows:" << st.error;
+        PipelineImporter::Progress saved;
+        if (PipelineImporter::loadProgress(m_db, kCsvImportFile_, &saved) && !saved.done)
+            statusBar()->showMessage(QString("Import CSV stopped after line %1; "
+                                             "BD -> Clear import progress to start over").arg(saved.line));
+    } else if (st.resumedAtLine > 0) {
+        LAB2_INFO(lcDb()) << "onImportCsv:" << st.rows << "rows from" << kCsvImportFile_ << "(resumed after line"
+                          << st.resumedAtLine << "," << st.resumedRows << "rows imported before)";
+    } else {
+        LAB2_INFO(lcDb()) << "onImportCsv:" << st.rows << "rows from" << kCsvImportFile_;
+    }
+
+    // Закоммиченные порции есть в таблице и при ошибке — сводка получает ровно их.
+    if (st.rows > 0) {
+        m_warmModels.remove(kTable_);
+        m_columnStats->addRows(added);
+    }
+    if (st.rows > 0 && m_model && !m_model->tableName().isEmpty() && !m_model->isDirty())
+        m_model->select();
+}
+
+void MainWindow::onClearImportProgress()
+{
+    if (!ensureDbReady_("onClearImportProgress")) return;
+
+    if (!PipelineImporter::clearProgress(m_db, kCsvImportFile_))
+        return;
+    LAB2_INFO(lcDb()) << "onClearImportProgress: next Import CSV starts from the beginning of" << kCsvImportFile_;
+    statusBar()->clearMessage();
+}
+
+// -------------------- Model --------------------
+
+void MainWindow::onInitTableModel() {
+    if (!ensureDbReady_("onInitTableModel")) return;
+
+    if (!m_db.tables().contains(kTable_)) {
+        LAB2_WARNING(lcDb()) << "onInitTableModel: table does not exist. Call BD -> Create table first.";
+        return;
+    }
+
+    // Init всегда перечитывает kTable_ (даже если для неё есть тёплая модель).
+    WarmModelCache::Entry warm;
+    if (!activateModel_(kTable_, &warm)) return;
+    loadModel_(kTable_, "onInitTableModel");
+}
 
-    qDebug() << "onInitTableModel: loaded rows=" << m_model->rowCount();
+void MainWindow::onSelectTable()
+{
+    if (!ensureDbReady_("onSelectTable")) return;
+
+    const QStringList tables = RectangleTableModel::compatibleTables(m_db);
+    if (tables.isEmpty()) {
+        LAB2_WARNING(lcModel()) << "onSelectTable: no rectangle tables. Call BD -> Create table first.";
+        return;
+    }
+
+    bool ok = false;
+    const QString table = QInputDialog::getItem(this, "Select table", "Table:", tables,
+                                                qMax(0, tables.indexOf(currentTable())), false, &ok);
+    if (ok)
+        selectTable(table);
+}
+
+bool MainWindow::selectTable(const QString& table)
+{
+    if (!ensureDbReady_("selectTable")) return false;
+
+    if (!RectangleTableModel::compatibleTables(m_db).contains(table)) {
+        LAB2_WARNING(lcModel()) << "selectTable: no rectangle table" << table;
+        return false;
+    }
+
+    if (currentTable() == table) {
+        LAB2_INFO(lcModel()) << "selectTable:" << table << "is already shown";
+        return true;
+    }
+
+    WarmModelCache::Entry warm;
+    if (!activateModel_(table, &warm)) return false;
+
+    // Модель уже выбрана, но view показывал снимок — просто возвращаем её.
+    if (!warm.model && m_model->tableName() == table) {
+        showModel_(m_model);
+        return true;
+    }
+
+    if (!warm.model)
+        return loadModel_(table, "selectTable");
+
+    // Тёплая модель: строки уже в памяти, select() не нужен.
+    showModel_(m_model);
+    restoreViewState_(warm.state);
+    m_memoryBudget.touch(m_modelCacheId);
+    updateMemoryLabel_();
+
+    LAB2_INFO(lcModel()) << "selectTable: warm" << table << "rows=" << m_model->rowCount()
+                         << "warm tables=" << m_warmModels.tables();
+    return true;
 }
-void MainWindow::onSelectTable()    { qDebug() << "Model: Select table"; }
 
 void MainWindow::onInsertRow()      {
     if (!ensureDbOpen_("onInsertRow")) return;
     if (!m_model) {
-        qDebug() << "onInsertRow: model not initialized. Use Model -> Table model first.";
+        LAB2_WARNING(lcModel()) << "onInsertRow: model not initialized. Use Model -> Table model first.";
+        return;
+    }
+    if (!viewShowsTableModel_()) {
+        LAB2_WARNING(lcModel()) << "onInsertRow: snapshot view is read-only. Use Model -> Init table model.";
         return;
     }
 
     const int row = m_model->rowCount(); // куда вставляем (в конец)
     if (!m_model->insertRows(row, 1)) {  // insertRows(row, count) — добавление строк в модель.
-        qDebug() << "onInsertRow: insertRows failed:" << m_model->lastError().text();
+        LAB2_WARNING(lcModel()) << "onInsertRow: insertRows failed:" << m_model->lastError().text();
         return;
     }
 
@@ -370,34 +1046,316 @@ void MainWindow::onInsertRow()      {
     ui->tableView->selectRow(row);
     ui->tableView->scrollTo(m_model->index(row, 1));
 
-    qDebug() << "onInsertRow: inserted row=" << row;
+    LAB2_INFO(lcModel()) << "onInsertRow: inserted row=" << row;
 }
 
 void MainWindow::onRemoveRow()      {
     if (!ensureDbOpen_("onRemoveRow")) return;
     if (!m_model) {
-        qDebug() << "onRemoveRow: model not initialized. Use Model -> Table model first.";
+        LAB2_WARNING(lcModel()) << "onRemoveRow: model not initialized. Use Model -> Table model first.";
+        return;
+    }
+    if (!viewShowsTableModel_()) {
+        LAB2_WARNING(lcModel()) << "onRemoveRow: snapshot view is read-only. Use Model -> Init table model.";
         return;
     }
 
     const QModelIndex cur = ui->tableView->currentIndex(); // currentIndex() ([doc.qt.io](https://doc.qt.io/qt-5/qabstractitemview.html?utm_source=chatgpt.com))
     if (!cur.isValid()) {
-        qDebug() << "onRemoveRow: no current row selected";
+        LAB2_WARNING(lcModel()) << "onRemoveRow: no current row selected";
         return;
     }
 
     const int row = cur.row();
     if (!m_model->removeRows(row, 1)) { // removeRows(row, count) ([doc.qt.io](https://doc.qt.io/qt-5/qsqltablemodel.html?utm_source=chatgpt.com))
-        qDebug() << "onRemoveRow: removeRows failed:" << m_model->lastError().text();
+        LAB2_WARNING(lcModel()) << "onRemoveRow: removeRows failed:" << m_model->lastError().text();
+        return;
+    }
+
+    LAB2_INFO(lcModel()) << "onRemoveRow: removed row=" << row;
+}
+
+void MainWindow::onExportFrameStats()
+{
+    if (!m_frameStats.exportJson(kFrameStatsFile_)) {
+        LAB2_WARNING(lcPerf()) << "onExportFrameStats: cannot write" << kFrameStatsFile_;
+        return;
+    }
+    LAB2_INFO(lcPerf()) << "onExportFrameStats:" << m_frameStats.shortText() << "->" << kFrameStatsFile_;
+}
+
+void MainWindow::onScanStatistics()
+{
+    if (!ensureDbReady_("onScanStatistics")) return;
+
+    if (!m_db.tables().contains(kTable_)) {
+        LAB2_WARNING(lcDb()) << "onScanStatistics: table does not exist. Call BD -> Create table first.";
+        return;
+    }
+
+    ParallelScanner scanner(QFileInfo(m_db.databaseName()).absoluteFilePath());
+    RectAnalytics a;
+    const bool ok = scanner.aggregate(
+                a,
+                [](RectAnalytics& acc, const RectRow& row) { acc.add(row.rect); },
+                [](RectAnalytics& acc, const RectAnalytics& part) { acc.merge(part); });
+    if (!ok) {
+        LAB2_WARNING(lcDb()) << "onScanStatistics: scan failed:" << scanner.lastError();
         return;
     }
 
-    qDebug() << "onRemoveRow: removed row=" << row;
+    LAB2_INFO(lcDb()) << "onScanStatistics: rows=" << a.rows
+                      << "partitions=" << scanner.partitionCount()
+                      << "bounds=" << a.bounds()
+                      << "area=" << a.totalArea
+                      << "meanPenWidth=" << a.meanPenWidth();
+    statusBar()->showMessage(QString("Rows: %1, area: %2, mean pen width: %3")
+                             .arg(a.rows).arg(a.totalArea).arg(a.meanPenWidth(), 0, 'f', 2), 5000);
+}
+
+void MainWindow::onColumnStatistics()
+{
+    if (!ensureDbReady_("onColumnStatistics")) return;
+
+    if (!m_db.tables().contains(kTable_)) {
+        LAB2_WARNING(lcDb()) << "onColumnStatistics: table does not exist. Call BD -> Create table first.";
+        return;
+    }
+
+    QString error;
+    if (!m_columnStats->rescan(QFileInfo(m_db.databaseName()).absoluteFilePath(), &error)) {
+        LAB2_WARNING(lcDb()) << "onColumnStatistics: scan failed:" << error;
+        return;
+    }
+
+    if (!m_columnStatsDock) {
+        m_columnStatsDock = new QDockWidget("Column statistics", this);
+        m_columnStatsDock->setObjectName("columnStatsDock");
+        m_columnStatsDock->setWidget(new ColumnStatsPanel(m_columnStats, m_columnStatsDock));
+        addDockWidget(Qt::RightDockWidgetArea, m_columnStatsDock);
+    }
+    m_columnStatsDock->show();
+    m_columnStatsDock->raise();
+
+    LAB2_INFO(lcDb()) << "onColumnStatistics: rows=" << m_columnStats->stats().rows();
+}
+
+void MainWindow::onGroupBy()
+{
+    if (!ensureDbReady_("onGroupBy")) return;
+
+    if (!m_db.tables().contains(kTable_)) {
+        LAB2_WARNING(lcDb()) << "onGroupBy: table does not exist. Call BD -> Create table first.";
+        return;
+    }
+
+    const QString dbPath = QFileInfo(m_db.databaseName()).absoluteFilePath();
+    if (m_groupBy && m_groupBy->dbPath() != dbPath) {
+        delete m_groupByDock;
+        delete m_groupBy;
+        m_groupByDock = nullptr;
+        m_groupBy = nullptr;
+    }
+
+    if (!m_groupByDock) {
+        m_groupBy = new GroupByModel(dbPath, this);
+        m_groupByDock = new QDockWidget("Group by", this);
+        m_groupByDock->setObjectName("groupByDock");
+        m_groupByDock->setWidget(new GroupByPanel(m_groupBy, m_groupByDock));
+        addDockWidget(Qt::BottomDockWidgetArea, m_groupByDock);
+        // Догоняем журнал, только пока панель видна.
+        connect(m_groupByDock, &QDockWidget::visibilityChanged, m_groupBy, [this](bool visible) {
+            m_groupBy->setAutoRefresh(visible ? GroupByModel::kDefaultAutoRefreshMs : 0);
+        });
+    }
+    m_groupByDock->show();
+    m_groupByDock->raise();
+    m_groupBy->reload();
+
+    LAB2_INFO(lcDb()) << "onGroupBy: grouping" << dbPath;
+}
+
+void MainWindow::rescanColumnStats_(const char* caller)
+{
+    if (!m_columnStats->isInitialized())
+        return;
+
+    // Таблица изменена так, что инкрементальная сводка этого не видела (миграция, откат группы правок).
+    QString error;
+    if (!m_columnStats->rescan(QFileInfo(m_db.databaseName()).absoluteFilePath(), &error))
+        LAB2_WARNING(lcDb()) << caller << ": column statistics rescan failed:" << error;
+}
+
+void MainWindow::onSaveSnapshot()
+{
+    if (!ensureDbReady_("onSaveSnapshot")) return;
+
+    if (!m_db.tables().contains(kTable_)) {
+        LAB2_WARNING(lcDb()) << "onSaveSnapshot: table does not exist. Call BD -> Create table first.";
+        return;
+    }
+
+    if (!m_snapshotRefresher) {
+        m_snapshotRefresher = new SnapshotRefresher(QFileInfo(m_db.databaseName()).absoluteFilePath(),
+                                                    QFileInfo(kSnapshotFile_).absoluteFilePath(),
+                                                    this);
+        connect(m_snapshotRefresher, &SnapshotRefresher::finished, this, &MainWindow::onSnapshotWritten_);
+    }
+
+    if (!m_snapshotRefresher->start()) {
+        LAB2_INFO(lcPerf()) << "onSaveSnapshot: snapshot is already being written";
+        return;
+    }
+    statusBar()->showMessage("Writing snapshot...");
+}
+
+void MainWindow::onSnapshotWritten_(bool ok, const QString& tmpPath, const QString& error)
+{
+    statusBar()->clearMessage();
+
+    if (!ok) {
+        LAB2_WARNING(lcPerf()) << "snapshot: write failed:" << error;
+        QFile::remove(tmpPath);
+        return;
+    }
+
+    qint64 seq = -1;
+    {
+        RectSnapshot probe;
+        if (probe.open(tmpPath))
+            seq = probe.sourceSeq();
+    }
+
+    // Отображённый файл нельзя заменить (Windows) — закрываем вид на время подмены.
+    const QString path = m_snapshotRefresher->snapshotPath();
+    const bool reloadView = m_snapshotModel && m_snapshotModel->snapshot().isOpen()
+            && QFileInfo(m_snapshotModel->snapshot().fileName()).absoluteFilePath() == path;
+    if (reloadView)
+        m_snapshotModel->unload();
+    const bool reloadHeatmap = m_heatmapView && m_heatmapView->snapshot().isOpen()
+            && QFileInfo(m_heatmapView->snapshot().fileName()).absoluteFilePath() == path;
+    const QRectF heatmapWorld = reloadHeatmap ? m_heatmapView->world() : QRectF();
+    if (reloadHeatmap)
+        m_heatmapView->unload();
+
+    if (!RectSnapshot::replaceFile(tmpPath, path)) {
+        LAB2_WARNING(lcPerf()) << "snapshot: cannot replace" << path;
+        return;
+    }
+    m_snapshotSeq = seq;
+
+    if (reloadView) {
+        QString err;
+        if (!m_snapshotModel->load(path, &err))
+            LAB2_WARNING(lcPerf()) << "snapshot: reload failed:" << err;
+    }
+    if (reloadHeatmap) {
+        QString err;
+        if (m_heatmapView->load(path, &err))
+            m_heatmapView->setWorld(heatmapWorld);
+        else
+            LAB2_WARNING(lcPerf()) << "snapshot: heatmap reload failed:" << err;
+    }
+
+    LAB2_INFO(lcPerf()) << "snapshot: written" << path << "change seq" << seq;
+}
+
+void MainWindow::onLoadSnapshotView()
+{
+    if (!m_snapshotModel)
+        m_snapshotModel = new SnapshotTableModel(this);
+
+    QString err;
+    if (!m_snapshotModel->load(kSnapshotFile_, &err)) {
+        LAB2_WARNING(lcModel()) << "onLoadSnapshotView:" << err << "(use Model -> Save snapshot first)";
+        return;
+    }
+
+    showModel_(m_snapshotModel);
+
+    const RectAnalytics a = m_snapshotModel->snapshot().analytics();
+    LAB2_INFO(lcModel()) << "onLoadSnapshotView: rows=" << a.rows
+                         << "bounds=" << a.bounds()
+                         << "area=" << a.totalArea
+                         << "meanPenWidth=" << a.meanPenWidth()
+                         << "mapped=" << MemoryBudget::formatBytes(m_snapshotModel->snapshot().mappedBytes());
+}
+
+void MainWindow::onShowHeatmap()
+{
+    if (!m_heatmapDock) {
+        m_heatmapDock = new QDockWidget("Density heatmap", this);
+        m_heatmapDock->setObjectName("heatmapDock");
+        m_heatmapView = new HeatmapView(m_heatmapDock);
+        m_heatmapDock->setWidget(m_heatmapView);
+        addDockWidget(Qt::RightDockWidgetArea, m_heatmapDock);
+    }
+
+    QString err;
+    if (!m_heatmapView->load(kSnapshotFile_, &err)) {
+        LAB2_WARNING(lcModel()) << "onShowHeatmap:" << err << "(use Model -> Save snapshot first)";
+        m_heatmapDock->hide();
+        return;
+    }
+    m_heatmapDock->show();
+    m_heatmapDock->raise();
+
+    LAB2_INFO(lcModel()) << "onShowHeatmap: rows=" << m_heatmapView->snapshot().rowCount()
+                         << "world=" << m_heatmapView->world();
+}
+
+void MainWindow::onExportTiles()
+{
+    RectSnapshot snapshot;
+    QString err;
+    if (!snapshot.open(kSnapshotFile_, &err)) {
+        LAB2_WARNING(lcModel()) << "onExportTiles:" << err << "(use Model -> Save snapshot first)";
+        return;
+    }
+
+    const TilePyramid::Stats st = TilePyramid(kTilesDir_).exportSnapshot(snapshot);
+    if (!st.ok) {
+        LAB2_WARNING(lcModel()) << "onExportTiles: failed:" << st.error;
+        return;
+    }
+    LAB2_INFO(lcModel()) << "onExportTiles:" << st.rows << "rows," << st.levels << "levels,"
+                         << st.tilesRendered << "tiles rendered," << st.tilesSkipped << "unchanged,"
+                         << st.tilesRemoved << "removed ->" << kTilesDir_;
+}
+
+void MainWindow::onSnapshotAutoRefresh(bool enabled)
+{
+    if (!m_snapshotTimer) {
+        m_snapshotTimer = new QTimer(this);
+        connect(m_snapshotTimer, &QTimer::timeout, this, &MainWindow::checkSnapshotFreshness_);
+    }
+
+    if (enabled)
+        m_snapshotTimer->start(kSnapshotCheckMs_);
+    else
+        m_snapshotTimer->stop();
+
+    LAB2_INFO(lcPerf()) << "snapshot auto-refresh:" << (enabled ? "on" : "off");
+}
+
+void MainWindow::checkSnapshotFreshness_()
+{
+    if (!m_db.isValid() || !m_db.isOpen() || !m_db.tables().contains(kTable_)) return;
+    if (m_snapshotRefresher && m_snapshotRefresher->isRunning()) return;
+
+    // Без журнала изменений (схема < v2) свежесть не определить — снимок не трогаем.
+    if (!m_db.tables().contains(ChangeExporter::kChangesTable)) return;
+
+    const qint64 latest = ChangeExporter(m_db).latestSeq();
+    if (latest < 0 || latest == m_snapshotSeq) return;
+
+    LAB2_DEBUG(lcPerf()) << "snapshot: stale (seq" << m_snapshotSeq << "->" << latest << "), refreshing";
+    onSaveSnapshot();
 }
 
 // -------------------- Query (пока заглушка) --------------------
 
-void MainWindow::onDoQuery()        { qDebug() << "Query: Do query"; }
+void MainWindow::onDoQuery()        { LAB2_INFO(lcDb()) << "Query: Do query"; }
 
 // -------------------- menus --------------------
 
@@ -411,7 +1369,14 @@ void MainWindow::setupMenus_()
     QAction* aCreateTbl  = mBd->addAction("Create table");
     QAction* aInsertInto = mBd->addAction("Insert into");
     QAction* aPrintTbl   = mBd->addAction("Print table");
+    QAction* aPrintPdf   = mBd->addAction("Print to PDF");
     QAction* aDropTbl    = mBd->addAction("Drop table");
+    QAction* aExportChg  = mBd->addAction("Export changes");
+    QAction* aExportArc  = mBd->addAction("Export compressed");
+    QAction* aImportArc  = mBd->addAction("Import compressed");
+    QAction* aImportCsv  = mBd->addAction("Import CSV");
+    QAction* aClearProg  = mBd->addAction("Clear import progress");
+    QAction* aLockStats  = mBd->addAction("Lock contention");
 
     // --- Model ---
     QMenu* mModel = menuBar()->addMenu("Model");
@@ -419,6 +1384,18 @@ void MainWindow::setupMenus_()
     QAction* aSelectTable = mModel->addAction("Select table");
     QAction* aInsertRow   = mModel->addAction("Insert row");
     QAction* aRemoveRow   = mModel->addAction("Remove row");
+    mModel->addSeparator();
+    QAction* aFrameStats  = mModel->addAction("Export frame stats");
+    QAction* aScanStats   = mModel->addAction("Scan statistics");
+    QAction* aColumnStats = mModel->addAction("Column statistics");
+    QAction* aGroupBy     = mModel->addAction("Group by");
+    mModel->addSeparator();
+    QAction* aSaveSnap    = mModel->addAction("Save snapshot");
+    QAction* aSnapView    = mModel->addAction("Snapshot view");
+    QAction* aSnapAuto    = mModel->addAction("Auto-refresh snapshot");
+    aSnapAuto->setCheckable(true);
+    QAction* aHeatmap     = mModel->addAction("Density heatmap");
+    QAction* aExportTiles = mModel->addAction("Export tiles");
 
     // --- Query ---
     QMenu* mQuery = menuBar()->addMenu("Query");
@@ -430,12 +1407,28 @@ void MainWindow::setupMenus_()
     connect(aCreateTbl,  &QAction::triggered, this, &MainWindow::onCreateTable);
     connect(aInsertInto, &QAction::triggered, this, &MainWindow::onInsertInto);
     connect(aPrintTbl,   &QAction::triggered, this, &MainWindow::onPrintTable);
+    connect(aPrintPdf,   &QAction::triggered, this, &MainWindow::onPrintPdf);
     connect(aDropTbl,    &QAction::triggered, this, &MainWindow::onDropTable);
+    connect(aExportChg,  &QAction::triggered, this, &MainWindow::onExportChanges);
+    connect(aExportArc,  &QAction::triggered, this, &MainWindow::onExportArchive);
+    connect(aImportArc,  &QAction::triggered, this, &MainWindow::onImportArchive);
+    connect(aImportCsv,  &QAction::triggered, this, &MainWindow::onImportCsv);
+    connect(aClearProg,  &QAction::triggered, this, &MainWindow::onClearImportProgress);
+    connect(aLockStats,  &QAction::triggered, this, &MainWindow::onLockContention);
 
     connect(aInitModel,   &QAction::triggered, this, &MainWindow::onInitTableModel);
     connect(aSelectTable, &QAction::triggered, this, &MainWindow::onSelectTable);
     connect(aInsertRow,   &QAction::triggered, this, &MainWindow::onInsertRow);
     connect(aRemoveRow,   &QAction::triggered, this, &MainWindow::onRemoveRow);
+    connect(aFrameStats,  &QAction::triggered, this, &MainWindow::onExportFrameStats);
+    connect(aScanStats,   &QAction::triggered, this, &MainWindow::onScanStatistics);
+    connect(aColumnStats, &QAction::triggered, this, &MainWindow::onColumnStatistics);
+    connect(aGroupBy,     &QAction::triggered, this, &MainWindow::onGroupBy);
+    connect(aSaveSnap,    &QAction::triggered, this, &MainWindow::onSaveSnapshot);
+    connect(aSnapView,    &QAction::triggered, this, &MainWindow::onLoadSnapshotView);
+    connect(aSnapAuto,    &QAction::toggled,   this, &MainWindow::onSnapshotAutoRefresh);
+    connect(aHeatmap,     &QAction::triggered, this, &MainWindow::onShowHeatmap);
+    connect(aExportTiles, &QAction::triggered, this, &MainWindow::onExportTiles);
 
     connect(aDoQuery, &QAction::triggered, this, &MainWindow::onDoQuery);
 }
@@ -6,6 +6,27 @@
 #include <QtSql/QSqlDatabase>
 #include <QtSql/QSqlTableModel>
 
+#include "busyretry.h"
+#include "framestats.h"
+#include "memorybudget.h"
+#include "penpalette.h"
+#include "rectangleschema.h"
+#include "warmmodelcache.h"
+
+#include <map>
+#include <memory>
+
+class ColumnStatsTracker;
+class GroupByModel;
+class GroupCommitter;
+class HeatmapView;
+class QDockWidget;
+class QLabel;
+class QTimer;
+class RectangleTableModel;
+class SnapshotRefresher;
+class SnapshotTableModel;
+
 namespace Ui {
 class MainWindow;
 }
@@ -17,8 +38,8 @@ class MainWindow;
  *  - создание/закрытие соединения (QSqlDatabase),
  *  - создание/удаление таблицы,
  *  - вставка тестовых данных разными способами (QSqlQuery),
- *  - выборка и печать таблицы в qDebug(),
- *  - отображение таблицы через QSqlTableModel + QTableView,
+ *  - выборка и печать таблицы в лог (logger.h),
+ *  - отображение таблицы через QSqlTableModel + QTableView, переключение между таблицами,
  *  - добавление/удаление строк через модель.
  *
  * @note Соединение используется именованное (kConnName_), чтобы:
@@ -47,6 +68,63 @@ public:
      */
     ~MainWindow();
 
+    /**
+     * @brief Учёт памяти кэшей окна (строки модели и т.п.) и глобальный бюджет.
+     *
+     * Бюджет берётся из переменной окружения LAB2_MEMORY_BUDGET_MB
+     * (по умолчанию MemoryBudget::kDefaultLimitBytes) и может быть изменён через setLimitBytes().
+     */
+    MemoryBudget& memoryBudget() { return m_memoryBudget; }
+
+    /**
+     * @brief Статистика времени кадров отрисовки tableView за сессию.
+     *
+     * Обновляется при каждом paintEvent() таблицы; сводка показывается в статус-баре.
+     */
+    FrameStats& frameStats() { return m_frameStats; }
+
+    /**
+     * @brief Ожидание блокировок для запросов окна к m_db (busy timeout + повторы) и его метрики.
+     *
+     * Параметры берутся из LAB2_DB_BUSY_TIMEOUT_MS / LAB2_DB_RETRIES
+     * (по умолчанию BusyRetry::Policy), busy timeout применяется при открытии соединения.
+     */
+    BusyRetry& busyRetry() { return m_busyRetry; }
+
+    /**
+     * @brief Групповая фиксация правок таблицы (nullptr до Model -> Init table model).
+     *
+     * Правки модели копятся в одной транзакции и фиксируются раз в
+     * GroupCommitter::kDefaultWindowMs мс или после kDefaultMaxChanges правок.
+     */
+    GroupCommitter* groupCommitter() const { return m_groupCommit; }
+
+    /**
+     * @brief Показывает в tableView таблицу table (Model -> Select table без диалога).
+     *
+     * Текущая модель паркуется в warmModels() вместе с прокруткой, текущей ячейкой и
+     * сортировкой; если для table есть тёплая модель, она показывается без select().
+     *
+     * @param table Таблица из RectangleTableModel::compatibleTables() ("rectangle", "aux.rectangle", ...).
+     * @return true если таблица показана.
+     */
+    bool selectTable(const QString& table);
+
+    /// Таблица, показанная в tableView (пусто — модель не инициализирована или открыт снимок).
+    QString currentTable() const;
+
+    /// Тёплые модели недавно открытых таблиц.
+    WarmModelCache& warmModels() { return m_warmModels; }
+
+    /// Сводка по колонкам таблицы (инициализируется Model -> Column statistics).
+    ColumnStatsTracker* columnStats() const { return m_columnStats; }
+
+    /// Группировка таблицы (nullptr до первого Model -> Group by).
+    GroupByModel* groupBy() const { return m_groupBy; }
+
+    /// Тепловая карта снимка (nullptr до первого Model -> Density heatmap).
+    HeatmapView* heatmapView() const { return m_heatmapView; }
+
 private slots:
     // -------------------- BD --------------------
 
@@ -58,7 +136,7 @@ private slots:
      *  - setDatabaseName(kDbFile_),
      *  - open().
      *
-     * В случае ошибок пишет диагностику через qDebug().
+     * В случае ошибок пишет диагностику в лог (категория lcDb).
      */
     void onCreateConnection();
 
@@ -70,9 +148,11 @@ private slots:
     void onCloseConnection();
 
     /**
-     * @brief Создаёт таблицу kTable_ ("rectangle") командой CREATE TABLE.
+     * @brief Создаёт таблицу kTable_ ("rectangle") или обновляет её схему до последней версии.
      *
-     * Если таблица уже существует — удаляет её (onDropTable()) и создаёт заново.
+     * Схема ведётся миграциями SchemaMigrator (версия — PRAGMA user_version):
+     * существующая таблица не удаляется, данные сохраняются. Прогресс перестроек
+     * больших таблиц показывается в статус-баре.
      */
     void onCreateTable();
 
@@ -90,17 +170,66 @@ private slots:
     void onInsertInto();
 
     /**
-     * @brief Делает SELECT * FROM kTable_ и печатает строки в qDebug().
+     * @brief Делает SELECT * FROM kTable_ и печатает строки в лог.
+     *
+     * Строки уходят в асинхронный логгер (LAB2_INFO), поэтому печать большой таблицы
+     * не упирается в синхронный вывод в консоль.
      *
      * Для SELECT * порядок колонок не фиксирован — используется QSqlRecord::indexOf().
      */
     void onPrintTable();
 
     /**
-     * @brief Удаляет таблицу kTable_ командой DROP TABLE.
+     * @brief Печатает таблицу в PDF kPdfReportFile_ (RectPdfReport): строки идут из forward-only
+     *        выборки прямо на страницы, модель не загружается.
+     */
+    void onPrintPdf();
+
+    /**
+     * @brief Удаляет таблицу kTable_ командой DROP TABLE и сбрасывает версию схемы.
+     *
+     * Маркер удаления в журнале изменений ('X'), DROP TABLE, PRAGMA user_version = 0 и сброс отметок
+     * импорта идут одной транзакцией: при ошибке любого шага ничего не меняется.
      */
     void onDropTable();
 
+    /**
+     * @brief Выгружает изменения таблицы с момента прошлой выгрузки (журнал rectangle_changes).
+     *
+     * Файл rectangle_changes_<from>-<to>.jsonl создаётся в рабочей папке;
+     * курсор потребителя kCdcConsumer_ хранится в БД (cdc_cursor).
+     */
+    void onExportChanges();
+
+    /**
+     * @brief Выгружает таблицу в сжатый поблочный архив kArchiveFile_ (RectArchive).
+     */
+    void onExportArchive();
+
+    /**
+     * @brief Пишет в лог метрики ожидания блокировок (BusyRetry): повторы, отказы, время ожидания.
+     */
+    void onLockContention();
+
+    /**
+     * @brief Дописывает в таблицу строки из архива kArchiveFile_ (новые id, одна транзакция).
+     */
+    void onImportArchive();
+
+    /**
+     * @brief Импортирует kCsvImportFile_ конвейером PipelineImporter (разбор параллельно, запись порциями).
+     *
+     * Прерванный импорт того же файла продолжается с последней закоммиченной порции.
+     */
+    void onImportCsv();
+
+    /**
+     * @brief Удаляет отметку прогресса kCsvImportFile_: следующий Import CSV начнётся с начала файла.
+     *
+     * Нужна, если файл изменился после прерванного импорта (такой импорт не продолжается).
+     */
+    void onClearImportProgress();
+
     // -------------------- Model --------------------
 
     /**
@@ -119,7 +248,10 @@ private slots:
     void onInitTableModel();
 
     /**
-     * @brief Заглушка/точка расширения: выбор другой таблицы или повторный select().
+     * @brief Выбор таблицы для tableView: список совместимых таблиц основной и присоединённых БД.
+     *
+     * Выбранная таблица открывается через selectTable(): недавно открытые таблицы
+     * возвращаются мгновенно из тёплых моделей.
      */
     void onSelectTable();
 
@@ -138,6 +270,73 @@ private slots:
      */
     void onRemoveRow();
 
+    /**
+     * @brief Сохраняет статистику кадров (p50/p99, jank, гистограмма) в kFrameStatsFile_ (JSON).
+     */
+    void onExportFrameStats();
+
+    /**
+     * @brief Считает сводку по таблице (охват, площадь, средняя толщина пера) параллельным сканом.
+     *
+     * ParallelScanner читает диапазоны id в отдельных потоках и соединениях; итог — в лог и статус-бар.
+     */
+    void onScanStatistics();
+
+    /**
+     * @brief Показывает панель сводки по колонкам (count/min/max/mean, гистограммы, частоты цветов и стилей).
+     *
+     * Сводка считается одним параллельным сканом, дальше обновляется по правкам модели
+     * (ColumnStatsTracker); после Insert into и импорта скан повторяется.
+     */
+    void onColumnStatistics();
+
+    /**
+     * @brief Показывает в доке группировку таблицы (GroupByPanel + GroupByModel).
+     *
+     * Агрегаты считаются SQL-запросом в фоновом соединении; пока док виден, модель
+     * раз в GroupByModel::kDefaultAutoRefreshMs догоняет журнал изменений.
+     */
+    void onGroupBy();
+
+    /**
+     * @brief Запускает фоновую запись снимка таблицы в kSnapshotFile_ (RectSnapshot).
+     *
+     * Снимок пишется в собственном соединении, во временный файл; по готовности файл
+     * подменяется, а открытый вид снимка перезагружается.
+     */
+    void onSaveSnapshot();
+
+    /**
+     * @brief Показывает в tableView снимок kSnapshotFile_ (только чтение) и пишет его сводку в лог.
+     *
+     * Соединение с БД не требуется: данные читаются из отображённого в память файла.
+     * Вернуться к редактируемой таблице — Model -> Init table model.
+     */
+    void onLoadSnapshotView();
+
+    /**
+     * @brief Включает/выключает автообновление снимка.
+     *
+     * Раз в kSnapshotCheckMs_ сравнивается последний seq журнала изменений с seq снимка;
+     * если БД изменилась, снимок пересоздаётся в фоне.
+     */
+    void onSnapshotAutoRefresh(bool enabled);
+
+    /**
+     * @brief Показывает в доке тепловую карту покрытия снимка kSnapshotFile_ (HeatmapView).
+     *
+     * Как и Snapshot view, работает без соединения с БД. После перезаписи снимка
+     * (Save snapshot, автообновление) карта перечитывает файл сама.
+     */
+    void onShowHeatmap();
+
+    /**
+     * @brief Рисует снимок kSnapshotFile_ в пирамиду PNG-тайлов kTilesDir_ (TilePyramid).
+     *
+     * Повторный экспорт перерисовывает только тайлы, содержимое которых изменилось.
+     */
+    void onExportTiles();
+
     // -------------------- Query --------------------
 
     /**
@@ -163,6 +362,108 @@ private:
      */
     bool ensureDbOpen_(const char* caller) const;
 
+    /**
+     * @brief ensureDbOpen_() + фиксация отложенных правок модели (flushPendingEdits_()).
+     *
+     * Используется в слотах, работающих с БД напрямую (SQL, миграции, экспорт/импорт,
+     * фоновые соединения): им нужна зафиксированная таблица и соединение без открытой транзакции.
+     */
+    bool ensureDbReady_(const char* caller);
+
+    /// Фиксирует открытую группу правок модели (GroupCommitter), если она есть.
+    void flushPendingEdits_();
+
+    /**
+     * @brief Откладывает проверку бюджета памяти до возврата в цикл событий.
+     *
+     * Вызывается при подгрузке строк моделью (rowsInserted во время fetchMore()),
+     * поэтому само вытеснение (select()) нельзя делать синхронно.
+     */
+    void scheduleBudgetCheck_();
+
+    /// Применяет бюджет памяти (MemoryBudget::enforce()) и обновляет индикатор.
+    void enforceMemoryBudget_();
+
+    /// Обновляет индикатор памяти в статус-баре.
+    void updateMemoryLabel_();
+
+    /// Обновляет индикатор времени кадров в статус-баре.
+    void updateFrameLabel_();
+
+    /**
+     * @brief Вытесняет строки модели, далёкие от видимой области.
+     *
+     * QSqlTableModel не умеет выгружать отдельные строки, поэтому окно модели
+     * (RectangleTableModel::setWindowOffset()) сдвигается вниз: выше первой видимой строки
+     * остаётся kModelWindowMargin_ строк, ниже — подгружается только до конца видимой области
+     * с тем же запасом. Видимые строки и текущая ячейка остаются на месте.
+     * Если в модели есть несохранённые изменения или освобождать нечего, вытеснение пропускается.
+     *
+     * @return Освобождённые байты (оценка).
+     */
+    qint64 evictModelCache_(qint64 bytesToFree);
+
+    /**
+     * @brief Перечитывает m_model с окном offset, сохраняя видимые строки и текущую ячейку.
+     * @param margin Сколько строк подгрузить ниже видимой области.
+     */
+    bool moveModelWindow_(int offset, int margin);
+
+    /// Группа правок не зафиксировалась (GroupCommitter::rolledBack): словари цветов и сводка по колонкам
+    /// перечитываются, в статус-баре — сообщение.
+    void onGroupRolledBack_(int changes, const QString& error);
+
+    /// Прокрутка до верха окна модели — окно сдвигается вверх на kModelWindowStep_ строк.
+    void onTableScrollAction_(int action);
+    void shiftModelWindowUp_();
+
+    /// Фоновая запись снимка завершена: подмена файла и перезагрузка открытого вида.
+    void onSnapshotWritten_(bool ok, const QString& tmpPath, const QString& error);
+
+    /// Проверка по таймеру автообновления: устарел ли снимок относительно журнала изменений.
+    void checkSnapshotFreshness_();
+
+    /// Показывает в tableView модель model (столбец id скрыт, делегаты цвета/стиля).
+    void showModel_(QAbstractItemModel* model);
+
+    /// В tableView сейчас модель таблицы (а не снимок)?
+    bool viewShowsTableModel_() const;
+
+    /// Новая модель таблицы: статистика кадров, групповая фиксация, учёт в бюджете памяти.
+    RectangleTableModel* createTableModel_();
+
+    /**
+     * @brief Делает m_model моделью таблицы table.
+     *
+     * Текущая модель другой таблицы паркуется (несохранённые правки сначала записываются);
+     * тёплая модель table забирается из m_warmModels.
+     *
+     * @param warm Тёплая модель и состояние вида (warm->model == nullptr — модель нужно загрузить).
+     * @return false если текущую модель не удалось запарковать.
+     */
+    bool activateModel_(const QString& table, WarmModelCache::Entry* warm);
+
+    /// setTable() + select() для m_model, заголовки и показ в tableView.
+    bool loadModel_(const QString& table, const char* caller);
+
+    /// Словарь цветов для таблицы (своя схема для присоединённых БД).
+    PenPalette* paletteFor_(const QString& table);
+
+    /// Прокрутка, текущая ячейка и сортировка tableView.
+    WarmModelCache::ViewState captureViewState_() const;
+
+    /// Восстанавливает состояние tableView, снятое captureViewState_().
+    void restoreViewState_(const WarmModelCache::ViewState& state);
+
+    /**
+     * @brief Пересчитывает сводку по колонкам полным сканом (если панель уже открывалась).
+     *
+     * Только для изменений, которые сводка не может учесть сама (миграция схемы, откат группы правок,
+     * уже применённой к сводке); вставки
+     * Insert into и импортов добавляются ColumnStatsTracker::addRows().
+     */
+    void rescanColumnStats_(const char* caller);
+
 private:
     Ui::MainWindow *ui = nullptr;
 
@@ -176,7 +477,69 @@ private:
      *
      * Создаётся лениво в onInitTableModel(). Владелец — QObject parent = this.
      */
-    QSqlTableModel* m_model = nullptr;
+    RectangleTableModel* m_model = nullptr;
+
+    /// Групповая фиксация правок m_model (создаётся вместе с моделью).
+    GroupCommitter* m_groupCommit = nullptr;
+
+    /// Словарь цветов пера для m_db: вставки onInsertInto() и колонка цвета m_model.
+    PenPalette m_palette;
+
+    /// Бюджет памяти для кэшей (см. memoryBudget()).
+    MemoryBudget m_memoryBudget;
+
+    /// Повтор запросов к m_db при блокировке другим процессом (см. busyRetry()).
+    BusyRetry m_busyRetry;
+
+    /// Идентификатор кэша строк m_model в m_memoryBudget (0 — не зарегистрирован).
+    int m_modelCacheId = 0;
+
+    /// Идёт перечитывание окна m_model (moveModelWindow_()): прокрутка не сдвигает окно повторно.
+    bool m_modelWindowMoving = false;
+
+    /// Словари цветов присоединённых БД (схема -> словарь), основная БД — m_palette.
+    std::map<QString, std::unique_ptr<PenPalette>> m_schemaPalettes;
+
+    /// Тёплые модели недавно открытых таблиц (учитываются в m_memoryBudget).
+    WarmModelCache m_warmModels { &m_memoryBudget };
+
+    /// Сводка по колонкам kTable_ (отслеживает правки всех моделей окна).
+    ColumnStatsTracker* m_columnStats = nullptr;
+
+    /// Док с панелью сводки (создаётся при первом onColumnStatistics()).
+    QDockWidget* m_columnStatsDock = nullptr;
+
+    /// Группировка и её док (создаются при первом onGroupBy()).
+    GroupByModel* m_groupBy = nullptr;
+    QDockWidget* m_groupByDock = nullptr;
+
+    /// Проверка бюджета уже запланирована (схлопываем частые rowsInserted).
+    bool m_budgetCheckPending = false;
+
+    /// Индикатор памяти в статус-баре.
+    QLabel* m_memoryLabel = nullptr;
+
+    /// Статистика кадров tableView (см. frameStats()).
+    FrameStats m_frameStats;
+
+    /// Индикатор времени кадров в статус-баре (обновляется по таймеру).
+    QLabel* m_frameLabel = nullptr;
+
+    /// Модель вида снимка (создаётся в onLoadSnapshotView()).
+    SnapshotTableModel* m_snapshotModel = nullptr;
+
+    /// Фоновая запись снимка (создаётся при первом onSaveSnapshot()).
+    SnapshotRefresher* m_snapshotRefresher = nullptr;
+
+    /// Таймер автообновления снимка.
+    QTimer* m_snapshotTimer = nullptr;
+
+    /// seq журнала изменений, с которого снят последний записанный снимок (-2 — неизвестно).
+    qint64 m_snapshotSeq = -2;
+
+    /// Тепловая карта снимка и её док (создаются при первом onShowHeatmap()).
+    HeatmapView* m_heatmapView = nullptr;
+    QDockWidget* m_heatmapDock = nullptr;
 
     // -------------------- constants --------------------
 
@@ -185,7 +548,29 @@ private:
     /// Имя файла SQLite (создастся рядом с исполняемым файлом, если пути не указаны явно).
     static constexpr const char* kDbFile_   = "rectangle_data.sqlite";
     /// Имя таблицы с прямоугольниками.
-    static constexpr const char* kTable_    = "rectangle";
+    static constexpr const char* kTable_    = rectschema::kTable;
+    /// Имя потребителя журнала изменений для выгрузки из меню.
+    static constexpr const char* kCdcConsumer_ = "menu_export";
+    /// Файл для экспорта статистики кадров.
+    static constexpr const char* kFrameStatsFile_ = "frame_stats.json";
+    /// Файл сжатого архива таблицы (RectArchive).
+    static constexpr const char* kArchiveFile_ = "rectangle_data.l2z";
+    /// PDF-отчёт по таблице (BD -> Print to PDF).
+    static constexpr const char* kPdfReportFile_ = "rectangle_report.pdf";
+    /// CSV-файл для импорта (pencolor,penstyle,penwidth,left,top,width,height).
+    static constexpr const char* kCsvImportFile_ = "rectangle_import.csv";
+    /// Файл снимка таблицы (RectSnapshot).
+    static constexpr const char* kSnapshotFile_ = "rectangle_data.snapshot";
+    /// Каталог пирамиды тайлов (Model -> Export tiles).
+    static constexpr const char* kTilesDir_ = "rectangle_tiles";
+    /// Период проверки свежести снимка при автообновлении (мс).
+    static constexpr int kSnapshotCheckMs_ = 2000;
+    /// Период обновления индикатора кадров (мс).
+    static constexpr int kFrameLabelRefreshMs_ = 500;
+    /// Строк модели, оставляемых выше и ниже видимой области при вытеснении.
+    static constexpr int kModelWindowMargin_ = 512;
+    /// На сколько строк окно модели сдвигается вверх при прокрутке до его начала.
+    static constexpr int kModelWindowStep_ = 1024;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,114 @@
+#include "memorybudget.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+
+MemoryBudget::MemoryBudget(qint64 limitBytes)
+    : m_limitBytes(limitBytes)
+{
+}
+
+int MemoryBudget::registerConsumer(const QString& name, SizeFn size, EvictFn evict)
+{
+    Consumer c;
+    c.id = m_nextId++;
+    c.name = name;
+    c.size = std::move(size);
+    c.evict = std::move(evict);
+    c.lastUse = ++m_clock;
+    m_consumers.push_back(std::move(c));
+    return m_consumers.back().id;
+}
+
+void MemoryBudget::unregisterConsumer(int id)
+{
+    m_consumers.erase(std::remove_if(m_consumers.begin(), m_consumers.end(),
+                                     [id](const Consumer& c) { return c.id == id; }),
+                      m_consumers.end());
+}
+
+void MemoryBudget::touch(int id)
+{
+    for (auto& c : m_consumers) {
+        if (c.id == id) {
+            c.lastUse = ++m_clock;
+            return;
+        }
+    }
+}
+
+qint64 MemoryBudget::totalBytes() const
+{
+    qint64 total = 0;
+    for (const auto& c : m_consumers)
+        total += c.size ? c.size() : 0;
+    return total;
+}
+
+QVector<MemoryBudget::Usage> MemoryBudget::usage() const
+{
+    QVector<Usage> result;
+    result.reserve(m_consumers.size());
+    for (const auto& c : m_consumers)
+        result.push_back({ c.name, c.size ? c.size() : 0 });
+    return result;
+}
+
+qint64 MemoryBudget::enforce()
+{
+    if (m_limitBytes <= 0)
+        return 0;
+
+    qint64 total = totalBytes();
+    if (total <= m_limitBytes)
+        return 0;
+
+    // Порядок вытеснения: от давно не использованных к недавно использованным.
+    QVector<const Consumer*> order;
+    order.reserve(m_consumers.size());
+    for (const auto& c : m_consumers)
+        order.push_back(&c);
+    std::sort(order.begin(), order.end(),
+              [](const Consumer* a, const Consumer* b) { return a->lastUse < b->lastUse; });
+
+    qint64 freed = 0;
+    for (const Consumer* c : order) {
+        if (total <= m_limitBytes)
+            break;
+        if (!c->evict)
+            continue;
+
+        const qint64 got = c->evict(total - m_limitBytes);
+        if (got > 0) {
+            freed += got;
+            total -= got;
+        }
+    }
+    return freed;
+}
+
+qint64 MemoryBudget::limitFromEnvironment(qint64 fallback)
+{
+    bool ok = false;
+    const qint64 mb = qEnvironmentVariable(kEnvLimitMb).toLongLong(&ok);
+    if (!ok || mb < 0)
+        return fallback;
+    return mb * 1024 * 1024;
+}
+
+qint64 MemoryBudget::estimateRowCacheBytes(int rows, int columns)
+{
+    if (rows <= 0 || columns <= 0)
+        return 0;
+    return static_cast<qint64>(rows) * columns * kRowCacheBytesPerCell;
+}
+
+QString MemoryBudget::formatBytes(qint64 bytes)
+{
+    if (bytes < 1024)
+        return QString("%1 B").arg(bytes);
+    if (bytes < 1024 * 1024)
+        return QString("%1 KB").arg(bytes / 1024.0, 0, 'f', 1);
+    return QString("%1 MB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+}
@@ -0,0 +1,114 @@
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+/**
+ * @brief Учёт памяти кэшей приложения и глобальный бюджет с вытеснением.
+ *
+ * Каждый кэш (строки QSqlTableModel, страницы, результаты запросов, рендер-кэши)
+ * регистрируется как "потребитель" с двумя функциями:
+ *  - size()  — сколько байт он сейчас удерживает (оценка),
+ *  - evict() — попытаться освободить не меньше указанного числа байт.
+ *
+ * enforce() проверяет сумму и, если бюджет превышен, вытесняет данные,
+ * начиная с самого "холодного" потребителя (давнее всех вызывал touch()).
+ *
+ * @note Класс не потокобезопасен: используется из GUI-потока.
+ */
+class MemoryBudget
+{
+public:
+    /// Размер кэша одного потребителя (байт).
+    using SizeFn = std::function<qint64()>;
+    /// Освобождает не меньше bytesToFree (если может). Возвращает освобождённые байты.
+    using EvictFn = std::function<qint64(qint64 bytesToFree)>;
+
+    /// Текущее потребление одного кэша (для отображения в UI).
+    struct Usage
+    {
+        QString name;
+        qint64 bytes = 0;
+    };
+
+    /// Бюджет по умолчанию: 256 МБ.
+    static constexpr qint64 kDefaultLimitBytes = 256LL * 1024 * 1024;
+
+    /// Переменная окружения с бюджетом в мегабайтах.
+    static constexpr const char* kEnvLimitMb = "LAB2_MEMORY_BUDGET_MB";
+
+    explicit MemoryBudget(qint64 limitBytes = kDefaultLimitBytes);
+
+    /**
+     * @brief Регистрирует кэш.
+     * @return Идентификатор для touch()/unregisterConsumer().
+     */
+    int registerConsumer(const QString& name, SizeFn size, EvictFn evict);
+
+    /// Снимает кэш с учёта (например, при удалении модели).
+    void unregisterConsumer(int id);
+
+    /// Помечает кэш как только что использованный ("горячий").
+    void touch(int id);
+
+    /// Суммарный объём всех зарегистрированных кэшей.
+    qint64 totalBytes() const;
+
+    /// Потребление по каждому кэшу.
+    QVector<Usage> usage() const;
+
+    qint64 limitBytes() const { return m_limitBytes; }
+
+    /// Задаёт бюджет. Значение <= 0 отключает вытеснение.
+    void setLimitBytes(qint64 bytes) { m_limitBytes = bytes; }
+
+    /**
+     * @brief Приводит потребление к бюджету.
+     *
+     * Вытесняет данные от холодных кэшей к горячим, пока сумма больше бюджета
+     * или пока потребители могут что-то освободить.
+     *
+     * @return Количество освобождённых байт (0, если бюджет не превышен).
+     */
+    qint64 enforce();
+
+    /**
+     * @brief Читает бюджет из переменной окружения kEnvLimitMb.
+     * @param fallback Значение, если переменная не задана или некорректна.
+     */
+    static qint64 limitFromEnvironment(qint64 fallback = kDefaultLimitBytes);
+
+    /**
+     * @brief Оценка памяти кэша строк QSqlQueryModel/QSqlTableModel.
+     *
+     * Драйвер QSQLITE кэширует каждую выбранную строку как QVector<QVariant>,
+     * поэтому оценка = rows * columns * kRowCacheBytesPerCell.
+     */
+    static qint64 estimateRowCacheBytes(int rows, int columns);
+
+    /// Средняя стоимость одной ячейки в кэше строк (QVariant + небольшая строка).
+    static constexpr qint64 kRowCacheBytesPerCell = 48;
+
+    /// Форматирует объём в человекочитаемый вид ("12.3 MB").
+    static QString formatBytes(qint64 bytes);
+
+private:
+    struct Consumer
+    {
+        int id = 0;
+        QString name;
+        SizeFn size;
+        EvictFn evict;
+        quint64 lastUse = 0;
+    };
+
+    QVector<Consumer> m_consumers;
+    qint64 m_limitBytes = kDefaultLimitBytes;
+    int m_nextId = 1;
+    quint64 m_clock = 0;
+};
+
+#endif // MEMORYBUDGET_H
@@ -12,12 +12,7 @@
 #include <QStyleOptionComboBox>
 #include <QVariant>
 
-/**
- * @brief Преобразует числовое значение Qt::PenStyle в строку для отображения.
- * @param v Значение стиля (как хранится в БД / Qt::EditRole).
- * @return Текст (например "SolidLine"). Для неизвестных значений: "Style(N)".
- */
-static QString penStyleToText(int v)
+QString MyDelegate::penStyleToText(int v)
 {
     switch (static_cast<Qt::PenStyle>(v)) {
     case Qt::NoPen:          return "NoPen";
@@ -3,6 +3,8 @@
 
 #include <QStyledItemDelegate>
 
+#include "rectangleschema.h"
+
 class QComboBox;
 
 /**
@@ -18,8 +20,7 @@ class QComboBox;
  *  - paint(): для PenStyle рисует “ComboBox-подобное” отображение с текстом (SolidLine и т.п.),
  *    чтобы в таблице не показывались голые числа.
  *
- * @note Индексы столбцов должны соответствовать структуре таблицы:
- *       id=0, pencolor=1, penstyle=2, ...
+ * @note Индексы столбцов берутся из описания схемы (rectangleschema.h).
  */
 class MyDelegate final : public QStyledItemDelegate
 {
@@ -76,12 +77,19 @@ public:
                const QStyleOptionViewItem& option,
                const QModelIndex& index) const override;
 
+    /**
+     * @brief Преобразует числовое значение Qt::PenStyle в строку для отображения.
+     * @param v Значение стиля (как хранится в БД / Qt::EditRole).
+     * @return Текст (например "SolidLine"). Для неизвестных значений: "Style(N)".
+     */
+    static QString penStyleToText(int v);
+
 private:
-    /// Столбец pencolor в таблице rectangle (id=0, pencolor=1).
-    static constexpr int kPenColorColumn = 1;
+    /// Столбец цвета пера (pen_id) в таблице rectangle.
+    static constexpr int kPenColorColumn = rectschema::PenColor;
 
-    /// Столбец penstyle в таблице rectangle (id=0, penstyle=2).
-    static constexpr int kPenStyleColumn = 2;
+    /// Столбец penstyle в таблице rectangle.
+    static constexpr int kPenStyleColumn = rectschema::PenStyle;
 
 private:
     /// Заполняет combo вариантами Qt::PenStyle. В userData хранится int(enum).
@@ -0,0 +1,128 @@
+#include "parallelscanner.h"
+
+#include <QFuture>
+#include <QThread>
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include "logger.h"
+#include "rectbulkio.h"
+#include "scopedconnection.h"
+
+namespace {
+
+/// Результат чтения одной части.
+struct PartResult
+{
+    qint64 rows = 0;
+    QString error;
+};
+
+} // namespace
+
+ParallelScanner::ParallelScanner(const QString& dbPath, int partitions)
+    : m_dbPath(dbPath)
+    , m_partitions(partitions > 0 ? partitions : qMax(1, QThread::idealThreadCount()))
+{
+}
+
+QVector<ParallelScanner::Partition> ParallelScanner::split(qint64 minId, qint64 maxId, int n)
+{
+    QVector<Partition> parts;
+    if (maxId < minId || n <= 0) return parts;
+
+    const qint64 span = maxId - minId + 1;
+    const qint64 count = qMin<qint64>(n, span);
+    const qint64 width = span / count;
+    const qint64 extra = span % count;  // первые extra частей на одну id шире
+
+    qint64 from = minId;
+    for (qint64 i = 0; i < count; ++i) {
+        const qint64 to = from + width - 1 + (i < extra ? 1 : 0);
+        parts.append({ from, to });
+        from = to + 1;
+    }
+    return parts;
+}
+
+QVector<ParallelScanner::Partition> ParallelScanner::partitions()
+{
+    ScopedConnection conn(m_dbPath, "scan_plan", true);
+    if (!conn.isOpen()) {
+        m_lastError = "cannot open " + m_dbPath + ": " + conn.error();
+        return {};
+    }
+
+    QSqlQuery q(conn.db());
+    if (!q.exec("SELECT MIN(id), MAX(id) FROM rectangle;") || !q.next()) {
+        m_lastError = "SELECT MIN/MAX failed: " + q.lastError().text();
+        return {};
+    }
+    if (q.value(0).isNull())
+        return {};
+
+    return split(q.value(0).toLongLong(), q.value(1).toLongLong(), m_partitions);
+}
+
+bool ParallelScanner::scan(const Visitor& visit)
+{
+    m_lastError.clear();
+    m_rowsScanned = 0;
+    m_planned = 0;
+
+    const QVector<Partition> parts = partitions();
+    if (!m_lastError.isEmpty()) return false;
+    m_planned = parts.size();
+
+    const QString dbPath = m_dbPath;
+    QVector<QFuture<PartResult>> futures;
+    futures.reserve(parts.size());
+
+    for (int i = 0; i < parts.size(); ++i) {
+        const Partition part = parts.at(i);
+        futures.append(QtConcurrent::run([dbPath, part, i, &visit] {
+            PartResult r;
+
+            ScopedConnection conn(dbPath, "scan", true);
+            if (!conn.isOpen()) {
+                r.error = conn.error();
+                return r;
+            }
+
+            {
+                // Нативный путь sqlite3, если вкомпилирован (см. rectbulkio.h), иначе QSqlQuery.
+                RectBulkReader reader(conn.db());
+                if (!reader.exec(part.fromId, part.toId)) {
+                    r.error = reader.lastError();
+                    return r;
+                }
+
+                RectRow row;
+                while (reader.next(row)) {
+                    visit(i, row);
+                    ++r.rows;
+                }
+                if (!reader.lastError().isEmpty())
+                    r.error = reader.lastError();
+            }
+            return r;
+        }));
+    }
+
+    QStringList errors;
+    for (int i = 0; i < futures.size(); ++i) {
+        const PartResult r = futures[i].result();
+        m_rowsScanned += r.rows;
+        if (!r.error.isEmpty())
+            errors << QString("partition %1 [%2..%3]: %4").arg(i).arg(parts.at(i).fromId).arg(parts.at(i).toId).arg(r.error);
+    }
+
+    if (!errors.isEmpty()) {
+        m_lastError = errors.join("; ");
+        LAB2_WARNING(lcDb()) << "ParallelScanner:" << m_lastError;
+        return false;
+    }
+    return true;
+}
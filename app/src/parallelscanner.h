@@ -0,0 +1,94 @@
+#ifndef PARALLELSCANNER_H
+#define PARALLELSCANNER_H
+
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+#include "rectrow.h"
+
+/**
+ * @brief Параллельный полный скан таблицы rectangle по диапазонам id.
+ *
+ * Диапазон [MIN(id), MAX(id)] делится на N равных частей; каждая часть читается в своём потоке
+ * через своё соединение (ScopedConnection, только чтение) запросом
+ * "WHERE id BETWEEN ? AND ? ORDER BY id" — это поиск по первичному ключу, части не пересекаются.
+ *
+ * Пользовательский код получает строки через visitor, который вызывается параллельно
+ * для разных частей (номер части — первый аргумент); внутри одной части строки идут по возрастанию id.
+ * Для агрегатов удобнее aggregate(): у каждой части свой аккумулятор, в конце они сливаются
+ * merge() по порядку частей — результат детерминирован и не требует блокировок.
+ *
+ * @note Части читаются разными транзакциями: при одновременной записи в таблицу скан не является
+ *       согласованным снимком. Для согласованных данных используйте RectSnapshot.
+ */
+class ParallelScanner
+{
+public:
+    /// Диапазон id одной части (включительно).
+    struct Partition
+    {
+        qint64 fromId = 0;
+        qint64 toId = -1;
+    };
+
+    /// Обработчик строк: номер части, строка. Вызывается из рабочих потоков.
+    using Visitor = std::function<void(int partition, const RectRow& row)>;
+
+    /**
+     * @param dbPath Путь к файлу SQLite (соединения открываются заново в каждом потоке).
+     * @param partitions Число частей (0 — по числу ядер).
+     */
+    explicit ParallelScanner(const QString& dbPath, int partitions = 0);
+
+    int partitionCount() const { return m_partitions; }
+
+    /// Делит [minId, maxId] на не более чем n непустых частей равной ширины.
+    static QVector<Partition> split(qint64 minId, qint64 maxId, int n);
+
+    /// Вычисляет части по MIN/MAX(id) таблицы. Пустой список — таблица пуста (или ошибка, см. lastError()).
+    QVector<Partition> partitions();
+
+    /**
+     * @brief Запускает скан, блокируя вызывающий поток до завершения всех частей.
+     * @return false, если хотя бы одна часть не прочитана (текст — lastError()).
+     */
+    bool scan(const Visitor& visit);
+
+    /**
+     * @brief Параллельная агрегация: visit(acc, row) в каждой части, затем merge(result, partial).
+     *
+     * Каждая часть начинает с пустого Acc(), поэтому начальное значение result учитывается
+     * ровно один раз; при ошибке result не меняется.
+     */
+    template <typename Acc, typename Visit, typename Merge>
+    bool aggregate(Acc& result, Visit visit, Merge merge)
+    {
+        QVector<Acc> partial(m_partitions, Acc());
+        Acc* accs = partial.data();  // отсоединяем один раз до запуска потоков
+        const bool ok = scan([accs, &visit](int part, const RectRow& row) {
+            visit(accs[part], row);
+        });
+        if (!ok) return false;
+
+        for (int i = 0; i < m_planned; ++i)
+            merge(result, partial.at(i));
+        return true;
+    }
+
+    /// Строк прочитано в последнем скане.
+    qint64 rowsScanned() const { return m_rowsScanned; }
+
+    QString lastError() const { return m_lastError; }
+
+private:
+    QString m_dbPath;
+    int m_partitions = 1;
+    /// Сколько частей реально запущено в последнем скане (<= m_partitions).
+    int m_planned = 0;
+    qint64 m_rowsScanned = 0;
+    QString m_lastError;
+};
+
+#endif // PARALLELSCANNER_H
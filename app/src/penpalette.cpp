@@ -0,0 +1,131 @@
+#include "penpalette.h"
+
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include "busyretry.h"
+#include "logger.h"
+#include "rectrowdecoder.h"
+
+namespace {
+
+/// Верхняя граница id: словарь — это десятки цветов, массив по id не должен разрастаться.
+constexpr int kMaxPaletteId = 1 << 20;
+
+} // namespace
+
+PenPalette::PenPalette(QSqlDatabase db, const QString& schema)
+    : m_db(std::move(db))
+    , m_table(schema.isEmpty() ? QString(kTable) : schema + '.' + kTable)
+{
+}
+
+void PenPalette::setDatabase(QSqlDatabase db)
+{
+    m_db = std::move(db);
+    invalidate();
+}
+
+void PenPalette::invalidate()
+{
+    m_loaded = false;
+    m_ids.clear();
+    m_colors.clear();
+    m_missing.clear();
+}
+
+bool PenPalette::load()
+{
+    // Отсутствующие id переживают перечитывание: иначе каждый из них снова вызывал бы load().
+    m_loaded = false;
+    m_ids.clear();
+    m_colors.clear();
+    m_lastError.clear();
+
+    QSqlQuery q(m_db);
+    q.setForwardOnly(true);
+    if (!q.exec(QString("SELECT id, color FROM %1 ORDER BY id;").arg(m_table))) {
+        m_lastError = "cannot read " + m_table + ": " + q.lastError().text();
+        LAB2_WARNING(lcDb()) << "PenPalette:" << m_lastError;
+        return false;
+    }
+    while (q.next())
+        put_(q.value(0).toInt(), RectRowDecoder::parseColor(q.value(1).toString()));
+
+    m_loaded = true;
+    return true;
+}
+
+int PenPalette::idFor(const QColor& color)
+{
+    const QRgb key = color.rgb();
+    if (!m_loaded) load();
+
+    const auto it = m_ids.constFind(key);
+    if (it != m_ids.constEnd())
+        return it.value();
+
+    // Нового цвета нет в кэше: добавляем (или его уже добавило другое соединение).
+    const QString name = color.name();
+    QSqlQuery q(m_db);
+    q.prepare(QString("INSERT OR IGNORE INTO %1 (color) VALUES (?);").arg(m_table));
+    q.addBindValue(name);
+    if (!(m_retry ? m_retry->exec(q) : q.exec())) {
+        m_lastError = "cannot add color " + name + ": " + q.lastError().text();
+        return -1;
+    }
+
+    q.prepare(QString("SELECT id FROM %1 WHERE color = ?;").arg(m_table));
+    q.addBindValue(name);
+    if (!q.exec() || !q.next()) {
+        m_lastError = "cannot read id of color " + name + ": " + q.lastError().text();
+        return -1;
+    }
+
+    const int id = q.value(0).toInt();
+    put_(id, color);
+    return id;
+}
+
+QColor PenPalette::color(int id)
+{
+    if (id <= 0)
+        return QColor();
+    const auto known = [this, id] { return id < m_colors.size() && m_colors.at(id).isValid(); };
+    if (m_loaded && known())
+        return m_colors.at(id);
+    if (m_loaded && m_missing.contains(id))
+        return QColor();
+
+    if (load() && !known())
+        m_missing.insert(id);
+    return known() ? m_colors.at(id) : QColor();
+}
+
+const QVector<QColor>& PenPalette::colors()
+{
+    if (!m_loaded) load();
+    return m_colors;
+}
+
+QVector<QColor> PenPalette::loadColors(QSqlDatabase db, QString* error)
+{
+    PenPalette palette(std::move(db));
+    if (!palette.load() && error)
+        *error = palette.lastError();
+    return palette.m_colors;
+}
+
+void PenPalette::put_(int id, const QColor& color)
+{
+    if (id <= 0 || id > kMaxPaletteId) {
+        LAB2_WARNING(lcDb()) << "PenPalette: id out of range:" << id;
+        return;
+    }
+    if (id >= m_colors.size())
+        m_colors.resize(id + 1);
+    m_colors[id] = color;
+    m_missing.remove(id);
+    if (!m_ids.contains(color.rgb()))
+        m_ids.insert(color.rgb(), id);
+}
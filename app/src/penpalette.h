@@ -0,0 +1,92 @@
+#ifndef PENPALETTE_H
+#define PENPALETTE_H
+
+#include <QColor>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include <QtSql/QSqlDatabase>
+
+class BusyRetry;
+
+/**
+ * @brief Словарь цветов пера: таблица pen_palette (id -> "#rrggbb") и её кэш в памяти.
+ *
+ * С версии схемы v5 rectangle хранит вместо строки цвета маленький целый pen_id
+ * (внешний ключ на pen_palette). Различных цветов — десятки, строк — миллионы,
+ * поэтому строка "#rrggbb" на каждую строку таблицы тратила место и страничный кэш.
+ *
+ * Кэш двунаправленный:
+ *  - idFor(color) — при вставке/правке: цвет -> id, новый цвет добавляется в pen_palette;
+ *  - color(id) — при отображении и чтении: id -> цвет (массив по id, без поиска).
+ * Таблица читается целиком при первом обращении и перечитывается, если встретился
+ * неизвестный id (цвет добавило другое соединение). id, которого нет и после перечитывания
+ * (битая ссылка, откаченная вставка), запоминается: color() для него больше не читает таблицу
+ * до invalidate().
+ *
+ * Для таблиц из присоединённых БД (ATTACH DATABASE ... AS aux) словарь берётся из той же
+ * схемы: PenPalette(db, "aux") читает aux.pen_palette.
+ *
+ * @note Один экземпляр — на одно соединение и один поток. Если транзакция, в которой
+ *       idFor() добавил цвет, откатилась, нужно вызвать invalidate().
+ */
+class PenPalette
+{
+public:
+    /// Таблица словаря.
+    static constexpr const char* kTable = "pen_palette";
+
+    /// @param schema Схема (имя присоединённой БД); пустая — основная.
+    explicit PenPalette(QSqlDatabase db = QSqlDatabase(), const QString& schema = QString());
+
+    /// Переключает словарь на другое соединение (кэш сбрасывается).
+    void setDatabase(QSqlDatabase db);
+
+    /// Добавление нового цвета в idFor() — с повтором при SQLITE_BUSY (nullptr — без). Владение не передаётся.
+    void setBusyRetry(BusyRetry* retry) { m_retry = retry; }
+
+    /// Перечитывает pen_palette.
+    bool load();
+
+    /// Сбрасывает кэш и список отсутствующих id; следующее обращение перечитает таблицу.
+    void invalidate();
+
+    /**
+     * @brief id цвета; отсутствующий цвет добавляется в pen_palette.
+     * @return id (> 0) или -1 при ошибке (см. lastError()).
+     */
+    int idFor(const QColor& color);
+
+    /// Цвет по id (QColor() — id неизвестен; таблица перечитывается для такого id один раз).
+    QColor color(int id);
+
+    /// Таблица цветов по id (индекс — id) для чтения без обращения к словарю.
+    const QVector<QColor>& colors();
+
+    /// Число цветов в кэше.
+    int size() const { return m_ids.size(); }
+
+    QString lastError() const { return m_lastError; }
+
+    /// Читает pen_palette в таблицу цветов по id (для читателей на других соединениях).
+    static QVector<QColor> loadColors(QSqlDatabase db, QString* error = nullptr);
+
+private:
+    void put_(int id, const QColor& color);
+
+private:
+    QSqlDatabase m_db;
+    BusyRetry* m_retry = nullptr;
+    /// Имя таблицы словаря с учётом схемы ("pen_palette" или "aux.pen_palette").
+    QString m_table;
+    bool m_loaded = false;
+    QHash<QRgb, int> m_ids;
+    QVector<QColor> m_colors;
+    /// id, которых не оказалось в таблице и после перечитывания.
+    QSet<int> m_missing;
+    QString m_lastError;
+};
+
+#endif // PENPALETTE_H
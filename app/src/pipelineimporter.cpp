@@ -0,0 +1,477 @@
+#include "pipelineimporter.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QThread>
+#include <QVector>
+
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "busyretry.h"
+#include "logger.h"
+#include "rectbulkio.h"
+#include "ringbuffer.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Сырая порция строк файла.
+struct RawChunk
+{
+    qint64 seq = -1;
+    qint64 firstLine = 0;  ///< Номер первой строки порции (с 1).
+    qint64 lastLine = 0;
+    qint64 endOffset = 0;  ///< Смещение в файле после последней строки порции.
+    QList<QByteArray> lines;
+};
+
+/// Разобранная порция.
+struct ParsedChunk
+{
+    qint64 seq = -1;
+    qint64 lastLine = 0;
+    qint64 endOffset = 0;
+    QVector<MyRect> rows;
+    qint64 badLines = 0;
+    QString firstBadLine;
+};
+
+/// Ожидание с нарастающей паузой: сначала yield, потом короткий сон.
+void backoff(int& spins)
+{
+    if (++spins < 64)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+qint64 elapsedNs(Clock::time_point since)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - since).count();
+}
+
+/// Общее состояние стадий конвейера.
+struct Pipeline
+{
+    Pipeline(std::size_t queueChunks, qint64 reorderWindow)
+        : raw(queueChunks)
+        , parsed(queueChunks)
+        , window(reorderWindow)
+    {
+    }
+
+    MpmcRingBuffer<RawChunk> raw;
+    MpmcRingBuffer<ParsedChunk> parsed;
+
+    std::atomic<bool> readerDone { false };
+    std::atomic<qint64> totalChunks { 0 };
+    std::atomic<bool> cancelled { false };
+
+    /// Следующая порция, которую ждёт запись (для ограничения переупорядочивания).
+    std::atomic<qint64> writerNext { 0 };
+    const qint64 window;
+
+    std::atomic<qint64> readerStallNs { 0 };
+};
+
+bool isHeader(const QByteArray& line)
+{
+    return line.toLower().contains("pencolor");
+}
+
+} // namespace
+
+PipelineImporter::PipelineImporter(QSqlDatabase db)
+    : m_db(std::move(db))
+    , m_parsers(qMax(1, QThread::idealThreadCount() - 2))
+{
+}
+
+bool PipelineImporter::parseLine(const QByteArray& line, MyRect* out, QString* error)
+{
+    const auto fail = [error](const QString& what) {
+        if (error) *error = what;
+        return false;
+    };
+
+    QList<QByteArray> fields = line.trimmed().split(',');
+    if (fields.size() == 8)
+        fields.removeFirst();  // ведущий id
+    if (fields.size() != 7)
+        return fail(QString("expected 7 fields, got %1").arg(fields.size()));
+
+    const QColor color(QString::fromLatin1(fields.at(0).trimmed()));
+    if (!color.isValid())
+        return fail("invalid color " + QString::fromLatin1(fields.at(0)));
+
+    int values[6] = {};
+    for (int i = 0; i < 6; ++i) {
+        bool ok = false;
+        values[i] = fields.at(i + 1).trimmed().toInt(&ok);
+        if (!ok)
+            return fail(QString("field %1 is not an integer").arg(i + 2));
+    }
+
+    *out = MyRect(color, static_cast<Qt::PenStyle>(values[0]), values[1],
+                  values[2], values[3], values[4], values[5]);
+    return true;
+}
+
+PipelineImporter::Stats PipelineImporter::importCsv(const QString& path)
+{
+    Stats s;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        s.error = "cannot open " + path + ": " + file.errorString();
+        return s;
+    }
+    const QFileInfo info(file);
+    const QString source = info.absoluteFilePath();
+    const qint64 fileSize = info.size();
+    const qint64 fileMtimeMs = info.lastModified().toMSecsSinceEpoch();
+
+    // Без таблицы отметок (схема < v6) импорт работает, но не возобновляется.
+    const bool checkpoints = m_db.tables().contains(kProgressTable);
+    Progress base;
+    if (checkpoints && m_resume) {
+        Progress saved;
+        QString err;
+        if (loadProgress(m_db, path, &saved, &err)) {
+            if (!saved.done) {
+                if (saved.fileSize != fileSize || saved.fileMtimeMs != fileMtimeMs) {
+                    s.error = QString("%1 changed since the interrupted import (stopped after line %2); "
+                                      "clear its %3 row to start over").arg(path).arg(saved.line).arg(kProgressTable);
+                    return s;
+                }
+                base = saved;
+            }
+        } else if (!err.isEmpty()) {
+            s.error = err;
+            return s;
+        }
+    }
+    if (base.offset > 0 && !file.seek(base.offset)) {
+        s.error = QString("cannot seek %1 to %2: %3").arg(path).arg(base.offset).arg(file.errorString());
+        return s;
+    }
+    s.resumedAtLine = base.line;
+    s.resumedRows = base.rows;
+    if (base.line > 0)
+        LAB2_INFO(lcDb()) << "PipelineImporter: resuming" << path << "after line" << base.line << "("
+                          << base.rows << "rows already imported)";
+
+    RectBulkWriter ins(m_db);
+    if (!ins.isValid()) {
+        s.error = "prepare INSERT failed: " + ins.lastError();
+        return s;
+    }
+
+    QSqlQuery saveProgress(m_db);
+    if (checkpoints
+            && !saveProgress.prepare(QString("INSERT OR REPLACE INTO %1 (source, file_size, file_mtime, byte_offset,"
+                                             " line_no, batches, row_count, bad_lines, done)"
+                                             " VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);").arg(kProgressTable))) {
+        s.error = "prepare progress update failed: " + saveProgress.lastError().text();
+        return s;
+    }
+
+    Pipeline p(std::size_t(m_queueChunks), qint64(m_queueChunks) * 2);
+    const int chunkLines = m_chunkLines;
+    const qint64 startLine = base.line;
+
+    // --- чтение ---
+    std::thread reader([&p, &file, chunkLines, startLine] {
+        qint64 seq = 0;
+        qint64 lineNo = startLine;
+        RawChunk chunk;
+        chunk.firstLine = startLine + 1;
+
+        const auto push = [&] {
+            chunk.seq = seq++;
+            chunk.lastLine = lineNo;
+            chunk.endOffset = file.pos();
+            const auto waitStart = Clock::now();
+            bool waited = false;
+            int spins = 0;
+            while (!p.raw.tryPush(std::move(chunk))) {
+                if (p.cancelled.load(std::memory_order_relaxed)) return false;
+                waited = true;
+                backoff(spins);
+            }
+            if (waited) p.readerStallNs.fetch_add(elapsedNs(waitStart), std::memory_order_relaxed);
+            chunk = RawChunk();
+            chunk.firstLine = lineNo + 1;
+            return true;
+        };
+
+        while (!file.atEnd()) {
+            chunk.lines.append(file.readLine());
+            ++lineNo;
+            if (chunk.lines.size() == chunkLines && !push())
+                break;
+        }
+        if (!chunk.lines.isEmpty() && !p.cancelled.load())
+            push();
+
+        p.totalChunks.store(seq, std::memory_order_relaxed);
+        p.readerDone.store(true, std::memory_order_release);
+    });
+
+    // --- разбор ---
+    std::vector<std::thread> parsers;
+    for (int t = 0; t < m_parsers; ++t) {
+        parsers.emplace_back([&p] {
+            int spins = 0;
+            RawChunk chunk;
+            for (;;) {
+                if (p.cancelled.load(std::memory_order_relaxed)) return;
+                if (!p.raw.tryPop(chunk)) {
+                    // Чтение закончено: всё, что оно положило, уже видно — добираем остаток и выходим.
+                    if (!p.readerDone.load(std::memory_order_acquire)) {
+                        backoff(spins);
+                        continue;
+                    }
+                    if (!p.raw.tryPop(chunk))
+                        return;
+                }
+                spins = 0;
+
+                ParsedChunk out;
+                out.seq = chunk.seq;
+                out.lastLine = chunk.lastLine;
+                out.endOffset = chunk.endOffset;
+                out.rows.reserve(chunk.lines.size());
+                for (int i = 0; i < chunk.lines.size(); ++i) {
+                    const QByteArray& line = chunk.lines.at(i);
+                    if (line.trimmed().isEmpty()) continue;
+
+                    MyRect r;
+                    QString err;
+                    if (parseLine(line, &r, &err)) {
+                        out.rows.append(r);
+                    } else if (!(chunk.firstLine == 1 && i == 0 && isHeader(line))) {
+                        if (out.badLines++ == 0)
+                            out.firstBadLine = QString("line %1: %2").arg(chunk.firstLine + i).arg(err);
+                    }
+                }
+                chunk = RawChunk();
+
+                // Не уходим слишком далеко вперёд записи: буфер переупорядочивания ограничен.
+                while (out.seq >= p.writerNext.load(std::memory_order_acquire) + p.window) {
+                    if (p.cancelled.load(std::memory_order_relaxed)) return;
+                    backoff(spins);
+                }
+                while (!p.parsed.tryPush(std::move(out))) {
+                    if (p.cancelled.load(std::memory_order_relaxed)) return;
+                    backoff(spins);
+                }
+                spins = 0;
+            }
+        });
+    }
+
+    // --- запись (вызывающий поток) ---
+    std::map<qint64, ParsedChunk> pending;
+    qint64 next = 0;
+    int inBatch = 0;
+    QVector<MyRect> batchRows; // только при m_committedRows
+    bool inTx = false;
+    qint64 writerIdleNs = 0;
+    int spins = 0;
+
+    // Позиция после последней записанной порции — отметка прогресса для следующего COMMIT.
+    qint64 posOffset = base.offset;
+    qint64 posLine = base.line;
+
+    const auto writeProgress = [&](bool batch, bool done) {
+        const QVariantList values = { source, fileSize, fileMtimeMs, posOffset, posLine,
+                                      base.batches + s.batches + (batch ? 1 : 0),
+                                      base.rows + s.rows + inBatch, base.badLines + s.badLines, done ? 1 : 0 };
+        for (int i = 0; i < values.size(); ++i)
+            saveProgress.bindValue(i, values.at(i));
+        return saveProgress.exec();
+    };
+
+    // Порция данных и отметка прогресса фиксируются одной транзакцией.
+    const auto commit = [&](bool done) -> bool {
+        const bool batch = inTx;
+        if (!batch) {
+            if (!checkpoints || !done) return true;
+            // Данные уже зафиксированы — отдельной транзакцией только отметка "завершён".
+            if (!begin_()) {
+                s.error = "BEGIN failed: " + m_db.lastError().text();
+                return false;
+            }
+        }
+        inTx = false;
+        if (checkpoints && !writeProgress(batch, done)) {
+            s.error = "progress update failed: " + saveProgress.lastError().text();
+            m_db.rollback();
+            return false;
+        }
+        if (!commit_()) {
+            s.error = "COMMIT failed: " + m_db.lastError().text();
+            m_db.rollback();
+            return false;
+        }
+        if (batch) {
+            s.rows += inBatch;
+            ++s.batches;
+            if (m_committedRows)
+                m_committedRows(batchRows);
+        }
+        inBatch = 0;
+        batchRows.clear();
+        return true;
+    };
+
+    const auto writeChunk = [&](const ParsedChunk& c) -> bool {
+        s.badLines += c.badLines;
+        if (c.badLines > 0 && s.firstBadLine.isEmpty())
+            s.firstBadLine = c.firstBadLine;
+
+        for (const MyRect& r : c.rows) {
+            if (!inTx) {
+                if (!begin_()) {
+                    s.error = "BEGIN failed: " + m_db.lastError().text();
+                    return false;
+                }
+                inTx = true;
+            }
+            if (!ins.insert(r)) {
+                s.error = "INSERT failed: " + ins.lastError();
+                m_db.rollback();
+                inTx = false;
+                return false;
+            }
+            ++inBatch;
+            if (m_committedRows)
+                batchRows.append(r);
+        }
+        return true;
+    };
+
+    bool ok = true;
+    for (;;) {
+        ParsedChunk c;
+        while (p.parsed.tryPop(c))
+            pending.emplace(c.seq, std::move(c));
+
+        const auto it = pending.find(next);
+        if (it == pending.end()) {
+            if (p.readerDone.load(std::memory_order_acquire) && next == p.totalChunks.load())
+                break;
+            const auto waitStart = Clock::now();
+            backoff(spins);
+            writerIdleNs += elapsedNs(waitStart);
+            continue;
+        }
+        spins = 0;
+
+        ok = writeChunk(it->second);
+        if (ok) {
+            // Транзакция закрывается только на границе порции: отметке нужно смещение в файле.
+            posOffset = it->second.endOffset;
+            posLine = it->second.lastLine;
+            if (inBatch >= m_batchRows)
+                ok = commit(false);
+        }
+        pending.erase(it);
+        p.writerNext.store(++next, std::memory_order_release);
+        if (!ok) break;
+    }
+    if (ok)
+        ok = commit(true);
+
+    if (!ok)
+        p.cancelled.store(true);
+
+    reader.join();
+    for (auto& t : parsers)
+        t.join();
+
+    s.readerStallMs = p.readerStallNs.load() / 1000000;
+    s.writerIdleMs = writerIdleNs / 1000000;
+    s.ok = ok;
+
+    LAB2_INFO(lcDb()) << "PipelineImporter:" << s.rows << "rows," << s.badLines << "bad lines,"
+                      << s.batches << "batches, reader stall" << s.readerStallMs
+                      << "ms, writer idle" << s.writerIdleMs << "ms";
+    return s;
+}
+
+bool PipelineImporter::begin_()
+{
+    return m_retry ? m_retry->transaction(m_db) : m_db.transaction();
+}
+
+bool PipelineImporter::commit_()
+{
+    return m_retry ? m_retry->commit(m_db) : m_db.commit();
+}
+
+bool PipelineImporter::loadProgress(QSqlDatabase db, const QString& path, Progress* progress, QString* error)
+{
+    if (!db.tables().contains(kProgressTable))
+        return false;
+
+    QSqlQuery q(db);
+    q.prepare(QString("SELECT file_size, file_mtime, byte_offset, line_no, batches, row_count, bad_lines, done"
+                      " FROM %1 WHERE source = ?;").arg(kProgressTable));
+    q.addBindValue(QFileInfo(path).absoluteFilePath());
+    if (!q.exec()) {
+        if (error) *error = "reading import progress failed: " + q.lastError().text();
+        return false;
+    }
+    if (!q.next())
+        return false;
+
+    progress->fileSize = q.value(0).toLongLong();
+    progress->fileMtimeMs = q.value(1).toLongLong();
+    progress->offset = q.value(2).toLongLong();
+    progress->line = q.value(3).toLongLong();
+    progress->batches = q.value(4).toLongLong();
+    progress->rows = q.value(5).toLongLong();
+    progress->badLines = q.value(6).toLongLong();
+    progress->done = q.value(7).toInt() != 0;
+    return true;
+}
+
+bool PipelineImporter::clearProgress(QSqlDatabase db, const QString& path)
+{
+    if (!db.tables().contains(kProgressTable))
+        return true;
+
+    QSqlQuery q(db);
+    q.prepare(QString("DELETE FROM %1 WHERE source = ?;").arg(kProgressTable));
+    q.addBindValue(QFileInfo(path).absoluteFilePath());
+    if (!q.exec()) {
+        LAB2_WARNING(lcDb()) << "PipelineImporter: cannot clear progress of" << path << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool PipelineImporter::clearAllProgress(QSqlDatabase db)
+{
+    if (!db.tables().contains(kProgressTable))
+        return true;
+
+    QSqlQuery q(db);
+    if (!q.exec(QString("DELETE FROM %1;").arg(kProgressTable))) {
+        LAB2_WARNING(lcDb()) << "PipelineImporter: cannot clear progress:" << q.lastError().text();
+        return false;
+    }
+    return true;
+}
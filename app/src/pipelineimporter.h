@@ -0,0 +1,139 @@
+#ifndef PIPELINEIMPORTER_H
+#define PIPELINEIMPORTER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include <QtSql/QSqlDatabase>
+
+#include <functional>
+
+#include "myrect.h"
+
+class BusyRetry;
+
+/**
+ * @brief Конвейерный импорт CSV в таблицу rectangle: чтение -> разбор (N потоков) -> запись (1 поток).
+ *
+ * Формат строки: pencolor,penstyle,penwidth,left,top,width,height
+ * (допускается ведущий столбец id — он игнорируется; первая строка может быть заголовком).
+ *
+ * Стадии связаны ограниченными lock-free очередями (MpmcRingBuffer):
+ *  - поток чтения режет файл на порции по chunkLines строк и нумерует их;
+ *  - потоки разбора превращают порции в MyRect (битые строки пропускаются и считаются);
+ *  - запись идёт в вызывающем потоке (ему принадлежит соединение): порции вставляются строго
+ *    в порядке файла, транзакциями по batchRows строк.
+ * Полная очередь тормозит предыдущую стадию (backpressure), поэтому память ограничена,
+ * а разбор и запись в SQLite перекрываются — импорт идёт со скоростью самой медленной стадии.
+ * Stats::readerStallMs / writerIdleMs показывают, какая стадия упирается.
+ *
+ * Импорт возобновляемый. Транзакция закрывается на границе порции (batchRows округляется вверх
+ * до целой порции), и в той же транзакции в таблицу kProgressTable (схема v6) пишется смещение
+ * в файле и номер строки после последней вставленной порции. Прерванный импорт (ошибка, падение
+ * процесса) при следующем importCsv() того же файла продолжается с этого смещения: данные и
+ * отметка фиксируются вместе, поэтому строки не теряются и не вставляются дважды.
+ * Завершённый импорт помечается done — повторный importCsv() того же файла начинается сначала.
+ * Если файл изменился с момента прерывания (размер или время изменения), импорт отказывается
+ * продолжать: нужен clearProgress() или setResume(false). Отметки относятся к данным таблицы:
+ * кто удаляет или создаёт таблицу заново, вызывает clearAllProgress().
+ *
+ * @note Уже закоммиченные порции при ошибке записи остаются в таблице (Stats::rows)
+ *       и учтены в отметке прогресса.
+ */
+class PipelineImporter
+{
+public:
+    /// Итог импорта.
+    struct Stats
+    {
+        bool ok = false;
+        qint64 rows = 0;          ///< Вставлено (закоммичено) строк.
+        qint64 badLines = 0;      ///< Пропущено строк с ошибкой разбора.
+        qint64 batches = 0;       ///< Закоммичено транзакций.
+        QString firstBadLine;     ///< Описание первой битой строки ("line N: ...").
+        QString error;
+        qint64 readerStallMs = 0; ///< Чтение ждало места в очереди (разбор/запись не успевают).
+        qint64 writerIdleMs = 0;  ///< Запись ждала разобранных порций (чтение/разбор не успевают).
+        qint64 resumedAtLine = 0; ///< Импорт продолжен после этой строки файла (0 — с начала).
+        qint64 resumedRows = 0;   ///< Строк, вставленных прерванными запусками до этого.
+    };
+
+    /// Отметка прогресса импорта файла (строка kProgressTable).
+    struct Progress
+    {
+        qint64 fileSize = 0;
+        qint64 fileMtimeMs = 0;
+        qint64 offset = 0;     ///< Смещение в файле после последней закоммиченной порции.
+        qint64 line = 0;       ///< Номер последней строки этой порции.
+        qint64 batches = 0;
+        qint64 rows = 0;
+        qint64 badLines = 0;
+        bool done = false;
+    };
+
+    static constexpr const char* kProgressTable = "import_progress";
+
+    static constexpr int kDefaultChunkLines = 1024;
+    static constexpr int kDefaultBatchRows = 5000;
+    static constexpr int kDefaultQueueChunks = 16;
+
+    explicit PipelineImporter(QSqlDatabase db);
+
+    /// Потоков разбора (по умолчанию — число ядер минус два: чтение и запись).
+    void setParserThreads(int n) { m_parsers = qMax(1, n); }
+    int parserThreads() const { return m_parsers; }
+
+    void setChunkLines(int n) { m_chunkLines = n > 0 ? n : kDefaultChunkLines; }
+    void setBatchRows(int n) { m_batchRows = n > 0 ? n : kDefaultBatchRows; }
+
+    /// Ёмкость каждой очереди (в порциях).
+    void setQueueChunks(int n) { m_queueChunks = qMax(2, n); }
+
+    /// Продолжать прерванный импорт с отметки (по умолчанию да); false — всегда с начала.
+    void setResume(bool resume) { m_resume = resume; }
+
+    /// Строки порции сразу после её COMMIT (вызывающий поток): сводки обновляются без повторного скана.
+    using CommittedRowsFn = std::function<void(const QVector<MyRect>& rows)>;
+    void setCommittedRows(CommittedRowsFn fn) { m_committedRows = std::move(fn); }
+
+    /// Транзакции порций открываются и фиксируются через retry (nullptr — напрямую). Владение не передаётся.
+    void setBusyRetry(BusyRetry* retry) { m_retry = retry; }
+
+    /// Импортирует CSV-файл. Блокирует вызывающий поток до конца импорта.
+    Stats importCsv(const QString& path);
+
+    /**
+     * @brief Отметка прогресса импорта path.
+     * @return false — отметки нет (или нет таблицы kProgressTable), *error — при ошибке чтения.
+     */
+    static bool loadProgress(QSqlDatabase db, const QString& path, Progress* progress, QString* error = nullptr);
+
+    /// Удаляет отметку прогресса path: следующий импорт начнётся сначала.
+    static bool clearProgress(QSqlDatabase db, const QString& path);
+
+    /// Удаляет отметки всех файлов (таблица удалена или создана заново — смещения не относятся к данным).
+    static bool clearAllProgress(QSqlDatabase db);
+
+    /**
+     * @brief Разбирает одну строку CSV.
+     * @param error Причина ошибки (может быть nullptr).
+     */
+    static bool parseLine(const QByteArray& line, MyRect* out, QString* error = nullptr);
+
+private:
+    bool begin_();
+    bool commit_();
+
+private:
+    QSqlDatabase m_db;
+    BusyRetry* m_retry = nullptr;
+    CommittedRowsFn m_committedRows;
+    int m_parsers = 1;
+    int m_chunkLines = kDefaultChunkLines;
+    int m_batchRows = kDefaultBatchRows;
+    int m_queueChunks = kDefaultQueueChunks;
+    bool m_resume = true;
+};
+
+#endif // PIPELINEIMPORTER_H
@@ -0,0 +1,76 @@
+#ifndef RECTANALYTICS_H
+#define RECTANALYTICS_H
+
+#include <QRect>
+#include <QtGlobal>
+
+#include "myrect.h"
+
+/**
+ * @brief Сводка по набору прямоугольников: охват, суммарная площадь, средняя толщина пера.
+ *
+ * Накапливается построчно (add()) и складывается из частичных результатов (merge()),
+ * поэтому одинаково считается по снимку (RectSnapshot) и параллельным сканом (ParallelScanner).
+ */
+struct RectAnalytics
+{
+    qint64 rows = 0;
+    /// Сумма width*height.
+    qint64 totalArea = 0;
+    qint64 penWidthSum = 0;
+
+    qint64 minX = 0;
+    qint64 minY = 0;
+    qint64 maxX = 0;
+    qint64 maxY = 0;
+
+    void add(int left, int top, int width, int height, int penWidth)
+    {
+        const qint64 right = qint64(left) + width;
+        const qint64 bottom = qint64(top) + height;
+        if (rows == 0) {
+            minX = left;
+            minY = top;
+            maxX = right;
+            maxY = bottom;
+        } else {
+            minX = qMin<qint64>(minX, left);
+            minY = qMin<qint64>(minY, top);
+            maxX = qMax(maxX, right);
+            maxY = qMax(maxY, bottom);
+        }
+        totalArea += qint64(width) * height;
+        penWidthSum += penWidth;
+        ++rows;
+    }
+
+    void add(const MyRect& r) { add(r.left, r.top, r.width, r.height, r.penWidth); }
+
+    /// Добавляет частичный результат другого потока/диапазона.
+    void merge(const RectAnalytics& o)
+    {
+        if (o.rows == 0) return;
+        if (rows == 0) {
+            *this = o;
+            return;
+        }
+        minX = qMin(minX, o.minX);
+        minY = qMin(minY, o.minY);
+        maxX = qMax(maxX, o.maxX);
+        maxY = qMax(maxY, o.maxY);
+        totalArea += o.totalArea;
+        penWidthSum += o.penWidthSum;
+        rows += o.rows;
+    }
+
+    /// Охватывающий прямоугольник (пустой, если строк нет).
+    QRect bounds() const
+    {
+        if (rows == 0) return QRect();
+        return QRect(QPoint(int(minX), int(minY)), QSize(int(maxX - minX), int(maxY - minY)));
+    }
+
+    double meanPenWidth() const { return rows ? double(penWidthSum) / double(rows) : 0.0; }
+};
+
+#endif // RECTANALYTICS_H
@@ -0,0 +1,260 @@
+#ifndef RECTANGLESCHEMA_H
+#define RECTANGLESCHEMA_H
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+/**
+ * @brief Описание текущей схемы таблицы rectangle, из которого на этапе компиляции
+ *        получаются DDL, подготовленные запросы, индексы колонок и заголовки.
+ *
+ * Раньше схема повторялась строками в INSERT-ах, setHeaderData() и "магическими" номерами
+ * колонок в MyDelegate — правка в одном месте молча расходилась с остальными.
+ * Теперь колонки перечислены один раз в kColumns, а всё остальное строится из них:
+ *  - индексы — enum Column (проверяются static_assert по именам);
+ *  - SQL — constexpr-сборка в статические буферы (kCreateTableSql, kInsertSql, ...), без рантайм-склейки.
+ *
+ * @note Миграции SchemaMigrator — история и намеренно хранят DDL своей версии литералами;
+ *       соответствие последней миграции этому описанию проверяет test_rectangleschema.
+ */
+namespace rectschema {
+
+/// Одна колонка таблицы.
+struct ColumnDef
+{
+    const char* name;
+    /// Тип и ограничения в DDL.
+    const char* sqlType;
+    /// Заголовок в таблице окна.
+    const char* header;
+    /// Выражение GENERATED ALWAYS AS (...) STORED или nullptr.
+    const char* generatedAs;
+    /// Первичный ключ (значение назначает SQLite).
+    bool primaryKey;
+};
+
+/// Имя таблицы.
+inline constexpr const char* kTable = "rectangle";
+
+/// Словарь цветов пера: колонка PenColor хранит id из него (см. PenPalette).
+inline constexpr const char* kPaletteTable = "pen_palette";
+
+/// Колонки в порядке таблицы.
+inline constexpr ColumnDef kColumns[] = {
+    { "id",       "INTEGER PRIMARY KEY AUTOINCREMENT",  "ID",       nullptr,          true  },
+    { "pen_id",   "INTEGER REFERENCES pen_palette(id)", "Color",    nullptr,          false },
+    { "penstyle", "INTEGER",                            "Style",    nullptr,          false },
+    { "penwidth", "INTEGER",                            "PenWidth", nullptr,          false },
+    { "left",     "INTEGER",                            "Left",     nullptr,          false },
+    { "top",      "INTEGER",                            "Top",      nullptr,          false },
+    { "width",    "INTEGER",                            "Width",    nullptr,          false },
+    { "height",   "INTEGER",                            "Height",   nullptr,          false },
+    { "right",    "INTEGER",                            "Right",    "left + width",   false },
+    { "bottom",   "INTEGER",                            "Bottom",   "top + height",   false },
+    { "area",     "INTEGER",                            "Area",     "width * height", false },
+};
+
+/// Индексы колонок (совпадают с порядком kColumns и с индексами колонок модели).
+enum Column : int {
+    Id = 0,
+    PenColor,
+    PenStyle,
+    PenWidth,
+    Left,
+    Top,
+    Width,
+    Height,
+    Right,
+    Bottom,
+    Area,
+    ColumnCount
+};
+
+/// Число колонок, хранимых напрямую (без вычисляемых): id + 7 значений.
+inline constexpr int kValueColumnCount = Height + 1;
+
+/// Число колонок, которые заполняет INSERT (без id и вычисляемых).
+inline constexpr int kInsertColumnCount = kValueColumnCount - 1;
+
+constexpr bool isGenerated(int column) { return kColumns[column].generatedAs != nullptr; }
+constexpr bool isWritable(int column) { return !kColumns[column].primaryKey && !isGenerated(column); }
+
+/// Индекс колонки по имени (-1 — нет такой). Для проверок на этапе компиляции.
+constexpr int indexOf(std::string_view name)
+{
+    for (int i = 0; i < ColumnCount; ++i) {
+        if (name == kColumns[i].name) return i;
+    }
+    return -1;
+}
+
+static_assert(sizeof(kColumns) / sizeof(kColumns[0]) == ColumnCount, "kColumns and Column disagree");
+static_assert(indexOf("id") == Id && indexOf("pen_id") == PenColor && indexOf("penstyle") == PenStyle
+              && indexOf("penwidth") == PenWidth && indexOf("left") == Left && indexOf("top") == Top
+              && indexOf("width") == Width && indexOf("height") == Height && indexOf("right") == Right
+              && indexOf("bottom") == Bottom && indexOf("area") == Area,
+              "Column enum does not match kColumns order");
+
+namespace detail {
+
+/// Писатель для constexpr-сборки строк: без буфера только считает длину.
+struct Writer
+{
+    char* out = nullptr;
+    std::size_t pos = 0;
+
+    constexpr void put(const char* s)
+    {
+        for (std::size_t i = 0; s[i] != '\0'; ++i) {
+            if (out) out[pos] = s[i];
+            ++pos;
+        }
+    }
+};
+
+using Emitter = void (*)(Writer&);
+
+template <Emitter Emit>
+constexpr std::size_t emittedLength()
+{
+    Writer w;
+    Emit(w);
+    return w.pos;
+}
+
+/// Статический буфер с результатом Emit (нуль-терминированный).
+template <Emitter Emit>
+constexpr std::array<char, emittedLength<Emit>() + 1> build()
+{
+    std::array<char, emittedLength<Emit>() + 1> buf {};
+    Writer w;
+    w.out = buf.data();
+    Emit(w);
+    return buf;
+}
+
+/// Список колонок через ", ", отобранных предикатом.
+template <bool (*Pick)(int)>
+constexpr void columnList(Writer& w, const char* prefix = "")
+{
+    bool first = true;
+    for (int i = 0; i < ColumnCount; ++i) {
+        if (!Pick(i)) continue;
+        if (!first) w.put(", ");
+        w.put(prefix);
+        w.put(kColumns[i].name);
+        first = false;
+    }
+}
+
+constexpr bool pickValue(int column) { return !isGenerated(column); }
+constexpr bool pickInsert(int column) { return isWritable(column); }
+
+constexpr void emitCreateTable(Writer& w)
+{
+    w.put("CREATE TABLE %1 (");
+    for (int i = 0; i < ColumnCount; ++i) {
+        if (i > 0) w.put(", ");
+        w.put(kColumns[i].name);
+        w.put(" ");
+        w.put(kColumns[i].sqlType);
+        if (isGenerated(i)) {
+            w.put(" GENERATED ALWAYS AS (");
+            w.put(kColumns[i].generatedAs);
+            w.put(") STORED");
+        }
+    }
+    w.put(");");
+}
+
+constexpr void emitValueColumns(Writer& w)
+{
+    columnList<pickValue>(w);
+}
+
+constexpr void emitInsertColumns(Writer& w)
+{
+    columnList<pickInsert>(w);
+}
+
+constexpr void emitInsert(Writer& w)
+{
+    w.put("INSERT INTO ");
+    w.put(kTable);
+    w.put(" (");
+    columnList<pickInsert>(w);
+    w.put(") VALUES (");
+    for (int i = 0; i < kInsertColumnCount; ++i)
+        w.put(i == 0 ? "?" : ",?");
+    w.put(");");
+}
+
+constexpr void emitInsertWithId(Writer& w)
+{
+    w.put("INSERT INTO ");
+    w.put(kTable);
+    w.put(" (");
+    columnList<pickValue>(w);
+    w.put(") VALUES (");
+    for (int i = 0; i < kValueColumnCount; ++i)
+        w.put(i == 0 ? "?" : ",?");
+    w.put(");");
+}
+
+constexpr void emitNamedInsert(Writer& w)
+{
+    w.put("INSERT INTO ");
+    w.put(kTable);
+    w.put(" (");
+    columnList<pickInsert>(w);
+    w.put(") VALUES (");
+    columnList<pickInsert>(w, ":");
+    w.put(");");
+}
+
+constexpr void emitSelectValues(Writer& w)
+{
+    w.put("SELECT ");
+    columnList<pickValue>(w);
+    w.put(" FROM ");
+    w.put(kTable);
+}
+
+inline constexpr auto kCreateTableBuf  = build<emitCreateTable>();
+inline constexpr auto kValueColumnsBuf = build<emitValueColumns>();
+inline constexpr auto kInsertColsBuf   = build<emitInsertColumns>();
+inline constexpr auto kInsertBuf       = build<emitInsert>();
+inline constexpr auto kInsertWithIdBuf = build<emitInsertWithId>();
+inline constexpr auto kNamedInsertBuf  = build<emitNamedInsert>();
+inline constexpr auto kSelectValuesBuf = build<emitSelectValues>();
+
+} // namespace detail
+
+/// CREATE TABLE текущей схемы с плейсхолдером %1 вместо имени таблицы (формат SchemaMigrator::Rebuild).
+inline constexpr const char* kCreateTableSql = detail::kCreateTableBuf.data();
+
+/// "id, pen_id, ..., height" — все хранимые (не вычисляемые) колонки.
+inline constexpr const char* kValueColumns = detail::kValueColumnsBuf.data();
+
+/// "pen_id, ..., height" — колонки, которые заполняет INSERT.
+inline constexpr const char* kInsertColumns = detail::kInsertColsBuf.data();
+
+/// INSERT всех записываемых колонок с позиционными "?" (порядок — PenColor..Height).
+inline constexpr const char* kInsertSql = detail::kInsertBuf.data();
+
+/// INSERT всех хранимых колонок вместе с id (перенос строк с сохранением ключей).
+inline constexpr const char* kInsertWithIdSql = detail::kInsertWithIdBuf.data();
+
+/// То же с именованными параметрами ":pen_id", ":penstyle", ...
+inline constexpr const char* kNamedInsertSql = detail::kNamedInsertBuf.data();
+
+/// "SELECT id, pen_id, ..., height FROM rectangle" (без условия и ;) — для сканов и выгрузок.
+inline constexpr const char* kSelectValuesSql = detail::kSelectValuesBuf.data();
+
+/// Позиция колонки в kInsertSql (для bindValue(pos, ...)).
+constexpr int insertPosition(Column column) { return column - PenColor; }
+
+} // namespace rectschema
+
+#endif // RECTANGLESCHEMA_H
@@ -0,0 +1,185 @@
+#include "rectangletablemodel.h"
+
+#include <QElapsedTimer>
+
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlRecord>
+
+#include "framestats.h"
+#include "penpalette.h"
+#include "rectangleschema.h"
+#include "rectrowdecoder.h"
+#include "schemamigrator.h"
+
+RectangleTableModel::RectangleTableModel(QObject* parent, QSqlDatabase db)
+    : QSqlTableModel(parent, db)
+{
+}
+
+const QStringList& RectangleTableModel::generatedColumns()
+{
+    static const QStringList kGenerated = [] {
+        QStringList names;
+        for (int c = 0; c < rectschema::ColumnCount; ++c) {
+            if (rectschema::isGenerated(c))
+                names << rectschema::kColumns[c].name;
+        }
+        return names;
+    }();
+    return kGenerated;
+}
+
+QStringList RectangleTableModel::compatibleTables(const QSqlDatabase& db)
+{
+    using namespace rectschema;
+
+    const auto compatible = [](const QSqlRecord& rec) {
+        for (int c = Id; c < kValueColumnCount; ++c) {
+            if (c != PenColor && !rec.contains(kColumns[c].name))
+                return false;
+        }
+        return rec.contains(kColumns[PenColor].name) || rec.contains("pencolor"); // pencolor — схема < v5
+    };
+
+    QStringList schemas;
+    QSqlQuery q(db);
+    if (q.exec("PRAGMA database_list;")) {
+        while (q.next()) {
+            const QString name = q.value(1).toString();
+            if (name != "temp")
+                schemas << name;
+        }
+    }
+
+    QStringList result;
+    for (const QString& schema : schemas) {
+        if (!q.exec(QString("SELECT name FROM \"%1\".sqlite_master WHERE type = 'table' ORDER BY name;").arg(schema)))
+            continue;
+        while (q.next()) {
+            const QString table = q.value(0).toString();
+            if (table.startsWith("sqlite_") || table.endsWith(SchemaMigrator::kRebuildSuffix))
+                continue;
+            const QString qualified = schema == "main" ? table : schema + '.' + table;
+            if (compatible(db.record(qualified)))
+                result << qualified;
+        }
+    }
+    return result;
+}
+
+QString RectangleTableModel::schemaOf(const QString& tableName)
+{
+    const int dot = tableName.indexOf('.');
+    return dot > 0 ? tableName.left(dot) : QString();
+}
+
+void RectangleTableModel::setTable(const QString& tableName)
+{
+    m_windowOffset = 0;
+    QSqlTableModel::setTable(tableName);
+
+    // Индексы по именам: у БД со старой схемой (< v3) этих колонок нет.
+    m_generatedColumns.clear();
+    for (const QString& name : generatedColumns()) {
+        const int column = fieldIndex(name);
+        if (column >= 0)
+            m_generatedColumns.insert(column);
+    }
+    m_penColumn = fieldIndex(rectschema::kColumns[rectschema::PenColor].name);
+}
+
+void RectangleTableModel::setSort(int column, Qt::SortOrder order)
+{
+    m_windowOffset = 0;
+    QSqlTableModel::setSort(column, order);
+}
+
+void RectangleTableModel::setFilter(const QString& filter)
+{
+    m_windowOffset = 0;
+    QSqlTableModel::setFilter(filter);
+}
+
+QString RectangleTableModel::selectStatement() const
+{
+    const QString sql = QSqlTableModel::selectStatement();
+    if (sql.isEmpty() || m_windowOffset == 0)
+        return sql;
+    // LIMIT -1: без ограничения сверху, OFFSET в SQLite допустим только вместе с LIMIT.
+    return QString("%1 LIMIT -1 OFFSET %2").arg(sql).arg(m_windowOffset);
+}
+
+QVariant RectangleTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    const QVariant v = QSqlTableModel::headerData(section, orientation, role);
+    // Для вставленных/удалённых строк базовая модель показывает "*"/"!" — их не трогаем.
+    if (orientation == Qt::Vertical && role == Qt::DisplayRole && m_windowOffset > 0
+            && v.type() == QVariant::Int && v.toInt() == section + 1)
+        return m_windowOffset + section + 1;
+    return v;
+}
+
+bool RectangleTableModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if (index.isValid() && isGeneratedColumn(index.column()))
+        return false;
+
+    // Цвет (QColor от делегата или строка) -> id словаря.
+    if (m_palette && role == Qt::EditRole && index.isValid() && index.column() == m_penColumn) {
+        const QColor color = value.type() == QVariant::Color
+                ? value.value<QColor>()
+                : RectRowDecoder::parseColor(value.toString().trimmed());
+        if (!color.isValid())
+            return false;
+        const int id = m_palette->idFor(color);
+        if (id < 0)
+            return false;
+        return QSqlTableModel::setData(index, id, role);
+    }
+    return QSqlTableModel::setData(index, value, role);
+}
+
+Qt::ItemFlags RectangleTableModel::flags(const QModelIndex& index) const
+{
+    Qt::ItemFlags f = QSqlTableModel::flags(index);
+    if (index.isValid() && isGeneratedColumn(index.column()))
+        f &= ~Qt::ItemIsEditable;
+    return f;
+}
+
+QVariant RectangleTableModel::data(const QModelIndex& index, int role) const
+{
+    // Замеряем только вызовы из кадра отрисовки, остальные не трогаем.
+    if (!m_stats || !m_stats->inFrame())
+        return value_(index, role);
+
+    QElapsedTimer t;
+    t.start();
+    QVariant v = value_(index, role);
+    m_stats->addDataTime(t.nsecsElapsed());
+    return v;
+}
+
+QVariant RectangleTableModel::value_(const QModelIndex& index, int role) const
+{
+    QVariant v = QSqlTableModel::data(index, role);
+    if (m_palette && (role == Qt::DisplayRole || role == Qt::EditRole)
+            && index.column() == m_penColumn && !v.isNull()) {
+        const QColor color = m_palette->color(v.toInt());
+        return color.isValid() ? QVariant(color.name()) : v;
+    }
+    return v;
+}
+
+void RectangleTableModel::fetchMore(const QModelIndex& parent)
+{
+    if (!m_stats) {
+        QSqlTableModel::fetchMore(parent);
+        return;
+    }
+
+    QElapsedTimer t;
+    t.start();
+    QSqlTableModel::fetchMore(parent);
+    m_stats->addFetchStall(t.nsecsElapsed());
+}
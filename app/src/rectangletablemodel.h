@@ -0,0 +1,102 @@
+#ifndef RECTANGLETABLEMODEL_H
+#define RECTANGLETABLEMODEL_H
+
+#include <QSet>
+
+#include <QtSql/QSqlTableModel>
+
+class FrameStats;
+class PenPalette;
+
+/**
+ * @brief QSqlTableModel для таблицы rectangle.
+ *
+ * Добавляет к базовой модели:
+ *  - инструментирование: время data() во время кадра отрисовки и время fetchMore()
+ *    (подгрузка следующей порции строк при прокрутке);
+ *  - вычисляемые колонки схемы v3 (right, bottom, area — GENERATED ALWAYS ... STORED)
+ *    только для чтения: их значение считает SQLite, записать их нельзя;
+ *  - колонку цвета схемы v5 (pen_id): view видит и редактирует строку "#rrggbb",
+ *    а в таблицу пишется id из словаря PenPalette;
+ *  - окно строк (setWindowOffset()): выборка начинается не с первой строки, строки выше
+ *    окна не загружаются — так кэш ограничивается без потери позиции прокрутки.
+ *
+ * @note Наследник, а не proxy-модель: view и код окна продолжают работать
+ *       с QSqlTableModel (qobject_cast<QSqlTableModel*> остаётся валидным).
+ */
+class RectangleTableModel : public QSqlTableModel
+{
+    Q_OBJECT
+public:
+    explicit RectangleTableModel(QObject* parent = nullptr, QSqlDatabase db = QSqlDatabase());
+
+    /// Подключает статистику кадров (nullptr — отключить). Владение не передаётся.
+    void setFrameStats(FrameStats* stats) { m_stats = stats; }
+
+    /**
+     * @brief Словарь цветов для колонки pen_id (nullptr — показывать id как есть).
+     *
+     * Словарь должен работать через то же соединение, что и модель. Владение не передаётся.
+     */
+    void setPalette(PenPalette* palette) { m_palette = palette; }
+
+    /// Вычисляемые колонки таблицы rectangle (схема v3).
+    static const QStringList& generatedColumns();
+
+    /**
+     * @brief Таблицы соединения, которые модель может показать (Model -> Select table).
+     *
+     * Подходят таблицы с колонками прямоугольника (id, цвет — pen_id или pencolor, стиль,
+     * толщина, геометрия) в основной схеме и в присоединённых БД; имена последних
+     * возвращаются с префиксом схемы ("aux.rectangle").
+     */
+    static QStringList compatibleTables(const QSqlDatabase& db);
+
+    /// Схема таблицы: "aux" для "aux.rectangle", пустая строка для основной.
+    static QString schemaOf(const QString& tableName);
+
+    /// Колонка index.column() вычисляемая (только чтение)?
+    bool isGeneratedColumn(int column) const { return m_generatedColumns.contains(column); }
+
+    /**
+     * @brief Первая строка выборки, которую показывает модель (SELECT ... LIMIT -1 OFFSET offset).
+     *
+     * Строка модели r — это строка offset + r полной выборки. Действует с ближайшего select();
+     * setTable(), setSort() и setFilter() возвращают окно к началу.
+     */
+    void setWindowOffset(int offset) { m_windowOffset = qMax(0, offset); }
+    int windowOffset() const { return m_windowOffset; }
+
+    void setTable(const QString& tableName) override;
+    void setSort(int column, Qt::SortOrder order) override;
+    void setFilter(const QString& filter) override;
+
+    /// Номера строк вертикального заголовка — сквозные, с учётом windowOffset().
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+    void fetchMore(const QModelIndex& parent = QModelIndex()) override;
+
+protected:
+    QString selectStatement() const override;
+
+private:
+    QVariant value_(const QModelIndex& index, int role) const;
+
+private:
+    FrameStats* m_stats = nullptr;
+    PenPalette* m_palette = nullptr;
+
+    /// Строк выборки выше окна (см. setWindowOffset()).
+    int m_windowOffset = 0;
+
+    /// Индекс колонки pen_id текущей таблицы (-1 — нет).
+    int m_penColumn = -1;
+
+    /// Индексы вычисляемых колонок текущей таблицы (считаются в setTable()).
+    QSet<int> m_generatedColumns;
+};
+
+#endif // RECTANGLETABLEMODEL_H
@@ -0,0 +1,268 @@
+#include "rectarchive.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QFuture>
+#include <QSaveFile>
+#include <QThread>
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include <cstring>
+#include <deque>
+
+#include "busyretry.h"
+#include "logger.h"
+#include "penpalette.h"
+#include "rectangleschema.h"
+#include "rectbulkio.h"
+#include "rectrowdecoder.h"
+
+namespace {
+
+constexpr char kMagic[8] = { 'L', '2', 'R', 'C', 'Z', '0', '0', '1' };
+
+/// Верхняя граница несжатого блока при импорте (защита от испорченного заголовка).
+constexpr quint32 kMaxRawBlockBytes = 64u * 1024u * 1024u;
+
+/// Распакованный блок (результат задачи в пуле потоков).
+struct DecodedBlock
+{
+    bool ok = false;
+    QVector<RectRow> rows;
+};
+
+RectArchive::Stats failed(RectArchive::Stats s, const QString& what)
+{
+    s.ok = false;
+    s.error = what;
+    return s;
+}
+
+} // namespace
+
+RectArchive::RectArchive(QSqlDatabase db)
+    : m_db(std::move(db))
+    , m_maxParallel(qMax(1, QThread::idealThreadCount()))
+{
+}
+
+QByteArray RectArchive::encodeRows(const QVector<RectRow>& rows)
+{
+    QByteArray raw;
+    raw.reserve(rows.size() * kRowBytes);
+
+    QDataStream ds(&raw, QIODevice::WriteOnly);
+    ds.setVersion(QDataStream::Qt_5_0);
+    for (const RectRow& r : rows) {
+        ds << qint64(r.id)
+           << quint32(r.rect.penColor.rgb())
+           << qint32(r.rect.penStyle)
+           << qint32(r.rect.penWidth)
+           << qint32(r.rect.left)
+           << qint32(r.rect.top)
+           << qint32(r.rect.width)
+           << qint32(r.rect.height);
+    }
+    return raw;
+}
+
+bool RectArchive::decodeRows(const QByteArray& raw, QVector<RectRow>* rows)
+{
+    if (raw.size() % kRowBytes != 0) return false;
+
+    const int count = raw.size() / kRowBytes;
+    rows->clear();
+    rows->reserve(count);
+
+    QDataStream ds(raw);
+    ds.setVersion(QDataStream::Qt_5_0);
+    for (int i = 0; i < count; ++i) {
+        qint64 id = 0;
+        quint32 rgb = 0;
+        qint32 style = 0, penWidth = 0, left = 0, top = 0, width = 0, height = 0;
+        ds >> id >> rgb >> style >> penWidth >> left >> top >> width >> height;
+
+        RectRow r;
+        r.id = id;
+        r.rect = MyRect(QColor::fromRgb(rgb), static_cast<Qt::PenStyle>(style),
+                        penWidth, left, top, width, height);
+        rows->append(r);
+    }
+    return ds.status() == QDataStream::Ok;
+}
+
+RectArchive::Stats RectArchive::exportTo(const QString& path) const
+{
+    Stats s;
+
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly))
+        return failed(s, "cannot open " + path + ": " + out.errorString());
+
+    QDataStream ds(&out);
+    ds.setVersion(QDataStream::Qt_5_0);
+    ds.writeRawData(kMagic, sizeof(kMagic));
+    ds << kFormatVersion << quint32(m_rowsPerBlock);
+
+    QSqlQuery q(m_db);
+    q.setForwardOnly(true);
+    if (!q.exec(QString(rectschema::kSelectValuesSql) + " ORDER BY id;")) {
+        out.cancelWriting();
+        return failed(s, "SELECT failed: " + q.lastError().text());
+    }
+
+    // Окно блоков в работе: сжимаются параллельно, пишутся строго по порядку.
+    struct Pending
+    {
+        QFuture<QByteArray> compressed;
+        quint32 rows = 0;
+    };
+    std::deque<Pending> window;
+    const int level = m_level;
+
+    const auto writeOldest = [&] {
+        Pending p = window.front();
+        window.pop_front();
+
+        const QByteArray c = p.compressed.result();
+        ds << quint32(p.rows * kRowBytes) << p.rows << quint32(c.size());
+        ds.writeRawData(c.constData(), c.size());
+
+        s.rawBytes += qint64(p.rows) * kRowBytes;
+        s.compressedBytes += c.size();
+        ++s.blocks;
+    };
+
+    const auto submit = [&](const QVector<RectRow>& batch) {
+        Pending p;
+        p.rows = quint32(batch.size());
+        p.compressed = QtConcurrent::run([batch, level] { return qCompress(encodeRows(batch), level); });
+        window.push_back(p);
+        if (int(window.size()) >= m_maxParallel)
+            writeOldest();
+    };
+
+    RectRowDecoder decoder(PenPalette::loadColors(m_db));
+    QVector<RectRow> batch;
+    while (decoder.fetch(q, batch, m_rowsPerBlock) > 0) {
+        s.rows += batch.size();
+        submit(batch);
+    }
+    while (!window.empty())
+        writeOldest();
+
+    // Завершающий блок: общее число строк для контроля целостности.
+    ds << quint32(s.rows) << quint32(0) << quint32(0);
+
+    if (ds.status() != QDataStream::Ok || !out.commit())
+        return failed(s, "cannot write " + path + ": " + out.errorString());
+
+    s.ok = true;
+    return s;
+}
+
+RectArchive::Stats RectArchive::importFrom(const QString& path, bool keepIds)
+{
+    Stats s;
+
+    QFile in(path);
+    if (!in.open(QIODevice::ReadOnly))
+        return failed(s, "cannot open " + path + ": " + in.errorString());
+
+    QDataStream ds(&in);
+    ds.setVersion(QDataStream::Qt_5_0);
+
+    char magic[sizeof(kMagic)] = {};
+    quint32 version = 0, rowsPerBlock = 0;
+    ds.readRawData(magic, sizeof(magic));
+    ds >> version >> rowsPerBlock;
+    if (ds.status() != QDataStream::Ok || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version != kFormatVersion)
+        return failed(s, path + ": not a rectangle archive or unsupported version");
+
+    if (!(m_retry ? m_retry->transaction(m_db) : m_db.transaction()))
+        return failed(s, "BEGIN failed: " + m_db.lastError().text());
+
+    const auto abort = [&](const QString& what) {
+        m_db.rollback();
+        return failed(s, what);
+    };
+
+    RectBulkWriter ins(m_db, keepIds);
+    if (!ins.isValid())
+        return abort("prepare INSERT failed: " + ins.lastError());
+
+    // Окно блоков: распаковываются параллельно, вставляются строго по порядку.
+    std::deque<QFuture<DecodedBlock>> window;
+    QString insertError;
+
+    const auto insertOldest = [&]() -> bool {
+        const DecodedBlock block = window.front().result();
+        window.pop_front();
+        if (!block.ok) {
+            insertError = QString("block %1 is corrupt").arg(s.blocks);
+            return false;
+        }
+
+        for (const RectRow& r : block.rows) {
+            if (!ins.insert(r)) {
+                insertError = "INSERT failed: " + ins.lastError();
+                return false;
+            }
+            if (m_rowObserver)
+                m_rowObserver(r);
+        }
+        s.rows += block.rows.size();
+        ++s.blocks;
+        return true;
+    };
+
+    qint64 expectedRows = -1;
+    for (;;) {
+        quint32 rawSize = 0, rowCount = 0, compressedSize = 0;
+        ds >> rawSize >> rowCount >> compressedSize;
+        if (ds.status() != QDataStream::Ok)
+            return abort(path + ": archive is truncated");
+
+        if (rowCount == 0 && compressedSize == 0) {
+            expectedRows = rawSize;
+            break;
+        }
+        if (rawSize != rowCount * quint32(kRowBytes) || rawSize > kMaxRawBlockBytes || compressedSize > kMaxRawBlockBytes)
+            return abort(path + ": invalid block header");
+
+        QByteArray compressed(int(compressedSize), Qt::Uninitialized);
+        if (ds.readRawData(compressed.data(), compressed.size()) != compressed.size())
+            return abort(path + ": archive is truncated");
+
+        s.rawBytes += rawSize;
+        s.compressedBytes += compressedSize;
+
+        window.push_back(QtConcurrent::run([compressed, rawSize] {
+            DecodedBlock block;
+            const QByteArray raw = qUncompress(compressed);
+            block.ok = raw.size() == int(rawSize) && decodeRows(raw, &block.rows);
+            return block;
+        }));
+
+        if (int(window.size()) >= m_maxParallel && !insertOldest())
+            return abort(insertError);
+    }
+
+    while (!window.empty()) {
+        if (!insertOldest())
+            return abort(insertError);
+    }
+
+    if (expectedRows != s.rows)
+        return abort(QString("row count mismatch: archive says %1, read %2").arg(expectedRows).arg(s.rows));
+
+    if (!(m_retry ? m_retry->commit(m_db) : m_db.commit()))
+        return abort("COMMIT failed: " + m_db.lastError().text());
+
+    LAB2_INFO(lcDb()) << "RectArchive: imported" << s.rows << "rows in" << s.blocks << "blocks from" << path;
+    s.ok = true;
+    return s;
+}
@@ -0,0 +1,103 @@
+#ifndef RECTARCHIVE_H
+#define RECTARCHIVE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include <QtSql/QSqlDatabase>
+
+#include <functional>
+
+#include "rectrow.h"
+
+class BusyRetry;
+
+/**
+ * @brief Сжатый поблочный экспорт/импорт таблицы rectangle.
+ *
+ * Текстовые выгрузки в разы больше необходимого, а переносятся они через медленные носители.
+ * Архив состоит из независимых блоков по rowsPerBlock строк, каждый сжат qCompress (zlib):
+ *
+ *   magic[8] "L2RCZ001", formatVersion quint32, rowsPerBlock quint32
+ *   блок:  rawSize quint32, rowCount quint32, compressedSize quint32, данные qCompress
+ *   конец: блок с rowCount == 0 и compressedSize == 0, rawSize — общее число строк (контроль)
+ *
+ * Числа — big-endian (QDataStream), архив переносим между машинами.
+ * Строка внутри блока: id qint64, pencolor quint32 (QRgb), penstyle/penwidth/left/top/width/height qint32.
+ *
+ * Память постоянна: одновременно в памяти не больше maxParallelBlocks блоков.
+ * Блоки независимы, поэтому сжатие (экспорт) и распаковка (импорт) идут параллельно
+ * в пуле потоков (QtConcurrent), а запись в файл/БД — по порядку, в вызывающем потоке.
+ */
+class RectArchive
+{
+public:
+    /// Итог операции.
+    struct Stats
+    {
+        bool ok = false;
+        qint64 rows = 0;
+        qint64 blocks = 0;
+        qint64 rawBytes = 0;         ///< Размер несжатых блоков.
+        qint64 compressedBytes = 0;  ///< Размер сжатых блоков.
+        QString error;
+    };
+
+    static constexpr int kDefaultRowsPerBlock = 4096;
+    static constexpr int kDefaultCompressionLevel = 6;
+    static constexpr quint32 kFormatVersion = 1;
+    /// Размер одной строки в несжатом блоке (байт).
+    static constexpr int kRowBytes = 8 + 4 + 6 * 4;
+
+    explicit RectArchive(QSqlDatabase db);
+
+    void setRowsPerBlock(int rows) { m_rowsPerBlock = rows > 0 ? rows : kDefaultRowsPerBlock; }
+    int rowsPerBlock() const { return m_rowsPerBlock; }
+
+    /// Уровень zlib: 0 (без сжатия) .. 9 (максимум).
+    void setCompressionLevel(int level) { m_level = qBound(0, level, 9); }
+    int compressionLevel() const { return m_level; }
+
+    /// Сколько блоков одновременно в обработке (по умолчанию — число ядер).
+    void setMaxParallelBlocks(int n) { m_maxParallel = qMax(1, n); }
+    int maxParallelBlocks() const { return m_maxParallel; }
+
+    /**
+     * @brief Вызывается importFrom() для каждой вставленной строки.
+     *
+     * Импорт — одна транзакция: строки попадают в таблицу, только если Stats::ok.
+     */
+    using RowFn = std::function<void(const RectRow& row)>;
+    void setRowObserver(RowFn fn) { m_rowObserver = std::move(fn); }
+
+    /// BEGIN/COMMIT импорта с повтором, если файл занят другим процессом (nullptr — без повтора).
+    void setBusyRetry(BusyRetry* retry) { m_retry = retry; }
+
+    /**
+     * @brief Выгружает таблицу rectangle в архив (forward-only чтение, файл через QSaveFile).
+     */
+    Stats exportTo(const QString& path) const;
+
+    /**
+     * @brief Загружает архив в таблицу rectangle одной транзакцией (всё или ничего).
+     * @param keepIds true — вставлять с исходными id (восстановление), false — новые id (дозапись).
+     */
+    Stats importFrom(const QString& path, bool keepIds = false);
+
+    /// Сериализует строки в несжатый блок.
+    static QByteArray encodeRows(const QVector<RectRow>& rows);
+
+    /// Разбирает несжатый блок. @return false, если размер не кратен kRowBytes.
+    static bool decodeRows(const QByteArray& raw, QVector<RectRow>* rows);
+
+private:
+    QSqlDatabase m_db;
+    BusyRetry* m_retry = nullptr;
+    RowFn m_rowObserver;
+    int m_rowsPerBlock = kDefaultRowsPerBlock;
+    int m_level = kDefaultCompressionLevel;
+    int m_maxParallel = 1;
+};
+
+#endif // RECTARCHIVE_H
@@ -0,0 +1,298 @@
+#include "rectbulkio.h"
+
+#include <QByteArray>
+#include <QVariant>
+
+#include <QtSql/QSqlDriver>
+#include <QtSql/QSqlError>
+
+#include <atomic>
+#include <limits>
+
+#include "penpalette.h"
+#include "rectangleschema.h"
+
+#ifdef LAB2_SQLITE_NATIVE
+#include <sqlite3.h>
+#endif
+
+namespace {
+
+std::atomic<bool> g_nativeEnabled { true };
+
+const QString kRangeSql = QString(rectschema::kSelectValuesSql) + " WHERE id BETWEEN ? AND ? ORDER BY id;";
+
+#ifdef LAB2_SQLITE_NATIVE
+
+/// Сырой sqlite3* соединения (nullptr — драйвер не QSQLITE или соединение закрыто).
+sqlite3* handleOf(const QSqlDatabase& db)
+{
+    if (!db.isOpen() || !db.driver())
+        return nullptr;
+    const QVariant v = db.driver()->handle();
+    if (!v.isValid() || qstrcmp(v.typeName(), "sqlite3*") != 0)
+        return nullptr;
+    return *static_cast<sqlite3* const*>(v.constData());
+}
+
+#endif
+
+} // namespace
+
+namespace rectbulkio {
+
+bool nativeCompiledIn()
+{
+#ifdef LAB2_SQLITE_NATIVE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void setNativeEnabled(bool enabled)
+{
+    g_nativeEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool nativeEnabled()
+{
+    return g_nativeEnabled.load(std::memory_order_relaxed);
+}
+
+bool nativeAvailable(const QSqlDatabase& db)
+{
+#ifdef LAB2_SQLITE_NATIVE
+    return nativeEnabled() && handleOf(db) != nullptr;
+#else
+    Q_UNUSED(db);
+    return false;
+#endif
+}
+
+} // namespace rectbulkio
+
+// ---------------------------------------------------------------- RectBulkReader
+
+#ifdef LAB2_SQLITE_NATIVE
+
+struct RectBulkReader::Native
+{
+    sqlite3* db = nullptr;
+    sqlite3_stmt* stmt = nullptr;
+
+    ~Native() { sqlite3_finalize(stmt); }
+};
+
+#else
+
+struct RectBulkReader::Native
+{
+};
+
+#endif
+
+RectBulkReader::RectBulkReader(QSqlDatabase db)
+    : m_db(std::move(db))
+    , m_query(m_db)
+{
+}
+
+RectBulkReader::~RectBulkReader() = default;
+
+bool RectBulkReader::execAll()
+{
+    return exec(std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max());
+}
+
+bool RectBulkReader::exec(qint64 fromId, qint64 toId)
+{
+    m_lastError.clear();
+    m_native.reset();
+    m_query.finish();
+
+    // Словарь цветов — десятки строк: читаем целиком, дальше pen_id -> цвет по массиву.
+    QString paletteError;
+    m_decoder = RectRowDecoder(PenPalette::loadColors(m_db, &paletteError));
+    if (!paletteError.isEmpty()) {
+        m_lastError = paletteError;
+        return false;
+    }
+
+#ifdef LAB2_SQLITE_NATIVE
+    if (rectbulkio::nativeAvailable(m_db)) {
+        auto n = std::make_unique<Native>();
+        n->db = handleOf(m_db);
+        const QByteArray sql = kRangeSql.toUtf8();
+        if (sqlite3_prepare_v2(n->db, sql.constData(), sql.size(), &n->stmt, nullptr) != SQLITE_OK) {
+            m_lastError = QString::fromUtf8(sqlite3_errmsg(n->db));
+            return false;
+        }
+        sqlite3_bind_int64(n->stmt, 1, fromId);
+        sqlite3_bind_int64(n->stmt, 2, toId);
+        m_native = std::move(n);
+        return true;
+    }
+#endif
+
+    m_query.setForwardOnly(true);
+    if (!m_query.prepare(kRangeSql)) {
+        m_lastError = m_query.lastError().text();
+        return false;
+    }
+    m_query.addBindValue(fromId);
+    m_query.addBindValue(toId);
+    if (!m_query.exec()) {
+        m_lastError = m_query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool RectBulkReader::next(RectRow& row)
+{
+#ifdef LAB2_SQLITE_NATIVE
+    if (m_native) {
+        using namespace rectschema;
+        Native& n = *m_native;
+
+        const int rc = sqlite3_step(n.stmt);
+        if (rc != SQLITE_ROW) {
+            if (rc != SQLITE_DONE)
+                m_lastError = QString::fromUtf8(sqlite3_errmsg(n.db));
+            return false;
+        }
+
+        row.id = sqlite3_column_int64(n.stmt, Id);
+
+        row.rect.penColor = m_decoder.color(sqlite3_column_int(n.stmt, PenColor));
+
+        row.rect.penStyle = static_cast<Qt::PenStyle>(sqlite3_column_int(n.stmt, PenStyle));
+        row.rect.penWidth = sqlite3_column_int(n.stmt, PenWidth);
+        row.rect.left = sqlite3_column_int(n.stmt, Left);
+        row.rect.top = sqlite3_column_int(n.stmt, Top);
+        row.rect.width = sqlite3_column_int(n.stmt, Width);
+        row.rect.height = sqlite3_column_int(n.stmt, Height);
+        return true;
+    }
+#endif
+
+    if (!m_query.next()) {
+        if (m_query.lastError().isValid())
+            m_lastError = m_query.lastError().text();
+        return false;
+    }
+    m_decoder.decode(m_query, row);
+    return true;
+}
+
+// ---------------------------------------------------------------- RectBulkWriter
+
+#ifdef LAB2_SQLITE_NATIVE
+
+struct RectBulkWriter::Native
+{
+    sqlite3* db = nullptr;
+    sqlite3_stmt* stmt = nullptr;
+
+    ~Native() { sqlite3_finalize(stmt); }
+};
+
+#else
+
+struct RectBulkWriter::Native
+{
+};
+
+#endif
+
+RectBulkWriter::RectBulkWriter(QSqlDatabase db, bool keepIds)
+    : m_db(std::move(db))
+    , m_keepIds(keepIds)
+    , m_palette(m_db)
+    , m_query(m_db)
+{
+    const char* sql = keepIds ? rectschema::kInsertWithIdSql : rectschema::kInsertSql;
+
+#ifdef LAB2_SQLITE_NATIVE
+    if (rectbulkio::nativeAvailable(m_db)) {
+        auto n = std::make_unique<Native>();
+        n->db = handleOf(m_db);
+        if (sqlite3_prepare_v2(n->db, sql, -1, &n->stmt, nullptr) != SQLITE_OK) {
+            m_lastError = QString::fromUtf8(sqlite3_errmsg(n->db));
+            return;
+        }
+        m_native = std::move(n);
+        m_valid = true;
+        return;
+    }
+#endif
+
+    m_valid = m_query.prepare(sql);
+    if (!m_valid)
+        m_lastError = m_query.lastError().text();
+}
+
+RectBulkWriter::~RectBulkWriter() = default;
+
+bool RectBulkWriter::insert(const MyRect& rect)
+{
+    return insert_(rect, nullptr);
+}
+
+bool RectBulkWriter::insert(const RectRow& row)
+{
+    return insert_(row.rect, &row.id);
+}
+
+bool RectBulkWriter::insert_(const MyRect& r, const qint64* id)
+{
+    if (!m_valid)
+        return false;
+
+    const int penId = m_palette.idFor(r.penColor);
+    if (penId < 0) {
+        m_lastError = m_palette.lastError();
+        return false;
+    }
+
+#ifdef LAB2_SQLITE_NATIVE
+    if (m_native) {
+        Native& n = *m_native;
+        int i = 1;
+        if (m_keepIds) {
+            if (id) sqlite3_bind_int64(n.stmt, i, *id);
+            else sqlite3_bind_null(n.stmt, i);
+            ++i;
+        }
+        sqlite3_bind_int(n.stmt, i++, penId);
+        sqlite3_bind_int(n.stmt, i++, int(r.penStyle));
+        sqlite3_bind_int(n.stmt, i++, r.penWidth);
+        sqlite3_bind_int(n.stmt, i++, r.left);
+        sqlite3_bind_int(n.stmt, i++, r.top);
+        sqlite3_bind_int(n.stmt, i++, r.width);
+        sqlite3_bind_int(n.stmt, i++, r.height);
+
+        const int rc = sqlite3_step(n.stmt);
+        if (rc != SQLITE_DONE)
+            m_lastError = QString::fromUtf8(sqlite3_errmsg(n.db));
+        sqlite3_reset(n.stmt);
+        return rc == SQLITE_DONE;
+    }
+#endif
+
+    int i = 0;
+    if (m_keepIds) m_query.bindValue(i++, id ? QVariant(*id) : QVariant(QVariant::LongLong));
+    m_query.bindValue(i++, penId);
+    m_query.bindValue(i++, int(r.penStyle));
+    m_query.bindValue(i++, r.penWidth);
+    m_query.bindValue(i++, r.left);
+    m_query.bindValue(i++, r.top);
+    m_query.bindValue(i++, r.width);
+    m_query.bindValue(i++, r.height);
+    if (!m_query.exec()) {
+        m_lastError = m_query.lastError().text();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,117 @@
+#ifndef RECTBULKIO_H
+#define RECTBULKIO_H
+
+#include <QString>
+
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+
+#include <memory>
+
+#include "penpalette.h"
+#include "rectrow.h"
+#include "rectrowdecoder.h"
+
+/**
+ * @brief Массовое чтение и вставка строк rectangle с нативным путём через sqlite3.
+ *
+ * Обычный путь QtSql на каждое поле создаёт QVariant;
+ * на массовых сканах и импортах это основная часть времени на строку.
+ * Если проект собран с LAB2_SQLITE_NATIVE (опция CMake), RectBulkReader/RectBulkWriter берут
+ * у драйвера сырой sqlite3* (QSqlDriver::handle()) и работают через sqlite3_bind_* /
+ * sqlite3_step / sqlite3_column_* напрямую. Всё остальное приложение остаётся на QtSql.
+ *
+ * Без опции, с другим драйвером или после setNativeEnabled(false) используется QSqlQuery
+ * (+ RectRowDecoder) — поведение одинаковое, отличается только скорость.
+ *
+ * @note Нативный путь требует, чтобы QSQLITE и приложение использовали одну и ту же
+ *       библиотеку SQLite (Qt, собранный с -system-sqlite). Иначе опцию включать нельзя.
+ * @note Транзакциями управляет вызывающий код (QSqlDatabase::transaction()/commit()):
+ *       нативные запросы идут через то же соединение.
+ */
+namespace rectbulkio {
+
+/// Нативный путь вкомпилирован (LAB2_SQLITE_NATIVE).
+bool nativeCompiledIn();
+
+/// Разрешить/запретить нативный путь во время работы (для сравнения и отладки).
+void setNativeEnabled(bool enabled);
+bool nativeEnabled();
+
+/// Нативный путь доступен для соединения (вкомпилирован, разрешён, драйвер отдаёт sqlite3*).
+bool nativeAvailable(const QSqlDatabase& db);
+
+} // namespace rectbulkio
+
+/// Чтение rectangle по возрастанию id (rectschema::kSelectValuesSql).
+class RectBulkReader
+{
+public:
+    explicit RectBulkReader(QSqlDatabase db);
+    ~RectBulkReader();
+
+    RectBulkReader(const RectBulkReader&) = delete;
+    RectBulkReader& operator=(const RectBulkReader&) = delete;
+
+    /// Запускает выборку строк с id в [fromId, toId].
+    bool exec(qint64 fromId, qint64 toId);
+
+    /// Вся таблица.
+    bool execAll();
+
+    /// Следующая строка; false — строки кончились или ошибка (см. lastError()).
+    bool next(RectRow& row);
+
+    bool isNative() const { return m_native != nullptr; }
+    QString lastError() const { return m_lastError; }
+
+private:
+    struct Native;
+
+    QSqlDatabase m_db;
+    std::unique_ptr<Native> m_native;
+    QSqlQuery m_query;
+    RectRowDecoder m_decoder;
+    QString m_lastError;
+};
+
+/// Вставка строк подготовленным INSERT (rectschema::kInsertSql / kInsertWithIdSql).
+class RectBulkWriter
+{
+public:
+    /// @param keepIds Вставлять id из RectRow (иначе id назначает SQLite).
+    explicit RectBulkWriter(QSqlDatabase db, bool keepIds = false);
+    ~RectBulkWriter();
+
+    RectBulkWriter(const RectBulkWriter&) = delete;
+    RectBulkWriter& operator=(const RectBulkWriter&) = delete;
+
+    /// INSERT подготовлен.
+    bool isValid() const { return m_valid; }
+
+    /// Вставляет строку (row.id используется только при keepIds).
+    bool insert(const RectRow& row);
+
+    /// Вставляет прямоугольник; id назначает SQLite.
+    bool insert(const MyRect& rect);
+
+    bool isNative() const { return m_native != nullptr; }
+    QString lastError() const { return m_lastError; }
+
+private:
+    struct Native;
+
+    bool insert_(const MyRect& r, const qint64* id);
+
+private:
+    QSqlDatabase m_db;
+    bool m_keepIds = false;
+    bool m_valid = false;
+    /// Цвет -> pen_id (новые цвета добавляются в словарь в той же транзакции).
+    PenPalette m_palette;
+    std::unique_ptr<Native> m_native;
+    QSqlQuery m_query;
+    QString m_lastError;
+};
+
+#endif // RECTBULKIO_H
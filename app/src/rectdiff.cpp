@@ -0,0 +1,314 @@
+#include "rectdiff.h"
+
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QThread>
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlRecord>
+
+#include <algorithm>
+
+#include "logger.h"
+#include "penpalette.h"
+#include "rectangleschema.h"
+#include "rectbulkio.h"
+#include "scopedconnection.h"
+
+namespace {
+
+/// Два независимых хеша строки: h = (h * K + v) mod P по id и значениям (|h| < P < 2^31, без переполнения).
+constexpr qint64 kMul1 = 1000003;
+constexpr qint64 kMod1 = 2147483647;
+constexpr qint64 kMul2 = 999983;
+constexpr qint64 kMod2 = 2147483629;
+
+/// Вместо NULL — значение вне диапазона int, чтобы NULL не совпадал с 0.
+constexpr qint64 kNullValue = qint64(1) << 32;
+
+/// Сдвиг в нелинейном перемешивании h -> h * (h + kMixAdd) mod P (|h| < 2^31, произведение < 2^62).
+constexpr qint64 kMixAdd = 0x1bd1e995;
+
+/// Выражение хеша строки; color — выражение цвета (rgb или -1). Линейно по каждой колонке.
+QString rowHash(const QString& color, qint64 mul, qint64 mod)
+{
+    using namespace rectschema;
+
+    QString h = QString("(id % %1)").arg(mod);
+    for (int c = PenColor; c < kValueColumnCount; ++c) {
+        const QString v = c == PenColor ? color : QString("IFNULL(%1, %2)").arg(kColumns[c].name).arg(kNullValue);
+        h = QString("((%1 * %2 + %3) % %4)").arg(h, QString::number(mul), v, QString::number(mod));
+    }
+    return h;
+}
+
+/// Запускает fn для каждого элемента items параллельно; результаты — в порядке items.
+template <typename T, typename Fn>
+auto runAll(const QVector<T>& items, Fn fn) -> QVector<decltype(fn(items.first()))>
+{
+    using R = decltype(fn(items.first()));
+
+    QVector<QFuture<R>> futures;
+    futures.reserve(items.size());
+    for (const T& item : items)
+        futures.append(QtConcurrent::run([fn, item] { return fn(item); }));
+
+    QVector<R> results;
+    results.reserve(items.size());
+    for (QFuture<R>& f : futures)
+        results.append(f.result());
+    return results;
+}
+
+} // namespace
+
+RectDiff::RectDiff(const QString& basePath, const QString& otherPath, int threads)
+    : m_basePath(basePath)
+    , m_otherPath(otherPath)
+    , m_threads(threads > 0 ? threads : qMax(1, QThread::idealThreadCount()))
+{
+}
+
+bool RectDiff::sameRect(const MyRect& a, const MyRect& b)
+{
+    return a.penColor.rgb() == b.penColor.rgb() && a.penColor.isValid() == b.penColor.isValid()
+            && a.penStyle == b.penStyle && a.penWidth == b.penWidth
+            && a.left == b.left && a.top == b.top && a.width == b.width && a.height == b.height;
+}
+
+RectDiff::Result RectDiff::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Result res;
+    QString sqlBase, sqlOther;
+    qint64 minBase = 0, maxBase = -1, minOther = 0, maxOther = -1;
+    if (!prepareSide_(m_basePath, &sqlBase, &minBase, &maxBase, &res.error)
+            || !prepareSide_(m_otherPath, &sqlOther, &minOther, &maxOther, &res.error)) {
+        LAB2_WARNING(lcDb()) << "RectDiff:" << res.error;
+        return res;
+    }
+
+    // Общий диапазон id непустых сторон.
+    qint64 lo = 0, hi = -1;
+    if (minBase <= maxBase) { lo = minBase; hi = maxBase; }
+    if (minOther <= maxOther) {
+        lo = hi < lo ? minOther : qMin(lo, minOther);
+        hi = qMax(hi, maxOther);
+    }
+
+    struct Task
+    {
+        bool other;
+        Range range;
+    };
+
+    QVector<Range> level = ParallelScanner::split(lo, hi, m_threads * kFanout);
+    QVector<Range> leaves;
+    const QString basePath = m_basePath;
+    const QString otherPath = m_otherPath;
+
+    while (!level.isEmpty()) {
+        ++res.levels;
+
+        QVector<Task> tasks;
+        tasks.reserve(level.size() * 2);
+        for (const Range& r : level)
+            tasks << Task { false, r } << Task { true, r };
+
+        const QVector<RangeHash> hashes = runAll(tasks, [=](const Task& t) {
+            return t.other ? hashRange_(otherPath, sqlOther, t.range) : hashRange_(basePath, sqlBase, t.range);
+        });
+        res.rangesHashed += level.size();
+
+        QVector<Range> next;
+        for (int i = 0; i < level.size(); ++i) {
+            const RangeHash& a = hashes.at(2 * i);
+            const RangeHash& b = hashes.at(2 * i + 1);
+            if (!a.error.isEmpty() || !b.error.isEmpty()) {
+                res.error = a.error.isEmpty() ? b.error : a.error;
+                LAB2_WARNING(lcDb()) << "RectDiff: range hash failed:" << res.error;
+                return res;
+            }
+            if (a.rows == b.rows && a.h1 == b.h1 && a.h2 == b.h2)
+                continue;
+
+            const Range& r = level.at(i);
+            if (qMax(a.rows, b.rows) <= m_leafRows || r.fromId == r.toId)
+                leaves << r;
+            else
+                next << ParallelScanner::split(r.fromId, r.toId, kFanout);
+        }
+        level = next;
+    }
+
+    const QVector<LeafDiff> diffs = runAll(leaves, [=](const Range& r) {
+        return compareLeaf_(basePath, otherPath, r);
+    });
+    for (const LeafDiff& d : diffs) {
+        if (!d.error.isEmpty()) {
+            res.error = d.error;
+            LAB2_WARNING(lcDb()) << "RectDiff: leaf compare failed:" << res.error;
+            return res;
+        }
+        res.inserted << d.inserted;
+        res.deleted << d.deleted;
+        res.modified << d.modified;
+        res.rowsCompared += d.rows;
+    }
+
+    // Листья разных уровней идут не по порядку id.
+    const auto byId = [](const RectRow& a, const RectRow& b) { return a.id < b.id; };
+    std::sort(res.inserted.begin(), res.inserted.end(), byId);
+    std::sort(res.deleted.begin(), res.deleted.end(), byId);
+    std::sort(res.modified.begin(), res.modified.end(),
+              [](const Modified& a, const Modified& b) { return a.before.id < b.before.id; });
+
+    res.ok = true;
+    res.elapsedMs = timer.elapsed();
+    LAB2_INFO(lcPerf()) << "RectDiff:" << res.inserted.size() << "inserted," << res.deleted.size() << "deleted,"
+                        << res.modified.size() << "modified; levels" << res.levels << "ranges" << res.rangesHashed
+                        << "rows compared" << res.rowsCompared << "in" << res.elapsedMs << "ms";
+    return res;
+}
+
+bool RectDiff::prepareSide_(const QString& path, QString* hashSql, qint64* minId, qint64* maxId, QString* error)
+{
+    ScopedConnection conn(path, "diff_plan", true);
+    if (!conn.isOpen()) {
+        *error = "cannot open " + path + ": " + conn.error();
+        return false;
+    }
+
+    const QSqlRecord rec = conn.db().record(rectschema::kTable);
+    if (rec.isEmpty()) {
+        *error = path + ": no table " + rectschema::kTable;
+        return false;
+    }
+    if (!rec.contains(rectschema::kColumns[rectschema::PenColor].name)) {
+        *error = path + ": schema is older than v5 (no pen_id), run BD -> Create table to migrate";
+        return false;
+    }
+
+    QString paletteError;
+    *hashSql = hashSql_(PenPalette::loadColors(conn.db(), &paletteError));
+    if (!paletteError.isEmpty()) {
+        *error = path + ": " + paletteError;
+        return false;
+    }
+
+    QSqlQuery q(conn.db());
+    if (!q.exec("SELECT MIN(id), MAX(id) FROM rectangle;") || !q.next()) {
+        *error = path + ": SELECT MIN/MAX failed: " + q.lastError().text();
+        return false;
+    }
+    if (q.value(0).isNull()) {
+        *minId = 0;
+        *maxId = -1;
+    } else {
+        *minId = q.value(0).toLongLong();
+        *maxId = q.value(1).toLongLong();
+    }
+    return true;
+}
+
+QString RectDiff::hashSql_(const QVector<QColor>& colors)
+{
+    // pen_id -> rgb по словарю этой стороны; неизвестный id и NULL — -1 (как QColor() у RectRowDecoder).
+    QString color = "CASE pen_id";
+    for (int id = 1; id < colors.size(); ++id) {
+        if (colors.at(id).isValid())
+            color += QString(" WHEN %1 THEN %2").arg(id).arg(colors.at(id).rgb() & 0xffffff);
+    }
+    color = color == "CASE pen_id" ? QString("-1") : color + " ELSE -1 END";
+
+    // Линейный хеш строки перед суммированием проходит через квадратичное перемешивание:
+    // у суммы линейных хешей обмен значением между двумя строками диапазона или правки +d/-d
+    // в двух строках почти всегда сокращаются. Хеши считаются во вложенном запросе, чтобы
+    // каждое выражение вычислялось один раз (LIMIT под агрегатом не даёт SQLite раскрыть подзапрос).
+    const QString mix = "SUM((%1 * (%1 + %2)) % %3)";
+    return QString("SELECT COUNT(*), %1, %2 FROM ("
+                   "SELECT %3 AS h1, %4 AS h2 FROM %5 WHERE id BETWEEN ? AND ? LIMIT -1);")
+            .arg(mix.arg("h1").arg(kMixAdd).arg(kMod1), mix.arg("h2").arg(kMixAdd).arg(kMod2),
+                 rowHash(color, kMul1, kMod1), rowHash(color, kMul2, kMod2), rectschema::kTable);
+}
+
+RectDiff::RangeHash RectDiff::hashRange_(const QString& path, const QString& sql, const Range& range)
+{
+    RangeHash h;
+
+    ScopedConnection conn(path, "diff_hash", true);
+    if (!conn.isOpen()) {
+        h.error = "cannot open " + path + ": " + conn.error();
+        return h;
+    }
+
+    {
+        QSqlQuery q(conn.db());
+        q.setForwardOnly(true);
+        if (!q.prepare(sql)) {
+            h.error = path + ": " + q.lastError().text();
+            return h;
+        }
+        q.addBindValue(range.fromId);
+        q.addBindValue(range.toId);
+        if (!q.exec() || !q.next()) {
+            h.error = path + ": " + q.lastError().text();
+            return h;
+        }
+        h.rows = q.value(0).toLongLong();
+        h.h1 = q.value(1).toLongLong();
+        h.h2 = q.value(2).toLongLong();
+    }
+    return h;
+}
+
+RectDiff::LeafDiff RectDiff::compareLeaf_(const QString& basePath, const QString& otherPath, const Range& range)
+{
+    LeafDiff d;
+
+    ScopedConnection baseConn(basePath, "diff_leaf", true);
+    ScopedConnection otherConn(otherPath, "diff_leaf", true);
+    if (!baseConn.isOpen() || !otherConn.isOpen()) {
+        d.error = "cannot open: " + (baseConn.isOpen() ? otherConn.error() : baseConn.error());
+        return d;
+    }
+
+    {
+        RectBulkReader base(baseConn.db());
+        RectBulkReader other(otherConn.db());
+        if (!base.exec(range.fromId, range.toId) || !other.exec(range.fromId, range.toId)) {
+            d.error = base.lastError().isEmpty() ? other.lastError() : base.lastError();
+            return d;
+        }
+
+        // Слияние двух потоков, упорядоченных по id.
+        RectRow a, b;
+        bool hasA = base.next(a);
+        bool hasB = other.next(b);
+        while (hasA || hasB) {
+            if (hasA && (!hasB || a.id < b.id)) {
+                d.deleted << a;
+                ++d.rows;
+                hasA = base.next(a);
+            } else if (hasB && (!hasA || b.id < a.id)) {
+                d.inserted << b;
+                ++d.rows;
+                hasB = other.next(b);
+            } else {
+                if (!sameRect(a.rect, b.rect))
+                    d.modified << Modified { a, b };
+                d.rows += 2;
+                hasA = base.next(a);
+                hasB = other.next(b);
+            }
+        }
+
+        if (!base.lastError().isEmpty() || !other.lastError().isEmpty())
+            d.error = base.lastError().isEmpty() ? other.lastError() : base.lastError();
+    }
+    return d;
+}
@@ -0,0 +1,130 @@
+#ifndef RECTDIFF_H
+#define RECTDIFF_H
+
+#include <QColor>
+#include <QString>
+#include <QVector>
+
+#include "parallelscanner.h"
+#include "rectrow.h"
+
+/**
+ * @brief Сравнение таблиц rectangle двух файлов БД (реплика, резервная копия): вставленные,
+ *        удалённые и изменённые строки.
+ *
+ * Сравнение идёт сверху вниз по диапазонам id (дерево хешей, строится на лету):
+ *  1. общий диапазон id делится на части; для каждой части на каждой стороне одним запросом
+ *     считается COUNT(*) и две суммы хешей строк (хеш строки считает SQLite — строки в Qt не передаются);
+ *  2. части с совпавшими хешами больше не читаются; различающиеся делятся на kFanout частей
+ *     и сравниваются снова;
+ *  3. части не больше leafRows() строк читаются целиком (RectBulkReader) и сравниваются построчно.
+ * Хеши частей одного уровня и листья считаются параллельно, каждая задача — в своём соединении
+ * (ScopedConnection, только чтение).
+ *
+ * Для почти одинаковых файлов полностью читается только первый уровень (один проход по таблице
+ * на каждой стороне, параллельно); дальше — только окрестности отличий.
+ *
+ * Цвет сравнивается по значению, а не по pen_id: словари цветов сторон могут нумеровать
+ * цвета по-разному (хеш берёт rgb через CASE по словарю своей стороны).
+ *
+ * Хеш строки — два независимых полиномиальных хеша (по модулю ~2^31) по id и значениям,
+ * каждый перед суммированием перемешивается нелинейно (h * (h + c) mod P). Без перемешивания
+ * сумма линейна по колонкам: обмен значениями между строками диапазона или правки +d/-d
+ * в двух строках её не меняют. С ним такие правки совпадают по хешу только при случайной
+ * коллизии обоих хешей (порядка 1/P на хеш).
+ *
+ * @note Нужна схема v5 (колонка pen_id) на обеих сторонах.
+ */
+class RectDiff
+{
+public:
+    /// Строка, изменённая между base и other.
+    struct Modified
+    {
+        RectRow before;
+        RectRow after;
+    };
+
+    struct Result
+    {
+        bool ok = false;
+        QString error;
+
+        /// Есть только в other.
+        QVector<RectRow> inserted;
+        /// Есть только в base.
+        QVector<RectRow> deleted;
+        /// Есть в обеих с разными данными.
+        QVector<Modified> modified;
+
+        /// Уровней дерева диапазонов пройдено.
+        int levels = 0;
+        /// Пар хешей диапазонов посчитано.
+        qint64 rangesHashed = 0;
+        /// Строк прочитано при построчном сравнении листьев (обе стороны).
+        qint64 rowsCompared = 0;
+        qint64 elapsedMs = 0;
+
+        bool identical() const { return ok && inserted.isEmpty() && deleted.isEmpty() && modified.isEmpty(); }
+    };
+
+    /// Диапазон не больше стольких строк сравнивается построчно.
+    static constexpr int kDefaultLeafRows = 512;
+    /// На сколько частей делится различающийся диапазон.
+    static constexpr int kFanout = 16;
+
+    /**
+     * @param basePath Исходный файл (удалённые строки — его).
+     * @param otherPath Сравниваемый файл (вставленные строки — его).
+     * @param threads Частей на первом уровне — kFanout на поток (0 — по числу ядер).
+     */
+    RectDiff(const QString& basePath, const QString& otherPath, int threads = 0);
+
+    void setLeafRows(int rows) { m_leafRows = qMax(1, rows); }
+    int leafRows() const { return m_leafRows; }
+
+    /// Сравнивает таблицы (блокирует до конца).
+    Result run();
+
+    /// Одинаковые ли данные прямоугольников (id не сравнивается, цвет — по rgb).
+    static bool sameRect(const MyRect& a, const MyRect& b);
+
+private:
+    /// Хеш и размер диапазона на одной стороне.
+    struct RangeHash
+    {
+        qint64 rows = 0;
+        qint64 h1 = 0;
+        qint64 h2 = 0;
+        QString error;
+    };
+
+    /// Построчное сравнение одного диапазона.
+    struct LeafDiff
+    {
+        QVector<RectRow> inserted;
+        QVector<RectRow> deleted;
+        QVector<Modified> modified;
+        qint64 rows = 0;
+        QString error;
+    };
+
+    using Range = ParallelScanner::Partition;
+
+    /// Подготовка стороны: проверка схемы, словарь цветов, диапазон id. false — ошибка в *error.
+    static bool prepareSide_(const QString& path, QString* hashSql, qint64* minId, qint64* maxId, QString* error);
+
+    /// SQL хеша диапазона (параметры — from, to) с CASE по словарю colors.
+    static QString hashSql_(const QVector<QColor>& colors);
+
+    static RangeHash hashRange_(const QString& path, const QString& sql, const Range& range);
+    static LeafDiff compareLeaf_(const QString& basePath, const QString& otherPath, const Range& range);
+
+private:
+    QString m_basePath;
+    QString m_otherPath;
+    int m_threads = 1;
+    int m_leafRows = kDefaultLeafRows;
+};
+
+#endif // RECTDIFF_H
@@ -0,0 +1,213 @@
+#include "rectpdfreport.h"
+
+#include <QFontMetricsF>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QSaveFile>
+
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include <array>
+
+#include "logger.h"
+#include "mydelegate.h"
+#include "rectangleschema.h"
+#include "rectbulkio.h"
+
+namespace {
+
+/// Колонки отчёта и их относительная ширина.
+struct ReportColumn
+{
+    const char* title;
+    qreal weight;
+    bool numeric;
+};
+
+constexpr std::array<ReportColumn, 8> kColumns { {
+    { "id",       1.2, true },
+    { "pencolor", 1.6, false },
+    { "penstyle", 1.6, false },
+    { "penwidth", 1.0, true },
+    { "left",     1.0, true },
+    { "top",      1.0, true },
+    { "width",    1.0, true },
+    { "height",   1.0, true },
+} };
+
+RectPdfReport::Stats failed(RectPdfReport::Stats s, const QString& what)
+{
+    s.ok = false;
+    s.error = what;
+    return s;
+}
+
+} // namespace
+
+RectPdfReport::RectPdfReport(QSqlDatabase db)
+    : m_db(std::move(db))
+{
+}
+
+RectPdfReport::Stats RectPdfReport::exportTo(const QString& path) const
+{
+    Stats s;
+    QSqlDatabase db = m_db;
+
+    if (!db.tables().contains(rectschema::kTable))
+        return failed(s, QString("table %1 does not exist").arg(rectschema::kTable));
+
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly))
+        return failed(s, "cannot open " + path + ": " + out.errorString());
+
+    QPdfWriter writer(&out);
+    writer.setTitle(m_title);
+    writer.setCreator("lab2");
+    writer.setResolution(m_resolution);
+    writer.setPageSize(m_pageSize);
+    writer.setPageMargins(QMarginsF(kMarginMm, kMarginMm, kMarginMm, kMarginMm), QPageLayout::Millimeter);
+
+    // Шрифты в пунктах: QPdfWriter переводит их в точки страницы по своему разрешению.
+    QFont font;
+    font.setPointSizeF(m_fontPt);
+    QFont bold = font;
+    bold.setBold(true);
+    const QFontMetricsF fm(font, &writer);
+
+    const qreal pageW = writer.width();
+    const qreal pageH = writer.height();
+    const qreal rowH = fm.height() * 1.25;
+    const qreal pad = fm.averageCharWidth() * 0.5;
+    const qreal swatch = fm.ascent();
+    // Сверху заголовок отчёта и шапка колонок, снизу номер страницы.
+    const qreal bodyTop = 2.5 * rowH;
+    const qreal bodyBottom = pageH - 1.5 * rowH;
+    s.rowsPerPage = qMax(1, int((bodyBottom - bodyTop) / rowH));
+
+    qreal weights = 0;
+    for (const ReportColumn& c : kColumns)
+        weights += c.weight;
+    std::array<QRectF, kColumns.size()> cells;
+    qreal x = 0;
+    for (size_t i = 0; i < kColumns.size(); ++i) {
+        const qreal w = pageW * kColumns[i].weight / weights;
+        cells[i] = QRectF(x + pad, 0, w - 2 * pad, rowH);
+        x += w;
+    }
+
+    // COUNT и выборка в одной транзакции — число страниц в колонтитуле сходится с файлом.
+    // Если соединение уже в транзакции, она и даёт согласованность.
+    const bool ownTransaction = db.transaction();
+    const auto finish = [&] {
+        if (ownTransaction)
+            db.commit();
+    };
+
+    qint64 total = 0;
+    {
+        QSqlQuery q(db);
+        if (!q.exec(QString("SELECT COUNT(*) FROM %1;").arg(rectschema::kTable)) || !q.next()) {
+            const QString err = q.lastError().text();
+            q.finish();
+            finish();
+            out.cancelWriting();
+            return failed(s, "SELECT COUNT failed: " + err);
+        }
+        total = q.value(0).toLongLong();
+    }
+    const int pages = int(qMax<qint64>(1, (total + s.rowsPerPage - 1) / s.rowsPerPage));
+
+    QPainter p;
+    if (!p.begin(&writer)) {
+        finish();
+        out.cancelWriting();
+        return failed(s, "cannot start PDF painter for " + path);
+    }
+
+    const auto drawPageFrame = [&](int page) {
+        p.setFont(bold);
+        p.setPen(Qt::black);
+        p.drawText(QRectF(0, 0, pageW, rowH), Qt::AlignLeft | Qt::AlignVCenter,
+                   QString("%1 %2 %3 rows").arg(m_title).arg(QChar(0x2014)).arg(total));
+
+        const qreal headerY = 1.25 * rowH;
+        for (size_t i = 0; i < kColumns.size(); ++i) {
+            p.drawText(cells[i].translated(0, headerY),
+                       (kColumns[i].numeric ? Qt::AlignRight : Qt::AlignLeft) | Qt::AlignVCenter,
+                       kColumns[i].title);
+        }
+        p.drawLine(QPointF(0, headerY + rowH), QPointF(pageW, headerY + rowH));
+
+        p.setFont(font);
+        p.drawText(QRectF(0, pageH - rowH, pageW, rowH), Qt::AlignRight | Qt::AlignVCenter,
+                   QString("%1 / %2").arg(page).arg(pages));
+    };
+
+    const QColor zebra(0xf0, 0xf0, 0xf0);
+    const auto cellFlags = [](size_t i) {
+        return (kColumns[i].numeric ? Qt::AlignRight : Qt::AlignLeft) | Qt::AlignVCenter;
+    };
+
+    int page = 1;
+    int line = 0;
+    QString readError;
+    drawPageFrame(page);
+    {
+        // Выборка закрывается до COMMIT.
+        RectBulkReader reader(db);
+        if (!reader.execAll()) {
+            const QString err = reader.lastError();
+            p.end();
+            finish();
+            out.cancelWriting();
+            return failed(s, "SELECT failed: " + err);
+        }
+
+        RectRow row;
+        while (reader.next(row)) {
+            if (line == s.rowsPerPage) {
+                // Готовая страница уходит в файл, в памяти только новая.
+                writer.newPage();
+                drawPageFrame(++page);
+                line = 0;
+            }
+
+            const qreal y = bodyTop + line * rowH;
+            if (line % 2)
+                p.fillRect(QRectF(0, y, pageW, rowH), zebra);
+
+            const MyRect& r = row.rect;
+            const QRectF colorCell = cells[1].translated(0, y);
+            p.fillRect(QRectF(colorCell.left(), y + (rowH - swatch) / 2, swatch, swatch), r.penColor);
+            p.drawText(colorCell.adjusted(swatch + pad, 0, 0, 0), cellFlags(1), r.penColor.name());
+
+            p.drawText(cells[0].translated(0, y), cellFlags(0), QString::number(row.id));
+            p.drawText(cells[2].translated(0, y), cellFlags(2), MyDelegate::penStyleToText(int(r.penStyle)));
+            p.drawText(cells[3].translated(0, y), cellFlags(3), QString::number(r.penWidth));
+            p.drawText(cells[4].translated(0, y), cellFlags(4), QString::number(r.left));
+            p.drawText(cells[5].translated(0, y), cellFlags(5), QString::number(r.top));
+            p.drawText(cells[6].translated(0, y), cellFlags(6), QString::number(r.width));
+            p.drawText(cells[7].translated(0, y), cellFlags(7), QString::number(r.height));
+
+            ++line;
+            ++s.rows;
+        }
+        readError = reader.lastError();
+    }
+    p.end();
+    finish();
+
+    if (!readError.isEmpty()) {
+        out.cancelWriting();
+        return failed(s, "read failed: " + readError);
+    }
+    if (!out.commit())
+        return failed(s, "cannot write " + path + ": " + out.errorString());
+
+    s.pages = page;
+    s.ok = true;
+    LAB2_DEBUG(lcDb()) << "RectPdfReport:" << s.rows << "rows," << s.pages << "pages ->" << path;
+    return s;
+}
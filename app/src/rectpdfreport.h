@@ -0,0 +1,57 @@
+#ifndef RECTPDFREPORT_H
+#define RECTPDFREPORT_H
+
+#include <QPageSize>
+#include <QString>
+
+#include <QtSql/QSqlDatabase>
+
+/**
+ * @brief Печать таблицы rectangle в PDF потоком, без модели.
+ *
+ * Печать через вид требует сначала загрузить всю таблицу в QSqlTableModel — на сотнях тысяч
+ * строк это минуты и сотни мегабайт. Отчёт читает строки forward-only (RectBulkReader)
+ * и сразу рисует их на страницах QPdfWriter: в памяти одна строка и текущая страница,
+ * готовые страницы уходят в файл (QSaveFile — при ошибке старый отчёт не портится).
+ *
+ * Страница: заголовок (имя отчёта, число строк), шапка колонок, строки с образцом цвета пера,
+ * внизу номер страницы "n / m". Число строк (COUNT) и выборка — в одной читающей транзакции,
+ * поэтому m совпадает с числом напечатанных страниц.
+ */
+class RectPdfReport
+{
+public:
+    /// Итог печати.
+    struct Stats
+    {
+        bool ok = false;
+        qint64 rows = 0;
+        int pages = 0;
+        int rowsPerPage = 0;
+        QString error;
+    };
+
+    static constexpr int kDefaultResolution = 150;
+    static constexpr qreal kDefaultFontPt = 8.0;
+    static constexpr qreal kMarginMm = 10.0;
+
+    explicit RectPdfReport(QSqlDatabase db);
+
+    void setTitle(const QString& title) { m_title = title; }
+    void setPageSize(const QPageSize& size) { m_pageSize = size; }
+    /// Разрешение страницы (dpi); от него зависят только координаты, не размер текста.
+    void setResolution(int dpi) { m_resolution = qMax(36, dpi); }
+    void setFontPointSize(qreal pt) { m_fontPt = pt > 0 ? pt : kDefaultFontPt; }
+
+    /// Печатает таблицу rectangle (по возрастанию id) в path.
+    Stats exportTo(const QString& path) const;
+
+private:
+    QSqlDatabase m_db;
+    QString m_title = "rectangle";
+    QPageSize m_pageSize = QPageSize(QPageSize::A4);
+    int m_resolution = kDefaultResolution;
+    qreal m_fontPt = kDefaultFontPt;
+};
+
+#endif // RECTPDFREPORT_H
@@ -0,0 +1,96 @@
+#include "rectrowdecoder.h"
+
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlRecord>
+
+namespace {
+
+int hexDigit(ushort u)
+{
+    if (u >= '0' && u <= '9') return u - '0';
+    if (u >= 'a' && u <= 'f') return u - 'a' + 10;
+    if (u >= 'A' && u <= 'F') return u - 'A' + 10;
+    return -1;
+}
+
+/// "#rrggbb" -> rgb; false, если текст в другом формате.
+template <typename CharAt>
+bool parseHexRgb(int size, CharAt at, int* rgb)
+{
+    if (size != 7 || at(0) != '#')
+        return false;
+    int v = 0;
+    for (int i = 1; i < 7; ++i) {
+        const int d = hexDigit(at(i));
+        if (d < 0)
+            return false;
+        v = (v << 4) | d;
+    }
+    *rgb = v;
+    return true;
+}
+
+QColor fromRgb(int rgb)
+{
+    return QColor((rgb >> 16) & 0xff, (rgb >> 8) & 0xff, rgb & 0xff);
+}
+
+} // namespace
+
+RectRowDecoder::RectRowDecoder(QVector<QColor> colors)
+    : m_colors(std::move(colors))
+{
+    for (int c = 0; c < rectschema::kValueColumnCount; ++c)
+        m_index[c] = c;
+}
+
+RectRowDecoder::RectRowDecoder(const QSqlRecord& record, QVector<QColor> colors)
+    : m_colors(std::move(colors))
+{
+    for (int c = 0; c < rectschema::kValueColumnCount; ++c) {
+        m_index[c] = record.indexOf(rectschema::kColumns[c].name);
+        if (m_index[c] < 0)
+            m_missing << rectschema::kColumns[c].name;
+    }
+}
+
+void RectRowDecoder::decode(const QSqlQuery& q, RectRow& row) const
+{
+    using namespace rectschema;
+
+    row.id = q.value(m_index[Id]).toLongLong();
+    row.rect.penColor = color(q.value(m_index[PenColor]).toInt());
+    row.rect.penStyle = static_cast<Qt::PenStyle>(q.value(m_index[PenStyle]).toInt());
+    row.rect.penWidth = q.value(m_index[PenWidth]).toInt();
+    row.rect.left = q.value(m_index[Left]).toInt();
+    row.rect.top = q.value(m_index[Top]).toInt();
+    row.rect.width = q.value(m_index[Width]).toInt();
+    row.rect.height = q.value(m_index[Height]).toInt();
+}
+
+RectRow RectRowDecoder::decode(const QSqlQuery& q) const
+{
+    RectRow row;
+    decode(q, row);
+    return row;
+}
+
+int RectRowDecoder::fetch(QSqlQuery& q, QVector<RectRow>& batch, int maxRows) const
+{
+    batch.resize(qMax(0, maxRows));
+
+    int n = 0;
+    while (n < maxRows && q.next())
+        decode(q, batch[n++]);
+
+    batch.resize(n);
+    return n;
+}
+
+QColor RectRowDecoder::parseColor(const QString& text)
+{
+    int rgb = 0;
+    if (parseHexRgb(text.size(), [&text](int i) { return text.at(i).unicode(); }, &rgb))
+        return fromRgb(rgb);
+    return QColor(text);
+}
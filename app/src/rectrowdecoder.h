@@ -0,0 +1,82 @@
+#ifndef RECTROWDECODER_H
+#define RECTROWDECODER_H
+
+#include <QColor>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <array>
+
+#include "rectangleschema.h"
+#include "rectrow.h"
+
+class QSqlQuery;
+class QSqlRecord;
+
+/**
+ * @brief Разбор строк результата QSqlQuery в RectRow с заранее найденными индексами колонок.
+ *
+ * Индексы колонок находятся один раз на запрос:
+ *  - конструктор по умолчанию — для запросов вида rectschema::kSelectValuesSql
+ *    (порядок колонок известен на этапе компиляции, поиск не нужен);
+ *  - конструктор от QSqlRecord — для SELECT * и произвольного порядка (поиск по именам один раз).
+ *
+ * Дальше каждая строка читается по готовым индексам, без QSqlRecord::indexOf и без QSqlRecord
+ * на строку. Цвет хранится как pen_id (схема v5) и берётся из таблицы цветов по id
+ * (PenPalette::colors() / PenPalette::loadColors()) — без разбора строк.
+ *
+ * parseColor() — быстрый разбор "#rrggbb" (без QColor(QString), который перебирает форматы
+ * и имена) для словаря и текстовых источников.
+ */
+class RectRowDecoder
+{
+public:
+    /**
+     * @brief Колонки в порядке kSelectValuesSql: id, pen_id, ..., height.
+     * @param colors Цвета по pen_id (индекс — id).
+     */
+    explicit RectRowDecoder(QVector<QColor> colors = {});
+
+    /// Колонки по именам из record (обычно query.record() после exec()).
+    RectRowDecoder(const QSqlRecord& record, QVector<QColor> colors);
+
+    /// Все нужные колонки есть в результате.
+    bool isValid() const { return m_missing.isEmpty(); }
+
+    /// Колонки схемы, которых нет в результате.
+    QStringList missingColumns() const { return m_missing; }
+
+    /// Индекс колонки в результате (-1 — нет).
+    int column(rectschema::Column c) const { return c < rectschema::kValueColumnCount ? m_index[c] : -1; }
+
+    /// Читает текущую строку q в row.
+    void decode(const QSqlQuery& q, RectRow& row) const;
+
+    /// Читает текущую строку q.
+    RectRow decode(const QSqlQuery& q) const;
+
+    /// Цвет по pen_id (QColor() — неизвестный id или NULL).
+    QColor color(int penId) const
+    {
+        return penId > 0 && penId < m_colors.size() ? m_colors.at(penId) : QColor();
+    }
+
+    /**
+     * @brief Читает до maxRows следующих строк q в batch (содержимое batch заменяется).
+     *
+     * Память batch переиспользуется между вызовами — удобно для обработки порциями.
+     * @return Число прочитанных строк (0 — результат исчерпан).
+     */
+    int fetch(QSqlQuery& q, QVector<RectRow>& batch, int maxRows) const;
+
+    /// Разбор цвета: быстрый путь для "#rrggbb", остальное — через QColor.
+    static QColor parseColor(const QString& text);
+
+private:
+    std::array<int, rectschema::kValueColumnCount> m_index {};
+    QStringList m_missing;
+    QVector<QColor> m_colors;
+};
+
+#endif // RECTROWDECODER_H
@@ -0,0 +1,266 @@
+#include "rectsnapshot.h"
+
+#include <QColor>
+#include <QDir>
+#include <QFile>
+
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+#include "changeexporter.h"
+#include "penpalette.h"
+#include "rectangleschema.h"
+#include "rectrowdecoder.h"
+
+namespace {
+
+constexpr char kMagic[8] = { 'L', '2', 'S', 'N', 'A', 'P', '0', '1' };
+
+/// Заголовок файла снимка (см. описание формата в rectsnapshot.h).
+struct FileHeader
+{
+    char magic[8];
+    quint32 formatVersion;
+    quint32 columnCount;
+    quint64 rowCount;
+    qint64 sourceSeq;
+    quint64 columnOffset[RectSnapshot::ColumnCount];
+};
+
+static_assert(sizeof(FileHeader) <= RectSnapshot::kHeaderSize, "snapshot header does not fit");
+static_assert(int(RectSnapshot::Height) == rectschema::Height
+              && int(RectSnapshot::ColumnCount) == rectschema::kValueColumnCount,
+              "snapshot columns must follow the stored columns of the schema");
+
+/// Размер одного значения колонки.
+constexpr qint64 elementSize(int column)
+{
+    return column == RectSnapshot::Id ? 8 : 4;
+}
+
+constexpr qint64 align8(qint64 v)
+{
+    return (v + 7) & ~qint64(7);
+}
+
+/// Раскладка колонок для rowCount строк; возвращает полный размер файла.
+qint64 layout(qint64 rowCount, quint64 (&offsets)[RectSnapshot::ColumnCount])
+{
+    qint64 pos = RectSnapshot::kHeaderSize;
+    for (int c = 0; c < RectSnapshot::ColumnCount; ++c) {
+        offsets[c] = quint64(pos);
+        pos = align8(pos + rowCount * elementSize(c));
+    }
+    return pos;
+}
+
+bool fail(QString* error, const QString& what)
+{
+    if (error) *error = what;
+    return false;
+}
+
+} // namespace
+
+RectSnapshot::~RectSnapshot()
+{
+    close();
+}
+
+bool RectSnapshot::write(QSqlDatabase db, const QString& path, QString* error)
+{
+    // Читающая транзакция: COUNT, seq журнала и SELECT видят одно и то же состояние БД.
+    if (!db.transaction())
+        return fail(error, "BEGIN failed: " + db.lastError().text());
+
+    const auto abort = [&](const QString& what) {
+        db.rollback();
+        return fail(error, what);
+    };
+
+    qint64 rowCount = 0;
+    qint64 sourceSeq = -1;
+    {
+        QSqlQuery q(db);
+        if (!q.exec("SELECT COUNT(*) FROM rectangle;") || !q.next())
+            return abort("COUNT failed: " + q.lastError().text());
+        rowCount = q.value(0).toLongLong();
+
+        if (db.tables().contains(ChangeExporter::kChangesTable))
+            sourceSeq = ChangeExporter(db).latestSeq();
+    }
+
+    FileHeader header {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.formatVersion = kFormatVersion;
+    header.columnCount = ColumnCount;
+    header.rowCount = quint64(rowCount);
+    header.sourceSeq = sourceSeq;
+    const qint64 fileSize = layout(rowCount, header.columnOffset);
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate))
+        return abort("cannot open " + path + ": " + file.errorString());
+    if (!file.resize(fileSize))
+        return abort("cannot resize " + path + ": " + file.errorString());
+
+    uchar* base = file.map(0, fileSize);
+    if (!base)
+        return abort("cannot map " + path + ": " + file.errorString());
+
+    std::memcpy(base, &header, sizeof(header));
+
+    auto* ids    = reinterpret_cast<qint64*>(base + header.columnOffset[Id]);
+    auto* colors = reinterpret_cast<quint32*>(base + header.columnOffset[PenColor]);
+    qint32* ints[ColumnCount] = {};
+    for (int c = PenStyle; c < ColumnCount; ++c)
+        ints[c] = reinterpret_cast<qint32*>(base + header.columnOffset[c]);
+
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    if (!q.exec(QString(rectschema::kSelectValuesSql) + " ORDER BY id;")) {
+        const QString err = q.lastError().text();
+        file.unmap(base);
+        return abort("SELECT failed: " + err);
+    }
+
+    RectRowDecoder decoder(PenPalette::loadColors(db));
+    RectRow row;
+    qint64 i = 0;
+    while (i < rowCount && q.next()) {
+        decoder.decode(q, row);
+        ids[i] = row.id;
+        colors[i] = row.rect.penColor.rgb();
+        ints[PenStyle][i] = int(row.rect.penStyle);
+        ints[PenWidth][i] = row.rect.penWidth;
+        ints[Left][i] = row.rect.left;
+        ints[Top][i] = row.rect.top;
+        ints[Width][i] = row.rect.width;
+        ints[Height][i] = row.rect.height;
+        ++i;
+    }
+    q.finish();
+
+    file.unmap(base);
+    file.close();
+    db.commit();
+
+    if (i != rowCount)
+        return fail(error, QString("row count changed while writing (%1 of %2)").arg(i).arg(rowCount));
+    return true;
+}
+
+bool RectSnapshot::replaceFile(const QString& tmpPath, const QString& path)
+{
+    // Замена одним вызовом ОС: в любой момент на месте path либо старый снимок, либо новый.
+    // (remove + rename оставлял окно, в котором снимка нет вовсе.)
+#ifdef Q_OS_WIN
+    const QString from = QDir::toNativeSeparators(tmpPath);
+    const QString to = QDir::toNativeSeparators(path);
+    return MoveFileExW(reinterpret_cast<const wchar_t*>(from.utf16()),
+                       reinterpret_cast<const wchar_t*>(to.utf16()),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(QFile::encodeName(tmpPath).constData(), QFile::encodeName(path).constData()) == 0;
+#endif
+}
+
+bool RectSnapshot::open(const QString& path, QString* error)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return fail(error, "cannot open " + path + ": " + m_file.errorString());
+
+    const qint64 size = m_file.size();
+    if (size < kHeaderSize) {
+        m_file.close();
+        return fail(error, path + ": file is too small");
+    }
+
+    m_base = m_file.map(0, size);
+    if (!m_base) {
+        m_file.close();
+        return fail(error, "cannot map " + path + ": " + m_file.errorString());
+    }
+    m_mappedSize = size;
+
+    FileHeader header;
+    std::memcpy(&header, m_base, sizeof(header));
+
+    quint64 expected[ColumnCount];
+    const bool headerOk = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0
+            && header.formatVersion == kFormatVersion
+            && header.columnCount == quint32(ColumnCount)
+            && header.rowCount <= quint64(size)
+            && layout(qint64(header.rowCount), expected) == size
+            && std::memcmp(expected, header.columnOffset, sizeof(expected)) == 0;
+    if (!headerOk) {
+        close();
+        return fail(error, path + ": not a snapshot or unsupported format");
+    }
+
+    m_rowCount = qint64(header.rowCount);
+    m_sourceSeq = header.sourceSeq;
+    for (int c = 0; c < ColumnCount; ++c)
+        m_columns[c] = m_base + header.columnOffset[c];
+    return true;
+}
+
+void RectSnapshot::close()
+{
+    if (m_base) {
+        m_file.unmap(m_base);
+        m_base = nullptr;
+    }
+    if (m_file.isOpen())
+        m_file.close();
+
+    m_mappedSize = 0;
+    m_rowCount = 0;
+    m_sourceSeq = -1;
+    std::fill(std::begin(m_columns), std::end(m_columns), nullptr);
+}
+
+RectRow RectSnapshot::row(qint64 i) const
+{
+    RectRow r;
+    r.id = ids()[i];
+    r.rect = MyRect(QColor::fromRgb(penColors()[i]),
+                    static_cast<Qt::PenStyle>(intColumn(PenStyle)[i]),
+                    intColumn(PenWidth)[i],
+                    intColumn(Left)[i],
+                    intColumn(Top)[i],
+                    intColumn(Width)[i],
+                    intColumn(Height)[i]);
+    return r;
+}
+
+RectAnalytics RectSnapshot::analytics() const
+{
+    RectAnalytics a;
+
+    const qint32* left   = intColumn(Left);
+    const qint32* top    = intColumn(Top);
+    const qint32* width  = intColumn(Width);
+    const qint32* height = intColumn(Height);
+    const qint32* penW   = intColumn(PenWidth);
+
+    // Проход по колонкам подряд: читаются только нужные страницы отображения.
+    for (qint64 i = 0; i < m_rowCount; ++i)
+        a.add(left[i], top[i], width[i], height[i], penW[i]);
+    return a;
+}
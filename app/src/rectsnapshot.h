@@ -0,0 +1,112 @@
+#ifndef RECTSNAPSHOT_H
+#define RECTSNAPSHOT_H
+
+#include <QFile>
+#include <QString>
+
+#include <QtSql/QSqlDatabase>
+
+#include "rectanalytics.h"
+#include "rectrow.h"
+
+/**
+ * @brief Колоночный снимок таблицы rectangle в бинарном файле, читаемый через mmap.
+ *
+ * Холодный старт на большой БД упирается в декодирование строк через QSqlQuery/QVariant.
+ * Снимок хранит те же данные в готовом к использованию виде: файл отображается в память
+ * (QFile::map), строки и колонки читаются напрямую из отображения без SQL и без копирования,
+ * а страницы подгружаются ОС по мере обращения.
+ *
+ * Формат (порядок байт — платформенный: снимок — локальный кэш, а не формат обмена):
+ *
+ *   Header (kHeaderSize байт)
+ *     magic[8]        "L2SNAP01"
+ *     formatVersion   quint32
+ *     columnCount     quint32 (== ColumnCount)
+ *     rowCount        quint64
+ *     sourceSeq       qint64  — последний seq журнала rectangle_changes на момент снимка (-1 — журнала нет)
+ *     columnOffset[ColumnCount] quint64 — смещения колонок от начала файла (кратны 8)
+ *   Колонки по rowCount значений:
+ *     Id — qint64, PenColor — quint32 (QRgb), остальные — qint32.
+ *
+ * Снимок строится внутри одной читающей транзакции (COUNT и SELECT видят одно состояние)
+ * и только для чтения: правки идут в БД, а снимок пересоздаётся (см. SnapshotRefresher).
+ */
+class RectSnapshot
+{
+public:
+    /// Колонки снимка — в том же порядке, что и в таблице rectangle.
+    enum Column {
+        Id = 0,
+        PenColor,
+        PenStyle,
+        PenWidth,
+        Left,
+        Top,
+        Width,
+        Height,
+        ColumnCount
+    };
+
+    static constexpr quint32 kFormatVersion = 1;
+    static constexpr int kHeaderSize = 128;
+
+    RectSnapshot() = default;
+    ~RectSnapshot();
+
+    RectSnapshot(const RectSnapshot&) = delete;
+    RectSnapshot& operator=(const RectSnapshot&) = delete;
+
+    /**
+     * @brief Пишет снимок таблицы rectangle из db в файл path (файл перезаписывается).
+     *
+     * Файл сразу создаётся нужного размера и заполняется через отображение в память
+     * за один проход forward-only запроса.
+     * @param error Текст ошибки (может быть nullptr).
+     */
+    static bool write(QSqlDatabase db, const QString& path, QString* error = nullptr);
+
+    /**
+     * @brief Атомарно заменяет path готовым файлом tmpPath (MoveFileEx / rename поверх цели).
+     *
+     * При сбое посередине на месте path остаётся старый снимок, а не пустота.
+     * @note Снимок path должен быть закрыт (close()) — на Windows отображённый файл не заменить.
+     */
+    static bool replaceFile(const QString& tmpPath, const QString& path);
+
+    /// Открывает и отображает файл. Проверяет заголовок и размеры колонок.
+    bool open(const QString& path, QString* error = nullptr);
+    void close();
+
+    bool isOpen() const { return m_base != nullptr; }
+    QString fileName() const { return m_file.fileName(); }
+
+    qint64 rowCount() const { return m_rowCount; }
+    qint64 sourceSeq() const { return m_sourceSeq; }
+
+    /// Размер отображения (байт).
+    qint64 mappedBytes() const { return m_mappedSize; }
+
+    /// Колонка id.
+    const qint64* ids() const { return reinterpret_cast<const qint64*>(m_columns[Id]); }
+    /// Колонка цвета пера (QRgb).
+    const quint32* penColors() const { return reinterpret_cast<const quint32*>(m_columns[PenColor]); }
+    /// Целочисленная колонка (PenStyle..Height).
+    const qint32* intColumn(Column c) const { return reinterpret_cast<const qint32*>(m_columns[c]); }
+
+    /// Строка снимка (без проверки границ).
+    RectRow row(qint64 i) const;
+
+    /// Сводка по всем строкам снимка, считается прямо по колонкам (без SQL).
+    RectAnalytics analytics() const;
+
+private:
+    QFile m_file;
+    uchar* m_base = nullptr;
+    qint64 m_mappedSize = 0;
+    qint64 m_rowCount = 0;
+    qint64 m_sourceSeq = -1;
+    const uchar* m_columns[ColumnCount] = {};
+};
+
+#endif // RECTSNAPSHOT_H
@@ -0,0 +1,128 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief Ограниченная lock-free очередь MPMC (кольцевой буфер, схема Д. Вьюкова).
+ *
+ * Несколько потоков могут одновременно класть и забирать элементы без мьютексов:
+ * каждая ячейка хранит счётчик sequence, по которому поток понимает,
+ * свободна ли ячейка для записи или уже готова для чтения.
+ *
+ * Очередь не блокирует: tryPush() на полной очереди и tryPop() на пустой
+ * сразу возвращают false — политику (ждать, отбросить, притормозить) выбирает вызывающий.
+ *
+ * @tparam T Тип элемента (должен быть move-конструируемым и default-конструируемым).
+ *
+ * @note Ёмкость округляется вверх до степени двойки.
+ */
+template <typename T>
+class MpmcRingBuffer
+{
+public:
+    explicit MpmcRingBuffer(std::size_t capacity)
+        : m_capacity(roundUpPow2(capacity < 2 ? 2 : capacity))
+        , m_mask(m_capacity - 1)
+        , m_cells(new Cell[m_capacity])
+    {
+        for (std::size_t i = 0; i < m_capacity; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcRingBuffer(const MpmcRingBuffer&) = delete;
+    MpmcRingBuffer& operator=(const MpmcRingBuffer&) = delete;
+
+    std::size_t capacity() const { return m_capacity; }
+
+    /// Кладёт элемент. false — очередь полна (элемент не тронут).
+    bool tryPush(T&& value)
+    {
+        Cell* cell = nullptr;
+        std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            const std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPush(const T& value)
+    {
+        T copy(value);
+        return tryPush(std::move(copy));
+    }
+
+    /// Забирает элемент. false — очередь пуста.
+    bool tryPop(T& out)
+    {
+        Cell* cell = nullptr;
+        std::size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            const std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        out = std::move(cell->value);
+        cell->value = T();
+        cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Приблизительное число элементов (точно только без конкурентных операций).
+    std::size_t sizeApprox() const
+    {
+        const std::size_t head = m_dequeuePos.load(std::memory_order_relaxed);
+        const std::size_t tail = m_enqueuePos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    bool emptyApprox() const { return sizeApprox() == 0; }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence { 0 };
+        T value {};
+    };
+
+    static std::size_t roundUpPow2(std::size_t v)
+    {
+        std::size_t p = 1;
+        while (p < v) p <<= 1;
+        return p;
+    }
+
+    // Разнесены по разным кэш-линиям, чтобы производители и потребители не мешали друг другу.
+    alignas(64) const std::size_t m_capacity;
+    const std::size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+    alignas(64) std::atomic<std::size_t> m_enqueuePos { 0 };
+    alignas(64) std::atomic<std::size_t> m_dequeuePos { 0 };
+};
+
+#endif // RINGBUFFER_H
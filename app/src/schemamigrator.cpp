@@ -0,0 +1,463 @@
+#include "schemamigrator.h"
+
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include "busyretry.h"
+#include "logger.h"
+
+namespace {
+
+/**
+ * @brief Триггеры журнала изменений (v2). Удаляются вместе с таблицей, поэтому нужны и после перестроек.
+ * @param colorOf Выражение цвета строки; %1 — NEW или OLD.
+ */
+QStringList cdcTriggerStatements(const QString& colorOf = "%1.pencolor")
+{
+    const QString insert =
+            " INSERT INTO rectangle_changes (op, row_id, pencolor, penstyle, penwidth, left, top, width, height)"
+            " VALUES ('%2', %1.id, %3, %1.penstyle, %1.penwidth, %1.left, %1.top, %1.width, %1.height);";
+    const auto row = [&](const char* op, const char* ref) {
+        return insert.arg(ref, op, colorOf.arg(ref));
+    };
+    return {
+        "CREATE TRIGGER IF NOT EXISTS rectangle_cdc_insert AFTER INSERT ON rectangle BEGIN"
+        + row("I", "NEW") + " END;",
+        "CREATE TRIGGER IF NOT EXISTS rectangle_cdc_update AFTER UPDATE ON rectangle BEGIN"
+        + row("U", "NEW") + " END;",
+        "CREATE TRIGGER IF NOT EXISTS rectangle_cdc_delete AFTER DELETE ON rectangle BEGIN"
+        + row("D", "OLD") + " END;"
+    };
+}
+
+} // namespace
+
+SchemaMigrator::SchemaMigrator(QSqlDatabase db)
+    : SchemaMigrator(std::move(db), builtinMigrations())
+{
+}
+
+SchemaMigrator::SchemaMigrator(QSqlDatabase db, QVector<Migration> migrations)
+    : m_db(std::move(db))
+    , m_migrations(std::move(migrations))
+{
+}
+
+QVector<SchemaMigrator::Migration> SchemaMigrator::builtinMigrations()
+{
+    QVector<Migration> list;
+
+    // v1: исходная схема ЛР2. IF NOT EXISTS — чтобы "усыновить" БД, созданные до миграций
+    // (таблица есть, user_version = 0).
+    {
+        Migration m;
+        m.version = 1;
+        m.description = "create rectangle table";
+        m.statements << "CREATE TABLE IF NOT EXISTS rectangle ("
+                        " id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                        " pencolor VARCHAR,"
+                        " penstyle INTEGER,"
+                        " penwidth INTEGER,"
+                        " left INTEGER,"
+                        " top INTEGER,"
+                        " width INTEGER,"
+                        " height INTEGER"
+                        ");";
+        list << m;
+    }
+
+    // v2: журнал изменений (CDC). Триггеры пишут в rectangle_changes каждую вставку/правку/удаление
+    // с монотонным seq; для I/U сохраняется новое состояние строки, для D — старое.
+    {
+        Migration m;
+        m.version = 2;
+        m.description = "change data capture log";
+        m.statements
+                << "CREATE TABLE IF NOT EXISTS rectangle_changes ("
+                   " seq INTEGER PRIMARY KEY AUTOINCREMENT,"
+                   " op TEXT NOT NULL,"
+                   " row_id INTEGER NOT NULL,"
+                   " pencolor VARCHAR,"
+                   " penstyle INTEGER,"
+                   " penwidth INTEGER,"
+                   " left INTEGER,"
+                   " top INTEGER,"
+                   " width INTEGER,"
+                   " height INTEGER,"
+                   " changed_at INTEGER NOT NULL DEFAULT (CAST(strftime('%s', 'now') AS INTEGER))"
+                   ");"
+                << "CREATE TABLE IF NOT EXISTS cdc_cursor ("
+                   " consumer TEXT PRIMARY KEY,"
+                   " seq INTEGER NOT NULL"
+                   ");"
+                << cdcTriggerStatements();
+        list << m;
+    }
+
+    // v3: вычисляемые STORED-колонки геометрии с индексами для запросов по диапазонам
+    // ("площадь больше X", "правый край за пределами окна"). STORED-колонку не добавить
+    // через ALTER TABLE — нужна перестройка; триггеры журнала создаются заново.
+    {
+        Migration m;
+        m.version = 3;
+        m.description = "generated geometry columns (right, bottom, area)";
+        m.rebuild.table = "rectangle";
+        m.rebuild.createSql = "CREATE TABLE %1 ("
+                              " id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                              " pencolor VARCHAR,"
+                              " penstyle INTEGER,"
+                              " penwidth INTEGER,"
+                              " left INTEGER,"
+                              " top INTEGER,"
+                              " width INTEGER,"
+                              " height INTEGER,"
+                              " right INTEGER GENERATED ALWAYS AS (left + width) STORED,"
+                              " bottom INTEGER GENERATED ALWAYS AS (top + height) STORED,"
+                              " area INTEGER GENERATED ALWAYS AS (width * height) STORED"
+                              ");";
+        m.rebuild.targetColumns = "id, pencolor, penstyle, penwidth, left, top, width, height";
+        m.rebuild.sourceExpressions = m.rebuild.targetColumns;
+        m.statements << "CREATE INDEX IF NOT EXISTS rectangle_right_idx ON rectangle(right);"
+                     << "CREATE INDEX IF NOT EXISTS rectangle_bottom_idx ON rectangle(bottom);"
+                     << "CREATE INDEX IF NOT EXISTS rectangle_area_idx ON rectangle(area);"
+                     << cdcTriggerStatements();
+        list << m;
+    }
+
+    // v4: словарь цветов пера. Заполняется различными цветами таблицы (в нижнем регистре,
+    // как QColor::name()); id без AUTOINCREMENT — плотные и маленькие.
+    {
+        Migration m;
+        m.version = 4;
+        m.description = "pen color palette";
+        m.statements << "CREATE TABLE IF NOT EXISTS pen_palette ("
+                        " id INTEGER PRIMARY KEY,"
+                        " color VARCHAR NOT NULL UNIQUE"
+                        ");"
+                     << "INSERT OR IGNORE INTO pen_palette (color)"
+                        " SELECT DISTINCT lower(pencolor) FROM rectangle WHERE pencolor IS NOT NULL ORDER BY 1;";
+        list << m;
+    }
+
+    // v5: rectangle хранит pen_id (ссылка на pen_palette) вместо строки "#rrggbb".
+    // Журнал изменений по-прежнему пишет цвет строкой — триггеры берут его из словаря.
+    {
+        Migration m;
+        m.version = 5;
+        m.description = "pen color as palette id";
+        m.rebuild.table = "rectangle";
+        m.rebuild.createSql = "CREATE TABLE %1 ("
+                              " id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                              " pen_id INTEGER REFERENCES pen_palette(id),"
+                              " penstyle INTEGER,"
+                              " penwidth INTEGER,"
+                              " left INTEGER,"
+                              " top INTEGER,"
+                              " width INTEGER,"
+                              " height INTEGER,"
+                              " right INTEGER GENERATED ALWAYS AS (left + width) STORED,"
+                              " bottom INTEGER GENERATED ALWAYS AS (top + height) STORED,"
+                              " area INTEGER GENERATED ALWAYS AS (width * height) STORED"
+                              ");";
+        m.rebuild.targetColumns = "id, pen_id, penstyle, penwidth, left, top, width, height";
+        m.rebuild.sourceExpressions = "id, (SELECT p.id FROM pen_palette p WHERE p.color = lower(rectangle.pencolor)),"
+                                      " penstyle, penwidth, left, top, width, height";
+        // Цвета строк, вставленных или изменённых после v4 (другим процессом, во время копирования).
+        m.rebuild.prepareSql = "INSERT OR IGNORE INTO pen_palette (color)"
+                               " SELECT DISTINCT lower(pencolor) FROM rectangle"
+                               " WHERE pencolor IS NOT NULL AND (%1) ORDER BY 1;";
+        m.statements << "CREATE INDEX IF NOT EXISTS rectangle_right_idx ON rectangle(right);"
+                     << "CREATE INDEX IF NOT EXISTS rectangle_bottom_idx ON rectangle(bottom);"
+                     << "CREATE INDEX IF NOT EXISTS rectangle_area_idx ON rectangle(area);"
+                     << "CREATE INDEX IF NOT EXISTS rectangle_pen_idx ON rectangle(pen_id);"
+                     << cdcTriggerStatements("(SELECT color FROM pen_palette WHERE id = %1.pen_id)");
+        list << m;
+    }
+
+    // v6: отметки прогресса импорта (PipelineImporter). Пишутся в одной транзакции с порцией
+    // данных, поэтому прерванный импорт продолжается ровно с места остановки.
+    {
+        Migration m;
+        m.version = 6;
+        m.description = "import progress checkpoints";
+        m.statements << "CREATE TABLE IF NOT EXISTS import_progress ("
+                        " source TEXT PRIMARY KEY,"
+                        " file_size INTEGER NOT NULL,"
+                        " file_mtime INTEGER NOT NULL,"
+                        " byte_offset INTEGER NOT NULL,"
+                        " line_no INTEGER NOT NULL,"
+                        " batches INTEGER NOT NULL,"
+                        " row_count INTEGER NOT NULL,"
+                        " bad_lines INTEGER NOT NULL,"
+                        " done INTEGER NOT NULL DEFAULT 0,"
+                        " updated_at INTEGER NOT NULL DEFAULT (CAST(strftime('%s', 'now') AS INTEGER))"
+                        ");";
+        list << m;
+    }
+
+    return list;
+}
+
+int SchemaMigrator::latestVersion()
+{
+    const auto list = builtinMigrations();
+    return list.isEmpty() ? 0 : list.last().version;
+}
+
+int SchemaMigrator::currentVersion() const
+{
+    QSqlQuery q(m_db);
+    if (!q.exec("PRAGMA user_version;") || !q.next())
+        return -1;
+    return q.value(0).toInt();
+}
+
+int SchemaMigrator::targetVersion() const
+{
+    return m_migrations.isEmpty() ? 0 : m_migrations.last().version;
+}
+
+bool SchemaMigrator::migrate(int target, const ProgressFn& progress)
+{
+    m_lastError.clear();
+    if (target < 0)
+        target = targetVersion();
+
+    const int current = currentVersion();
+    if (current < 0)
+        return fail_("cannot read PRAGMA user_version: " + m_db.lastError().text());
+
+    for (const Migration& m : m_migrations) {
+        if (m.version <= current || m.version > target)
+            continue;
+
+        LAB2_INFO(lcDb()) << "migration: applying v" << m.version << m.description;
+        if (!apply_(m, progress)) {
+            LAB2_WARNING(lcDb()) << "migration: v" << m.version << "failed:" << m_lastError;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SchemaMigrator::apply_(const Migration& m, const ProgressFn& progress)
+{
+    const bool rebuild = !m.rebuild.table.isEmpty();
+    if (rebuild && !copyInBatches_(m, progress))
+        return false;
+
+    if (!begin_())
+        return fail_("BEGIN failed: " + m_db.lastError().text());
+
+    const auto abort = [this] {
+        m_db.rollback();
+        return false;
+    };
+
+    if (rebuild) {
+        const QString& table = m.rebuild.table;
+        const QString tmp = table + kRebuildSuffix;
+
+        const QString log = tmp + kRebuildLogSuffix;
+
+        // Догоняем старую таблицу: строки за последним скопированным id (вставленные, пока шло
+        // копирование порциями) и строки, которые триггеры отметили изменёнными или удалёнными.
+        bool ok = false;
+        const qint64 last = scalar_(QString("SELECT COALESCE(MAX(id), 0) FROM %1;").arg(tmp), &ok);
+        if (!ok) return abort();
+
+        const QString pending = QString("id > %1 OR id IN (SELECT row_id FROM %2)").arg(last).arg(log);
+        if (!exec_(QString("DELETE FROM %1 WHERE id IN (SELECT row_id FROM %2);").arg(tmp, log)))
+            return abort();
+        if (!m.rebuild.prepareSql.isEmpty() && !exec_(m.rebuild.prepareSql.arg(pending)))
+            return abort();
+        if (!exec_(QString("INSERT INTO %1 (%2) SELECT %3 FROM %4 WHERE %5 ORDER BY id;")
+                   .arg(tmp, m.rebuild.targetColumns, m.rebuild.sourceExpressions, table, pending)))
+            return abort();
+
+        // Счётчик AUTOINCREMENT старой таблицы: новая таблица знает только MAX(id) скопированных
+        // строк, и без переноса id удалённых "хвостовых" строк были бы выданы повторно.
+        const qint64 hasSequence =
+                scalar_("SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = 'sqlite_sequence';", &ok);
+        if (!ok) return abort();
+        qint64 sequence = -1;
+        if (hasSequence > 0) {
+            sequence = scalar_(QString("SELECT COALESCE((SELECT seq FROM sqlite_sequence WHERE name = '%1'), -1);")
+                               .arg(table), &ok);
+            if (!ok) return abort();
+        }
+
+        // Триггеры отметок удаляются вместе со старой таблицей.
+        if (!exec_(QString("DROP TABLE %1;").arg(table))) return abort();
+        if (!exec_(QString("DROP TABLE %1;").arg(log))) return abort();
+        if (!exec_(QString("ALTER TABLE %1 RENAME TO %2;").arg(tmp, table))) return abort();
+
+        if (sequence >= 0) {
+            if (!exec_(QString("UPDATE sqlite_sequence SET seq = MAX(seq, %2) WHERE name = '%1';")
+                       .arg(table).arg(sequence)))
+                return abort();
+            if (!exec_(QString("INSERT INTO sqlite_sequence (name, seq) SELECT '%1', %2"
+                               " WHERE NOT EXISTS (SELECT 1 FROM sqlite_sequence WHERE name = '%1');")
+                       .arg(table).arg(sequence)))
+                return abort();
+        }
+    }
+
+    for (const QString& sql : m.statements) {
+        if (!exec_(sql)) return abort();
+    }
+
+    if (!exec_(QString("PRAGMA user_version = %1;").arg(m.version))) return abort();
+
+    if (!commit_()) {
+        fail_("COMMIT failed: " + m_db.lastError().text());
+        return abort();
+    }
+    return true;
+}
+
+bool SchemaMigrator::copyInBatches_(const Migration& m, const ProgressFn& progress)
+{
+    const QString& table = m.rebuild.table;
+    const QString tmp = table + kRebuildSuffix;
+
+    if (!m_db.tables().contains(table))
+        return fail_("table to rebuild does not exist: " + table);
+
+    const QString log = tmp + kRebuildLogSuffix;
+
+    // Временная таблица уже есть — значит, прошлый запуск прервался: продолжаем с места остановки.
+    // Без таблицы отметок изменений (перестройку начала старая версия) неизвестно, какие
+    // скопированные строки устарели, — копируем заново.
+    const QStringList tables = m_db.tables();
+    if (tables.contains(tmp) && tables.contains(log)) {
+        LAB2_INFO(lcDb()) << "migration: resuming rebuild of" << table;
+    } else {
+        if (tables.contains(tmp) && !exec_(QString("DROP TABLE %1;").arg(tmp)))
+            return false;
+        if (!createRebuildTables_(m))
+            return false;
+    }
+
+    bool ok = false;
+    const qint64 total = scalar_(QString("SELECT COUNT(*) FROM %1;").arg(table), &ok);
+    if (!ok) return false;
+    qint64 done = scalar_(QString("SELECT COUNT(*) FROM %1;").arg(tmp), &ok);
+    if (!ok) return false;
+    qint64 last = scalar_(QString("SELECT COALESCE(MAX(id), 0) FROM %1;").arg(tmp), &ok);
+    if (!ok) return false;
+
+    QSqlQuery copy(m_db);
+    if (!copy.prepare(QString("INSERT INTO %1 (%2) SELECT %3 FROM %4 WHERE id > ? ORDER BY id LIMIT ?;")
+                      .arg(tmp, m.rebuild.targetColumns, m.rebuild.sourceExpressions, table)))
+        return fail_("prepare batch copy failed: " + copy.lastError().text());
+
+    if (progress) progress(m.version, done, total);
+
+    for (;;) {
+        if (!begin_())
+            return fail_("BEGIN failed: " + m_db.lastError().text());
+
+        if (!m.rebuild.prepareSql.isEmpty()
+                && !exec_(m.rebuild.prepareSql.arg(QString("id IN (SELECT id FROM %1 WHERE id > %2 ORDER BY id LIMIT %3)")
+                                                   .arg(table).arg(last).arg(m_batchSize)))) {
+            m_db.rollback();
+            return false;
+        }
+
+        copy.bindValue(0, last);
+        copy.bindValue(1, m_batchSize);
+        if (!copy.exec()) {
+            const QString err = copy.lastError().text();
+            m_db.rollback();
+            return fail_("batch copy failed: " + err);
+        }
+        const int copied = copy.numRowsAffected();
+
+        last = scalar_(QString("SELECT COALESCE(MAX(id), 0) FROM %1;").arg(tmp), &ok);
+        if (!ok || !commit_()) {
+            m_db.rollback();
+            return fail_("batch commit failed: " + m_db.lastError().text());
+        }
+
+        done += copied;
+        if (progress) progress(m.version, done, total);
+
+        if (copied < m_batchSize)
+            break;
+    }
+    return true;
+}
+
+bool SchemaMigrator::createRebuildTables_(const Migration& m)
+{
+    const QString& table = m.rebuild.table;
+    const QString tmp = table + kRebuildSuffix;
+    const QString log = tmp + kRebuildLogSuffix;
+
+    // Копия, таблица отметок и триггеры появляются одной транзакцией: ни одна правка
+    // старой таблицы не проходит мимо отметок. Триггеры обычные (не TEMP), поэтому
+    // срабатывают и на запись из других соединений и процессов.
+    if (!begin_())
+        return fail_("BEGIN failed: " + m_db.lastError().text());
+
+    const QString mark = QString("INSERT OR IGNORE INTO %1 (row_id) VALUES (%2.id);").arg(log);
+    const QStringList sql {
+        m.rebuild.createSql.arg(tmp),
+        QString("CREATE TABLE IF NOT EXISTS %1 (row_id INTEGER PRIMARY KEY);").arg(log),
+        QString("CREATE TRIGGER IF NOT EXISTS %1_update AFTER UPDATE ON %2 BEGIN %3 %4 END;")
+                .arg(tmp, table, mark.arg("OLD"), mark.arg("NEW")),
+        QString("CREATE TRIGGER IF NOT EXISTS %1_delete AFTER DELETE ON %2 BEGIN %3 END;")
+                .arg(tmp, table, mark.arg("OLD")),
+        QString("CREATE TRIGGER IF NOT EXISTS %1_insert AFTER INSERT ON %2 BEGIN %3 END;")
+                .arg(tmp, table, mark.arg("NEW")),
+    };
+    for (const QString& s : sql) {
+        if (!exec_(s)) {
+            m_db.rollback();
+            return false;
+        }
+    }
+    if (!commit_()) {
+        const QString err = m_db.lastError().text();
+        m_db.rollback();
+        return fail_("COMMIT failed: " + err);
+    }
+    return true;
+}
+
+bool SchemaMigrator::begin_()
+{
+    return m_retry ? m_retry->transaction(m_db) : m_db.transaction();
+}
+
+bool SchemaMigrator::commit_()
+{
+    return m_retry ? m_retry->commit(m_db) : m_db.commit();
+}
+
+bool SchemaMigrator::exec_(const QString& sql)
+{
+    QSqlQuery q(m_db);
+    if (!q.exec(sql))
+        return fail_(QString("%1 -> %2").arg(sql, q.lastError().text()));
+    return true;
+}
+
+qint64 SchemaMigrator::scalar_(const QString& sql, bool* ok)
+{
+    QSqlQuery q(m_db);
+    const bool good = q.exec(sql) && q.next();
+    if (ok) *ok = good;
+    if (!good) {
+        fail_(QString("%1 -> %2").arg(sql, q.lastError().text()));
+        return 0;
+    }
+    return q.value(0).toLongLong();
+}
+
+bool SchemaMigrator::fail_(const QString& what)
+{
+    m_lastError = what;
+    return false;
+}
@@ -0,0 +1,137 @@
+#ifndef SCHEMAMIGRATOR_H
+#define SCHEMAMIGRATOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <QtSql/QSqlDatabase>
+
+#include <functional>
+
+class BusyRetry;
+
+/**
+ * @brief Версионные миграции схемы БД (версия хранится в PRAGMA user_version).
+ *
+ * Вместо "DROP + CREATE" схема доводится до нужной версии последовательностью миграций.
+ * Миграция бывает двух видов:
+ *  - простая: набор SQL-команд (CREATE INDEX, ALTER TABLE ADD COLUMN, ...) в одной транзакции;
+ *  - перестройка таблицы (rebuild): для изменений, которые SQLite не умеет делать через ALTER
+ *    (смена типа, STORED-колонки, новые ограничения).
+ *
+ * Перестройка выполняется порциями, чтобы не держать блокировку на всё время копирования:
+ *  1) одной транзакцией: CREATE TABLE <table>__migrating с новой схемой, таблица отметок
+ *     <table>__migrating_log и триггеры на старой таблице, которые отмечают в ней id каждой
+ *     вставленной, изменённой или удалённой строки (с любого соединения);
+ *  2) копирование строк по возрастанию id порциями batchSize, каждая порция — своя транзакция,
+ *     между порциями другие соединения могут читать и писать старую таблицу; после каждой порции — progress;
+ *  3) короткая финальная транзакция: отмеченные строки удаляются из копии и копируются заново
+ *     (удалённые — просто исчезают), докопируются строки за последним скопированным id,
+ *     DROP старой таблицы и таблицы отметок, RENAME новой, перенос счётчика AUTOINCREMENT
+ *     (sqlite_sequence), statements миграции, user_version.
+ *
+ * Индексы и триггеры старой таблицы удаляются вместе с ней — миграция с перестройкой
+ * должна создать их заново в statements (например, триггеры журнала изменений rectangle_changes).
+ *
+ * Если процесс прервался на шаге 2, при следующем запуске копирование продолжится
+ * с MAX(id) уже перенесённых строк — без потерь и дублей: триггеры отметок живут в файле БД
+ * и продолжают работать и между запусками.
+ */
+class SchemaMigrator
+{
+public:
+    /// Прогресс копирования: версия миграции, скопировано строк, всего строк.
+    using ProgressFn = std::function<void(int version, qint64 done, qint64 total)>;
+
+    /// Описание перестройки таблицы.
+    struct Rebuild
+    {
+        /// Перестраиваемая таблица (первичный ключ — INTEGER id).
+        QString table;
+        /// CREATE TABLE с плейсхолдером %1 вместо имени таблицы.
+        QString createSql;
+        /// Список колонок новой таблицы, в которые копируются данные.
+        QString targetColumns;
+        /// Выражения над старой таблицей в том же порядке (можно CAST и т.п.).
+        QString sourceExpressions;
+        /// Необязательная команда перед каждым копированием (порция и догоняющая копия) в той же
+        /// транзакции; %1 — условие на строки старой таблицы, которые сейчас будут скопированы.
+        /// Например, дополнить словарь, на который ссылаются sourceExpressions.
+        QString prepareSql;
+    };
+
+    /// Одна миграция: переводит схему из version-1 в version.
+    struct Migration
+    {
+        int version = 0;
+        QString description;
+        /// Если rebuild.table не пуст — перестройка таблицы перед statements.
+        Rebuild rebuild;
+        /// Команды, выполняемые в той же транзакции, что и запись user_version.
+        QStringList statements;
+    };
+
+    /// Размер порции копирования по умолчанию (строк).
+    static constexpr int kDefaultBatchSize = 10000;
+
+    /// Суффикс временной таблицы при перестройке.
+    static constexpr const char* kRebuildSuffix = "__migrating";
+
+    /// Суффикс (к имени временной таблицы) таблицы отметок строк, изменённых во время перестройки.
+    static constexpr const char* kRebuildLogSuffix = "_log";
+
+    /// Мигратор со встроенным списком миграций (builtinMigrations()).
+    explicit SchemaMigrator(QSqlDatabase db);
+
+    /// Мигратор с произвольным списком (для тестов и утилит). Версии должны идти по возрастанию с 1.
+    SchemaMigrator(QSqlDatabase db, QVector<Migration> migrations);
+
+    /// Миграции схемы таблицы rectangle.
+    static QVector<Migration> builtinMigrations();
+
+    /// Последняя версия встроенной схемы.
+    static int latestVersion();
+
+    /// Текущая версия (PRAGMA user_version) или -1 при ошибке.
+    int currentVersion() const;
+
+    /// Версия последней миграции в списке этого мигратора.
+    int targetVersion() const;
+
+    /**
+     * @brief Применяет все миграции с версией > currentVersion() и <= target.
+     * @param target Целевая версия (-1 — последняя).
+     * @param progress Колбэк прогресса перестроек (может быть пустым).
+     * @return true если схема доведена до target. При ошибке текущая миграция откатывается.
+     */
+    bool migrate(int target = -1, const ProgressFn& progress = {});
+
+    void setBatchSize(int rows) { m_batchSize = rows > 0 ? rows : kDefaultBatchSize; }
+
+    /// Повтор BEGIN/COMMIT миграции и порций копирования при SQLITE_BUSY (nullptr — без повтора).
+    void setBusyRetry(BusyRetry* retry) { m_retry = retry; }
+    int batchSize() const { return m_batchSize; }
+
+    /// Текст последней ошибки.
+    QString lastError() const { return m_lastError; }
+
+private:
+    bool apply_(const Migration& m, const ProgressFn& progress);
+    bool copyInBatches_(const Migration& m, const ProgressFn& progress);
+    bool createRebuildTables_(const Migration& m);
+    bool begin_();
+    bool commit_();
+    bool exec_(const QString& sql);
+    qint64 scalar_(const QString& sql, bool* ok = nullptr);
+    bool fail_(const QString& what);
+
+private:
+    QSqlDatabase m_db;
+    QVector<Migration> m_migrations;
+    BusyRetry* m_retry = nullptr;
+    int m_batchSize = kDefaultBatchSize;
+    QString m_lastError;
+};
+
+#endif // SCHEMAMIGRATOR_H
@@ -0,0 +1,27 @@
+#include "scopedconnection.h"
+
+#include <QtSql/QSqlError>
+
+#include <atomic>
+
+ScopedConnection::ScopedConnection(const QString& dbPath, const QString& prefix, bool readOnly)
+{
+    static std::atomic<int> counter { 0 };
+    m_name = QString("%1_%2").arg(prefix).arg(++counter);
+
+    m_db = QSqlDatabase::addDatabase("QSQLITE", m_name);
+    m_db.setDatabaseName(dbPath);
+    if (readOnly)
+        m_db.setConnectOptions("QSQLITE_OPEN_READONLY");
+
+    if (!m_db.open())
+        m_error = m_db.lastError().text();
+}
+
+ScopedConnection::~ScopedConnection()
+{
+    if (m_db.isOpen())
+        m_db.close();
+    m_db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(m_name);
+}
@@ -0,0 +1,46 @@
+#ifndef SCOPEDCONNECTION_H
+#define SCOPEDCONNECTION_H
+
+#include <QString>
+
+#include <QtSql/QSqlDatabase>
+
+/**
+ * @brief Временное собственное соединение с SQLite-файлом (RAII).
+ *
+ * QSqlDatabase нельзя использовать из другого потока, поэтому фоновые задачи
+ * (снимки, параллельные сканы, сравнение БД) открывают своё соединение с уникальным именем.
+ * Деструктор закрывает соединение и удаляет его из реестра QSqlDatabase.
+ *
+ * @note Все QSqlQuery по db() должны быть разрушены раньше ScopedConnection.
+ */
+class ScopedConnection
+{
+public:
+    /**
+     * @param dbPath Путь к файлу SQLite.
+     * @param prefix Префикс имени соединения (для диагностики).
+     * @param readOnly Открыть только для чтения (QSQLITE_OPEN_READONLY).
+     */
+    explicit ScopedConnection(const QString& dbPath,
+                              const QString& prefix = "worker",
+                              bool readOnly = false);
+    ~ScopedConnection();
+
+    ScopedConnection(const ScopedConnection&) = delete;
+    ScopedConnection& operator=(const ScopedConnection&) = delete;
+
+    bool isOpen() const { return m_db.isOpen(); }
+    QSqlDatabase& db() { return m_db; }
+    QString name() const { return m_name; }
+
+    /// Ошибка открытия (пусто, если соединение открыто).
+    QString error() const { return m_error; }
+
+private:
+    QString m_name;
+    QSqlDatabase m_db;
+    QString m_error;
+};
+
+#endif // SCOPEDCONNECTION_H
@@ -0,0 +1,45 @@
+#include "snapshotrefresher.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "rectsnapshot.h"
+#include "scopedconnection.h"
+
+SnapshotRefresher::SnapshotRefresher(const QString& dbPath, const QString& snapshotPath, QObject* parent)
+    : QObject(parent)
+    , m_dbPath(dbPath)
+    , m_snapshotPath(snapshotPath)
+{
+    connect(&m_watcher, &QFutureWatcher<Result>::finished, this, [this] {
+        const Result r = m_watcher.result();
+        emit finished(r.ok, r.tmpPath, r.error);
+    });
+}
+
+SnapshotRefresher::~SnapshotRefresher()
+{
+    m_watcher.waitForFinished();
+}
+
+bool SnapshotRefresher::start()
+{
+    if (m_watcher.isRunning())
+        return false;
+
+    const QString dbPath = m_dbPath;
+    const QString tmp = tmpPath();
+
+    m_watcher.setFuture(QtConcurrent::run([dbPath, tmp] {
+        Result r;
+        r.tmpPath = tmp;
+
+        ScopedConnection conn(dbPath, "snapshot", true);
+        if (!conn.isOpen()) {
+            r.error = "cannot open " + dbPath + ": " + conn.error();
+            return r;
+        }
+        r.ok = RectSnapshot::write(conn.db(), tmp, &r.error);
+        return r;
+    }));
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef SNAPSHOTREFRESHER_H
+#define SNAPSHOTREFRESHER_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+
+/**
+ * @brief Пересоздаёт снимок RectSnapshot в фоновом потоке.
+ *
+ * Задача открывает собственное соединение (ScopedConnection) с файлом БД и пишет снимок
+ * во временный файл "<snapshot>.tmp". Замена основного файла — за получателем сигнала finished()
+ * (в GUI-потоке): сначала закрыть открытый снимок, затем RectSnapshot::replaceFile().
+ *
+ * Пока задача идёт, повторный start() игнорируется (см. isRunning()).
+ */
+class SnapshotRefresher : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Результат фоновой записи.
+    struct Result
+    {
+        bool ok = false;
+        QString tmpPath;
+        QString error;
+    };
+
+    SnapshotRefresher(const QString& dbPath, const QString& snapshotPath, QObject* parent = nullptr);
+    ~SnapshotRefresher() override;
+
+    QString snapshotPath() const { return m_snapshotPath; }
+    QString tmpPath() const { return m_snapshotPath + ".tmp"; }
+
+    bool isRunning() const { return m_watcher.isRunning(); }
+
+    /// Запускает фоновую запись. @return false, если запись уже идёт.
+    bool start();
+
+    /// Ожидает завершения текущей записи (используется при закрытии окна).
+    void waitForFinished() { m_watcher.waitForFinished(); }
+
+signals:
+    /// Запись завершена (в потоке владельца объекта).
+    void finished(bool ok, const QString& tmpPath, const QString& error);
+
+private:
+    QString m_dbPath;
+    QString m_snapshotPath;
+    QFutureWatcher<Result> m_watcher;
+};
+
+#endif // SNAPSHOTREFRESHER_H
@@ -0,0 +1,75 @@
+#include "snapshottablemodel.h"
+
+#include <QColor>
+
+#include <limits>
+
+#include "rectangleschema.h"
+
+SnapshotTableModel::SnapshotTableModel(QObject* parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+bool SnapshotTableModel::load(const QString& path, QString* error)
+{
+    beginResetModel();
+    const bool ok = m_snapshot.open(path, error);
+    endResetModel();
+    return ok;
+}
+
+void SnapshotTableModel::unload()
+{
+    beginResetModel();
+    m_snapshot.close();
+    endResetModel();
+}
+
+int SnapshotTableModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    // QAbstractItemModel ограничен int; снимки больше 2^31 строк не показываются целиком.
+    return int(qMin<qint64>(m_snapshot.rowCount(), std::numeric_limits<int>::max()));
+}
+
+int SnapshotTableModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : RectSnapshot::ColumnCount;
+}
+
+QVariant SnapshotTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || !m_snapshot.isOpen())
+        return {};
+    if (role != Qt::DisplayRole && role != Qt::EditRole)
+        return {};
+
+    const qint64 row = index.row();
+    switch (index.column()) {
+    case RectSnapshot::Id:
+        return m_snapshot.ids()[row];
+    case RectSnapshot::PenColor:
+        // Как в БД: строка "#rrggbb" (её понимает MyDelegate).
+        return QColor::fromRgb(m_snapshot.penColors()[row]).name();
+    default:
+        return m_snapshot.intColumn(static_cast<RectSnapshot::Column>(index.column()))[row];
+    }
+}
+
+QVariant SnapshotTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    // Колонки снимка совпадают с первыми колонками схемы (static_assert в rectsnapshot.cpp).
+    if (section < 0 || section >= RectSnapshot::ColumnCount)
+        return {};
+    return QString(rectschema::kColumns[section].header);
+}
+
+Qt::ItemFlags SnapshotTableModel::flags(const QModelIndex& index) const
+{
+    if (!index.isValid()) return Qt::NoItemFlags;
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
@@ -0,0 +1,40 @@
+#ifndef SNAPSHOTTABLEMODEL_H
+#define SNAPSHOTTABLEMODEL_H
+
+#include <QAbstractTableModel>
+
+#include "rectsnapshot.h"
+
+/**
+ * @brief Модель "только чтение" поверх снимка RectSnapshot.
+ *
+ * Колонки и заголовки те же, что у RectangleTableModel, поэтому tableView и делегаты
+ * работают с ней без изменений. data() читает значение прямо из отображённого файла:
+ * нет ни SQL, ни кэша строк, ни fetchMore() — вся таблица доступна сразу.
+ */
+class SnapshotTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit SnapshotTableModel(QObject* parent = nullptr);
+
+    /// Открывает снимок (предыдущий закрывается). Модель сбрасывается.
+    bool load(const QString& path, QString* error = nullptr);
+
+    /// Закрывает снимок (модель становится пустой), например перед заменой файла.
+    void unload();
+
+    const RectSnapshot& snapshot() const { return m_snapshot; }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+private:
+    RectSnapshot m_snapshot;
+};
+
+#endif // SNAPSHOTTABLEMODEL_H
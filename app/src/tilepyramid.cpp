@@ -0,0 +1,424 @@
+#include "tilepyramid.h"
+
+#include <QAtomicInt>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFuture>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QPainter>
+#include <QSaveFile>
+#include <QSet>
+#include <QThread>
+#include <QVector>
+
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <cmath>
+#include <limits>
+
+#include "logger.h"
+#include "rectsnapshot.h"
+
+namespace {
+
+/// Меньше стольких строк на часть — отдельный поток не окупается.
+constexpr qint64 kMinRowsPerPart = 64 * 1024;
+
+/// Тайл уровня: номер в сетке 2^z x 2^z и хеш содержимого.
+struct Tile
+{
+    int x = 0;
+    int y = 0;
+    QByteArray hash;
+};
+
+quint64 tileCode(int x, int y)
+{
+    return (quint64(quint32(x)) << 32) | quint32(y);
+}
+
+QString tileKey(int level, int x, int y)
+{
+    return QString("%1/%2/%3").arg(level).arg(x).arg(y);
+}
+
+/// Строка снимка в том виде, в каком она входит в хеш тайла.
+struct HashedRow
+{
+    qint64 id;
+    quint32 color;
+    qint32 style, penWidth, left, top, width, height;
+};
+
+/// threads рабочих по очереди берут индексы [0, n) и вызывают fn(i).
+template <typename Fn>
+void runWorkers(int threads, int n, Fn fn)
+{
+    QAtomicInt next(0);
+    QAtomicInt* nextPtr = &next;
+    QVector<QFuture<void>> futures;
+    const int workers = qMin(threads, n);
+    futures.reserve(workers);
+    for (int w = 0; w < workers; ++w) {
+        futures.append(QtConcurrent::run([nextPtr, n, fn] {
+            for (int i = nextPtr->fetchAndAddRelaxed(1); i < n; i = nextPtr->fetchAndAddRelaxed(1))
+                fn(i);
+        }));
+    }
+    for (QFuture<void>& f : futures)
+        f.waitForFinished();
+}
+
+/// Первая ошибка рабочих потоков.
+class FirstError
+{
+public:
+    void set(const QString& error)
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_error.isEmpty())
+            m_error = error;
+    }
+
+    QString get()
+    {
+        QMutexLocker lock(&m_mutex);
+        return m_error;
+    }
+
+private:
+    QMutex m_mutex;
+    QString m_error;
+};
+
+Qt::PenStyle penStyleOf(qint32 v)
+{
+    return v >= Qt::NoPen && v <= Qt::DashDotDotLine ? Qt::PenStyle(v) : Qt::SolidLine;
+}
+
+} // namespace
+
+TilePyramid::TilePyramid(const QString& outDir, int threads)
+    : m_outDir(outDir)
+    , m_threads(threads > 0 ? threads : qMax(1, QThread::idealThreadCount()))
+{
+}
+
+QString TilePyramid::tilePath(int level, int x, int y)
+{
+    return tileKey(level, x, y) + ".png";
+}
+
+TilePyramid::Stats TilePyramid::exportSnapshot(const RectSnapshot& snapshot)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Stats st;
+    if (!snapshot.isOpen()) {
+        st.error = "snapshot is not open";
+        return st;
+    }
+    if (snapshot.rowCount() > qint64(std::numeric_limits<quint32>::max())) {
+        st.error = "snapshot has too many rows";
+        return st;
+    }
+    const QDir out(m_outDir);
+    if (!out.mkpath(".")) {
+        st.error = "cannot create " + m_outDir;
+        return st;
+    }
+
+    const qint64 rowCount = snapshot.rowCount();
+    const qint64* ids = snapshot.ids();
+    const quint32* colors = snapshot.penColors();
+    const qint32* styles = snapshot.intColumn(RectSnapshot::PenStyle);
+    const qint32* penWidths = snapshot.intColumn(RectSnapshot::PenWidth);
+    const qint32* lefts = snapshot.intColumn(RectSnapshot::Left);
+    const qint32* tops = snapshot.intColumn(RectSnapshot::Top);
+    const qint32* widths = snapshot.intColumn(RectSnapshot::Width);
+    const qint32* heights = snapshot.intColumn(RectSnapshot::Height);
+
+    // 1. Область: охват видимых строк с запасом на перо, квадрат.
+    double minX = std::numeric_limits<double>::max(), minY = minX;
+    double maxX = std::numeric_limits<double>::lowest(), maxY = maxX;
+    qint32 maxPen = 0;
+    for (qint64 i = 0; i < rowCount; ++i) {
+        if (styles[i] == Qt::NoPen) continue;
+        const double l = lefts[i], t = tops[i];
+        const double r = l + widths[i], b = t + heights[i];
+        minX = qMin(minX, qMin(l, r));
+        maxX = qMax(maxX, qMax(l, r));
+        minY = qMin(minY, qMin(t, b));
+        maxY = qMax(maxY, qMax(t, b));
+        maxPen = qMax(maxPen, penWidths[i]);
+        ++st.rows;
+    }
+    if (st.rows == 0)
+        minX = minY = maxX = maxY = 0;
+
+    const double margin = maxPen / 2.0 + 1;
+    const double ox = minX - margin;
+    const double oy = minY - margin;
+    const double side = qMax(maxX - minX, maxY - minY) + 2 * margin;
+    int deepest = 0;
+    while (deepest < m_maxLevel && side / double(1 << deepest) > m_tileSize)
+        ++deepest;
+    const int n = 1 << deepest;
+    const double tileWorld = side / n;
+    const int ts = m_tileSize;
+    st.levels = deepest + 1;
+
+    QJsonObject grid;
+    grid["tileSize"] = ts;
+    grid["levels"] = st.levels;
+    grid["origin"] = QJsonArray { ox, oy };
+    grid["side"] = side;
+    // Хеши зависят от сетки: другой размер тайла или область — другие хеши.
+    const QByteArray salt = QJsonDocument(grid).toJson(QJsonDocument::Compact);
+
+    // 2. Строки -> тайлы нижнего уровня, которых касаются стороны прямоугольника.
+    const auto tileOf = [=](double v, double origin) {
+        return qBound(0, int(std::floor((v - origin) / tileWorld)), n - 1);
+    };
+    const int parts = int(qBound<qint64>(1, rowCount / kMinRowsPerPart, m_threads));
+    QVector<QVector<quint64>> pairs(parts);  // (тайл << 32) | строка, строки по возрастанию
+    {
+        QVector<QFuture<void>> futures;
+        for (int p = 0; p < parts; ++p) {
+            QVector<quint64>* dst = &pairs[p];
+            const qint64 begin = rowCount * p / parts;
+            const qint64 end = rowCount * (p + 1) / parts;
+            futures.append(QtConcurrent::run([=] {
+                for (qint64 i = begin; i < end; ++i) {
+                    if (styles[i] == Qt::NoPen) continue;
+                    const double hw = qMax(1, penWidths[i]) / 2.0 + 1;
+                    const double l = lefts[i], r = l + widths[i];
+                    const double t = tops[i], b = t + heights[i];
+                    const double x0 = qMin(l, r), x1 = qMax(l, r);
+                    const double y0 = qMin(t, b), y1 = qMax(t, b);
+
+                    const int tx0 = tileOf(x0 - hw, ox), tx1 = tileOf(x1 + hw, ox);
+                    const int ty0 = tileOf(y0 - hw, oy), ty1 = tileOf(y1 + hw, oy);
+                    // Полосы сторон: внутренние тайлы контура не касаются.
+                    const int topBand = tileOf(y0 + hw, oy), bottomBand = tileOf(y1 - hw, oy);
+                    const int leftBand = tileOf(x0 + hw, ox), rightBand = tileOf(x1 - hw, ox);
+
+                    const auto add = [&](int tx, int ty) { dst->append((quint64(ty * n + tx) << 32) | quint64(i)); };
+                    for (int ty = ty0; ty <= ty1; ++ty) {
+                        if (ty <= topBand || ty >= bottomBand || leftBand + 1 >= rightBand) {
+                            for (int tx = tx0; tx <= tx1; ++tx) add(tx, ty);
+                        } else {
+                            for (int tx = tx0; tx <= leftBand; ++tx) add(tx, ty);
+                            for (int tx = rightBand; tx <= tx1; ++tx) add(tx, ty);
+                        }
+                    }
+                }
+            }));
+        }
+        for (QFuture<void>& f : futures)
+            f.waitForFinished();
+    }
+
+    // Сортировка подсчётом по тайлам; порядок строк (порядок рисования) внутри тайла сохраняется.
+    QVector<quint32> start(n * n + 1, 0);
+    for (const QVector<quint64>& part : pairs)
+        for (quint64 pair : part)
+            ++start[int(pair >> 32) + 1];
+    for (int t = 0; t < n * n; ++t)
+        start[t + 1] += start[t];
+    QVector<quint32> order(int(start.last()));
+    {
+        QVector<quint32> fill = start;
+        for (QVector<quint64>& part : pairs) {
+            for (quint64 pair : part)
+                order[int(fill[int(pair >> 32)]++)] = quint32(pair);
+            part = QVector<quint64>();
+        }
+    }
+
+    // 3. Хеши: нижний уровень — по строкам тайла, верхние — по хешам детей.
+    QVector<QVector<Tile>> levels(st.levels);
+    QVector<Tile>& leaves = levels[deepest];
+    for (int t = 0; t < n * n; ++t) {
+        if (start[t] != start[t + 1])
+            leaves.append(Tile { t % n, t / n, QByteArray() });
+    }
+    runWorkers(m_threads, leaves.size(), [&, deepest](int k) {
+        Tile& tile = leaves[k];
+        QCryptographicHash h(QCryptographicHash::Md5);
+        h.addData(salt);
+        h.addData(tileKey(deepest, tile.x, tile.y).toUtf8());
+        const int t = tile.y * n + tile.x;
+        for (quint32 j = start[t]; j < start[t + 1]; ++j) {
+            const quint32 i = order[int(j)];
+            const HashedRow r { ids[i], colors[i], styles[i], penWidths[i], lefts[i], tops[i], widths[i], heights[i] };
+            h.addData(reinterpret_cast<const char*>(&r), sizeof(r));
+        }
+        tile.hash = h.result().toHex();
+    });
+
+    QVector<QHash<quint64, int>> index(st.levels);
+    for (int k = 0; k < leaves.size(); ++k)
+        index[deepest].insert(tileCode(leaves[k].x, leaves[k].y), k);
+    for (int z = deepest - 1; z >= 0; --z) {
+        for (const Tile& child : levels[z + 1]) {
+            const quint64 code = tileCode(child.x / 2, child.y / 2);
+            if (!index[z].contains(code)) {
+                index[z].insert(code, levels[z].size());
+                levels[z].append(Tile { child.x / 2, child.y / 2, QByteArray() });
+            }
+        }
+        for (Tile& tile : levels[z]) {
+            QCryptographicHash h(QCryptographicHash::Md5);
+            h.addData(salt);
+            h.addData(tileKey(z, tile.x, tile.y).toUtf8());
+            for (int d = 0; d < 4; ++d) {
+                const int c = index[z + 1].value(tileCode(2 * tile.x + d % 2, 2 * tile.y + d / 2), -1);
+                h.addData(c >= 0 ? levels[z + 1][c].hash : QByteArray("-"));
+            }
+            tile.hash = h.result().toHex();
+        }
+    }
+
+    // 4. Что перерисовать. Манифест сначала теряет записи этих тайлов: прерванный экспорт
+    //    не оставит тайл, чей файл новее записи в манифесте.
+    const QHash<QString, QByteArray> previous = readManifest_();
+    QHash<QString, QByteArray> current;
+    QHash<QString, QByteArray> trusted = previous;
+    QVector<QVector<int>> work(st.levels);
+    for (int z = 0; z <= deepest; ++z) {
+        for (int k = 0; k < levels[z].size(); ++k) {
+            const Tile& tile = levels[z][k];
+            const QString key = tileKey(z, tile.x, tile.y);
+            current.insert(key, tile.hash);
+            if (previous.value(key) == tile.hash && QFile::exists(out.filePath(key + ".png"))) {
+                ++st.tilesSkipped;
+            } else {
+                work[z].append(k);
+                trusted.remove(key);
+            }
+        }
+    }
+    if (trusted.size() != previous.size() && !writeManifest_(grid, trusted, &st.error))
+        return st;
+
+    // 5. Рисование: нижний уровень из строк, выше — из четырёх детей; потоки берут тайлы по очереди.
+    FirstError firstError;
+    for (int z = deepest; z >= 0; --z) {
+        const QVector<Tile>& tiles = levels[z];
+        const QVector<int>& todo = work[z];
+
+        QSet<int> columns;
+        for (int k : todo)
+            columns.insert(tiles[k].x);
+        for (int x : columns) {
+            if (!out.mkpath(QString("%1/%2").arg(z).arg(x))) {
+                st.error = QString("cannot create %1/%2 in %3").arg(z).arg(x).arg(m_outDir);
+                return st;
+            }
+        }
+
+        runWorkers(m_threads, todo.size(), [&, z](int w) {
+            const Tile& tile = tiles[todo[w]];
+            QImage img(ts, ts, QImage::Format_ARGB32_Premultiplied);
+            img.fill(Qt::transparent);
+            {
+                QPainter p(&img);
+                if (z == deepest) {
+                    p.scale(ts / tileWorld, ts / tileWorld);
+                    p.translate(-(ox + tile.x * tileWorld), -(oy + tile.y * tileWorld));
+                    p.setBrush(Qt::NoBrush);
+
+                    QPen pen;
+                    p.setPen(pen);
+                    const int t = tile.y * n + tile.x;
+                    for (quint32 j = start[t]; j < start[t + 1]; ++j) {
+                        const quint32 i = order[int(j)];
+                        const QColor color = QColor::fromRgb(colors[i]);
+                        if (pen.color() != color || pen.width() != penWidths[i] || pen.style() != penStyleOf(styles[i])) {
+                            pen = QPen(color, penWidths[i], penStyleOf(styles[i]));
+                            p.setPen(pen);
+                        }
+                        p.drawRect(QRectF(lefts[i], tops[i], widths[i], heights[i]));
+                    }
+                } else {
+                    p.setRenderHint(QPainter::SmoothPixmapTransform);
+                    const double half = ts / 2.0;
+                    for (int d = 0; d < 4; ++d) {
+                        const int cx = 2 * tile.x + d % 2, cy = 2 * tile.y + d / 2;
+                        if (!index[z + 1].contains(tileCode(cx, cy)))
+                            continue;
+                        const QImage child(out.filePath(tilePath(z + 1, cx, cy)));
+                        if (child.isNull()) {
+                            firstError.set("cannot read tile " + tilePath(z + 1, cx, cy));
+                            return;
+                        }
+                        p.drawImage(QRectF(d % 2 * half, d / 2 * half, half, half), child);
+                    }
+                }
+            }
+            if (!img.save(out.filePath(tilePath(z, tile.x, tile.y)), "PNG"))
+                firstError.set("cannot write tile " + tilePath(z, tile.x, tile.y));
+        });
+
+        st.error = firstError.get();
+        if (!st.error.isEmpty()) {
+            LAB2_WARNING(lcPerf()) << "TilePyramid:" << st.error;
+            return st;
+        }
+        st.tilesRendered += todo.size();
+    }
+
+    // 6. Тайлы прошлого экспорта, которых больше нет (стали пустыми или изменилась сетка).
+    for (auto it = previous.cbegin(); it != previous.cend(); ++it) {
+        if (!current.contains(it.key()) && QFile::remove(out.filePath(it.key() + ".png")))
+            ++st.tilesRemoved;
+    }
+
+    if (!writeManifest_(grid, current, &st.error))
+        return st;
+
+    st.ok = true;
+    st.elapsedMs = timer.elapsed();
+    LAB2_INFO(lcPerf()) << "TilePyramid:" << st.rows << "rows," << st.levels << "levels, rendered" << st.tilesRendered
+                        << "skipped" << st.tilesSkipped << "removed" << st.tilesRemoved << "in" << st.elapsedMs << "ms";
+    return st;
+}
+
+QHash<QString, QByteArray> TilePyramid::readManifest_() const
+{
+    QHash<QString, QByteArray> hashes;
+    QFile f(QDir(m_outDir).filePath(kManifestFile));
+    if (!f.open(QIODevice::ReadOnly))
+        return hashes;
+
+    const QJsonObject tiles = QJsonDocument::fromJson(f.readAll()).object().value("tiles").toObject();
+    for (auto it = tiles.constBegin(); it != tiles.constEnd(); ++it)
+        hashes.insert(it.key(), it.value().toString().toLatin1());
+    return hashes;
+}
+
+bool TilePyramid::writeManifest_(const QJsonObject& grid, const QHash<QString, QByteArray>& hashes, QString* error) const
+{
+    QJsonObject tiles;
+    for (auto it = hashes.cbegin(); it != hashes.cend(); ++it)
+        tiles.insert(it.key(), QString::fromLatin1(it.value()));
+
+    QJsonObject manifest = grid;
+    manifest["tiles"] = tiles;
+
+    QSaveFile f(QDir(m_outDir).filePath(kManifestFile));
+    if (!f.open(QIODevice::WriteOnly) || f.write(QJsonDocument(manifest).toJson()) < 0 || !f.commit()) {
+        *error = "cannot write " + f.fileName() + ": " + f.errorString();
+        LAB2_WARNING(lcPerf()) << "TilePyramid:" << *error;
+        return false;
+    }
+    return true;
+}
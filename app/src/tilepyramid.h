@@ -0,0 +1,86 @@
+#ifndef TILEPYRAMID_H
+#define TILEPYRAMID_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+
+class QJsonObject;
+class RectSnapshot;
+
+/**
+ * @brief Экспорт прямоугольников снимка в пирамиду PNG-тайлов (для офлайн-просмотрщиков).
+ *
+ * Одна картинка на весь набор в память не помещается, поэтому рисуются тайлы tileSize x tileSize:
+ *
+ *   <outDir>/<z>/<x>/<y>.png  — уровень z (0 — один тайл на всю область), 2^z x 2^z тайлов;
+ *   <outDir>/tiles.json       — манифест: область, число уровней, хеши тайлов.
+ *
+ * Нижний уровень рисуется из прямоугольников (QPainter, перо — цвет/стиль/толщина строки)
+ * с масштабом не крупнее единицы координат на пиксель; верхние уровни собираются из четырёх
+ * дочерних тайлов с уменьшением вдвое. Пустые тайлы не пишутся.
+ *
+ * Прямоугольники рисуются контуром, поэтому строка относится только к тайлам, которые
+ * пересекают её стороны (с запасом на толщину пера), а не ко всей площади — большие
+ * прямоугольники не раздувают списки тайлов.
+ *
+ * Работа идёт в пуле потоков: каждый рабочий поток берёт следующий тайл уровня и рисует
+ * его в своих QImage/QPainter. Память — порядка threads тайлов плюс списки строк по тайлам.
+ *
+ * Повторный экспорт пропускает тайлы без изменений: хеш тайла нижнего уровня — по строкам,
+ * которые его касаются, верхних — по хешам детей. Тайл перерисовывается, только если хеш
+ * отличается от манифеста или файла нет; тайлы, ставшие пустыми, удаляются.
+ */
+class TilePyramid
+{
+public:
+    /// Итог экспорта.
+    struct Stats
+    {
+        bool ok = false;
+        int levels = 0;
+        qint64 rows = 0;            ///< Строк нарисовано (без NoPen).
+        qint64 tilesRendered = 0;
+        qint64 tilesSkipped = 0;    ///< Хеш совпал с манифестом, файл на месте.
+        qint64 tilesRemoved = 0;    ///< Тайлы прошлого экспорта, ставшие пустыми.
+        qint64 elapsedMs = 0;
+        QString error;
+    };
+
+    static constexpr int kDefaultTileSize = 256;
+    static constexpr int kDefaultMaxLevel = 8;
+    /// Предел глубины: 2^12 x 2^12 тайлов нижнего уровня.
+    static constexpr int kMaxLevel = 12;
+    static constexpr const char* kManifestFile = "tiles.json";
+
+    /// @param threads Рабочих потоков; 0 — по числу ядер.
+    explicit TilePyramid(const QString& outDir, int threads = 0);
+
+    void setTileSize(int px) { m_tileSize = px >= 16 ? px : kDefaultTileSize; }
+    int tileSize() const { return m_tileSize; }
+
+    /// Наибольший номер уровня (нижний уровень может быть мельче, если набор мал).
+    void setMaxLevel(int level) { m_maxLevel = qBound(0, level, kMaxLevel); }
+    int maxLevel() const { return m_maxLevel; }
+
+    /// Рисует пирамиду из открытого снимка.
+    Stats exportSnapshot(const RectSnapshot& snapshot);
+
+    /// Путь тайла относительно outDir: "z/x/y.png".
+    static QString tilePath(int level, int x, int y);
+
+private:
+    /// Хеши тайлов прошлого экспорта из манифеста (пусто, если манифеста нет).
+    QHash<QString, QByteArray> readManifest_() const;
+
+    /// Пишет манифест (QSaveFile): сетка grid и хеши тайлов.
+    bool writeManifest_(const QJsonObject& grid, const QHash<QString, QByteArray>& hashes, QString* error) const;
+
+private:
+    QString m_outDir;
+    int m_threads = 1;
+    int m_tileSize = kDefaultTileSize;
+    int m_maxLevel = kDefaultMaxLevel;
+};
+
+#endif // TILEPYRAMID_H
@@ -0,0 +1,137 @@
+#include "warmmodelcache.h"
+
+#include "logger.h"
+#include "memorybudget.h"
+
+WarmModelCache::WarmModelCache(MemoryBudget* budget, int capacity)
+    : m_budget(budget)
+{
+    setCapacity(capacity);
+}
+
+WarmModelCache::~WarmModelCache()
+{
+    clear();
+}
+
+void WarmModelCache::setCapacity(int models)
+{
+    m_capacity = qMax(0, models);
+    purge_();
+    while (m_slots.size() > m_capacity)
+        release_(m_slots.size() - 1);
+}
+
+bool WarmModelCache::park(const QString& table, QSqlTableModel* model, const ViewState& state)
+{
+    if (!model || model->isDirty())
+        return false;
+
+    purge_();
+    remove(table);
+
+    if (m_capacity == 0) {
+        delete model;
+        return true;
+    }
+
+    Slot s;
+    s.table = table;
+    s.model = model;
+    s.state = state;
+    if (m_budget) {
+        const QPointer<QSqlTableModel> p = model;
+        s.budgetId = m_budget->registerConsumer(
+                    "warm model " + table,
+                    [p] { return p ? MemoryBudget::estimateRowCacheBytes(p->rowCount(), p->columnCount()) : 0; },
+                    [this, p](qint64) { return evict_(p); });
+    }
+    m_slots.prepend(s);
+
+    while (m_slots.size() > m_capacity) {
+        LAB2_DEBUG(lcModel()) << "WarmModelCache: dropping" << m_slots.last().table;
+        release_(m_slots.size() - 1);
+    }
+    return true;
+}
+
+WarmModelCache::Entry WarmModelCache::take(const QString& table)
+{
+    purge_();
+
+    Entry e;
+    for (int i = 0; i < m_slots.size(); ++i) {
+        if (m_slots.at(i).table != table) continue;
+
+        e.model = m_slots.at(i).model;
+        e.state = m_slots.at(i).state;
+        m_slots[i].model = nullptr; // владение — вызывающему
+        release_(i);
+        ++m_hits;
+        return e;
+    }
+    ++m_misses;
+    return e;
+}
+
+void WarmModelCache::remove(const QString& table)
+{
+    for (int i = m_slots.size() - 1; i >= 0; --i) {
+        if (m_slots.at(i).table == table)
+            release_(i);
+    }
+}
+
+void WarmModelCache::clear()
+{
+    while (!m_slots.isEmpty())
+        release_(m_slots.size() - 1);
+}
+
+bool WarmModelCache::contains(const QString& table) const
+{
+    for (const Slot& s : m_slots) {
+        if (s.model && s.table == table)
+            return true;
+    }
+    return false;
+}
+
+QStringList WarmModelCache::tables() const
+{
+    QStringList result;
+    for (const Slot& s : m_slots) {
+        if (s.model)
+            result << s.table;
+    }
+    return result;
+}
+
+qint64 WarmModelCache::evict_(QSqlTableModel* model)
+{
+    // Вызывается из MemoryBudget::enforce(): список потребителей трогать нельзя,
+    // поэтому удаляем только модель, а пустой слот снимет с учёта purge_().
+    if (!model || model->isDirty())
+        return 0;
+
+    const qint64 bytes = MemoryBudget::estimateRowCacheBytes(model->rowCount(), model->columnCount());
+    LAB2_DEBUG(lcModel()) << "WarmModelCache: evicting" << model->tableName() << MemoryBudget::formatBytes(bytes);
+    delete model;
+    return bytes;
+}
+
+void WarmModelCache::release_(int index)
+{
+    Slot s = m_slots.takeAt(index);
+    if (m_budget && s.budgetId != 0)
+        m_budget->unregisterConsumer(s.budgetId);
+    delete s.model.data();
+}
+
+void WarmModelCache::purge_()
+{
+    for (int i = m_slots.size() - 1; i >= 0; --i) {
+        if (!m_slots.at(i).model)
+            release_(i);
+    }
+}
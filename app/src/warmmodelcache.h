@@ -0,0 +1,116 @@
+#ifndef WARMMODELCACHE_H
+#define WARMMODELCACHE_H
+
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <QtSql/QSqlTableModel>
+
+class MemoryBudget;
+
+/**
+ * @brief LRU-кэш "тёплых" моделей таблиц для быстрого переключения (Model -> Select table).
+ *
+ * Переключение на другую таблицу не удаляет текущую модель, а "паркует" её вместе с
+ * состоянием вида (прокрутка, текущая ячейка, индикатор сортировки). Модель сохраняет
+ * уже подгруженные порции строк и свой ORDER BY, поэтому возврат к таблице — это
+ * setModel() и восстановление прокрутки, без повторного select().
+ *
+ * Ограничения памяти:
+ *  - в кэше не больше capacity() моделей, при переполнении удаляется самая давняя;
+ *  - каждая запаркованная модель учитывается в MemoryBudget как отдельный кэш;
+ *    при нехватке бюджета холодная модель удаляется целиком (вернуться к ней — обычный select()).
+ *
+ * Модели с несохранёнными правками не паркуются и не вытесняются — правки не теряются.
+ *
+ * @note Запаркованная модель держит открытый SELECT по своей таблице: перед DROP/перестройкой
+ *       таблицы или закрытием соединения кэш нужно очистить (clear()/remove()).
+ */
+class WarmModelCache
+{
+public:
+    /// Состояние вида таблицы, восстанавливаемое при возврате к модели.
+    struct ViewState
+    {
+        int verticalScroll = 0;
+        int horizontalScroll = 0;
+        int currentRow = -1;
+        int currentColumn = -1;
+        /// Колонка индикатора сортировки (-1 — индикатор не показан).
+        int sortColumn = -1;
+        Qt::SortOrder sortOrder = Qt::AscendingOrder;
+    };
+
+    /// Результат take(): model == nullptr — тёплой модели для таблицы нет.
+    struct Entry
+    {
+        QSqlTableModel* model = nullptr;
+        ViewState state;
+    };
+
+    /// Число тёплых моделей по умолчанию (не считая текущей).
+    static constexpr int kDefaultCapacity = 3;
+
+    /// @param budget Бюджет памяти для учёта запаркованных моделей (может быть nullptr).
+    explicit WarmModelCache(MemoryBudget* budget = nullptr, int capacity = kDefaultCapacity);
+    ~WarmModelCache();
+
+    WarmModelCache(const WarmModelCache&) = delete;
+    WarmModelCache& operator=(const WarmModelCache&) = delete;
+
+    void setCapacity(int models);
+    int capacity() const { return m_capacity; }
+
+    /**
+     * @brief Паркует модель таблицы table; владение переходит к кэшу.
+     *
+     * Уже запаркованная модель той же таблицы заменяется. При переполнении удаляется самая давняя.
+     * @return false — модель не запаркована (есть несохранённые правки), владение остаётся у вызывающего.
+     */
+    bool park(const QString& table, QSqlTableModel* model, const ViewState& state);
+
+    /// Забирает тёплую модель таблицы (владение — вызывающему).
+    Entry take(const QString& table);
+
+    /// Удаляет тёплую модель таблицы (например, таблица изменена в обход модели).
+    void remove(const QString& table);
+
+    /// Удаляет все тёплые модели.
+    void clear();
+
+    bool contains(const QString& table) const;
+
+    /// Таблицы с тёплыми моделями, от недавней к давней.
+    QStringList tables() const;
+
+    int size() const { return tables().size(); }
+
+    /// Сколько раз take() нашёл модель / не нашёл.
+    quint64 hits() const { return m_hits; }
+    quint64 misses() const { return m_misses; }
+
+private:
+    struct Slot
+    {
+        QString table;
+        QPointer<QSqlTableModel> model;
+        ViewState state;
+        int budgetId = 0;
+    };
+
+    qint64 evict_(QSqlTableModel* model);
+    void release_(int index);
+    void purge_();
+
+private:
+    MemoryBudget* m_budget = nullptr;
+    int m_capacity = kDefaultCapacity;
+    /// Спереди — недавно запаркованные.
+    QVector<Slot> m_slots;
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+};
+
+#endif // WARMMODELCACHE_H
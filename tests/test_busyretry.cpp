@@ -0,0 +1,233 @@
+#include <QtTest/QtTest>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+
+#include "busyretry.h"
+
+/**
+ * @brief Тесты BusyRetry (busy timeout + повтор с экспоненциальной паузой и jitter).
+ *
+ * Проверяем:
+ *  - пауза растёт вдвое, ограничена maxDelayMs, случайна в [d/2, d]
+ *  - блокировка, снятая во время пауз, — операция выполнена, метрики учли повторы
+ *  - блокировка не снялась — отказ после maxRetries повторов или по сроку maxWaitMs
+ *  - ошибки, не связанные с блокировкой, не повторяются; SQLITE_LOCKED — тоже
+ *  - applyBusyTimeout() выставляет PRAGMA busy_timeout
+ */
+class TestBusyRetry : public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr const char* kWriter = "busy_writer";
+    static constexpr const char* kBlocker = "busy_blocker";
+
+    QTemporaryDir* m_dir = nullptr;
+
+    static QSqlDatabase writer() { return QSqlDatabase::database(kWriter, false); }
+    static QSqlDatabase blocker() { return QSqlDatabase::database(kBlocker, false); }
+
+    static BusyRetry::Policy fastPolicy(int maxRetries)
+    {
+        BusyRetry::Policy p;
+        p.busyTimeoutMs = 0;
+        p.maxRetries = maxRetries;
+        p.baseDelayMs = 1;
+        p.maxDelayMs = 4;
+        return p;
+    }
+
+private slots:
+    void init()
+    {
+        m_dir = new QTemporaryDir();
+        QVERIFY(m_dir->isValid());
+        const QString path = m_dir->filePath("busy.sqlite");
+
+        for (const char* name : { kWriter, kBlocker }) {
+            QSqlDatabase d = QSqlDatabase::addDatabase("QSQLITE", name);
+            d.setDatabaseName(path);
+            QVERIFY(d.open());
+        }
+        QSqlQuery q(writer());
+        QVERIFY(q.exec("CREATE TABLE t (v INTEGER);"));
+    }
+
+    void cleanup()
+    {
+        for (const char* name : { kWriter, kBlocker }) {
+            {
+                QSqlDatabase d = QSqlDatabase::database(name, false);
+                if (d.isOpen()) d.close();
+            }
+            QSqlDatabase::removeDatabase(name);
+        }
+        delete m_dir;
+        m_dir = nullptr;
+    }
+
+    void test_delayFor_exponentialCappedJittered()
+    {
+        BusyRetry::Policy p;
+        p.baseDelayMs = 10;
+        p.maxDelayMs = 100;
+        BusyRetry r(p);
+        r.setRandomSeed(42);
+
+        for (int i = 0; i < 200; ++i) {
+            const int d0 = r.delayFor(0);
+            QVERIFY(d0 >= 5 && d0 <= 10);
+            const int d2 = r.delayFor(2);
+            QVERIFY(d2 >= 20 && d2 <= 40);
+            const int d10 = r.delayFor(10);
+            QVERIFY(d10 >= 50 && d10 <= 100);
+        }
+
+        // Jitter: паузы одного шага различаются.
+        QSet<int> seen;
+        for (int i = 0; i < 50; ++i)
+            seen.insert(r.delayFor(3));
+        QVERIFY(seen.size() > 1);
+    }
+
+    void test_exec_lockReleasedDuringBackoff_succeeds()
+    {
+        QSqlQuery lock(blocker());
+        QVERIFY(lock.exec("BEGIN IMMEDIATE;"));
+
+        BusyRetry r(fastPolicy(5));
+        QVERIFY(r.applyBusyTimeout(writer()));
+        QVector<int> delays;
+        r.setSleeper([&](int ms) {
+            delays << ms;
+            if (delays.size() == 3)
+                QSqlQuery(blocker()).exec("COMMIT;");
+        });
+
+        QSqlQuery q(writer());
+        q.prepare("INSERT INTO t (v) VALUES (?);");
+        q.addBindValue(7);
+        QVERIFY2(r.exec(q), qPrintable(q.lastError().text()));
+        QCOMPARE(delays.size(), 3);
+        QVERIFY(delays.at(2) <= 4);
+
+        const BusyRetry::Stats& st = r.stats();
+        QCOMPARE(st.operations, qint64(1));
+        QCOMPARE(st.contended, qint64(1));
+        QCOMPARE(st.retries, qint64(3));
+        QCOMPARE(st.failures, qint64(0));
+        QVERIFY(st.waitMsMax <= st.waitMsTotal);
+
+        QSqlQuery check(writer());
+        QVERIFY(check.exec("SELECT COUNT(*) FROM t WHERE v = 7;") && check.next());
+        QCOMPARE(check.value(0).toInt(), 1);
+
+        // Без блокировки — без повторов, метрики ожидания не растут.
+        QVERIFY(r.exec(q));
+        QCOMPARE(r.stats().operations, qint64(2));
+        QCOMPARE(r.stats().contended, qint64(1));
+    }
+
+    void test_exec_lockHeld_failsAfterMaxRetries()
+    {
+        QSqlQuery lock(blocker());
+        QVERIFY(lock.exec("BEGIN IMMEDIATE;"));
+
+        BusyRetry r(fastPolicy(2));
+        QVERIFY(r.applyBusyTimeout(writer()));
+        int sleeps = 0;
+        r.setSleeper([&](int) { ++sleeps; });
+
+        QSqlQuery q(writer());
+        QVERIFY(!r.exec(q, "INSERT INTO t (v) VALUES (1);"));
+        QVERIFY(BusyRetry::isLockError(q.lastError()));
+        QCOMPARE(sleeps, 2);
+        QCOMPARE(r.stats().retries, qint64(2));
+        QCOMPARE(r.stats().failures, qint64(1));
+
+        // Блокировка снята — BEGIN/INSERT/COMMIT через те же обёртки проходят сразу.
+        QVERIFY(QSqlQuery(blocker()).exec("COMMIT;"));
+        QVERIFY(r.transaction(writer()));
+        QVERIFY(r.exec(q, "INSERT INTO t (v) VALUES (2);"));
+        QVERIFY(r.commit(writer()));
+
+        const QJsonObject json = r.toJson();
+        QCOMPARE(json.value("failures").toInt(), 1);
+        QCOMPARE(json.value("policy").toObject().value("max_retries").toInt(), 2);
+    }
+
+    void test_exec_lockHeld_stopsAtMaxWait()
+    {
+        QSqlQuery lock(blocker());
+        QVERIFY(lock.exec("BEGIN IMMEDIATE;"));
+
+        BusyRetry::Policy p = fastPolicy(1000);
+        p.baseDelayMs = 10;
+        p.maxDelayMs = 10;
+        p.maxWaitMs = 50;
+        BusyRetry r(p);
+        QVERIFY(r.applyBusyTimeout(writer()));
+        int sleeps = 0;
+        r.setSleeper([&](int ms) {
+            ++sleeps;
+            QThread::msleep(ulong(ms));
+        });
+
+        QElapsedTimer timer;
+        timer.start();
+        QSqlQuery q(writer());
+        QVERIFY(!r.exec(q, "INSERT INTO t (v) VALUES (1);"));
+        QVERIFY(BusyRetry::isLockError(q.lastError()));
+
+        // Паузы по 5..10 мс в пределах 50 мс: повторов заметно меньше maxRetries, ожидание не больше срока.
+        QVERIFY(sleeps > 0);
+        QVERIFY(sleeps <= 10);
+        QCOMPARE(r.stats().failures, qint64(1));
+        QVERIFY(r.stats().waitMsMax < p.maxWaitMs + 100); // запас на точность таймера ОС
+        QVERIFY(timer.elapsed() < 1000);
+
+        QVERIFY(QSqlQuery(blocker()).exec("COMMIT;"));
+    }
+
+    void test_exec_otherError_notRetried()
+    {
+        BusyRetry r(fastPolicy(5));
+        int sleeps = 0;
+        r.setSleeper([&](int) { ++sleeps; });
+
+        QSqlQuery q(writer());
+        QVERIFY(!r.exec(q, "SELECT * FROM no_such_table;"));
+        QVERIFY(!BusyRetry::isLockError(q.lastError()));
+        QCOMPARE(sleeps, 0);
+        QCOMPARE(r.stats().contended, qint64(0));
+        QCOMPARE(r.stats().failures, qint64(0));
+    }
+
+    void test_isLockError_busyOnly()
+    {
+        QVERIFY(BusyRetry::isLockError(QSqlError("", "database is locked", QSqlError::StatementError, "5")));
+        QVERIFY(BusyRetry::isLockError(QSqlError("", "database is locked", QSqlError::StatementError)));
+
+        // SQLITE_LOCKED: конфликт внутри соединения, ожидание не поможет.
+        QVERIFY(!BusyRetry::isLockError(QSqlError("", "database table is locked", QSqlError::StatementError, "6")));
+        QVERIFY(!BusyRetry::isLockError(QSqlError("", "database table is locked", QSqlError::StatementError)));
+        QVERIFY(!BusyRetry::isLockError(QSqlError()));
+    }
+
+    void test_applyBusyTimeout_setsPragma()
+    {
+        BusyRetry::Policy p;
+        p.busyTimeoutMs = 1234;
+        QVERIFY(BusyRetry(p).applyBusyTimeout(writer()));
+
+        QSqlQuery q(writer());
+        QVERIFY(q.exec("PRAGMA busy_timeout;") && q.next());
+        QCOMPARE(q.value(0).toInt(), 1234);
+    }
+};
+
+QTEST_MAIN(TestBusyRetry)
+#include "test_busyretry.moc"
@@ -0,0 +1,143 @@
+#include <QtTest/QtTest>
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include "changeexporter.h"
+#include "myrect.h"
+#include "rectbulkio.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты журнала изменений (триггеры миграции v2) и ChangeExporter.
+ *
+ * Проверяем:
+ *  - триггеры пишут I/U/D с монотонным seq
+ *  - exportSince() выгружает только изменения после заданного seq
+ *  - exportIncremental() сдвигает курсор и не создаёт файл без новых изменений
+ */
+class TestChangeExporter : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestDb m_db { "cdc_conn", "cdc.sqlite" };
+
+    /// Вставляет строку (цвет — через словарь pen_palette).
+    bool insert(const MyRect& r)
+    {
+        RectBulkWriter w(m_db.db());
+        if (!w.insert(r)) {
+            qWarning() << w.lastError();
+            return false;
+        }
+        return true;
+    }
+
+    /// Читает JSON Lines файл в список объектов.
+    static QList<QJsonObject> readLines(const QString& path)
+    {
+        QList<QJsonObject> result;
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly)) return result;
+        while (!f.atEnd()) {
+            const QByteArray line = f.readLine().trimmed();
+            if (!line.isEmpty())
+                result << QJsonDocument::fromJson(line).object();
+        }
+        return result;
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_triggers_recordInsertUpdateDelete()
+    {
+        QVERIFY(insert(MyRect(QColor("#ff0000"), Qt::SolidLine, 2, 3, 4, 5, 6)));
+        QVERIFY(m_db.exec("UPDATE rectangle SET width = 50 WHERE id = 1;"));
+        QVERIFY(m_db.exec("DELETE FROM rectangle WHERE id = 1;"));
+
+        QSqlQuery q(m_db.db());
+        QVERIFY(q.exec("SELECT seq, op, row_id, width FROM rectangle_changes ORDER BY seq;"));
+
+        QStringList ops;
+        qint64 prevSeq = 0;
+        QList<int> widths;
+        while (q.next()) {
+            QVERIFY(q.value(0).toLongLong() > prevSeq);
+            prevSeq = q.value(0).toLongLong();
+            ops << q.value(1).toString();
+            QCOMPARE(q.value(2).toInt(), 1);
+            widths << q.value(3).toInt();
+        }
+        QCOMPARE(ops, QStringList({ "I", "U", "D" }));
+        QCOMPARE(widths, QList<int>({ 5, 50, 50 })); // D хранит последнее состояние строки
+    }
+
+    void test_exportSince_onlyNewerChanges()
+    {
+        for (int i = 0; i < 5; ++i) {
+            QVERIFY(insert(MyRect(QColor("#00ff00"), Qt::SolidLine, 1, i, 0, 10, 10)));
+        }
+
+        ChangeExporter exporter(m_db.db());
+        QCOMPARE(exporter.latestSeq(), qint64(5));
+
+        const QString path = m_db.filePath("changes.jsonl");
+        const ChangeExporter::Result r = exporter.exportSince(3, path);
+        QVERIFY2(r.ok, qPrintable(r.error));
+        QCOMPARE(r.changes, qint64(2));
+        QCOMPARE(r.toSeq, qint64(5));
+
+        const auto lines = readLines(path);
+        QCOMPARE(lines.size(), 2);
+        QCOMPARE(lines.at(0).value("seq").toInt(), 4);
+        QCOMPARE(lines.at(0).value("op").toString(), QString("I"));
+        QCOMPARE(lines.at(0).value("left").toInt(), 3);
+        QCOMPARE(lines.at(1).value("pencolor").toString(), QString("#00ff00")); // цвет из словаря
+    }
+
+    void test_exportIncremental_advancesCursor()
+    {
+        ChangeExporter exporter(m_db.db());
+        QCOMPARE(exporter.cursor("downstream"), qint64(0));
+
+        QVERIFY(insert(MyRect(QColor("#0000ff"), Qt::SolidLine, 1, 0, 0, 1, 1)));
+
+        const QString first = m_db.filePath("first.jsonl");
+        auto r = exporter.exportIncremental("downstream", first);
+        QVERIFY2(r.ok, qPrintable(r.error));
+        QCOMPARE(r.changes, qint64(1));
+        QCOMPARE(exporter.cursor("downstream"), qint64(1));
+
+        // Без новых изменений файл не создаётся, курсор не меняется.
+        const QString empty = m_db.filePath("empty.jsonl");
+        r = exporter.exportIncremental("downstream", empty);
+        QVERIFY(r.ok);
+        QCOMPARE(r.changes, qint64(0));
+        QVERIFY(!QFile::exists(empty));
+
+        QVERIFY(m_db.exec("UPDATE rectangle SET top = 7;"));
+        const QString second = m_db.filePath("second.jsonl");
+        r = exporter.exportIncremental("downstream", second);
+        QCOMPARE(r.changes, qint64(1));
+        QCOMPARE(readLines(second).at(0).value("op").toString(), QString("U"));
+        QCOMPARE(exporter.cursor("downstream"), qint64(2));
+    }
+};
+
+QTEST_MAIN(TestChangeExporter)
+#include "test_changeexporter.moc"
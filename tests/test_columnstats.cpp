@@ -0,0 +1,257 @@
+#include <QtTest/QtTest>
+
+#include <QRandomGenerator>
+#include <QSignalSpy>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <limits>
+
+#include "columnstats.h"
+#include "penpalette.h"
+#include "rectangleschema.h"
+#include "rectangletablemodel.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты ColumnStats / ColumnStatsTracker (Model -> Column statistics).
+ *
+ * Проверяем:
+ *  - корзины гистограммы покрывают весь диапазон qint64
+ *  - add/remove/merge дают ту же сводку, что полный пересчёт
+ *  - удалённый экстремум помечается устаревшим и уточняется запросом к таблице
+ *  - правки модели (вставка, изменение, удаление) приводят сводку к результату нового скана
+ *  - addRows() добавляет сводку вставленных строк без скана, до первого скана — игнорируется
+ */
+class TestColumnStats : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestDb m_db { "colstats_conn", "colstats.sqlite" };
+
+    static MyRect randomRect(QRandomGenerator& rng)
+    {
+        static const QColor kColors[] = { QColor("#ff0000"), QColor("#00ff00"), QColor("#0000ff") };
+        return MyRect(kColors[rng.bounded(3)],
+                      static_cast<Qt::PenStyle>(rng.bounded(1, 6)),
+                      rng.bounded(1, 10),
+                      rng.bounded(-500, 500),
+                      rng.bounded(-500, 500),
+                      rng.bounded(0, 200),
+                      rng.bounded(0, 200));
+    }
+
+    /// Сравнивает сводки; устаревший экстремум a должен быть строгой оценкой экстремума b.
+    static void compareStats(const ColumnStats& a, const ColumnStats& b)
+    {
+        QCOMPARE(a.rows(), b.rows());
+        for (int c = 0; c < ColumnStats::NumericCount; ++c) {
+            const ColumnStats::Numeric& x = a.numeric(c);
+            const ColumnStats::Numeric& y = b.numeric(c);
+            QCOMPARE(x.count, y.count);
+            QCOMPARE(x.sum, y.sum);
+            QVERIFY2(x.bins == y.bins, ColumnStats::columnName(c));
+            if (x.minStale) {
+                QVERIFY(x.min < y.min);
+            } else {
+                QCOMPARE(x.min, y.min);
+                QCOMPARE(x.minCount, y.minCount);
+            }
+            if (x.maxStale) {
+                QVERIFY(x.max > y.max);
+            } else {
+                QCOMPARE(x.max, y.max);
+                QCOMPARE(x.maxCount, y.maxCount);
+            }
+        }
+        QCOMPARE(a.colors(), b.colors());
+        QCOMPARE(a.styles(), b.styles());
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_bins_coverWholeRange()
+    {
+        QCOMPARE(ColumnStats::binOf(0), ColumnStats::kZeroBin);
+        QCOMPARE(ColumnStats::binOf(1), ColumnStats::kZeroBin + 1);
+        QCOMPARE(ColumnStats::binOf(3), ColumnStats::kZeroBin + 2);
+        QCOMPARE(ColumnStats::binOf(-1), ColumnStats::kZeroBin - 1);
+        QCOMPARE(ColumnStats::binOf(std::numeric_limits<qint64>::min()), 0);
+        QCOMPARE(ColumnStats::binOf(std::numeric_limits<qint64>::max()), ColumnStats::kBins - 1);
+
+        const qint64 samples[] = { std::numeric_limits<qint64>::min(), -1025, -1024, -2, -1, 0, 1, 2,
+                                   1023, 1024, std::numeric_limits<qint64>::max() };
+        for (qint64 v : samples) {
+            const int b = ColumnStats::binOf(v);
+            QVERIFY(b >= 0 && b < ColumnStats::kBins);
+            QVERIFY(ColumnStats::binLow(b) <= v);
+            QVERIFY(v <= ColumnStats::binHigh(b));
+        }
+        // Корзины идут подряд, без пропусков.
+        for (int b = 1; b < ColumnStats::kBins; ++b)
+            QCOMPARE(ColumnStats::binLow(b), ColumnStats::binHigh(b - 1) + 1);
+    }
+
+    void test_addRemoveMerge_matchRecompute()
+    {
+        QRandomGenerator rng(42);
+        QVector<MyRect> rects;
+        for (int i = 0; i < 2000; ++i)
+            rects << randomRect(rng);
+
+        // merge() частей == один проход.
+        ColumnStats full;
+        ColumnStats parts[3];
+        for (int i = 0; i < rects.size(); ++i) {
+            full.add(rects.at(i));
+            parts[i % 3].add(rects.at(i));
+        }
+        ColumnStats merged;
+        for (const ColumnStats& p : parts)
+            merged.merge(p);
+        compareStats(merged, full);
+        if (QTest::currentTestFailed()) return;
+
+        // remove() части строк == пересчёт по оставшимся.
+        ColumnStats rest;
+        for (int i = 0; i < rects.size(); ++i) {
+            if (i % 4 == 0)
+                full.remove(rects.at(i));
+            else
+                rest.add(rects.at(i));
+        }
+        compareStats(full, rest);
+        QCOMPARE(full.numeric(ColumnStats::Area).mean(), rest.numeric(ColumnStats::Area).mean());
+    }
+
+    void test_removedExtreme_refreshedFromTable()
+    {
+        QSqlQuery q(m_db.db());
+        QVERIFY(q.exec("INSERT INTO rectangle (penstyle, penwidth, left, top, width, height) "
+                       "VALUES (1, 1, -50, 0, 10, 10), (1, 2, 5, 5, 20, 20), (1, 3, 7, 9, 1, 1), (1, 3, 7, 9, 1, 1);"));
+
+        ColumnStatsTracker tracker(m_db.db());
+        QVERIFY(tracker.rescan(m_db.path()));
+        QCOMPARE(tracker.stats().numeric(ColumnStats::Left).min, qint64(-50));
+
+        // Удаляем единственную строку с минимумом left, как это сделала бы модель.
+        ColumnStats stats = tracker.stats();
+        stats.remove(MyRect(QColor(), Qt::SolidLine, 1, -50, 0, 10, 10));
+        QVERIFY(q.exec("DELETE FROM rectangle WHERE left = -50;"));
+        QVERIFY(stats.numeric(ColumnStats::Left).minStale);
+        QVERIFY(stats.hasStaleExtremes());
+
+        QString error;
+        QVERIFY2(stats.refreshExtremes(m_db.db(), "rectangle", &error), qPrintable(error));
+        QVERIFY(!stats.hasStaleExtremes());
+        QCOMPARE(stats.numeric(ColumnStats::Left).min, qint64(5));
+        QCOMPARE(stats.numeric(ColumnStats::Left).minCount, qint64(1));
+        QCOMPARE(stats.numeric(ColumnStats::Left).max, qint64(7));
+        QCOMPARE(stats.numeric(ColumnStats::Left).maxCount, qint64(2));
+
+        // Дубликат максимума: удаление одного не делает максимум устаревшим.
+        stats.remove(MyRect(QColor(), Qt::SolidLine, 3, 7, 9, 1, 1));
+        QVERIFY(!stats.numeric(ColumnStats::Left).maxStale);
+        QCOMPARE(stats.numeric(ColumnStats::Left).max, qint64(7));
+    }
+
+    void test_tracker_followsModelEdits()
+    {
+        PenPalette palette(m_db.db());
+        const int red = palette.idFor(QColor("#ff0000"));
+        QVERIFY(red > 0);
+
+        QSqlQuery q(m_db.db());
+        for (int i = 0; i < 20; ++i) {
+            QVERIFY(q.exec(QString("INSERT INTO rectangle (pen_id, penstyle, penwidth, left, top, width, height) "
+                                   "VALUES (%1, %2, %3, %4, %5, %6, %7);")
+                           .arg(red).arg(1 + i % 3).arg(1 + i % 4).arg(i * 10).arg(i).arg(5 + i).arg(3)));
+        }
+
+        ColumnStatsTracker tracker(m_db.db());
+        tracker.setPalette(&palette);
+        QVERIFY(tracker.rescan(m_db.path()));
+        QCOMPARE(tracker.stats().rows(), qint64(20));
+
+        RectangleTableModel model(nullptr, m_db.db());
+        model.setPalette(&palette);
+        model.setTable(rectschema::kTable);
+        model.setEditStrategy(QSqlTableModel::OnManualSubmit);
+        model.setSort(rectschema::Id, Qt::AscendingOrder);
+        QVERIFY(model.select());
+        tracker.attach(&model);
+
+        QSignalSpy changed(&tracker, &ColumnStatsTracker::changed);
+
+        // Изменение: последняя строка (максимум left) получает новый цвет и меньший left.
+        QVERIFY(model.setData(model.index(19, rectschema::PenColor), QColor("#00ff00")));
+        QVERIFY(model.setData(model.index(19, rectschema::Left), -7));
+        // Удаление: первая строка.
+        QVERIFY(model.removeRows(0, 1));
+        // Вставка.
+        const int row = model.rowCount();
+        QVERIFY(model.insertRows(row, 1));
+        QVERIFY(model.setData(model.index(row, rectschema::PenColor), QColor("#0000ff")));
+        QVERIFY(model.setData(model.index(row, rectschema::PenStyle), int(Qt::DotLine)));
+        QVERIFY(model.setData(model.index(row, rectschema::PenWidth), 9));
+        QVERIFY(model.setData(model.index(row, rectschema::Left), 1000));
+        QVERIFY(model.setData(model.index(row, rectschema::Top), 1));
+        QVERIFY(model.setData(model.index(row, rectschema::Width), 2));
+        QVERIFY(model.setData(model.index(row, rectschema::Height), 3));
+
+        QVERIFY2(model.submitAll(), qPrintable(model.lastError().text()));
+        QCOMPARE(tracker.updatesApplied(), quint64(3));
+        QCOMPARE(changed.count(), 3);
+
+        QString error;
+        QVERIFY2(tracker.refreshExtremes(&error), qPrintable(error));
+        const ColumnStats incremental = tracker.stats();
+        QCOMPARE(incremental.numeric(ColumnStats::Left).max, qint64(1000));
+        QCOMPARE(incremental.numeric(ColumnStats::Left).min, qint64(-7));
+        QCOMPARE(incremental.colors().value(QColor("#00ff00").rgb()), qint64(1));
+
+        ColumnStatsTracker fresh(m_db.db());
+        QVERIFY(fresh.rescan(m_db.path()));
+        compareStats(incremental, fresh.stats());
+    }
+
+    void test_tracker_addRows_mergesWithoutRescan()
+    {
+        ColumnStatsTracker tracker(m_db.db());
+        QSignalSpy changed(&tracker, &ColumnStatsTracker::changed);
+
+        ColumnStats added;
+        added.add(MyRect(QColor("#ff0000"), Qt::SolidLine, 3, 10, 20, 60, 60));
+        added.add(MyRect(QColor("#00ff00"), Qt::DashLine, 5, -4, 1, 2, 2));
+
+        // Сводки ещё нет — добавлять не к чему.
+        tracker.addRows(added);
+        QCOMPARE(changed.count(), 0);
+        QCOMPARE(tracker.stats().rows(), qint64(0));
+
+        QVERIFY(tracker.rescan(m_db.path()));
+        const int afterRescan = changed.count();
+        tracker.addRows(added);
+        tracker.addRows(ColumnStats());
+        QCOMPARE(changed.count(), afterRescan + 1);
+        QCOMPARE(tracker.updatesApplied(), quint64(2));
+        QCOMPARE(tracker.stats().rows(), qint64(2));
+        QCOMPARE(tracker.stats().numeric(ColumnStats::Left).min, qint64(-4));
+        QCOMPARE(tracker.stats().numeric(ColumnStats::Left).max, qint64(10));
+    }
+};
+
+QTEST_MAIN(TestColumnStats)
+#include "test_columnstats.moc"
@@ -0,0 +1,166 @@
+#include <QtTest/QtTest>
+
+#include <QRandomGenerator>
+
+#include "densityheatmap.h"
+
+/**
+ * @brief Тесты DensityHeatmap (тепловая карта покрытия).
+ *
+ * Проверяем:
+ *  - spanAdd() совпадает со скалярным сложением при любой длине (векторная часть + хвост)
+ *  - покрытие совпадает с перебором "прямоугольник x ячейка", включая обрезку краями области
+ *  - прямоугольник меньше ячейки занимает одну ячейку
+ *  - результат не зависит от числа потоков (несколько частей строк)
+ *  - изображение: размер сетки, непокрытые ячейки прозрачны
+ */
+class TestDensityHeatmap : public QObject
+{
+    Q_OBJECT
+
+private:
+    /// Колонки геометрии в памяти (вместо снимка).
+    struct Rects
+    {
+        QVector<qint32> left, top, width, height;
+
+        void add(int l, int t, int w, int h)
+        {
+            left << l;
+            top << t;
+            width << w;
+            height << h;
+        }
+
+        DensityHeatmap::Columns columns() const
+        {
+            DensityHeatmap::Columns c;
+            c.left = left.constData();
+            c.top = top.constData();
+            c.width = width.constData();
+            c.height = height.constData();
+            c.count = left.size();
+            return c;
+        }
+    };
+
+    static Rects randomRects(int n, int span, int maxSide, quint32 seed)
+    {
+        QRandomGenerator rng(seed);
+        Rects r;
+        for (int i = 0; i < n; ++i)
+            r.add(rng.bounded(-10, span), rng.bounded(-10, span), rng.bounded(1, maxSide), rng.bounded(1, maxSide));
+        return r;
+    }
+
+private slots:
+    void test_spanAdd_matchesScalar()
+    {
+        for (int n : { 0, 1, 3, 4, 7, 8, 9, 17, 33, 100 }) {
+            QVector<qint32> dst(n), src(n), expected(n);
+            for (int i = 0; i < n; ++i) {
+                dst[i] = i * 3 - 7;
+                src[i] = 100 - i;
+                expected[i] = dst[i] + src[i];
+            }
+            DensityHeatmap::spanAdd(dst.data(), src.constData(), n);
+            QCOMPARE(dst, expected);
+        }
+    }
+
+    void test_counts_matchBruteForce()
+    {
+        const int w = 53, h = 37;
+        const Rects rects = randomRects(2000, 60, 20, 42);
+
+        DensityHeatmap heatmap(3);
+        QVERIFY(heatmap.render(rects.columns(), QRectF(0, 0, w, h), QSize(w, h)));
+
+        QVector<qint32> expected(w * h, 0);
+        qint64 visible = 0;
+        for (int i = 0; i < rects.left.size(); ++i) {
+            const int x0 = qMax(0, rects.left[i]), x1 = qMin(w, rects.left[i] + rects.width[i]);
+            const int y0 = qMax(0, rects.top[i]), y1 = qMin(h, rects.top[i] + rects.height[i]);
+            if (x0 >= x1 || y0 >= y1)
+                continue;
+            ++visible;
+            for (int y = y0; y < y1; ++y)
+                for (int x = x0; x < x1; ++x)
+                    ++expected[y * w + x];
+        }
+
+        qint32 max = 0;
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                QCOMPARE(heatmap.countAt(x, y), expected[y * w + x]);
+                max = qMax(max, expected[y * w + x]);
+            }
+        }
+        QCOMPARE(heatmap.maxCount(), max);
+        QCOMPARE(heatmap.visibleRows(), visible);
+        QCOMPARE(heatmap.countAt(-1, 0), 0);
+        QCOMPARE(heatmap.countAt(w, 0), 0);
+    }
+
+    void test_tinyRects_occupyOneCell()
+    {
+        Rects rects;
+        rects.add(5, 5, 0, 0);
+        rects.add(12, 12, 1, 1);
+
+        // 10 единиц на ячейку: оба прямоугольника меньше ячейки.
+        DensityHeatmap heatmap(1);
+        QVERIFY(heatmap.render(rects.columns(), QRectF(0, 0, 100, 100), QSize(10, 10)));
+        QCOMPARE(heatmap.countAt(0, 0), 1);
+        QCOMPARE(heatmap.countAt(1, 1), 1);
+        QCOMPARE(heatmap.countAt(1, 0), 0);
+        QCOMPARE(heatmap.countAt(0, 1), 0);
+        QCOMPARE(heatmap.visibleRows(), qint64(2));
+    }
+
+    void test_threads_sameResult()
+    {
+        // Больше 4 * 64K строк: у четырёх потоков действительно четыре сетки разностей.
+        const Rects rects = randomRects(300000, 1000, 200, 7);
+        const QRectF world(-20, -20, 1100, 900);
+        const QSize size(131, 97);
+
+        DensityHeatmap one(1), four(4);
+        QVERIFY(one.render(rects.columns(), world, size));
+        QVERIFY(four.render(rects.columns(), world, size));
+        QCOMPARE(four.maxCount(), one.maxCount());
+        QCOMPARE(four.visibleRows(), one.visibleRows());
+        QCOMPARE(four.image(), one.image());
+        for (int y = 0; y < size.height(); ++y)
+            for (int x = 0; x < size.width(); ++x)
+                QCOMPARE(four.countAt(x, y), one.countAt(x, y));
+
+        // Повторный render() на тех же буферах даёт тот же результат.
+        QVERIFY(four.render(rects.columns(), world, size));
+        QCOMPARE(four.image(), one.image());
+    }
+
+    void test_image_sizeAndTransparency()
+    {
+        Rects rects;
+        rects.add(0, 0, 4, 4);
+        rects.add(2, 2, 4, 4);
+
+        DensityHeatmap heatmap(2);
+        QVERIFY(!heatmap.render(rects.columns(), QRectF(0, 0, 10, 10), QSize()));
+        QVERIFY(!heatmap.render(rects.columns(), QRectF(0, 0, 0, 10), QSize(10, 10)));
+        QVERIFY(heatmap.render(rects.columns(), QRectF(0, 0, 10, 10), QSize(10, 10)));
+
+        const QImage& img = heatmap.image();
+        QCOMPARE(img.size(), QSize(10, 10));
+        QCOMPARE(qAlpha(img.pixel(9, 9)), 0);
+        QCOMPARE(qAlpha(img.pixel(0, 0)), 255);
+        QCOMPARE(heatmap.maxCount(), 2);
+        // Самая "горячая" ячейка — последний цвет шкалы.
+        QCOMPARE(img.pixel(3, 3), DensityHeatmap::colorAt(1.0));
+        QVERIFY(img.pixel(0, 0) != img.pixel(3, 3));
+    }
+};
+
+QTEST_MAIN(TestDensityHeatmap)
+#include "test_densityheatmap.moc"
@@ -0,0 +1,136 @@
+#include <QtTest/QtTest>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardItemModel>
+#include <QTemporaryDir>
+
+#include "framestats.h"
+#include "instrumentedtableview.h"
+
+/**
+ * @brief Тесты для FrameStats и InstrumentedTableView.
+ *
+ * Проверяем:
+ *  - подсчёт p50/p99 и jank-кадров по гистограмме
+ *  - учёт подгрузок fetchMore() в следующем кадре
+ *  - экспорт в JSON
+ *  - что InstrumentedTableView действительно записывает кадры при отрисовке
+ */
+class TestFrameStats : public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr qint64 kMs = 1000000; // нс в мс
+
+private slots:
+    void test_empty_summaryIsZero()
+    {
+        FrameStats stats;
+        const auto s = stats.summary();
+        QCOMPARE(s.frames, qint64(0));
+        QCOMPARE(s.p50Ms, 0.0);
+        QCOMPARE(s.p99Ms, 0.0);
+    }
+
+    /**
+     * @brief 99 быстрых кадров по 1 мс и один медленный 50 мс.
+     *
+     * @details
+     * p50 должен попасть в корзину ~1 мс, p99 — тоже (99-й кадр из 100 быстрый),
+     * максимум и jank — от медленного кадра.
+     */
+    void test_percentilesAndJank()
+    {
+        FrameStats stats;
+        for (int i = 0; i < 99; ++i)
+            stats.recordFrame(1 * kMs, 0, 0);
+        stats.recordFrame(50 * kMs, 0, 0);
+
+        const auto s = stats.summary();
+        QCOMPARE(s.frames, qint64(100));
+        QVERIFY(s.p50Ms >= 1.0 && s.p50Ms <= 1.2);
+        QVERIFY(s.p99Ms >= 1.0 && s.p99Ms <= 1.2);
+        QVERIFY(qAbs(s.maxMs - 50.0) < 0.001);
+        QCOMPARE(s.jankFrames, qint64(1));
+    }
+
+    void test_fetchStall_attributedToNextFrame()
+    {
+        FrameStats stats;
+        stats.addFetchStall(40 * kMs);
+
+        stats.beginFrame();
+        stats.endFrame();
+
+        const auto s = stats.summary();
+        QCOMPARE(s.frames, qint64(1));
+        QCOMPARE(s.fetchStalls, qint64(1));
+        QVERIFY(s.fetchMsTotal >= 40.0);
+        QCOMPARE(s.jankFrames, qint64(1));
+    }
+
+    void test_dataTime_countedOnlyInsideFrame()
+    {
+        FrameStats stats;
+        QVERIFY(!stats.inFrame());
+
+        stats.beginFrame();
+        QVERIFY(stats.inFrame());
+        stats.addDataTime(2 * kMs);
+        stats.endFrame();
+
+        QVERIFY(!stats.inFrame());
+        QVERIFY(qAbs(stats.summary().dataMsTotal - 2.0) < 0.001);
+    }
+
+    void test_exportJson_writesSummary()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        FrameStats stats;
+        stats.recordFrame(3 * kMs, 1 * kMs, 0);
+
+        const QString path = dir.filePath("frames.json");
+        QVERIFY(stats.exportJson(path));
+
+        QFile f(path);
+        QVERIFY(f.open(QIODevice::ReadOnly));
+        const QJsonObject o = QJsonDocument::fromJson(f.readAll()).object();
+        QCOMPARE(o.value("frames").toInt(), 1);
+        QVERIFY(o.contains("p99_ms"));
+        QCOMPARE(o.value("histogram").toArray().size(), 1);
+    }
+
+    void test_reset_clearsEverything()
+    {
+        FrameStats stats;
+        stats.recordFrame(100 * kMs, 0, 0);
+        stats.reset();
+        QCOMPARE(stats.summary().frames, qint64(0));
+        QCOMPARE(stats.summary().jankFrames, qint64(0));
+    }
+
+    void test_view_recordsFramesOnPaint()
+    {
+        QStandardItemModel model(20, 3);
+        FrameStats stats;
+
+        InstrumentedTableView view;
+        view.setModel(&model);
+        view.setFrameStats(&stats);
+        view.resize(300, 200);
+
+        view.grab();
+
+        QVERIFY(stats.summary().frames > 0);
+        QVERIFY(!stats.inFrame());
+    }
+};
+
+QTEST_MAIN(TestFrameStats)
+#include "test_framestats.moc"
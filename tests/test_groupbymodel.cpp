@@ -0,0 +1,201 @@
+#include <QtTest/QtTest>
+
+#include <QSignalSpy>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include "groupbymodel.h"
+#include "mydelegate.h"
+#include "penpalette.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты GroupByModel (группировка / сводная таблица с инкрементальным обновлением).
+ *
+ * Проверяем:
+ *  - полный расчёт: число строк и сумма площадей по цвету x стилю
+ *  - refresh() после INSERT/UPDATE/DELETE — по журналу, меняются только затронутые группы
+ *  - сводная таблица: колонки по значениям второго измерения и итог
+ *  - смена группировки (корзины толщины пера, одно измерение)
+ */
+class TestGroupByModel : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestDb m_db { "groupby_conn", "groupby.sqlite" };
+
+    bool insert(const QString& color, int style, int penWidth, int w, int h)
+    {
+        QSqlQuery q(m_db.db());
+        q.prepare("INSERT INTO rectangle (pen_id, penstyle, penwidth, left, top, width, height) "
+                  "VALUES (?,?,?,?,?,?,?);");
+        const int penId = PenPalette(m_db.db()).idFor(QColor(color));
+        for (const QVariant& v : { QVariant(penId), QVariant(style), QVariant(penWidth),
+                                   QVariant(0), QVariant(0), QVariant(w), QVariant(h) })
+            q.addBindValue(v);
+        if (!q.exec()) {
+            qWarning() << q.lastError().text();
+            return false;
+        }
+        return true;
+    }
+
+    qint64 penId(const QString& color) { return PenPalette(m_db.db()).idFor(QColor(color)); }
+
+    /// Запускает action и ждёт refreshed(); возвращает его аргументы (full, groupsChanged).
+    template <typename F>
+    static QList<QVariant> waitRefreshed(GroupByModel& m, F action)
+    {
+        QSignalSpy spy(&m, &GroupByModel::refreshed);
+        action();
+        if (!spy.wait(5000))
+            return {};
+        return spy.takeFirst();
+    }
+
+    /// Группа по ключу (count -1 — нет такой).
+    static GroupByModel::Group group(const GroupByModel& m, qint64 a, qint64 b)
+    {
+        for (const GroupByModel::Group& g : m.groups()) {
+            if (g.key == GroupByModel::Key(a, b))
+                return g;
+        }
+        GroupByModel::Group none;
+        none.count = -1;
+        return none;
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+
+        QVERIFY(insert("#ff0000", Qt::SolidLine, 1, 10, 10));
+        QVERIFY(insert("#ff0000", Qt::SolidLine, 2, 5, 5));
+        QVERIFY(insert("#0000ff", Qt::DashLine, 3, 2, 2));
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_reload_groupsByColorAndStyle()
+    {
+        GroupByModel m(m_db.path());
+        const QList<QVariant> args = waitRefreshed(m, [&] { m.reload(); });
+        QCOMPARE(args.size(), 2);
+        QCOMPARE(args.at(0).toBool(), true);
+
+        QCOMPARE(m.groups().size(), 2);
+        QCOMPARE(m.rowCount(), 2);
+        QCOMPARE(m.columnCount(), 5);
+        QVERIFY(m.seq() > 0);
+
+        const GroupByModel::Group red = group(m, penId("#ff0000"), Qt::SolidLine);
+        QCOMPARE(red.count, qint64(2));
+        QCOMPARE(red.area, qint64(125));
+        const GroupByModel::Group blue = group(m, penId("#0000ff"), Qt::DashLine);
+        QCOMPARE(blue.count, qint64(1));
+        QCOMPARE(blue.area, qint64(4));
+
+        // Порядок ключей: красный получил pen_id первым.
+        QCOMPARE(m.data(m.index(0, 0)).toString(), QString("#ff0000"));
+        QCOMPARE(m.data(m.index(0, 1)).toString(), MyDelegate::penStyleToText(Qt::SolidLine));
+        QCOMPARE(m.data(m.index(0, 2)).toLongLong(), qint64(2));
+        QCOMPARE(m.headerData(2, Qt::Horizontal).toString(), QString("Count"));
+    }
+
+    void test_refresh_appliesJournalDelta()
+    {
+        GroupByModel m(m_db.path());
+        QVERIFY(!waitRefreshed(m, [&] { m.reload(); }).isEmpty());
+        const qint64 seq0 = m.seq();
+
+        // Без изменений: пустая дельта.
+        QList<QVariant> args = waitRefreshed(m, [&] { m.refresh(); });
+        QCOMPARE(args.size(), 2);
+        QCOMPARE(args.at(0).toBool(), false);
+        QCOMPARE(args.at(1).toInt(), 0);
+        QCOMPARE(m.seq(), seq0);
+
+        // INSERT: появляется одна группа.
+        QVERIFY(insert("#00ff00", Qt::SolidLine, 1, 3, 3));
+        args = waitRefreshed(m, [&] { m.refresh(); });
+        QCOMPARE(args.at(0).toBool(), false);
+        QCOMPARE(args.at(1).toInt(), 1);
+        QCOMPARE(m.groups().size(), 3);
+        QCOMPARE(group(m, penId("#00ff00"), Qt::SolidLine).area, qint64(9));
+
+        // UPDATE: строка уходит из (blue, Dash) в (blue, Solid) — две группы.
+        QVERIFY(m_db.exec("UPDATE rectangle SET penstyle = 1 WHERE id = 3;"));
+        args = waitRefreshed(m, [&] { m.refresh(); });
+        QCOMPARE(args.at(0).toBool(), false);
+        QCOMPARE(args.at(1).toInt(), 2);
+        QCOMPARE(group(m, penId("#0000ff"), Qt::DashLine).count, qint64(-1));
+        QCOMPARE(group(m, penId("#0000ff"), Qt::SolidLine).count, qint64(1));
+
+        // DELETE: меняются числа одной группы.
+        QVERIFY(m_db.exec("DELETE FROM rectangle WHERE id = 1;"));
+        args = waitRefreshed(m, [&] { m.refresh(); });
+        QCOMPARE(args.at(0).toBool(), false);
+        QCOMPARE(args.at(1).toInt(), 1);
+        const GroupByModel::Group red = group(m, penId("#ff0000"), Qt::SolidLine);
+        QCOMPARE(red.count, qint64(1));
+        QCOMPARE(red.area, qint64(25));
+        QVERIFY(m.seq() > seq0);
+    }
+
+    void test_pivot_columnsPerValueAndTotal()
+    {
+        GroupByModel m(m_db.path());
+        GroupByModel::Spec spec;
+        spec.rows = GroupByModel::PenColor;
+        spec.columns = GroupByModel::PenStyle;
+        spec.pivot = true;
+        QVERIFY(!waitRefreshed(m, [&] { m.setSpec(spec); }).isEmpty());
+
+        // Строки — цвета, колонки — Solid, Dash и итог.
+        QCOMPARE(m.rowCount(), 2);
+        QCOMPARE(m.columnCount(), 4);
+        QCOMPARE(m.headerData(1, Qt::Horizontal).toString(), MyDelegate::penStyleToText(Qt::SolidLine));
+        QCOMPARE(m.headerData(3, Qt::Horizontal).toString(), QString("Total"));
+        QCOMPARE(m.data(m.index(0, 0)).toString(), QString("#ff0000"));
+        QCOMPARE(m.data(m.index(0, 1)).toLongLong(), qint64(2));
+        QVERIFY(m.data(m.index(0, 2)).isNull());
+        QCOMPARE(m.data(m.index(0, 3)).toLongLong(), qint64(2));
+        QCOMPARE(m.data(m.index(1, 2)).toLongLong(), qint64(1));
+
+        // Новое значение стиля — новая колонка.
+        QVERIFY(insert("#0000ff", Qt::DotLine, 1, 1, 1));
+        QVERIFY(!waitRefreshed(m, [&] { m.refresh(); }).isEmpty());
+        QCOMPARE(m.columnCount(), 5);
+        QCOMPARE(m.data(m.index(1, 4)).toLongLong(), qint64(2));
+    }
+
+    void test_setSpec_widthBuckets()
+    {
+        GroupByModel m(m_db.path());
+        GroupByModel::Spec spec;
+        spec.rows = GroupByModel::PenWidth;
+        spec.columns = GroupByModel::NoDimension;
+        spec.widthBucket = 2;
+        const QList<QVariant> args = waitRefreshed(m, [&] { m.setSpec(spec); });
+        QCOMPARE(args.size(), 2);
+        QCOMPARE(args.at(0).toBool(), true);
+
+        // Толщины 1, 2, 3: корзины [0..1] и [2..3].
+        QCOMPARE(m.columnCount(), 4);
+        QCOMPARE(m.groups().size(), 2);
+        QCOMPARE(group(m, 0, 0).count, qint64(1));
+        QCOMPARE(group(m, 2, 0).count, qint64(2));
+        QCOMPARE(m.data(m.index(1, 0)).toString(), QString("2..3"));
+        QCOMPARE(m.headerData(0, Qt::Horizontal).toString(), GroupByModel::dimensionName(GroupByModel::PenWidth));
+    }
+};
+
+QTEST_MAIN(TestGroupByModel)
+#include "test_groupbymodel.moc"
@@ -0,0 +1,260 @@
+#include <QtTest/QtTest>
+
+#include <QSignalSpy>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlTableModel>
+
+#include "busyretry.h"
+#include "groupcommitter.h"
+#include "penpalette.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты групповой фиксации правок GroupCommitter.
+ *
+ * Проверяем:
+ *  - правки модели копятся в одной транзакции: модель их видит, другое соединение — нет
+ *  - группа фиксируется по окну времени, по числу правок и по flush()
+ *  - выключенный коммиттер не открывает транзакций
+ *  - COMMIT, упёршийся в блокировку, повторяется через BusyRetry
+ *  - не прошедший COMMIT откатывает группу, модель перечитывается, испускается rolledBack()
+ */
+class TestGroupCommitter : public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr const char* kReaderConn = "group_reader";
+
+    TestDb m_db { "group_conn", "group.sqlite" };
+
+    /// COUNT(*) через отдельное соединение (видит только зафиксированные данные).
+    static int committedRows()
+    {
+        QSqlQuery q(QSqlDatabase::database(kReaderConn, false));
+        if (!q.exec("SELECT COUNT(*) FROM rectangle;") || !q.next()) {
+            qWarning() << q.lastError().text();
+            return -1;
+        }
+        return q.value(0).toInt();
+    }
+
+    /// Без busy timeout и с мгновенными паузами: блокировка сразу даёт повтор/отказ.
+    static BusyRetry::Policy fastPolicy(int maxRetries)
+    {
+        BusyRetry::Policy p;
+        p.busyTimeoutMs = 0;
+        p.maxRetries = maxRetries;
+        p.baseDelayMs = 1;
+        p.maxDelayMs = 1;
+        return p;
+    }
+
+    /// Открывает на читателе транзакцию с разделяемой блокировкой: COMMIT писателя получит SQLITE_BUSY.
+    static bool holdReadLock()
+    {
+        QSqlDatabase r = QSqlDatabase::database(kReaderConn, false);
+        QSqlQuery q(r);
+        return r.transaction() && q.exec("SELECT COUNT(*) FROM rectangle;") && q.next();
+    }
+
+    static void releaseReadLock()
+    {
+        QSqlDatabase::database(kReaderConn, false).commit();
+    }
+
+    static bool insertRow(QSqlTableModel& model, int left)
+    {
+        QSqlRecord rec = model.record();
+        rec.setGenerated("id", false);
+        rec.setValue("pen_id", PenPalette(model.database()).idFor(QColor("#ff0000")));
+        rec.setValue("penstyle", 1);
+        rec.setValue("penwidth", 1);
+        rec.setValue("left", left);
+        rec.setValue("top", 0);
+        rec.setValue("width", 10);
+        rec.setValue("height", 10);
+        return model.insertRecord(-1, rec);
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+
+        QSqlDatabase r = QSqlDatabase::addDatabase("QSQLITE", kReaderConn);
+        r.setDatabaseName(m_db.path());
+        QVERIFY(r.open());
+    }
+
+    void cleanup()
+    {
+        {
+            QSqlDatabase r = QSqlDatabase::database(kReaderConn, false);
+            if (r.isOpen()) r.close();
+        }
+        QSqlDatabase::removeDatabase(kReaderConn);
+        m_db.close();
+    }
+
+    void test_editsVisibleToModelBeforeCommit()
+    {
+        QSqlTableModel model(nullptr, m_db.db());
+        model.setTable("rectangle");
+        model.setEditStrategy(QSqlTableModel::OnFieldChange);
+        QVERIFY(model.select());
+
+        GroupCommitter gc(m_db.db());
+        gc.setWindowMs(60000);  // только явный flush()
+        gc.attach(&model);
+
+        for (int i = 0; i < 5; ++i)
+            QVERIFY(insertRow(model, i));
+        QVERIFY(model.setData(model.index(0, model.fieldIndex("width")), 99));
+
+        QVERIFY(gc.hasPending());
+        QCOMPARE(gc.pendingChanges(), 6);
+        QCOMPARE(committedRows(), 0);
+
+        // read-your-writes: модель перечитывает таблицу через то же соединение.
+        QVERIFY(model.select());
+        QCOMPARE(model.rowCount(), 5);
+        QCOMPARE(model.data(model.index(0, model.fieldIndex("width"))).toInt(), 99);
+
+        QSignalSpy spy(&gc, &GroupCommitter::committed);
+        QVERIFY(gc.flush());
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(spy.at(0).at(0).toInt(), 6);
+        QCOMPARE(committedRows(), 5);
+        QCOMPARE(gc.groupsCommitted(), quint64(1));
+    }
+
+    void test_windowElapsed_commits()
+    {
+        QSqlTableModel model(nullptr, m_db.db());
+        model.setTable("rectangle");
+        model.setEditStrategy(QSqlTableModel::OnFieldChange);
+        QVERIFY(model.select());
+
+        GroupCommitter gc(m_db.db());
+        gc.setWindowMs(20);
+        gc.attach(&model);
+
+        QVERIFY(insertRow(model, 1));
+        QVERIFY(insertRow(model, 2));
+        QCOMPARE(committedRows(), 0);
+
+        QTRY_COMPARE(committedRows(), 2);
+        QVERIFY(!gc.hasPending());
+        QCOMPARE(gc.changesCommitted(), quint64(2));
+    }
+
+    void test_maxChanges_commitsFromEventLoop()
+    {
+        QSqlTableModel model(nullptr, m_db.db());
+        model.setTable("rectangle");
+        model.setEditStrategy(QSqlTableModel::OnFieldChange);
+        QVERIFY(model.select());
+
+        GroupCommitter gc(m_db.db());
+        gc.setWindowMs(60000);
+        gc.setMaxChanges(3);
+        gc.attach(&model);
+
+        for (int i = 0; i < 3; ++i)
+            QVERIFY(insertRow(model, i));
+
+        QCoreApplication::processEvents();
+        QCOMPARE(committedRows(), 3);
+        QCOMPARE(gc.groupsCommitted(), quint64(1));
+    }
+
+    void test_disabled_autocommitsEachEdit()
+    {
+        QSqlTableModel model(nullptr, m_db.db());
+        model.setTable("rectangle");
+        model.setEditStrategy(QSqlTableModel::OnFieldChange);
+        QVERIFY(model.select());
+
+        GroupCommitter gc(m_db.db());
+        gc.attach(&model);
+        gc.setEnabled(false);
+
+        QVERIFY(insertRow(model, 1));
+        QVERIFY(!gc.hasPending());
+        QCOMPARE(committedRows(), 1);
+    }
+
+    void test_commitLocked_retriedUntilReleased()
+    {
+        QSqlTableModel model(nullptr, m_db.db());
+        model.setTable("rectangle");
+        model.setEditStrategy(QSqlTableModel::OnFieldChange);
+        QVERIFY(model.select());
+
+        BusyRetry retry(fastPolicy(5));
+        QVERIFY(retry.applyBusyTimeout(m_db.db()));
+        int sleeps = 0;
+        retry.setSleeper([&](int) {
+            if (++sleeps == 2)
+                releaseReadLock();
+        });
+
+        GroupCommitter gc(m_db.db());
+        gc.setWindowMs(60000);
+        gc.setBusyRetry(&retry);
+        gc.attach(&model);
+
+        QVERIFY(insertRow(model, 1));
+        QVERIFY(holdReadLock());
+
+        QVERIFY(gc.flush());
+        QCOMPARE(sleeps, 2);
+        QCOMPARE(retry.stats().retries, qint64(2));
+        QCOMPARE(committedRows(), 1);
+        QCOMPARE(gc.groupsRolledBack(), quint64(0));
+    }
+
+    void test_commitFailed_rollsBackAndReselectsModel()
+    {
+        QSqlTableModel model(nullptr, m_db.db());
+        model.setTable("rectangle");
+        model.setEditStrategy(QSqlTableModel::OnFieldChange);
+        QVERIFY(model.select());
+
+        BusyRetry retry(fastPolicy(1));
+        QVERIFY(retry.applyBusyTimeout(m_db.db()));
+        retry.setSleeper([](int) {});
+
+        GroupCommitter gc(m_db.db());
+        gc.setWindowMs(60000);
+        gc.setBusyRetry(&retry);
+        gc.attach(&model);
+
+        QVERIFY(insertRow(model, 1));
+        QVERIFY(insertRow(model, 2));
+        QCOMPARE(model.rowCount(), 2);
+        QVERIFY(holdReadLock());
+
+        QSignalSpy spy(&gc, &GroupCommitter::rolledBack);
+        QVERIFY(!gc.flush());
+        releaseReadLock();
+
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(spy.at(0).at(0).toInt(), 2);
+        QVERIFY(!spy.at(0).at(1).toString().isEmpty());
+        QCOMPARE(gc.groupsRolledBack(), quint64(1));
+        QVERIFY(!gc.hasPending());
+
+        // Модель не показывает откаченные строки.
+        QCOMPARE(model.rowCount(), 0);
+        QCOMPARE(committedRows(), 0);
+    }
+};
+
+QTEST_MAIN(TestGroupCommitter)
+#include "test_groupcommitter.moc"
@@ -0,0 +1,214 @@
+#include <QtTest/QtTest>
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "logger.h"
+#include "ringbuffer.h"
+
+LAB2_LOG_CATEGORY(lcTest, "test")
+
+/**
+ * @brief Тесты для MpmcRingBuffer и асинхронного логгера.
+ *
+ * Проверяем:
+ *  - FIFO-порядок и поведение полной/пустой очереди
+ *  - отсутствие потерь при нескольких производителях и потребителях
+ *  - доставку записей в sink фоновым писателем
+ *  - у записи нет хвостового пробела от QDebug
+ *  - переполнение буфера: Warning ждёт и не теряется, Info отбрасывается и не блокирует
+ *  - фильтрацию по уровню: выключенный уровень не вычисляет аргументы
+ */
+class TestLogger : public QObject
+{
+    Q_OBJECT
+
+private:
+    /// Собирает записи, выведенные писателем (вызывается из его потока).
+    struct CapturedLog
+    {
+        QMutex mutex;
+        QStringList lines;
+    };
+
+    CapturedLog m_captured;
+
+    static int sideEffect(int* counter)
+    {
+        ++*counter;
+        return *counter;
+    }
+
+private slots:
+    void init()
+    {
+        m_captured.lines.clear();
+        lab2log::Logger::instance().setSink([this](const lab2log::LogRecord& r) {
+            QMutexLocker lock(&m_captured.mutex);
+            m_captured.lines << QString("%1 %2 %3").arg(lab2log::levelTag(r.level), r.category, r.text);
+        });
+        lab2log::Logger::instance().setLevel(lab2log::Level::Info);
+    }
+
+    void cleanup()
+    {
+        lab2log::Logger::instance().flush();
+        lab2log::Logger::instance().setSink(nullptr);
+    }
+
+    void test_ring_fifoAndBounds()
+    {
+        MpmcRingBuffer<int> q(3);
+        QCOMPARE(int(q.capacity()), 4); // округление до степени двойки
+
+        for (int i = 0; i < 4; ++i)
+            QVERIFY(q.tryPush(i));
+        QVERIFY(!q.tryPush(99)); // полна
+
+        int v = -1;
+        for (int i = 0; i < 4; ++i) {
+            QVERIFY(q.tryPop(v));
+            QCOMPARE(v, i);
+        }
+        QVERIFY(!q.tryPop(v)); // пуста
+    }
+
+    void test_ring_concurrentNoLoss()
+    {
+        constexpr int kProducers = 4;
+        constexpr int kPerProducer = 20000;
+
+        MpmcRingBuffer<int> q(256);
+        std::atomic<long long> sum { 0 };
+        std::atomic<int> consumed { 0 };
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < kProducers; ++p) {
+            threads.emplace_back([&q] {
+                for (int i = 1; i <= kPerProducer; ++i) {
+                    while (!q.tryPush(i))
+                        std::this_thread::yield();
+                }
+            });
+        }
+        for (int c = 0; c < 2; ++c) {
+            threads.emplace_back([&] {
+                int v = 0;
+                while (consumed.load() < kProducers * kPerProducer) {
+                    if (q.tryPop(v)) {
+                        sum += v;
+                        ++consumed;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+
+        const long long expected = kProducers * (static_cast<long long>(kPerProducer) * (kPerProducer + 1) / 2);
+        QCOMPARE(sum.load(), expected);
+    }
+
+    void test_logger_deliversToSink()
+    {
+        LAB2_INFO(lcTest()) << "hello" << 42;
+        LAB2_WARNING(lcTest()) << "careful";
+        lab2log::Logger::instance().flush();
+
+        QMutexLocker lock(&m_captured.mutex);
+        QCOMPARE(m_captured.lines.size(), 2);
+        QCOMPARE(m_captured.lines.at(0), QString("I test hello 42"));
+        QCOMPARE(m_captured.lines.at(1), QString("W test careful"));
+    }
+
+    /**
+     * @brief Предупреждений больше ёмкости буфера, sink медленный — все доходят по порядку.
+     */
+    void test_logger_fullRing_blocksWarnings()
+    {
+        constexpr int kRows = lab2log::Logger::kCapacity * 2 + 100;
+
+        QStringList got;
+        lab2log::Logger::instance().setSink([&got](const lab2log::LogRecord& r) {
+            if (got.size() % 1024 == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            got << r.text;
+        });
+
+        const quint64 droppedBefore = lab2log::Logger::instance().droppedCount();
+        for (int i = 0; i < kRows; ++i)
+            LAB2_WARNING(lcTest()) << i;
+        lab2log::Logger::instance().flush();
+
+        QCOMPARE(lab2log::Logger::instance().droppedCount(), droppedBefore);
+        QCOMPARE(got.size(), kRows);
+        for (int i = 0; i < kRows; ++i)
+            QCOMPARE(got.at(i), QString::number(i));
+    }
+
+    /**
+     * @brief Sink стоит, буфер полон — Info не ждёт писателя: лишние записи отбрасываются и считаются.
+     */
+    void test_logger_fullRing_dropsInfoWithoutBlocking()
+    {
+        constexpr int kRows = lab2log::Logger::kCapacity + 500;
+
+        std::atomic<bool> release { false };
+        QStringList got;
+        lab2log::Logger::instance().setSink([&](const lab2log::LogRecord& r) {
+            while (!release.load())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            got << r.text;
+        });
+
+        const quint64 droppedBefore = lab2log::Logger::instance().droppedCount();
+        // Писатель держит не больше одной записи в sink, остальное — в буфере: цикл завершается, не дожидаясь его.
+        for (int i = 0; i < kRows; ++i)
+            LAB2_INFO(lcTest()) << i;
+        const quint64 dropped = lab2log::Logger::instance().droppedCount() - droppedBefore;
+        release.store(true);
+        lab2log::Logger::instance().flush();
+
+        QVERIFY(dropped >= quint64(kRows - lab2log::Logger::kCapacity - 1));
+        QCOMPARE(quint64(got.size()) + dropped, quint64(kRows));
+        for (int i = 1; i < got.size(); ++i)
+            QVERIFY(got.at(i - 1).toInt() < got.at(i).toInt());
+    }
+
+    /**
+     * @brief Выключенный уровень не форматирует и даже не вычисляет аргументы.
+     */
+    void test_logger_disabledLevel_doesNotEvaluateArguments()
+    {
+        int counter = 0;
+        LAB2_DEBUG(lcTest()) << sideEffect(&counter);
+        QCOMPARE(counter, 0);
+
+        lab2log::Logger::instance().setCategoryLevel("test", lab2log::Level::Debug);
+        LAB2_DEBUG(lcTest()) << sideEffect(&counter);
+        QCOMPARE(counter, 1);
+
+        lab2log::Logger::instance().flush();
+        QMutexLocker lock(&m_captured.mutex);
+        QCOMPARE(m_captured.lines.size(), 1);
+    }
+
+    void test_parseLevel()
+    {
+        lab2log::Level level = lab2log::Level::Info;
+        QVERIFY(lab2log::Logger::parseLevel("Warning", &level));
+        QCOMPARE(level, lab2log::Level::Warning);
+        QVERIFY(!lab2log::Logger::parseLevel("verbose", &level));
+    }
+};
+
+QTEST_MAIN(TestLogger)
+#include "test_logger.moc"
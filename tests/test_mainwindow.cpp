@@ -2,9 +2,12 @@
 
 #include <QAction>
 #include <QDir>
+#include <QDockWidget>
 #include <QFile>
+#include <QLabel>
 #include <QMenu>
 #include <QMenuBar>
+#include <QScrollBar>
 #include <QSet>
 #include <QSqlDatabase>
 #include <QSqlError>
@@ -14,7 +17,18 @@
 #include <QTemporaryDir>
 #include <QVariant>
 
+#include "busyretry.h"
+#include "columnstats.h"
+#include "groupcommitter.h"
+#include "heatmapview.h"
+#include "logger.h"
 #include "mainwindow.h"
+#include "mydelegate.h"
+#include "penpalette.h"
+#include "pipelineimporter.h"
+#include "rectangleschema.h"
+#include "rectangletablemodel.h"
+#include "schemamigrator.h"
 
 /**
  * @brief Интеграционные тесты для MainWindow (Qt Widgets + QtSql + SQLite).
@@ -24,7 +38,9 @@
  *  - инициализацию окна и меню,
  *  - операции с БД (создание/закрытие соединения, создание/удаление таблицы, вставка данных),
  *  - инициализацию QSqlTableModel и работу с QTableView,
+ *  - вытеснение кэша строк окном модели без потери видимой области,
  *  - добавление/удаление строк через модель,
+ *  - переключение таблиц (selectTable) с тёплыми моделями,
  *  - безопасное поведение "guard"-веток при неготовой БД/модели.
  *
  * @note Внутренние приватные методы setupMenus_() и ensureDbOpen_() напрямую недоступны,
@@ -245,13 +261,20 @@ private slots:
         QVERIFY(bdActions.contains("Create table"));
         QVERIFY(bdActions.contains("Insert into"));
         QVERIFY(bdActions.contains("Print table"));
+        QVERIFY(bdActions.contains("Print to PDF"));
         QVERIFY(bdActions.contains("Drop table"));
+        QVERIFY(bdActions.contains("Lock contention"));
+        QVERIFY(bdActions.contains("Clear import progress"));
 
         const QSet<QString> modelActions = actionTexts(mModel);
         QVERIFY(modelActions.contains("Init table model"));
         QVERIFY(modelActions.contains("Select table"));
         QVERIFY(modelActions.contains("Insert row"));
         QVERIFY(modelActions.contains("Remove row"));
+        QVERIFY(modelActions.contains("Column statistics"));
+        QVERIFY(modelActions.contains("Group by"));
+        QVERIFY(modelActions.contains("Density heatmap"));
+        QVERIFY(modelActions.contains("Export tiles"));
 
         const QSet<QString> queryActions = actionTexts(mQuery);
         QVERIFY(queryActions.contains("Do query"));
@@ -372,40 +395,131 @@ private slots:
     }
 
     /**
-     * @brief Повторный onCreateTable() удаляет старую таблицу и создаёт заново.
+     * @brief Повторный onCreateTable() не удаляет существующую таблицу и данные.
      *
      * @details
-     * Проверяем ветку:
-     *  - table exists -> onDropTable() -> create again
+     * Схема ведётся миграциями: если версия уже последняя, таблица остаётся как есть.
      */
-    void test_onCreateTable_whenExists_recreatesTable()
+    void test_onCreateTable_whenExists_keepsData()
     {
         MainWindow w;
         QVERIFY(invokeSlot(w, "onCreateConnection"));
         QVERIFY(invokeSlot(w, "onCreateTable"));
 
-        // Вставим одну строку вручную, чтобы убедиться, что таблица действительно пересоздалась.
         {
             QSqlDatabase db = appDb();
             QSqlQuery q(db);
-            QVERIFY2(q.exec("INSERT INTO rectangle (pencolor, penstyle, penwidth, left, top, width, height) "
-                            "VALUES ('#ffffff', 1, 1, 1, 1, 1, 1);"),
+            const int white = PenPalette(db).idFor(QColor("#ffffff"));
+            QVERIFY(white > 0);
+            QVERIFY2(q.exec(QString("INSERT INTO rectangle (pen_id, penstyle, penwidth, left, top, width, height) "
+                                    "VALUES (%1, 1, 1, 1, 1, 1, 1);").arg(white)),
                      qPrintable(q.lastError().text()));
         }
 
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+
         {
             QSqlDatabase db = appDb();
+            QVERIFY(db.tables().contains("rectangle"));
             QCOMPARE(countRowsInRectangle(db), 1);
         }
+    }
 
-        // Повторный create должен дропнуть и создать пустую таблицу
+    /**
+     * @brief onCreateTable() выставляет PRAGMA user_version в последнюю версию схемы,
+     *        а onDropTable() сбрасывает её, чтобы таблицу можно было создать снова.
+     */
+    void test_onCreateTable_setsSchemaVersion_dropResetsIt()
+    {
+        MainWindow w;
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
         QVERIFY(invokeSlot(w, "onCreateTable"));
 
-        {
-            QSqlDatabase db = appDb();
-            QVERIFY(db.tables().contains("rectangle"));
-            QCOMPARE(countRowsInRectangle(db), 0);
-        }
+        const auto userVersion = [] {
+            QSqlQuery q(appDb());
+            return (q.exec("PRAGMA user_version;") && q.next()) ? q.value(0).toInt() : -1;
+        };
+
+        QCOMPARE(userVersion(), SchemaMigrator::latestVersion());
+
+        QVERIFY(invokeSlot(w, "onDropTable"));
+        QCOMPARE(userVersion(), 0);
+
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        QVERIFY(appDb().tables().contains("rectangle"));
+    }
+
+    /**
+     * @brief Отметки прерванного импорта не переживают Drop table / Create table,
+     *        Clear import progress удаляет отметку файла импорта.
+     */
+    void test_importProgress_clearedWithTable()
+    {
+        MainWindow w;
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+
+        const QString source = QFileInfo("rectangle_import.csv").absoluteFilePath();
+        const auto saveProgress = [&source] {
+            QSqlQuery q(appDb());
+            q.prepare("INSERT OR REPLACE INTO import_progress (source, file_size, file_mtime, byte_offset,"
+                      " line_no, batches, row_count, bad_lines, done) VALUES (?, 100, 1, 50, 5, 1, 4, 0, 0);");
+            q.addBindValue(source);
+            return q.exec();
+        };
+        const auto hasProgress = [] {
+            PipelineImporter::Progress p;
+            return PipelineImporter::loadProgress(appDb(), "rectangle_import.csv", &p);
+        };
+
+        QVERIFY(saveProgress());
+        QVERIFY(hasProgress());
+        QVERIFY(invokeSlot(w, "onClearImportProgress"));
+        QVERIFY(!hasProgress());
+
+        QVERIFY(saveProgress());
+        QVERIFY(invokeSlot(w, "onDropTable"));
+        QVERIFY(!hasProgress());
+
+        // Отметка, записанная без таблицы (import_progress переживает Drop table), снимается при создании новой.
+        QVERIFY(saveProgress());
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        QVERIFY(appDb().tables().contains("rectangle"));
+        QVERIFY(!hasProgress());
+    }
+
+    /**
+     * @brief Маркер 'X' в журнале и DROP TABLE атомарны: маркер не записался — таблица и версия на месте.
+     */
+    void test_onDropTable_markerAndDropAtomic()
+    {
+        MainWindow w;
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        QVERIFY(invokeSlot(w, "onInsertInto"));
+        QSqlDatabase db = appDb();
+        const int rows = countRowsInRectangle(db);
+        QVERIFY(rows > 0);
+
+        const auto scalar = [](const QString& sql) {
+            QSqlQuery q(appDb());
+            return (q.exec(sql) && q.next()) ? q.value(0).toInt() : -1;
+        };
+        const QString markers = "SELECT COUNT(*) FROM rectangle_changes WHERE op = 'X';";
+
+        QVERIFY(QSqlQuery(appDb()).exec("CREATE TRIGGER drop_marker_boom BEFORE INSERT ON rectangle_changes"
+                                        " WHEN NEW.op = 'X' BEGIN SELECT RAISE(ABORT, 'boom'); END;"));
+        QVERIFY(invokeSlot(w, "onDropTable"));
+        QVERIFY(db.tables().contains("rectangle"));
+        QCOMPARE(countRowsInRectangle(db), rows);
+        QCOMPARE(scalar("PRAGMA user_version;"), SchemaMigrator::latestVersion());
+        QCOMPARE(scalar(markers), 0);
+
+        QVERIFY(QSqlQuery(appDb()).exec("DROP TRIGGER drop_marker_boom;"));
+        QVERIFY(invokeSlot(w, "onDropTable"));
+        QVERIFY(!appDb().tables().contains("rectangle"));
+        QCOMPARE(scalar("PRAGMA user_version;"), 0);
+        QCOMPARE(scalar(markers), 1);
     }
 
     /**
@@ -507,6 +621,66 @@ private slots:
         QCOMPARE(countRowsInRectangle(db), 10);
     }
 
+    /**
+     * @brief Блокировка файла другим соединением: onInsertInto() ждёт и повторяет, а не падает.
+     *
+     * @details
+     * Проверяем:
+     *  - onCreateConnection() выставляет PRAGMA busy_timeout из политики BusyRetry
+     *  - INSERT под чужой пишущей транзакцией (BEGIN IMMEDIATE) повторяется; после её COMMIT все строки вставлены
+     *  - метрики: ожидание учтено, отказов нет
+     */
+    void test_onInsertInto_retriesWhileLockedByOtherConnection()
+    {
+        MainWindow w;
+        BusyRetry::Policy policy;
+        policy.busyTimeoutMs = 0;
+        policy.maxRetries = 5;
+        policy.baseDelayMs = 1;
+        policy.maxDelayMs = 2;
+        w.busyRetry().setPolicy(policy);
+
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        // Первый вызов заполняет словарь цветов: дальше вставкам нужен только INSERT.
+        QVERIFY(invokeSlot(w, "onInsertInto"));
+
+        QSqlDatabase db = appDb();
+        {
+            QSqlQuery q(db);
+            QVERIFY(q.exec("PRAGMA busy_timeout;") && q.next());
+            QCOMPARE(q.value(0).toInt(), 0);
+        }
+
+        {
+            QSqlDatabase blocker = QSqlDatabase::addDatabase("QSQLITE", "blocker_conn");
+            blocker.setDatabaseName(QDir::current().filePath("rectangle_data.sqlite"));
+            QVERIFY(blocker.open());
+            QSqlQuery lock(blocker);
+            QVERIFY2(lock.exec("BEGIN IMMEDIATE;"), qPrintable(lock.lastError().text()));
+
+            // Вторая пауза перед повтором — другой процесс отпускает файл.
+            int sleeps = 0;
+            w.busyRetry().setSleeper([&](int) {
+                if (++sleeps == 2)
+                    QSqlQuery(blocker).exec("COMMIT;");
+            });
+            w.busyRetry().resetStats();
+
+            QVERIFY(invokeSlot(w, "onInsertInto"));
+            QCOMPARE(sleeps, 2);
+            blocker.close();
+        }
+        QSqlDatabase::removeDatabase("blocker_conn");
+
+        QCOMPARE(countRowsInRectangle(db), 20);
+        const BusyRetry::Stats& st = w.busyRetry().stats();
+        QCOMPARE(st.contended, qint64(1));
+        QCOMPARE(st.retries, qint64(2));
+        QCOMPARE(st.failures, qint64(0));
+        QVERIFY(st.operations >= 10);
+    }
+
     /**
      * @brief onPrintTable() без открытой БД безопасен.
      */
@@ -547,6 +721,59 @@ private slots:
         QVERIFY(invokeSlot(w, "onPrintTable"));
     }
 
+    /**
+     * @brief Цвет, добавленный в pen_palette в обход словаря окна (как делают импорты), печатается как есть.
+     */
+    void test_onPrintTable_colorAddedByOtherPalette()
+    {
+        MainWindow w;
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        QVERIFY(invokeSlot(w, "onInsertInto")); // словарь окна загружен
+
+        {
+            QSqlDatabase db = appDb();
+            const int id = PenPalette(db).idFor(QColor("#13579b"));
+            QVERIFY(id > 0);
+            QSqlQuery q(db);
+            QVERIFY2(q.exec(QString("INSERT INTO rectangle (pen_id, penstyle, penwidth, left, top, width, height) "
+                                    "VALUES (%1, 1, 1, 1, 1, 1, 1);").arg(id)),
+                     qPrintable(q.lastError().text()));
+        }
+
+        QStringList lines;
+        lab2log::Logger::instance().flush();
+        lab2log::Logger::instance().setSink([&lines](const lab2log::LogRecord& r) { lines << r.text; });
+        QVERIFY(invokeSlot(w, "onPrintTable"));
+        lab2log::Logger::instance().flush();
+        lab2log::Logger::instance().setSink(nullptr);
+
+        QCOMPARE(lines.filter("color=").size(), 11);
+        QCOMPARE(lines.filter("#13579b").size(), 1);
+    }
+
+    /**
+     * @brief onExportChanges() выгружает журнал изменений только один раз.
+     *
+     * @details
+     * onInsertInto() вставляет 10 строк -> seq 1..10. Повторная выгрузка без новых
+     * изменений новых файлов не создаёт.
+     */
+    void test_onExportChanges_exportsOnlyNewChanges()
+    {
+        MainWindow w;
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        QVERIFY(invokeSlot(w, "onInsertInto"));
+
+        QVERIFY(invokeSlot(w, "onExportChanges"));
+        QVERIFY(QFile::exists(QDir::current().filePath("rectangle_changes_1-10.jsonl")));
+
+        QVERIFY(invokeSlot(w, "onExportChanges"));
+        const QStringList files = QDir::current().entryList({ "rectangle_changes_*.jsonl" }, QDir::Files);
+        QCOMPARE(files.size(), 1);
+    }
+
     /**
      * @brief onInitTableModel() без БД безопасен.
      */
@@ -613,6 +840,9 @@ private slots:
         QCOMPARE(model->headerData(5, Qt::Horizontal).toString(), QString("Top"));
         QCOMPARE(model->headerData(6, Qt::Horizontal).toString(), QString("Width"));
         QCOMPARE(model->headerData(7, Qt::Horizontal).toString(), QString("Height"));
+        QCOMPARE(model->headerData(8, Qt::Horizontal).toString(), QString("Right"));
+        QCOMPARE(model->headerData(9, Qt::Horizontal).toString(), QString("Bottom"));
+        QCOMPARE(model->headerData(10, Qt::Horizontal).toString(), QString("Area"));
 
         QVERIFY(tv->isColumnHidden(0));
 
@@ -620,6 +850,40 @@ private slots:
         QVERIFY(tv->itemDelegateForColumn(2) != nullptr);
     }
 
+    /**
+     * @brief Вычисляемые колонки (right, bottom, area) считаются SQLite и доступны только для чтения.
+     *
+     * @details
+     * Первая строка onInsertInto(): left=10, top=20, width=60, height=60.
+     */
+    void test_onInitTableModel_generatedColumnsReadOnly()
+    {
+        MainWindow w;
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        QVERIFY(invokeSlot(w, "onInsertInto"));
+        QVERIFY(invokeSlot(w, "onInitTableModel"));
+
+        auto* model = qobject_cast<QSqlTableModel*>(findTableView(w)->model());
+        QVERIFY(model != nullptr);
+        QCOMPARE(model->columnCount(), 11);
+
+        const int right = model->fieldIndex("right");
+        const int area = model->fieldIndex("area");
+        QCOMPARE(model->data(model->index(0, right)).toInt(), 70);
+        QCOMPARE(model->data(model->index(0, area)).toInt(), 3600);
+
+        QVERIFY(!(model->flags(model->index(0, area)) & Qt::ItemIsEditable));
+        QVERIFY(model->flags(model->index(0, model->fieldIndex("width"))) & Qt::ItemIsEditable);
+        QVERIFY(!model->setData(model->index(0, area), 1));
+
+        // Правка исходной колонки пересчитывает вычисляемую.
+        QVERIFY(model->setData(model->index(0, model->fieldIndex("width")), 100));
+        QVERIFY(model->submitAll());
+        QVERIFY(model->select());
+        QCOMPARE(model->data(model->index(0, right)).toInt(), 110);
+    }
+
     /**
      * @brief Повторный onInitTableModel() переиспользует уже созданную модель.
      *
@@ -646,6 +910,12 @@ private slots:
 
         QObject* secondModel = tv->model();
         QCOMPARE(secondModel, firstModel);
+
+        // Делегаты созданы один раз и не копятся при каждом показе модели.
+        QVERIFY(w.selectTable("rectangle"));
+        QCOMPARE(w.findChildren<MyDelegate*>().size(), 2);
+        QVERIFY(qobject_cast<MyDelegate*>(tv->itemDelegateForColumn(rectschema::PenColor)) != nullptr);
+        QVERIFY(qobject_cast<MyDelegate*>(tv->itemDelegateForColumn(rectschema::PenStyle)) != nullptr);
     }
 
     /**
@@ -810,12 +1080,336 @@ private slots:
 
 
     /**
-     * @brief onSelectTable() (заглушка) вызывается без падений.
+     * @brief Кэш строк модели учитывается в бюджете памяти и отображается в статус-баре.
+     */
+    void test_memoryBudget_tracksModelRowCache()
+    {
+        MainWindow w;
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        QVERIFY(invokeSlot(w, "onInsertInto"));
+
+        QCOMPARE(w.memoryBudget().totalBytes(), qint64(0));
+
+        QVERIFY(invokeSlot(w, "onInitTableModel"));
+
+        QCOMPARE(w.memoryBudget().totalBytes(),
+                 MemoryBudget::estimateRowCacheBytes(10, 11));
+
+        QLabel* label = w.findChild<QLabel*>("memoryLabel");
+        QVERIFY(label != nullptr);
+        QVERIFY(label->text().startsWith("Cache:"));
+    }
+
+    /**
+     * @brief Вытеснение кэша строк сдвигает окно модели, а не сбрасывает её.
+     *
+     * @details
+     * Видимая строка и текущая ячейка остаются теми же записями; прокрутка к началу окна
+     * сдвигает окно обратно вверх.
      */
-    void test_onSelectTable_stub_safe()
+    void test_memoryBudget_evictionKeepsViewport()
+    {
+        MainWindow w;
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        QVERIFY(invokeSlot(w, "onInsertInto"));
+
+        QSqlDatabase db = appDb();
+        QSqlQuery q(db);
+        for (int i = 0; i < 9; ++i) // 10 * 2^9 = 5120 строк
+            QVERIFY2(q.exec(QString("INSERT INTO rectangle (%1) SELECT %1 FROM rectangle;").arg(rectschema::kInsertColumns)),
+                     qPrintable(q.lastError().text()));
+
+        QVERIFY(invokeSlot(w, "onInitTableModel"));
+        QTableView* tv = findTableView(w);
+        QVERIFY(tv != nullptr);
+        auto* model = qobject_cast<RectangleTableModel*>(tv->model());
+        QVERIFY(model != nullptr);
+        while (model->canFetchMore())
+            model->fetchMore();
+        QCOMPARE(model->rowCount(), 5120);
+
+        tv->resize(300, 200);
+        tv->doItemsLayout();
+        tv->setCurrentIndex(model->index(4001, 4));
+        tv->scrollTo(model->index(4000, 1), QAbstractItemView::PositionAtTop);
+        const auto idAt = [&](int row) { return model->data(model->index(row, 0)).toLongLong(); };
+        const qint64 topId = idAt(tv->rowAt(0));
+        const qint64 currentId = idAt(tv->currentIndex().row());
+
+        w.memoryBudget().setLimitBytes(MemoryBudget::estimateRowCacheBytes(2000, 11));
+        QVERIFY(w.memoryBudget().enforce() > 0);
+
+        const int offset = model->windowOffset();
+        QVERIFY(offset > 0);
+        QVERIFY(model->rowCount() < 2000);
+        QCOMPARE(idAt(tv->rowAt(0)), topId);
+        QCOMPARE(idAt(tv->currentIndex().row()), currentId);
+        QCOMPARE(model->headerData(0, Qt::Vertical).toInt(), offset + 1);
+
+        // Прокрутка к началу окна — окно сдвигается вверх, первая строка окна остаётся видимой.
+        const qint64 firstId = idAt(0);
+        tv->verticalScrollBar()->triggerAction(QAbstractSlider::SliderToMinimum);
+        QTRY_VERIFY(model->windowOffset() < offset);
+        QCOMPARE(idAt(tv->rowAt(0)), firstId);
+    }
+
+    /**
+     * @brief onExportFrameStats() пишет статистику кадров в frame_stats.json.
+     */
+    void test_onExportFrameStats_writesJsonFile()
+    {
+        MainWindow w;
+        w.frameStats().recordFrame(5 * 1000 * 1000, 0, 0);
+
+        QVERIFY(invokeSlot(w, "onExportFrameStats"));
+
+        QFile f(QDir::current().filePath("frame_stats.json"));
+        QVERIFY(f.exists());
+        QVERIFY(w.findChild<QLabel*>("frameLabel") != nullptr);
+    }
+
+    /**
+     * @brief Снимок таблицы пишется в фоне и показывается в tableView без обращения к БД.
+     *
+     * @details
+     * Вид снимка — только чтение: Insert row не меняет ни снимок, ни таблицу.
+     * Density heatmap открывает тот же файл.
+     */
+    void test_snapshot_saveAndLoadView()
+    {
+        MainWindow w;
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        QVERIFY(invokeSlot(w, "onInsertInto"));
+        QVERIFY(invokeSlot(w, "onInitTableModel"));
+
+        QVERIFY(invokeSlot(w, "onSaveSnapshot"));
+        const QString snapshot = QDir::current().filePath("rectangle_data.snapshot");
+        QTRY_VERIFY_WITH_TIMEOUT(QFile::exists(snapshot), 10000);
+
+        QVERIFY(invokeSlot(w, "onCloseConnection"));
+        QVERIFY(invokeSlot(w, "onLoadSnapshotView"));
+
+        QTableView* view = findTableView(w);
+        QVERIFY(view != nullptr);
+        QVERIFY(view->model() != nullptr);
+        QCOMPARE(view->model()->rowCount(), 10);
+        QVERIFY(qobject_cast<QSqlTableModel*>(view->model()) == nullptr);
+
+        // Тепловая карта того же снимка: все 10 прямоугольников попадают в начальную область.
+        QVERIFY(invokeSlot(w, "onShowHeatmap"));
+        HeatmapView* heatmap = w.heatmapView();
+        QVERIFY(heatmap != nullptr);
+        QCOMPARE(heatmap->snapshot().rowCount(), qint64(10));
+        heatmap->resize(200, 150);
+        heatmap->resetView();
+        heatmap->ensureRendered();
+        QCOMPARE(heatmap->heatmap().visibleRows(), qint64(10));
+        QVERIFY(heatmap->heatmap().maxCount() >= 1);
+
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onInsertRow"));
+        QCOMPARE(view->model()->rowCount(), 10);
+
+        QSqlDatabase db = appDb();
+        QCOMPARE(countRowsInRectangle(db), 10);
+    }
+
+    /**
+     * @brief onSelectTable() без соединения не падает и ничего не открывает.
+     */
+    void test_onSelectTable_withoutConnection_safe()
     {
         MainWindow w;
         QVERIFY(invokeSlot(w, "onSelectTable"));
+        QVERIFY(w.currentTable().isEmpty());
+    }
+
+    /**
+     * @brief selectTable() переключает таблицы; при возврате — та же модель без select().
+     *
+     * @details
+     * Вторая таблица rectangle_b создаётся по описанию схемы. У первой таблицы
+     * восстанавливаются прокрутка и текущая строка, оба кэша строк учтены в бюджете.
+     */
+    void test_selectTable_keepsWarmModel()
+    {
+        MainWindow w;
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        for (int i = 0; i < 10; ++i)
+            QVERIFY(invokeSlot(w, "onInsertInto")); // 100 строк
+
+        QSqlDatabase db = appDb();
+        QSqlQuery q(db);
+        QVERIFY2(q.exec(QString(rectschema::kCreateTableSql).arg("rectangle_b")), qPrintable(q.lastError().text()));
+        QVERIFY2(q.exec(QString("INSERT INTO rectangle_b (%1) SELECT %1 FROM rectangle WHERE id <= 3;")
+                        .arg(rectschema::kInsertColumns)),
+                 qPrintable(q.lastError().text()));
+
+        QVERIFY(invokeSlot(w, "onInitTableModel"));
+        QCOMPARE(w.currentTable(), QString("rectangle"));
+
+        QTableView* tv = findTableView(w);
+        QVERIFY(tv != nullptr);
+        QAbstractItemModel* first = tv->model();
+        tv->resize(300, 200);
+        tv->doItemsLayout();
+        tv->setCurrentIndex(first->index(42, 4));
+        tv->verticalScrollBar()->setValue(tv->verticalScrollBar()->maximum() / 2);
+        const int scroll = tv->verticalScrollBar()->value();
+
+        QVERIFY(w.selectTable("rectangle_b"));
+        QCOMPARE(w.currentTable(), QString("rectangle_b"));
+        QVERIFY(tv->model() != first);
+        QCOMPARE(tv->model()->rowCount(), 3);
+        QCOMPARE(tv->model()->data(tv->model()->index(0, 1)).toString(), QString("#ff0000"));
+        QCOMPARE(w.warmModels().tables(), QStringList({ "rectangle" }));
+
+        QVERIFY(w.selectTable("rectangle"));
+        QCOMPARE(tv->model(), first);
+        QCOMPARE(first->rowCount(), 100);
+        QCOMPARE(tv->currentIndex().row(), 42);
+        QCOMPARE(tv->verticalScrollBar()->value(), scroll);
+        QCOMPARE(w.warmModels().tables(), QStringList({ "rectangle_b" }));
+        QCOMPARE(w.warmModels().hits(), quint64(1));
+
+        QCOMPARE(w.memoryBudget().totalBytes(),
+                 MemoryBudget::estimateRowCacheBytes(100, 11) + MemoryBudget::estimateRowCacheBytes(3, 11));
+
+        // Журнал изменений — не таблица прямоугольников.
+        QVERIFY(!w.selectTable("rectangle_changes"));
+        QCOMPARE(w.currentTable(), QString("rectangle"));
+    }
+
+    /**
+     * @brief Таблица присоединённой БД показывается с цветами из её собственного pen_palette.
+     */
+    void test_selectTable_attachedDatabase()
+    {
+        {
+            QSqlDatabase other = QSqlDatabase::addDatabase("QSQLITE", "other_conn");
+            other.setDatabaseName(QDir::current().filePath("other.sqlite"));
+            QVERIFY(other.open());
+            SchemaMigrator migrator(other);
+            QVERIFY2(migrator.migrate(), qPrintable(migrator.lastError()));
+
+            // id цвета в aux не совпадает с id того же цвета в основной БД.
+            PenPalette palette(other);
+            QVERIFY(palette.idFor(QColor("#00ff00")) > 0);
+            const int id = palette.idFor(QColor("#123456"));
+            QSqlQuery q(other);
+            QVERIFY2(q.exec(QString("INSERT INTO rectangle (pen_id, penstyle, penwidth, left, top, width, height) "
+                                    "VALUES (%1, 1, 1, 0, 0, 5, 5);").arg(id)),
+                     qPrintable(q.lastError().text()));
+            other.close();
+        }
+        QSqlDatabase::removeDatabase("other_conn");
+
+        MainWindow w;
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        QVERIFY(invokeSlot(w, "onInsertInto"));
+
+        QSqlDatabase db = appDb();
+        QSqlQuery q(db);
+        QVERIFY2(q.exec("ATTACH DATABASE 'other.sqlite' AS aux;"), qPrintable(q.lastError().text()));
+
+        QVERIFY(w.selectTable("aux.rectangle"));
+        QTableView* tv = findTableView(w);
+        QCOMPARE(tv->model()->rowCount(), 1);
+        QCOMPARE(tv->model()->data(tv->model()->index(0, 1)).toString(), QString("#123456"));
+    }
+
+    /**
+     * @brief Column statistics: сводка по скану, затем правки модели и Insert into без ручного пересчёта.
+     */
+    void test_onColumnStatistics_tracksEdits()
+    {
+        MainWindow w;
+        QVERIFY(invokeSlot(w, "onColumnStatistics")); // без соединения — ранний выход
+        QVERIFY(!w.columnStats()->isInitialized());
+
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        QVERIFY(invokeSlot(w, "onInsertInto"));
+
+        QVERIFY(invokeSlot(w, "onColumnStatistics"));
+        QVERIFY(w.columnStats()->isInitialized());
+        QCOMPARE(w.columnStats()->stats().rows(), qint64(10));
+        auto* dock = w.findChild<QDockWidget*>("columnStatsDock");
+        QVERIFY(dock != nullptr);
+        QVERIFY(dock->isVisibleTo(&w));
+
+        // Insert into пишет в обход модели — вставленные строки добавляются сводкой, без скана.
+        QVERIFY(invokeSlot(w, "onInsertInto"));
+        QCOMPARE(w.columnStats()->stats().rows(), qint64(20));
+        QCOMPARE(w.columnStats()->updatesApplied(), quint64(10));
+
+        // Удаление через модель — инкрементально.
+        QVERIFY(invokeSlot(w, "onInitTableModel"));
+        QTableView* tv = findTableView(w);
+        QVERIFY(tv != nullptr);
+        tv->selectRow(0);
+        QVERIFY(invokeSlot(w, "onRemoveRow"));
+
+        QSqlDatabase db = appDb();
+        QCOMPARE(w.columnStats()->stats().rows(), qint64(countRowsInRectangle(db)));
+        QCOMPARE(w.columnStats()->stats().rows(), qint64(19));
+        QCOMPARE(w.columnStats()->updatesApplied(), quint64(11));
+    }
+
+    /**
+     * @brief Группа правок откатилась (COMMIT упёрся в читателя) — сводка снова совпадает с таблицей.
+     */
+    void test_onColumnStatistics_groupRollbackResyncs()
+    {
+        static constexpr const char* kReader = "stats_reader";
+
+        // Без ожидания блокировки: COMMIT сразу получает SQLITE_BUSY.
+        qputenv(BusyRetry::kEnvBusyTimeoutMs, "0");
+        qputenv(BusyRetry::kEnvMaxRetries, "0");
+        MainWindow w;
+        qunsetenv(BusyRetry::kEnvBusyTimeoutMs);
+        qunsetenv(BusyRetry::kEnvMaxRetries);
+
+        QVERIFY(invokeSlot(w, "onCreateConnection"));
+        QVERIFY(invokeSlot(w, "onCreateTable"));
+        QVERIFY(invokeSlot(w, "onInsertInto"));
+        QVERIFY(invokeSlot(w, "onColumnStatistics"));
+        QCOMPARE(w.columnStats()->stats().rows(), qint64(10));
+
+        QVERIFY(invokeSlot(w, "onInitTableModel"));
+        QTableView* tv = findTableView(w);
+        QVERIFY(tv != nullptr);
+        tv->selectRow(0);
+        QVERIFY(invokeSlot(w, "onRemoveRow"));
+        QCOMPARE(w.columnStats()->stats().rows(), qint64(9));
+
+        {
+            QSqlDatabase reader = QSqlDatabase::addDatabase("QSQLITE", kReader);
+            reader.setDatabaseName(appDb().databaseName());
+            QVERIFY(reader.open());
+            QSqlQuery q(reader);
+            QVERIFY(reader.transaction());
+            QVERIFY(q.exec("SELECT COUNT(*) FROM rectangle;") && q.next());
+        }
+
+        QVERIFY(!w.groupCommitter()->flush());
+        QCOMPARE(w.groupCommitter()->groupsRolledBack(), quint64(1));
+        QCOMPARE(w.columnStats()->stats().rows(), qint64(10));
+
+        {
+            QSqlDatabase reader = QSqlDatabase::database(kReader, false);
+            reader.rollback();
+            reader.close();
+        }
+        QSqlDatabase::removeDatabase(kReader);
+
+        QSqlDatabase db = appDb();
+        QCOMPARE(countRowsInRectangle(db), 10);
     }
 
     /**
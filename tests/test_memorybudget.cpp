@@ -0,0 +1,139 @@
+#include <QtTest/QtTest>
+
+#include "memorybudget.h"
+
+/**
+ * @brief Тесты для MemoryBudget.
+ *
+ * Проверяем:
+ *  - суммирование объёма зарегистрированных кэшей
+ *  - отсутствие вытеснения, пока бюджет не превышен
+ *  - порядок вытеснения: сначала самый "холодный" кэш
+ *  - снятие кэша с учёта
+ *  - чтение бюджета из переменной окружения
+ */
+class TestMemoryBudget : public QObject
+{
+    Q_OBJECT
+
+private:
+    /// Простой кэш для тестов: хранит "объём" и освобождает всё по запросу.
+    struct FakeCache
+    {
+        qint64 bytes = 0;
+        int evictCalls = 0;
+
+        qint64 evict(qint64)
+        {
+            ++evictCalls;
+            const qint64 freed = bytes;
+            bytes = 0;
+            return freed;
+        }
+    };
+
+    static int registerFake(MemoryBudget& budget, const QString& name, FakeCache& cache)
+    {
+        return budget.registerConsumer(name,
+                                       [&cache] { return cache.bytes; },
+                                       [&cache](qint64 n) { return cache.evict(n); });
+    }
+
+private slots:
+    void test_totalBytes_sumsConsumers()
+    {
+        MemoryBudget budget(1000);
+        FakeCache a, b;
+        a.bytes = 100;
+        b.bytes = 250;
+        registerFake(budget, "a", a);
+        registerFake(budget, "b", b);
+
+        QCOMPARE(budget.totalBytes(), qint64(350));
+        QCOMPARE(budget.usage().size(), 2);
+        QCOMPARE(budget.usage().at(1).name, QString("b"));
+    }
+
+    void test_enforce_underLimit_doesNothing()
+    {
+        MemoryBudget budget(1000);
+        FakeCache a;
+        a.bytes = 900;
+        registerFake(budget, "a", a);
+
+        QCOMPARE(budget.enforce(), qint64(0));
+        QCOMPARE(a.evictCalls, 0);
+        QCOMPARE(a.bytes, qint64(900));
+    }
+
+    /**
+     * @brief При превышении бюджета вытесняется самый давно использованный кэш.
+     *
+     * @details
+     * "hot" был отмечен touch() позже, поэтому должен остаться нетронутым,
+     * если освобождения "cold" достаточно.
+     */
+    void test_enforce_evictsColdestFirst()
+    {
+        MemoryBudget budget(500);
+        FakeCache cold, hot;
+        cold.bytes = 400;
+        hot.bytes = 300;
+        const int coldId = registerFake(budget, "cold", cold);
+        const int hotId  = registerFake(budget, "hot", hot);
+
+        budget.touch(coldId);
+        budget.touch(hotId);
+
+        QCOMPARE(budget.enforce(), qint64(400));
+        QCOMPARE(cold.evictCalls, 1);
+        QCOMPARE(hot.evictCalls, 0);
+        QVERIFY(budget.totalBytes() <= budget.limitBytes());
+    }
+
+    void test_enforce_zeroLimit_disabled()
+    {
+        MemoryBudget budget(0);
+        FakeCache a;
+        a.bytes = 1 << 20;
+        registerFake(budget, "a", a);
+
+        QCOMPARE(budget.enforce(), qint64(0));
+        QCOMPARE(a.evictCalls, 0);
+    }
+
+    void test_unregisterConsumer_removesFromTotals()
+    {
+        MemoryBudget budget(1000);
+        FakeCache a;
+        a.bytes = 123;
+        const int id = registerFake(budget, "a", a);
+
+        budget.unregisterConsumer(id);
+
+        QCOMPARE(budget.totalBytes(), qint64(0));
+        QVERIFY(budget.usage().isEmpty());
+    }
+
+    void test_limitFromEnvironment()
+    {
+        qputenv(MemoryBudget::kEnvLimitMb, "3");
+        QCOMPARE(MemoryBudget::limitFromEnvironment(7), qint64(3) * 1024 * 1024);
+
+        qputenv(MemoryBudget::kEnvLimitMb, "not-a-number");
+        QCOMPARE(MemoryBudget::limitFromEnvironment(7), qint64(7));
+
+        qunsetenv(MemoryBudget::kEnvLimitMb);
+        QCOMPARE(MemoryBudget::limitFromEnvironment(7), qint64(7));
+    }
+
+    void test_estimateRowCacheBytes()
+    {
+        QCOMPARE(MemoryBudget::estimateRowCacheBytes(0, 8), qint64(0));
+        QCOMPARE(MemoryBudget::estimateRowCacheBytes(10, 8),
+                 qint64(10) * 8 * MemoryBudget::kRowCacheBytesPerCell);
+    }
+};
+
+QTEST_MAIN(TestMemoryBudget)
+#include "test_memorybudget.moc"
@@ -0,0 +1,145 @@
+#include <QtTest/QtTest>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <atomic>
+
+#include "parallelscanner.h"
+#include "penpalette.h"
+#include "rectanalytics.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты параллельного скана ParallelScanner.
+ *
+ * Проверяем:
+ *  - split(): части покрывают диапазон без пересечений
+ *  - scan(): каждая строка посещается ровно один раз, в том числе при "дырах" в id
+ *  - aggregate(): результат совпадает с однопоточным SQL-агрегатом, начальное значение учтено один раз
+ *  - пустая таблица и ошибка открытия БД
+ */
+class TestParallelScanner : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestDb m_db { "scan_conn", "scan.sqlite" };
+
+    bool fill(int rows)
+    {
+        QSqlDatabase d = m_db.db();
+        d.transaction();
+        QSqlQuery q(d);
+        q.prepare(QString("INSERT INTO rectangle (pen_id, penstyle, penwidth, left, top, width, height) "
+                          "VALUES (%1, 1, ?, ?, ?, ?, ?);").arg(PenPalette(d).idFor(QColor("#ff0000"))));
+        for (int i = 0; i < rows; ++i) {
+            q.addBindValue(1 + i % 7);
+            q.addBindValue(i % 300 - 100);
+            q.addBindValue(i % 200);
+            q.addBindValue(1 + i % 50);
+            q.addBindValue(1 + i % 30);
+            if (!q.exec()) {
+                qWarning() << q.lastError().text();
+                d.rollback();
+                return false;
+            }
+        }
+        return d.commit();
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_split_coversRangeWithoutOverlap()
+    {
+        const auto parts = ParallelScanner::split(5, 104, 3);
+        QCOMPARE(parts.size(), 3);
+        QCOMPARE(parts.first().fromId, qint64(5));
+        QCOMPARE(parts.last().toId, qint64(104));
+        for (int i = 1; i < parts.size(); ++i)
+            QCOMPARE(parts.at(i).fromId, parts.at(i - 1).toId + 1);
+
+        // Частей не больше, чем id в диапазоне.
+        QCOMPARE(ParallelScanner::split(1, 2, 8).size(), 2);
+        QVERIFY(ParallelScanner::split(10, 9, 4).isEmpty());
+    }
+
+    void test_scan_visitsEveryRowOnce()
+    {
+        QVERIFY(fill(2000));
+        QVERIFY(QSqlQuery(m_db.db()).exec("DELETE FROM rectangle WHERE id BETWEEN 300 AND 900;"));
+
+        ParallelScanner scanner(m_db.path(), 4);
+        std::atomic<qint64> rows { 0 };
+        std::atomic<qint64> idSum { 0 };
+        QVERIFY2(scanner.scan([&](int, const RectRow& r) {
+            ++rows;
+            idSum += r.id;
+        }), qPrintable(scanner.lastError()));
+
+        QCOMPARE(rows.load(), m_db.scalar("SELECT COUNT(*) FROM rectangle;"));
+        QCOMPARE(idSum.load(), m_db.scalar("SELECT SUM(id) FROM rectangle;"));
+        QCOMPARE(scanner.rowsScanned(), rows.load());
+    }
+
+    void test_aggregate_matchesSql()
+    {
+        QVERIFY(fill(5000));
+
+        ParallelScanner scanner(m_db.path(), 4);
+        RectAnalytics a;
+        QVERIFY(scanner.aggregate(
+                    a,
+                    [](RectAnalytics& acc, const RectRow& r) { acc.add(r.rect); },
+                    [](RectAnalytics& acc, const RectAnalytics& part) { acc.merge(part); }));
+
+        QCOMPARE(a.rows, qint64(5000));
+        QCOMPARE(a.totalArea, m_db.scalar("SELECT SUM(width * height) FROM rectangle;"));
+        QCOMPARE(a.penWidthSum, m_db.scalar("SELECT SUM(penwidth) FROM rectangle;"));
+        QCOMPARE(a.minX, m_db.scalar("SELECT MIN(left) FROM rectangle;"));
+        QCOMPARE(a.maxY, m_db.scalar("SELECT MAX(top + height) FROM rectangle;"));
+    }
+
+    /// Начальное значение result учитывается один раз, а не в каждой части.
+    void test_aggregate_nonEmptyInitial_countedOnce()
+    {
+        QVERIFY(fill(1000));
+
+        ParallelScanner scanner(m_db.path(), 4);
+        qint64 rows = 7;
+        QVERIFY(scanner.aggregate(
+                    rows,
+                    [](qint64& acc, const RectRow&) { ++acc; },
+                    [](qint64& acc, qint64 part) { acc += part; }));
+        QCOMPARE(rows, qint64(1007));
+    }
+
+    void test_scan_emptyTable_ok()
+    {
+        ParallelScanner scanner(m_db.path(), 4);
+        int calls = 0;
+        QVERIFY(scanner.scan([&](int, const RectRow&) { ++calls; }));
+        QCOMPARE(calls, 0);
+    }
+
+    void test_scan_missingDatabase_fails()
+    {
+        ParallelScanner scanner(m_db.filePath("missing/none.sqlite"), 2);
+        QVERIFY(!scanner.scan([](int, const RectRow&) {}));
+        QVERIFY(!scanner.lastError().isEmpty());
+    }
+};
+
+QTEST_MAIN(TestParallelScanner)
+#include "test_parallelscanner.moc"
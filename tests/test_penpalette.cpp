@@ -0,0 +1,127 @@
+#include <QtTest/QtTest>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+
+#include "penpalette.h"
+#include "rectangleschema.h"
+#include "rectangletablemodel.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты PenPalette (словарь цветов pen_palette).
+ *
+ * Проверяем:
+ *  - idFor() добавляет новый цвет один раз и дальше отвечает из кэша
+ *  - color() находит цвета, добавленные другим экземпляром (другим соединением)
+ *  - отсутствующий id перечитывает таблицу один раз (до invalidate())
+ *  - loadColors() возвращает таблицу цветов по id
+ *  - RectangleTableModel показывает pen_id как "#rrggbb" и принимает цвет при правке
+ */
+class TestPenPalette : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestDb m_db { "palette_conn", "palette.sqlite" };
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_idFor_addsOnceAndCaches()
+    {
+        PenPalette palette(m_db.db());
+        QCOMPARE(palette.size(), 0);
+
+        const int red = palette.idFor(QColor("#ff0000"));
+        QVERIFY2(red > 0, qPrintable(palette.lastError()));
+        QCOMPARE(palette.idFor(QColor("#FF0000")), red);
+        QCOMPARE(palette.idFor(QColor(Qt::red)), red);
+
+        const int blue = palette.idFor(QColor("#0000ff"));
+        QVERIFY(blue > 0);
+        QVERIFY(blue != red);
+
+        QCOMPARE(palette.size(), 2);
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM pen_palette;"), qint64(2));
+        QCOMPARE(palette.color(red), QColor("#ff0000"));
+        QCOMPARE(palette.color(0), QColor());
+        QCOMPARE(palette.color(1000), QColor());
+    }
+
+    void test_color_seesIdsFromOtherInstance()
+    {
+        PenPalette reader(m_db.db());
+        QCOMPARE(reader.colors().size(), 0);
+
+        PenPalette writer(m_db.db());
+        const int green = writer.idFor(QColor("#00ff00"));
+        QVERIFY(green > 0);
+
+        // Неизвестный id перечитывает словарь.
+        QCOMPARE(reader.color(green), QColor("#00ff00"));
+        QCOMPARE(reader.idFor(QColor("#00ff00")), green);
+
+        QString error;
+        const QVector<QColor> colors = PenPalette::loadColors(m_db.db(), &error);
+        QVERIFY(error.isEmpty());
+        QCOMPARE(colors.size(), green + 1);
+        QCOMPARE(colors.at(green), QColor("#00ff00"));
+    }
+
+    void test_color_missingIdRemembered()
+    {
+        PenPalette palette(m_db.db());
+        const int red = palette.idFor(QColor("#ff0000"));
+        QVERIFY(red > 0);
+
+        QCOMPARE(palette.color(50), QColor());
+
+        // Перечитывания нет: id 50 уже искали, строка, добавленная в обход словаря, не видна.
+        QVERIFY(m_db.exec("INSERT INTO pen_palette (id, color) VALUES (50, '#123456');"));
+        QCOMPARE(palette.color(50), QColor());
+        QCOMPARE(palette.color(red), QColor("#ff0000"));
+
+        palette.invalidate();
+        QCOMPARE(palette.color(50), QColor("#123456"));
+    }
+
+    void test_model_mapsPenIdToColor()
+    {
+        PenPalette palette(m_db.db());
+        const int red = palette.idFor(QColor("#ff0000"));
+        QVERIFY(QSqlQuery(m_db.db()).exec(QString("INSERT INTO rectangle (pen_id, penstyle, penwidth, left, top, width, height) "
+                                             "VALUES (%1, 1, 1, 0, 0, 10, 10);").arg(red)));
+
+        RectangleTableModel model(nullptr, m_db.db());
+        model.setPalette(&palette);
+        model.setTable(rectschema::kTable);
+        model.setEditStrategy(QSqlTableModel::OnManualSubmit);
+        QVERIFY(model.select());
+
+        const QModelIndex pen = model.index(0, rectschema::PenColor);
+        QCOMPARE(model.data(pen).toString(), QString("#ff0000"));
+        QCOMPARE(model.data(pen, Qt::EditRole).toString(), QString("#ff0000"));
+
+        QVERIFY(model.setData(pen, QColor("#123456"), Qt::EditRole));
+        QVERIFY2(model.submitAll(), qPrintable(model.lastError().text()));
+
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM pen_palette;"), qint64(2));
+        QCOMPARE(m_db.scalar("SELECT pen_id FROM rectangle;"), qint64(palette.idFor(QColor("#123456"))));
+        QCOMPARE(model.data(model.index(0, rectschema::PenColor)).toString(), QString("#123456"));
+    }
+};
+
+QTEST_MAIN(TestPenPalette)
+#include "test_penpalette.moc"
@@ -0,0 +1,307 @@
+#include <QtTest/QtTest>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QScrollBar>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <limits>
+
+#include "framestats.h"
+#include "instrumentedtableview.h"
+#include "mydelegate.h"
+#include "myrect.h"
+#include "penpalette.h"
+#include "rectangleschema.h"
+#include "rectangletablemodel.h"
+#include "rectbulkio.h"
+
+#include "testdb.h"
+
+#ifndef LAB2_PERF_BASELINE_FILE
+#error "LAB2_PERF_BASELINE_FILE must point to tests/perf_baseline.json"
+#endif
+
+/**
+ * @brief Регрессионный тест производительности с сохранённым baseline.
+ *
+ * @details
+ * Фиксированная нагрузка на детерминированном наборе данных (seed kSeed) в схеме последней версии
+ * (SchemaMigrator через TestDb: pen_id + словарь цветов, триггеры журнала изменений):
+ *  - bulk insert   — вставка rows строк одной транзакцией через RectBulkWriter,
+ *  - full scan     — forward-only SELECT с чтением всех хранимых полей,
+ *  - model load    — RectangleTableModel::select() + fetchMore() до конца,
+ *  - paint loop    — kPaintFrames кадров InstrumentedTableView с MyDelegate при прокрутке.
+ *
+ * Для пропускной способности (ед./с) берётся лучший из kRuns прогонов, тест падает, если результат
+ * ниже baseline * (1 - tolerance). p99 времени кадра (paint_p99_ms) — наоборот: падает, если выше
+ * baseline * (1 + tolerance).
+ *
+ * @note Тест меряет только Release-сборку (отдельное задание CI: ctest -C Release -L perf),
+ *       в Debug он пропускается (QSKIP). Release-сборка без измеренных metrics в baseline — ошибка,
+ *       а не пропуск: иначе порог молча не проверяется.
+ *
+ * @note Функциональные тесты (test_mainwindow) не зависят от скорости, поэтому
+ *       деградация производительности ловится только здесь.
+ *
+ * @note LAB2_PERF_UPDATE_BASELINE=1 — не сравнивать, а перезаписать baseline
+ *       результатами текущей машины (делается на эталонной сборке CI).
+ */
+class TestPerfGate : public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr quint32 kSeed = 20260101;
+    static constexpr int kRuns = 3;
+    static constexpr int kPaintFrames = 50;
+
+    /// Направление сравнения с baseline.
+    enum class Better { Higher, Lower };
+
+    TestDb m_db { "perf_conn", "perf.sqlite" };
+    QJsonObject m_baseline;
+    QJsonObject m_measured;
+    int m_rows = 20000;
+    double m_tolerance = 0.25;
+    bool m_updateMode = false;
+
+private:
+    QSqlDatabase db() const { return m_db.db(); }
+
+    /// Детерминированный набор прямоугольников.
+    static QVector<MyRect> makeDataset(int n)
+    {
+        static const Qt::PenStyle styles[] = {
+            Qt::SolidLine, Qt::DashLine, Qt::DotLine, Qt::DashDotLine, Qt::DashDotDotLine
+        };
+
+        QRandomGenerator rng(kSeed);
+        QVector<MyRect> rects;
+        rects.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            rects.push_back(MyRect(QColor::fromRgb(rng.bounded(0x1000000u)),
+                                   styles[rng.bounded(5)],
+                                   1 + rng.bounded(8),
+                                   rng.bounded(4000), rng.bounded(4000),
+                                   1 + rng.bounded(500), 1 + rng.bounded(500)));
+        }
+        return rects;
+    }
+
+    bool insertAll(const QVector<MyRect>& rects) const
+    {
+        QSqlDatabase d = db();
+        if (!d.transaction()) return false;
+        {
+            RectBulkWriter w(d);
+            if (!w.isValid()) {
+                qWarning() << "writer:" << w.lastError();
+                d.rollback();
+                return false;
+            }
+            for (const auto& r : rects) {
+                if (!w.insert(r)) {
+                    qWarning() << "insert failed:" << w.lastError();
+                    d.rollback();
+                    return false;
+                }
+            }
+        }
+        return d.commit();
+    }
+
+    static double rate(qint64 units, qint64 ns)
+    {
+        return ns > 0 ? units * 1e9 / ns : 0.0;
+    }
+
+    /**
+     * @brief Сравнивает метрику с baseline (или запоминает её в режиме обновления).
+     * @param better Higher — пропускная способность (порог снизу), Lower — время (порог сверху).
+     * @param message Диагностика для QVERIFY2.
+     */
+    bool withinBaseline(const QString& metric, double measured, Better better, QString* message)
+    {
+        m_measured[metric] = measured;
+        if (m_updateMode) {
+            *message = QString("%1: measured %2 (baseline update)").arg(metric).arg(measured, 0, 'f', 1);
+            qInfo().noquote() << *message;
+            return true;
+        }
+
+        const QJsonValue value = m_baseline.value("metrics").toObject().value(metric);
+        if (!value.isDouble()) {
+            *message = QString("%1: measured %2, no baseline").arg(metric).arg(measured, 0, 'f', 1);
+            return false;
+        }
+
+        const double base = value.toDouble();
+        const double limit = better == Better::Higher ? base * (1.0 - m_tolerance) : base * (1.0 + m_tolerance);
+        *message = QString("%1: measured %2, baseline %3, %4 %5")
+                .arg(metric).arg(measured, 0, 'f', 1).arg(base, 0, 'f', 1)
+                .arg(better == Better::Higher ? "floor" : "ceiling").arg(limit, 0, 'f', 1);
+        qInfo().noquote() << *message;
+
+        return better == Better::Higher ? measured >= limit : measured <= limit;
+    }
+
+private slots:
+    void initTestCase()
+    {
+#ifndef NDEBUG
+        QSKIP("perf gate measures Release builds only (ctest -C Release -L perf)");
+#endif
+        QFile f(LAB2_PERF_BASELINE_FILE);
+        QVERIFY2(f.open(QIODevice::ReadOnly), LAB2_PERF_BASELINE_FILE);
+        m_baseline = QJsonDocument::fromJson(f.readAll()).object();
+        QVERIFY(!m_baseline.isEmpty());
+
+        m_rows = m_baseline.value("rows").toInt(m_rows);
+        m_tolerance = m_baseline.value("tolerance").toDouble(m_tolerance);
+        m_updateMode = qEnvironmentVariableIntValue("LAB2_PERF_UPDATE_BASELINE") != 0;
+
+        // Угаданный порог ловит только катастрофы или даёт ложные падения — сравниваем только с измеренным.
+        QVERIFY2(m_updateMode || !m_baseline.value("metrics").toObject().isEmpty(),
+                 "perf_baseline.json has no measured metrics: commit the perf-baseline artifact of the CI "
+                 "Release job (LAB2_PERF_UPDATE_BASELINE=1 ctest -C Release -L perf)");
+
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+    }
+
+    void cleanupTestCase()
+    {
+        m_db.close();
+
+        if (!m_updateMode) return;
+
+        QJsonObject updated = m_baseline;
+        updated["metrics"] = m_measured;
+
+        QFile f(LAB2_PERF_BASELINE_FILE);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        f.write(QJsonDocument(updated).toJson());
+        qInfo() << "baseline updated:" << LAB2_PERF_BASELINE_FILE;
+    }
+
+    /**
+     * @brief Вставка набора данных одной транзакцией.
+     *
+     * @details
+     * Последний прогон оставляет в таблице ровно m_rows строк — на них работают следующие тесты.
+     */
+    void test_bulkInsert()
+    {
+        const QVector<MyRect> rects = makeDataset(m_rows);
+
+        qint64 best = std::numeric_limits<qint64>::max();
+        for (int run = 0; run < kRuns; ++run) {
+            QSqlQuery clear(db());
+            QVERIFY(clear.exec("DELETE FROM rectangle;"));
+
+            QElapsedTimer t;
+            t.start();
+            QVERIFY(insertAll(rects));
+            best = qMin(best, t.nsecsElapsed());
+        }
+
+        QString msg;
+        QVERIFY2(withinBaseline("bulk_insert_rows_per_s", rate(m_rows, best), Better::Higher, &msg), qPrintable(msg));
+    }
+
+    void test_fullScan()
+    {
+        qint64 best = std::numeric_limits<qint64>::max();
+        for (int run = 0; run < kRuns; ++run) {
+            QElapsedTimer t;
+            t.start();
+
+            QSqlQuery q(db());
+            q.setForwardOnly(true);
+            QVERIFY(q.exec(rectschema::kSelectValuesSql));
+
+            qint64 rows = 0;
+            qint64 checksum = 0;
+            while (q.next()) {
+                checksum += q.value(0).toLongLong() + q.value(1).toInt() + q.value(2).toInt()
+                        + q.value(3).toInt() + q.value(4).toInt() + q.value(5).toInt()
+                        + q.value(6).toInt() + q.value(7).toInt();
+                ++rows;
+            }
+            best = qMin(best, t.nsecsElapsed());
+
+            QCOMPARE(rows, qint64(m_rows));
+            QVERIFY(checksum > 0);
+        }
+
+        QString msg;
+        QVERIFY2(withinBaseline("full_scan_rows_per_s", rate(m_rows, best), Better::Higher, &msg), qPrintable(msg));
+    }
+
+    void test_modelLoad()
+    {
+        qint64 best = std::numeric_limits<qint64>::max();
+        for (int run = 0; run < kRuns; ++run) {
+            RectangleTableModel model(nullptr, db());
+            model.setTable(rectschema::kTable);
+
+            QElapsedTimer t;
+            t.start();
+            QVERIFY(model.select());
+            while (model.canFetchMore())
+                model.fetchMore();
+            best = qMin(best, t.nsecsElapsed());
+
+            QCOMPARE(model.rowCount(), m_rows);
+        }
+
+        QString msg;
+        QVERIFY2(withinBaseline("model_load_rows_per_s", rate(m_rows, best), Better::Higher, &msg), qPrintable(msg));
+    }
+
+    /**
+     * @brief Кадры отрисовки таблицы при прокрутке (делегаты + data()).
+     */
+    void test_paintLoop()
+    {
+        PenPalette palette(db());
+        RectangleTableModel model(nullptr, db());
+        model.setPalette(&palette);
+        model.setTable(rectschema::kTable);
+        QVERIFY(model.select());
+
+        FrameStats stats;
+        InstrumentedTableView view;
+        view.setModel(&model);
+        view.setItemDelegateForColumn(rectschema::PenColor, new MyDelegate(&view));
+        view.setItemDelegateForColumn(rectschema::PenStyle, new MyDelegate(&view));
+        view.setFrameStats(&stats);
+        model.setFrameStats(&stats);
+        view.resize(800, 600);
+
+        qint64 best = std::numeric_limits<qint64>::max();
+        for (int run = 0; run < kRuns; ++run) {
+            view.verticalScrollBar()->setValue(0);
+
+            QElapsedTimer t;
+            t.start();
+            for (int i = 0; i < kPaintFrames; ++i) {
+                view.verticalScrollBar()->setValue(i * 20);
+                view.grab();
+            }
+            best = qMin(best, t.nsecsElapsed());
+        }
+
+        QString msg;
+        QVERIFY2(withinBaseline("paint_frames_per_s", rate(kPaintFrames, best), Better::Higher, &msg), qPrintable(msg));
+        QVERIFY2(withinBaseline("paint_p99_ms", stats.summary().p99Ms, Better::Lower, &msg), qPrintable(msg));
+    }
+};
+
+QTEST_MAIN(TestPerfGate)
+#include "test_perfgate.moc"
@@ -0,0 +1,232 @@
+#include <QtTest/QtTest>
+
+#include <QFile>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include "pipelineimporter.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты конвейерного импорта PipelineImporter.
+ *
+ * Проверяем:
+ *  - parseLine(): 7 и 8 полей, ошибки
+ *  - порядок строк файла сохраняется при нескольких потоках разбора и маленьких очередях
+ *  - битые строки пропускаются и считаются, заголовок — нет
+ *  - запись идёт транзакциями по batchRows строк, setCommittedRows() получает каждую записанную пачку
+ *  - прерванный импорт продолжается с отметки прогресса без пропусков и повторов
+ *  - завершённый импорт начинается заново, изменённый файл не продолжается
+ */
+class TestPipelineImporter : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestDb m_db { "pipeline_conn", "pipeline.sqlite" };
+
+    /// Пишет CSV: заголовок + rows строк (left = номер строки), каждая badEvery-я строка битая.
+    QString writeCsv(int rows, int badEvery = 0)
+    {
+        const QString path = m_db.filePath("import.csv");
+        QFile f(path);
+        if (!f.open(QIODevice::WriteOnly)) return QString();
+
+        f.write("pencolor,penstyle,penwidth,left,top,width,height\n");
+        for (int i = 0; i < rows; ++i) {
+            if (badEvery > 0 && i % badEvery == badEvery - 1)
+                f.write("#zzzzzz,1,1,oops,0,1,1\n");
+            else
+                f.write(QString("#00ff00,1,2,%1,%2,10,20\n").arg(i).arg(-i).toLatin1());
+        }
+        return path;
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_parseLine()
+    {
+        MyRect r;
+        QVERIFY(PipelineImporter::parseLine("#ff0000, 2, 3, 4, 5, 6, 7\r\n", &r));
+        QCOMPARE(r.penColor, QColor("#ff0000"));
+        QCOMPARE(r.penStyle, Qt::DashLine);
+        QCOMPARE(r.height, 7);
+
+        QVERIFY(PipelineImporter::parseLine("15,#0000ff,1,1,0,0,1,1", &r));  // ведущий id
+        QCOMPARE(r.penColor, QColor("#0000ff"));
+
+        QString err;
+        QVERIFY(!PipelineImporter::parseLine("#ff0000,1,2", &r, &err));
+        QVERIFY(err.contains("fields"));
+        QVERIFY(!PipelineImporter::parseLine("red?,1,1,1,1,1,1", &r, &err));
+        QVERIFY(!PipelineImporter::parseLine("#ff0000,1,x,1,1,1,1", &r, &err));
+    }
+
+    void test_import_preservesFileOrder()
+    {
+        const QString path = writeCsv(20000);
+        QVERIFY(!path.isEmpty());
+
+        PipelineImporter importer(m_db.db());
+        importer.setParserThreads(4);
+        importer.setChunkLines(100);
+        importer.setQueueChunks(2);
+        importer.setBatchRows(3000);
+        qint64 committed = 0;
+        qint64 committedBatches = 0;
+        qint64 lastLeft = -1;
+        importer.setCommittedRows([&](const QVector<MyRect>& rows) {
+            committed += rows.size();
+            ++committedBatches;
+            if (!rows.isEmpty())
+                lastLeft = rows.last().left;
+        });
+
+        const PipelineImporter::Stats st = importer.importCsv(path);
+        QVERIFY2(st.ok, qPrintable(st.error));
+        QCOMPARE(st.rows, qint64(20000));
+        QCOMPARE(st.badLines, qint64(0));
+        QCOMPARE(st.batches, qint64(7));
+        QCOMPARE(committed, st.rows);
+        QCOMPARE(committedBatches, st.batches);
+        QCOMPARE(lastLeft, qint64(19999));
+
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), qint64(20000));
+        // id растёт вместе с номером строки файла: left == id - 1 у всех строк.
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle WHERE left <> id - 1;"), qint64(0));
+    }
+
+    void test_import_skipsBadLines()
+    {
+        const QString path = writeCsv(1000, 10);
+
+        PipelineImporter importer(m_db.db());
+        importer.setParserThreads(3);
+        importer.setChunkLines(64);
+
+        const PipelineImporter::Stats st = importer.importCsv(path);
+        QVERIFY2(st.ok, qPrintable(st.error));
+        QCOMPARE(st.badLines, qint64(100));
+        QCOMPARE(st.rows, qint64(900));
+        QVERIFY(st.firstBadLine.startsWith("line 11:"));  // строка 1 — заголовок
+    }
+
+    void test_import_interrupted_resumesWithoutGapsOrDuplicates()
+    {
+        const QString path = writeCsv(5000, 250);
+
+        // Сбой записи посреди файла: строка с left = 3456 не вставляется.
+        QSqlQuery q(m_db.db());
+        QVERIFY(q.exec("CREATE TRIGGER import_boom BEFORE INSERT ON rectangle WHEN NEW.left = 3456"
+                       " BEGIN SELECT RAISE(ABORT, 'boom'); END;"));
+
+        PipelineImporter importer(m_db.db());
+        importer.setParserThreads(3);
+        importer.setChunkLines(100);
+        importer.setQueueChunks(2);
+        importer.setBatchRows(1000);
+
+        const PipelineImporter::Stats first = importer.importCsv(path);
+        QVERIFY(!first.ok);
+        QVERIFY(first.error.contains("boom"));
+        QVERIFY(first.rows > 0);
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), first.rows);
+
+        // Отметка совпадает с закоммиченными данными.
+        PipelineImporter::Progress progress;
+        QVERIFY(PipelineImporter::loadProgress(m_db.db(), path, &progress));
+        QVERIFY(!progress.done);
+        QCOMPARE(progress.rows, first.rows);
+        QCOMPARE(progress.batches, first.batches);
+        QVERIFY(progress.line > 0 && progress.line < 5001);
+        QVERIFY(progress.offset > 0);
+
+        QVERIFY(q.exec("DROP TRIGGER import_boom;"));
+        const PipelineImporter::Stats second = importer.importCsv(path);
+        QVERIFY2(second.ok, qPrintable(second.error));
+        QCOMPARE(second.resumedAtLine, progress.line);
+        QCOMPARE(second.resumedRows, first.rows);
+
+        // 5000 строк, из них 20 битых: каждая хорошая строка ровно один раз и в порядке файла.
+        QCOMPARE(first.rows + second.rows, qint64(4980));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), qint64(4980));
+        QCOMPARE(m_db.scalar("SELECT COUNT(DISTINCT left) FROM rectangle;"), qint64(4980));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle r JOIN rectangle n ON n.id = r.id + 1"
+                        " WHERE n.left <= r.left;"), qint64(0));
+
+        QVERIFY(PipelineImporter::loadProgress(m_db.db(), path, &progress));
+        QVERIFY(progress.done);
+        QCOMPARE(progress.rows, qint64(4980));
+        QCOMPARE(progress.badLines, qint64(20));
+        QCOMPARE(progress.line, qint64(5001));
+    }
+
+    void test_import_completed_reimportStartsOver()
+    {
+        const QString path = writeCsv(300);
+
+        PipelineImporter importer(m_db.db());
+        importer.setChunkLines(64);
+        importer.setBatchRows(100);
+        QVERIFY(importer.importCsv(path).ok);
+
+        const PipelineImporter::Stats again = importer.importCsv(path);
+        QVERIFY2(again.ok, qPrintable(again.error));
+        QCOMPARE(again.resumedAtLine, qint64(0));
+        QCOMPARE(again.rows, qint64(300));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), qint64(600));
+    }
+
+    void test_import_changedFile_notResumed()
+    {
+        const QString path = writeCsv(1000);
+
+        QSqlQuery q(m_db.db());
+        QVERIFY(q.exec("CREATE TRIGGER import_boom BEFORE INSERT ON rectangle WHEN NEW.left = 700"
+                       " BEGIN SELECT RAISE(ABORT, 'boom'); END;"));
+        PipelineImporter importer(m_db.db());
+        importer.setChunkLines(50);
+        importer.setBatchRows(200);
+        QVERIFY(!importer.importCsv(path).ok);
+        QVERIFY(q.exec("DROP TRIGGER import_boom;"));
+
+        {
+            QFile f(path);
+            QVERIFY(f.open(QIODevice::Append));
+            f.write("#00ff00,1,2,5000,0,10,20\n");
+        }
+        const PipelineImporter::Stats st = importer.importCsv(path);
+        QVERIFY(!st.ok);
+        QVERIFY(st.error.contains("changed"));
+
+        // Сброс отметки — импорт с начала.
+        QVERIFY(PipelineImporter::clearProgress(m_db.db(), path));
+        const PipelineImporter::Stats fresh = importer.importCsv(path);
+        QVERIFY2(fresh.ok, qPrintable(fresh.error));
+        QCOMPARE(fresh.resumedAtLine, qint64(0));
+        QCOMPARE(fresh.rows, qint64(1001));
+    }
+
+    void test_import_missingFile_fails()
+    {
+        PipelineImporter importer(m_db.db());
+        const PipelineImporter::Stats st = importer.importCsv(m_db.filePath("none.csv"));
+        QVERIFY(!st.ok);
+        QVERIFY(!st.error.isEmpty());
+        QCOMPARE(st.rows, qint64(0));
+    }
+};
+
+QTEST_MAIN(TestPipelineImporter)
+#include "test_pipelineimporter.moc"
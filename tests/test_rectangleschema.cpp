@@ -0,0 +1,129 @@
+#include <QtTest/QtTest>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include "penpalette.h"
+#include "rectangleschema.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты описания схемы rectangleschema.h.
+ *
+ * Проверяем:
+ *  - последняя миграция SchemaMigrator даёт ровно те колонки (имена, порядок, вычисляемые), что в kColumns
+ *  - kCreateTableSql создаёт такую же таблицу
+ *  - сгенерированные INSERT/SELECT выполняются и согласованы по порядку колонок
+ */
+class TestRectangleSchema : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestDb m_db { "schema_conn", "schema.sqlite" };
+
+    /// Колонки таблицы: имя и признак вычисляемой (PRAGMA table_xinfo, hidden 2/3).
+    QList<QPair<QString, bool>> columnsOf(const QString& table)
+    {
+        QList<QPair<QString, bool>> result;
+        QSqlQuery q(m_db.db());
+        if (!q.exec(QString("PRAGMA table_xinfo(%1);").arg(table))) return result;
+        while (q.next()) {
+            const int hidden = q.value("hidden").toInt();
+            result << qMakePair(q.value("name").toString(), hidden == 2 || hidden == 3);
+        }
+        return result;
+    }
+
+    static QList<QPair<QString, bool>> expectedColumns()
+    {
+        QList<QPair<QString, bool>> result;
+        for (int c = 0; c < rectschema::ColumnCount; ++c)
+            result << qMakePair(QString(rectschema::kColumns[c].name), rectschema::isGenerated(c));
+        return result;
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_latestMigration_matchesDescriptor()
+    {
+        QCOMPARE(columnsOf(rectschema::kTable), expectedColumns());
+    }
+
+    void test_createTableSql_matchesDescriptor()
+    {
+        QSqlQuery q(m_db.db());
+        QVERIFY2(q.exec(QString(rectschema::kCreateTableSql).arg("rectangle_copy")), qPrintable(q.lastError().text()));
+        QCOMPARE(columnsOf("rectangle_copy"), expectedColumns());
+    }
+
+    void test_generatedSql_roundTrip()
+    {
+        using namespace rectschema;
+
+        PenPalette palette(m_db.db());
+        const int red = palette.idFor(QColor("#ff0000"));
+        QVERIFY(red > 0);
+
+        QSqlQuery ins(m_db.db());
+        QVERIFY2(ins.prepare(kInsertSql), qPrintable(ins.lastError().text()));
+        ins.bindValue(insertPosition(PenColor), red);
+        ins.bindValue(insertPosition(PenStyle), 1);
+        ins.bindValue(insertPosition(PenWidth), 2);
+        ins.bindValue(insertPosition(Left), 3);
+        ins.bindValue(insertPosition(Top), 4);
+        ins.bindValue(insertPosition(Width), 5);
+        ins.bindValue(insertPosition(Height), 6);
+        QVERIFY2(ins.exec(), qPrintable(ins.lastError().text()));
+
+        QSqlQuery named(m_db.db());
+        QVERIFY2(named.prepare(kNamedInsertSql), qPrintable(named.lastError().text()));
+        named.bindValue(":pen_id", palette.idFor(QColor("#00ff00")));
+        named.bindValue(":penstyle", 2);
+        named.bindValue(":penwidth", 1);
+        named.bindValue(":left", 0);
+        named.bindValue(":top", 0);
+        named.bindValue(":width", 10);
+        named.bindValue(":height", 20);
+        QVERIFY2(named.exec(), qPrintable(named.lastError().text()));
+
+        QSqlQuery withId(m_db.db());
+        QVERIFY2(withId.prepare(kInsertWithIdSql), qPrintable(withId.lastError().text()));
+        const QVariantList values = { 100, palette.idFor(QColor("#0000ff")), 1, 1, 7, 8, 9, 10 };
+        for (int i = 0; i < values.size(); ++i)
+            withId.bindValue(i, values.at(i));
+        QVERIFY2(withId.exec(), qPrintable(withId.lastError().text()));
+
+        QSqlQuery sel(m_db.db());
+        QVERIFY2(sel.exec(QString(kSelectValuesSql) + " ORDER BY id;"), qPrintable(sel.lastError().text()));
+        QVERIFY(sel.next());
+        QCOMPARE(sel.value(PenColor).toInt(), red);
+        QCOMPARE(palette.color(sel.value(PenColor).toInt()), QColor("#ff0000"));
+        QCOMPARE(sel.value(Height).toInt(), 6);
+        QVERIFY(sel.next());
+        QCOMPARE(sel.value(Width).toInt(), 10);
+        QVERIFY(sel.next());
+        QCOMPARE(sel.value(Id).toInt(), 100);
+        QCOMPARE(sel.value(Left).toInt(), 7);
+        QVERIFY(!sel.next());
+
+        QSqlQuery area(m_db.db());
+        QVERIFY(area.exec(QString("SELECT %1 FROM %2 WHERE id = 100;").arg(kColumns[Area].name, kTable)));
+        QVERIFY(area.next());
+        QCOMPARE(area.value(0).toInt(), 90);
+    }
+};
+
+QTEST_MAIN(TestRectangleSchema)
+#include "test_rectangleschema.moc"
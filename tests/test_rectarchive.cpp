@@ -0,0 +1,160 @@
+#include <QtTest/QtTest>
+
+#include <QFile>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include "penpalette.h"
+#include "rectarchive.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты сжатого поблочного архива RectArchive.
+ *
+ * Проверяем:
+ *  - encodeRows()/decodeRows() без потерь
+ *  - экспорт -> импорт через несколько блоков (и параллельную обработку)
+ *  - восстановление с исходными id
+ *  - испорченный архив не меняет таблицу
+ */
+class TestRectArchive : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestDb m_db { "archive_conn", "archive.sqlite" };
+
+    bool fill(int rows)
+    {
+        QSqlDatabase d = m_db.db();
+        d.transaction();
+        PenPalette palette(d);
+        const int red = palette.idFor(QColor("#ff0000"));
+        const int blue = palette.idFor(QColor("#0000ff"));
+
+        QSqlQuery q(d);
+        q.prepare("INSERT INTO rectangle (pen_id, penstyle, penwidth, left, top, width, height) "
+                  "VALUES (?,?,?,?,?,?,?);");
+        for (int i = 0; i < rows; ++i) {
+            q.addBindValue(i % 2 ? red : blue);
+            q.addBindValue(1 + i % 5);
+            q.addBindValue(1 + i % 4);
+            q.addBindValue(i);
+            q.addBindValue(-i);
+            q.addBindValue(10 + i % 100);
+            q.addBindValue(20 + i % 50);
+            if (!q.exec()) {
+                qWarning() << q.lastError().text();
+                d.rollback();
+                return false;
+            }
+        }
+        return d.commit();
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_encodeDecode_roundTrip()
+    {
+        RectRow r;
+        r.id = 42;
+        r.rect = MyRect(QColor("#123456"), Qt::DotLine, 3, -1, 2, 30, 40);
+
+        const QByteArray raw = RectArchive::encodeRows({ r, r });
+        QCOMPARE(raw.size(), 2 * RectArchive::kRowBytes);
+
+        QVector<RectRow> back;
+        QVERIFY(RectArchive::decodeRows(raw, &back));
+        QCOMPARE(back.size(), 2);
+        QCOMPARE(back.at(1).id, qint64(42));
+        QCOMPARE(back.at(1).rect.penColor, QColor("#123456"));
+        QCOMPARE(back.at(1).rect.penStyle, Qt::DotLine);
+        QCOMPARE(back.at(1).rect.left, -1);
+
+        QVERIFY(!RectArchive::decodeRows(raw.left(raw.size() - 1), &back));
+    }
+
+    void test_exportImport_multipleBlocks()
+    {
+        QVERIFY(fill(1000));
+
+        RectArchive archive(m_db.db());
+        archive.setRowsPerBlock(64);
+        archive.setMaxParallelBlocks(4);
+
+        const QString path = m_db.filePath("rect.l2z");
+        const RectArchive::Stats out = archive.exportTo(path);
+        QVERIFY2(out.ok, qPrintable(out.error));
+        QCOMPARE(out.rows, qint64(1000));
+        QCOMPARE(out.blocks, qint64(16));
+        QVERIFY(out.compressedBytes < out.rawBytes);
+
+        const qint64 sumBefore = m_db.scalar("SELECT SUM(left + top + width + height + penwidth) FROM rectangle;");
+
+        const RectArchive::Stats in = archive.importFrom(path);
+        QVERIFY2(in.ok, qPrintable(in.error));
+        QCOMPARE(in.rows, qint64(1000));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), qint64(2000));
+        QCOMPARE(m_db.scalar("SELECT SUM(left + top + width + height + penwidth) FROM rectangle WHERE id > 1000;"),
+                 sumBefore);
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle r JOIN pen_palette p ON p.id = r.pen_id"
+                        " WHERE r.id > 1000 AND p.color = '#ff0000';"), qint64(500));
+    }
+
+    void test_import_keepIds_restoresIntoEmptyTable()
+    {
+        QVERIFY(fill(10));
+        QVERIFY(QSqlQuery(m_db.db()).exec("DELETE FROM rectangle WHERE id IN (3, 4);"));
+
+        RectArchive archive(m_db.db());
+        const QString path = m_db.filePath("rect.l2z");
+        QVERIFY(archive.exportTo(path).ok);
+
+        QVERIFY(QSqlQuery(m_db.db()).exec("DELETE FROM rectangle;"));
+        const RectArchive::Stats in = archive.importFrom(path, true);
+        QVERIFY2(in.ok, qPrintable(in.error));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), qint64(8));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle WHERE id IN (3, 4);"), qint64(0));
+        QCOMPARE(m_db.scalar("SELECT left FROM rectangle WHERE id = 10;"), qint64(9));
+    }
+
+    void test_import_corruptArchive_rollsBack()
+    {
+        QVERIFY(fill(300));
+
+        RectArchive archive(m_db.db());
+        archive.setRowsPerBlock(100);
+        const QString path = m_db.filePath("rect.l2z");
+        QVERIFY(archive.exportTo(path).ok);
+
+        // Портим данные последнего блока (перед завершающими 12 байтами).
+        QFile f(path);
+        QVERIFY(f.open(QIODevice::ReadWrite));
+        QByteArray bytes = f.readAll();
+        const int pos = bytes.size() - 12 - 20;
+        bytes[pos] = char(bytes[pos] ^ 0x5a);
+        bytes[pos + 1] = char(bytes[pos + 1] ^ 0x5a);
+        QVERIFY(f.seek(0));
+        f.write(bytes);
+        f.close();
+
+        const RectArchive::Stats in = archive.importFrom(path);
+        QVERIFY(!in.ok);
+        QVERIFY(!in.error.isEmpty());
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), qint64(300));
+    }
+};
+
+QTEST_MAIN(TestRectArchive)
+#include "test_rectarchive.moc"
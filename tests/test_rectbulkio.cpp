@@ -0,0 +1,193 @@
+#include <QtTest/QtTest>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include "rectbulkio.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты и бенчмарки RectBulkReader / RectBulkWriter.
+ *
+ * Каждый тест прогоняется по обоим путям: "qtsql" (QSqlQuery) и "native" (sqlite3 напрямую;
+ * строка данных есть, только если сборка с LAB2_SQLITE_NATIVE и драйвер отдаёт sqlite3*).
+ *
+ * Проверяем:
+ *  - вставка и чтение дают одинаковые строки, включая цвет и стиль
+ *  - keepIds, выборка диапазона id
+ *
+ * Бенчмарки (QBENCHMARK): скан kBenchRows строк и вставка kBenchRows строк в транзакции,
+ * которая затем откатывается. Сравнение путей: ./test_rectbulkio benchmark_scan benchmark_insert
+ */
+class TestRectBulkIo : public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr int kBenchRows = 20000;
+
+    TestDb m_db { "bulkio_conn", "bulkio.sqlite" };
+
+    static MyRect sample(int i)
+    {
+        static const QColor kColors[] = { QColor("#ff0000"), QColor("#00ff00"), QColor("#1a2b3c") };
+        return MyRect(kColors[i % 3], static_cast<Qt::PenStyle>(1 + i % 5), 1 + i % 4,
+                      i, i * 2, 10 + i % 50, 20 + i % 30);
+    }
+
+    void addPathRows()
+    {
+        QTest::addColumn<bool>("native");
+        QTest::newRow("qtsql") << false;
+        if (rectbulkio::nativeAvailable(m_db.db()))
+            QTest::newRow("native") << true;
+    }
+
+    qint64 count()
+    {
+        QSqlQuery q(m_db.db());
+        return q.exec("SELECT COUNT(*) FROM rectangle;") && q.next() ? q.value(0).toLongLong() : -1;
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+    }
+
+    void cleanup()
+    {
+        rectbulkio::setNativeEnabled(true);
+        m_db.close();
+    }
+
+    void test_writeThenRead_data() { addPathRows(); }
+    void test_writeThenRead()
+    {
+        QFETCH(bool, native);
+        rectbulkio::setNativeEnabled(native);
+
+        {
+            QVERIFY(m_db.db().transaction());
+            RectBulkWriter w(m_db.db());
+            QVERIFY2(w.isValid(), qPrintable(w.lastError()));
+            QCOMPARE(w.isNative(), native);
+            for (int i = 0; i < 100; ++i)
+                QVERIFY2(w.insert(sample(i)), qPrintable(w.lastError()));
+            QVERIFY(m_db.db().commit());
+        }
+        QCOMPARE(count(), qint64(100));
+
+        // Строки, записанные QtSql, читаются одинаково обоими путями (и наоборот).
+        RectBulkReader r(m_db.db());
+        QVERIFY2(r.execAll(), qPrintable(r.lastError()));
+        QCOMPARE(r.isNative(), native);
+
+        RectRow row;
+        int n = 0;
+        while (r.next(row)) {
+            const MyRect expected = sample(n);
+            QCOMPARE(row.id, qint64(n + 1));
+            QCOMPARE(row.rect.penColor, expected.penColor);
+            QCOMPARE(row.rect.penStyle, expected.penStyle);
+            QCOMPARE(row.rect.penWidth, expected.penWidth);
+            QCOMPARE(row.rect.left, expected.left);
+            QCOMPARE(row.rect.top, expected.top);
+            QCOMPARE(row.rect.width, expected.width);
+            QCOMPARE(row.rect.height, expected.height);
+            ++n;
+        }
+        QVERIFY(r.lastError().isEmpty());
+        QCOMPARE(n, 100);
+
+        QSqlQuery q(m_db.db());
+        QVERIFY(q.exec("SELECT p.color FROM rectangle r JOIN pen_palette p ON p.id = r.pen_id WHERE r.id = 3;"));
+        QVERIFY(q.next());
+        QCOMPARE(q.value(0).toString(), QString("#1a2b3c"));
+    }
+
+    void test_keepIdsAndRange_data() { addPathRows(); }
+    void test_keepIdsAndRange()
+    {
+        QFETCH(bool, native);
+        rectbulkio::setNativeEnabled(native);
+
+        {
+            RectBulkWriter w(m_db.db(), true);
+            QVERIFY(w.isValid());
+            for (int i = 0; i < 10; ++i) {
+                RectRow row;
+                row.id = 100 + i * 10;
+                row.rect = sample(i);
+                QVERIFY2(w.insert(row), qPrintable(w.lastError()));
+            }
+
+            // Повтор ключа — ошибка с текстом, писатель остаётся пригодным.
+            RectRow dup;
+            dup.id = 100;
+            QVERIFY(!w.insert(dup));
+            QVERIFY(!w.lastError().isEmpty());
+
+            // MyRect без id — ключ назначает SQLite.
+            QVERIFY2(w.insert(sample(0)), qPrintable(w.lastError()));
+        }
+        QCOMPARE(count(), qint64(11));
+
+        RectBulkReader r(m_db.db());
+        QVERIFY(r.exec(120, 150));
+        QList<qint64> ids;
+        RectRow row;
+        while (r.next(row))
+            ids << row.id;
+        QCOMPARE(ids, QList<qint64>({ 120, 130, 140, 150 }));
+    }
+
+    void benchmark_scan_data() { addPathRows(); }
+    void benchmark_scan()
+    {
+        QFETCH(bool, native);
+
+        {
+            rectbulkio::setNativeEnabled(false);
+            QVERIFY(m_db.db().transaction());
+            RectBulkWriter w(m_db.db());
+            for (int i = 0; i < kBenchRows; ++i)
+                QVERIFY(w.insert(sample(i)));
+            QVERIFY(m_db.db().commit());
+        }
+        rectbulkio::setNativeEnabled(native);
+
+        qint64 checksum = 0;
+        QBENCHMARK {
+            RectBulkReader r(m_db.db());
+            QVERIFY(r.execAll());
+            RectRow row;
+            while (r.next(row))
+                checksum += row.rect.width + row.rect.penColor.red();
+        }
+        QVERIFY(checksum > 0);
+    }
+
+    void benchmark_insert_data() { addPathRows(); }
+    void benchmark_insert()
+    {
+        QFETCH(bool, native);
+        rectbulkio::setNativeEnabled(native);
+
+        QBENCHMARK {
+            QVERIFY(m_db.db().transaction());
+            {
+                RectBulkWriter w(m_db.db());
+                for (int i = 0; i < kBenchRows; ++i)
+                    w.insert(sample(i));
+            }
+            QVERIFY(m_db.db().rollback());
+        }
+        QCOMPARE(count(), qint64(0));
+    }
+};
+
+QTEST_MAIN(TestRectBulkIo)
+#include "test_rectbulkio.moc"
@@ -0,0 +1,222 @@
+#include <QtTest/QtTest>
+
+#include <QFile>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+
+#include "penpalette.h"
+#include "rectbulkio.h"
+#include "rectdiff.h"
+#include "schemamigrator.h"
+
+/**
+ * @brief Тесты RectDiff (lab2_dbdiff).
+ *
+ * Проверяем:
+ *  - одинаковые файлы: один уровень хешей, построчного чтения нет
+ *  - вставленные, удалённые и изменённые строки находятся точно, читаются только диапазоны с отличиями
+ *  - обмен значениями между строками и правки +d/-d внутри диапазона находятся
+ *  - разная нумерация цветов в словарях сторон не считается отличием
+ *  - ошибки: нет файла, старая схема
+ */
+class TestRectDiff : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir* m_dir = nullptr;
+
+    QString path(const char* name) const { return m_dir->filePath(name); }
+
+    /// Создаёт БД со схемой и rows строками (цвета — по кругу из colors, id 1..rows).
+    static bool createDb(const QString& file, int rows, const QVector<QColor>& colors)
+    {
+        bool ok = false;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "diff_setup");
+            db.setDatabaseName(file);
+            if (db.open()) {
+                SchemaMigrator migrator(db);
+                PenPalette palette(db);
+                ok = migrator.migrate();
+                for (const QColor& c : colors)
+                    ok = ok && palette.idFor(c) > 0;
+
+                ok = ok && db.transaction();
+                if (ok) {
+                    RectBulkWriter writer(db);
+                    for (int i = 0; ok && i < rows; ++i)
+                        ok = writer.insert(MyRect(colors.at(i % colors.size()), Qt::SolidLine, 1 + i % 3, i, i * 2, 10, 20));
+                }
+                ok = ok && db.commit();
+                if (!ok) qWarning() << db.lastError().text();
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase("diff_setup");
+        return ok;
+    }
+
+    /// Выполняет SQL над файлом.
+    static bool exec(const QString& file, const QStringList& statements)
+    {
+        bool ok = true;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "diff_exec");
+            db.setDatabaseName(file);
+            ok = db.open();
+            QSqlQuery q(db);
+            for (const QString& sql : statements) {
+                if (ok && !q.exec(sql)) {
+                    qWarning() << sql << q.lastError().text();
+                    ok = false;
+                }
+            }
+            q.clear();
+            db.close();
+        }
+        QSqlDatabase::removeDatabase("diff_exec");
+        return ok;
+    }
+
+    static QList<qint64> ids(const QVector<RectRow>& rows)
+    {
+        QList<qint64> result;
+        for (const RectRow& r : rows)
+            result << r.id;
+        return result;
+    }
+
+private slots:
+    void init()
+    {
+        m_dir = new QTemporaryDir();
+        QVERIFY(m_dir->isValid());
+    }
+
+    void cleanup()
+    {
+        delete m_dir;
+        m_dir = nullptr;
+    }
+
+    void test_identicalFiles_noRowReads()
+    {
+        QVERIFY(createDb(path("base.sqlite"), 5000, { QColor("#ff0000"), QColor("#0000ff") }));
+        QVERIFY(QFile::copy(path("base.sqlite"), path("copy.sqlite")));
+
+        RectDiff diff(path("base.sqlite"), path("copy.sqlite"), 2);
+        const RectDiff::Result res = diff.run();
+        QVERIFY2(res.ok, qPrintable(res.error));
+        QVERIFY(res.identical());
+        QCOMPARE(res.levels, 1);
+        QCOMPARE(res.rowsCompared, qint64(0));
+    }
+
+    void test_changes_foundExactly_onlyDifferingRangesRead()
+    {
+        QVERIFY(createDb(path("base.sqlite"), 20000, { QColor("#ff0000"), QColor("#0000ff") }));
+        QVERIFY(QFile::copy(path("base.sqlite"), path("other.sqlite")));
+
+        QVERIFY(exec(path("other.sqlite"), {
+            "DELETE FROM rectangle WHERE id IN (17, 9000);",
+            "UPDATE rectangle SET left = -1 WHERE id = 5000;",
+            "UPDATE rectangle SET penstyle = 2 WHERE id = 19999;",
+            "UPDATE rectangle SET pen_id = NULL WHERE id = 12345;",
+            "INSERT INTO rectangle (id, pen_id, penstyle, penwidth, left, top, width, height) "
+            "VALUES (20001, 1, 1, 1, 0, 0, 1, 1), (30000, 2, 1, 1, 0, 0, 1, 1);",
+        }));
+
+        RectDiff diff(path("base.sqlite"), path("other.sqlite"), 2);
+        diff.setLeafRows(16);
+        const RectDiff::Result res = diff.run();
+        QVERIFY2(res.ok, qPrintable(res.error));
+        QVERIFY(!res.identical());
+
+        QCOMPARE(ids(res.deleted), QList<qint64>({ 17, 9000 }));
+        QCOMPARE(ids(res.inserted), QList<qint64>({ 20001, 30000 }));
+        QCOMPARE(res.modified.size(), 3);
+        QCOMPARE(res.modified.at(0).before.id, qint64(5000));
+        QCOMPARE(res.modified.at(0).before.rect.left, 4999);
+        QCOMPARE(res.modified.at(0).after.rect.left, -1);
+        QCOMPARE(res.modified.at(1).before.id, qint64(12345));
+        QVERIFY(res.modified.at(1).before.rect.penColor.isValid());
+        QVERIFY(!res.modified.at(1).after.rect.penColor.isValid());
+        QCOMPARE(res.modified.at(2).after.rect.penStyle, Qt::DashLine);
+
+        QVERIFY(res.levels > 1);
+        // Построчно прочитаны только окрестности семи отличий, а не 40000 строк.
+        QVERIFY2(res.rowsCompared < 7 * 2 * 16 + 16, qPrintable(QString::number(res.rowsCompared)));
+    }
+
+    /// Обмен значением между строками одного диапазона и правки +d/-d не сокращаются в хеше диапазона.
+    void test_swapAndOffsettingEdits_detected()
+    {
+        QVERIFY(createDb(path("base.sqlite"), 2000, { QColor("#ff0000"), QColor("#0000ff") }));
+        QVERIFY(QFile::copy(path("base.sqlite"), path("other.sqlite")));
+
+        // left = id - 1: меняем местами left строк 10 и 20, top строк 30 и 40 сдвигаем на +5 и -5.
+        QVERIFY(exec(path("other.sqlite"), {
+            "UPDATE rectangle SET left = CASE id WHEN 10 THEN 19 ELSE 9 END WHERE id IN (10, 20);",
+            "UPDATE rectangle SET top = top + 5 WHERE id = 30;",
+            "UPDATE rectangle SET top = top - 5 WHERE id = 40;",
+        }));
+
+        // Один поток: первый уровень — 16 диапазонов по 125 строк, все четыре строки в первом.
+        RectDiff diff(path("base.sqlite"), path("other.sqlite"), 1);
+        const RectDiff::Result res = diff.run();
+        QVERIFY2(res.ok, qPrintable(res.error));
+        QCOMPARE(res.modified.size(), 4);
+        QCOMPARE(res.modified.at(0).before.id, qint64(10));
+        QCOMPARE(res.modified.at(0).after.rect.left, 19);
+        QCOMPARE(res.modified.at(1).before.id, qint64(20));
+        QCOMPARE(res.modified.at(1).after.rect.left, 9);
+        QCOMPARE(res.modified.at(2).before.id, qint64(30));
+        QCOMPARE(res.modified.at(3).before.id, qint64(40));
+    }
+
+    void test_differentPaletteIds_sameColors_identical()
+    {
+        // Одни и те же цвета строк, но словари пронумерованы в разном порядке.
+        QVERIFY(createDb(path("a.sqlite"), 300, { QColor("#ff0000"), QColor("#00ff00") }));
+        QVERIFY(createDb(path("b.sqlite"), 0, { QColor("#00ff00"), QColor("#ff0000") }));
+        QVERIFY(exec(path("b.sqlite"), {
+            QString("ATTACH DATABASE '%1' AS src;").arg(path("a.sqlite")),
+            "INSERT INTO rectangle (id, pen_id, penstyle, penwidth, left, top, width, height) "
+            "SELECT r.id, p.id, r.penstyle, r.penwidth, r.left, r.top, r.width, r.height "
+            "FROM src.rectangle r JOIN src.pen_palette s ON s.id = r.pen_id JOIN pen_palette p ON p.color = s.color;",
+        }));
+
+        const RectDiff::Result res = RectDiff(path("a.sqlite"), path("b.sqlite")).run();
+        QVERIFY2(res.ok, qPrintable(res.error));
+        QVERIFY(res.identical());
+
+        QVERIFY(exec(path("b.sqlite"), { "UPDATE rectangle SET pen_id = 3 - pen_id WHERE id = 7;" }));
+        const RectDiff::Result changed = RectDiff(path("a.sqlite"), path("b.sqlite")).run();
+        QVERIFY2(changed.ok, qPrintable(changed.error));
+        QCOMPARE(changed.modified.size(), 1);
+        QCOMPARE(changed.modified.at(0).before.id, qint64(7));
+    }
+
+    void test_errors_missingFileAndOldSchema()
+    {
+        QVERIFY(createDb(path("base.sqlite"), 10, { QColor("#ff0000") }));
+
+        RectDiff::Result res = RectDiff(path("base.sqlite"), path("missing.sqlite")).run();
+        QVERIFY(!res.ok);
+        QVERIFY(!res.error.isEmpty());
+
+        QVERIFY(exec(path("old.sqlite"), {
+            "CREATE TABLE rectangle (id INTEGER PRIMARY KEY, pencolor TEXT, penstyle INTEGER, penwidth INTEGER, "
+            "left INTEGER, top INTEGER, width INTEGER, height INTEGER);",
+        }));
+        res = RectDiff(path("base.sqlite"), path("old.sqlite")).run();
+        QVERIFY(!res.ok);
+        QVERIFY(res.error.contains("pen_id"));
+    }
+};
+
+QTEST_MAIN(TestRectDiff)
+#include "test_rectdiff.moc"
@@ -0,0 +1,120 @@
+#include <QtTest/QtTest>
+
+#include <QFile>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include "rectbulkio.h"
+#include "rectpdfreport.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты RectPdfReport (потоковая печать таблицы в PDF).
+ *
+ * Проверяем:
+ *  - все строки напечатаны, число страниц = ceil(строк / строк на странице), файл — PDF
+ *  - пустая таблица — одна страница с шапкой
+ *  - нет таблицы / нельзя писать файл — ошибка, старый отчёт не испорчен
+ */
+class TestRectPdfReport : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestDb m_db { "pdf_conn", "pdf.sqlite" };
+
+    bool fill(int rows)
+    {
+        QSqlDatabase d = m_db.db();
+        if (!d.transaction())
+            return false;
+        {
+            RectBulkWriter w(d);
+            if (!w.isValid())
+                return false;
+            for (int i = 0; i < rows; ++i) {
+                const MyRect r(QColor::fromRgb(0x102030 + i), Qt::PenStyle(1 + i % 5), 1 + i % 4,
+                               i, 2 * i, 10 + i % 7, 5 + i % 3);
+                if (!w.insert(r)) {
+                    qWarning() << w.lastError();
+                    return false;
+                }
+            }
+        }
+        return d.commit();
+    }
+
+    RectPdfReport report()
+    {
+        RectPdfReport r(m_db.db());
+        r.setPageSize(QPageSize(QPageSize::A6));
+        r.setResolution(72);
+        return r;
+    }
+
+    static QByteArray head(const QString& path, int n)
+    {
+        QFile f(path);
+        return f.open(QIODevice::ReadOnly) ? f.read(n) : QByteArray();
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_export_paginatesAllRows()
+    {
+        QVERIFY(fill(500));
+
+        const QString path = m_db.filePath("report.pdf");
+        const RectPdfReport::Stats st = report().exportTo(path);
+        QVERIFY2(st.ok, qPrintable(st.error));
+        QCOMPARE(st.rows, qint64(500));
+        QVERIFY(st.rowsPerPage > 1);
+        QVERIFY(st.rowsPerPage < 500);
+        QCOMPARE(st.pages, int((500 + st.rowsPerPage - 1) / st.rowsPerPage));
+
+        QCOMPARE(head(path, 5), QByteArray("%PDF-"));
+        QVERIFY(QFileInfo(path).size() > 1000);
+    }
+
+    void test_export_emptyTable_onePage()
+    {
+        const QString path = m_db.filePath("empty.pdf");
+        const RectPdfReport::Stats st = report().exportTo(path);
+        QVERIFY2(st.ok, qPrintable(st.error));
+        QCOMPARE(st.rows, qint64(0));
+        QCOMPARE(st.pages, 1);
+        QCOMPARE(head(path, 5), QByteArray("%PDF-"));
+    }
+
+    void test_export_errors_keepOldReport()
+    {
+        QVERIFY(fill(3));
+        const QString path = m_db.filePath("report.pdf");
+        QVERIFY(report().exportTo(path).ok);
+        const qint64 size = QFileInfo(path).size();
+
+        QSqlQuery q(m_db.db());
+        QVERIFY(q.exec("DROP TABLE rectangle;"));
+        const RectPdfReport::Stats st = report().exportTo(path);
+        QVERIFY(!st.ok);
+        QVERIFY(!st.error.isEmpty());
+        QCOMPARE(QFileInfo(path).size(), size);
+
+        const RectPdfReport::Stats bad = report().exportTo(m_db.filePath("no/such/dir/report.pdf"));
+        QVERIFY(!bad.ok);
+    }
+};
+
+QTEST_MAIN(TestRectPdfReport)
+#include "test_rectpdfreport.moc"
@@ -0,0 +1,143 @@
+#include <QtTest/QtTest>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include "penpalette.h"
+#include "rectangleschema.h"
+#include "rectrowdecoder.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты RectRowDecoder.
+ *
+ * Проверяем:
+ *  - разбор строк kSelectValuesSql (индексы по умолчанию), цвет — из словаря pen_palette
+ *  - поиск индексов по именам для произвольного порядка колонок и отсутствующие колонки
+ *  - чтение порциями fetch()
+ *  - быстрый разбор цвета совпадает с QColor(QString)
+ */
+class TestRectRowDecoder : public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr int kRows = 10;
+
+    TestDb m_db { "decoder_conn", "decoder.sqlite" };
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+        QSqlDatabase d = m_db.db();
+
+        PenPalette palette(d);
+        const int green = palette.idFor(QColor("#00ff00"));
+        const int red = palette.idFor(QColor("#FF0000"));
+
+        QSqlQuery ins(d);
+        QVERIFY(ins.prepare(rectschema::kInsertSql));
+        for (int i = 0; i < kRows; ++i) {
+            ins.addBindValue(i % 2 ? green : red);
+            ins.addBindValue(int(Qt::DashLine));
+            ins.addBindValue(i + 1);
+            ins.addBindValue(i * 10);
+            ins.addBindValue(i * 20);
+            ins.addBindValue(5);
+            ins.addBindValue(7);
+            QVERIFY2(ins.exec(), qPrintable(ins.lastError().text()));
+        }
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_decode_defaultOrder()
+    {
+        QSqlQuery q(m_db.db());
+        q.setForwardOnly(true);
+        QVERIFY(q.exec(QString(rectschema::kSelectValuesSql) + " ORDER BY id;"));
+
+        RectRowDecoder decoder(PenPalette::loadColors(m_db.db()));
+        QVERIFY(decoder.isValid());
+
+        QVERIFY(q.next());
+        RectRow r = decoder.decode(q);
+        QCOMPARE(r.id, qint64(1));
+        QCOMPARE(r.rect.penColor, QColor(Qt::red));
+        QCOMPARE(r.rect.penStyle, Qt::DashLine);
+        QCOMPARE(r.rect.penWidth, 1);
+
+        QVERIFY(q.next());
+        decoder.decode(q, r);
+        QCOMPARE(r.id, qint64(2));
+        QCOMPARE(r.rect.penColor, QColor(Qt::green));
+        QCOMPARE(r.rect.left, 10);
+        QCOMPARE(r.rect.top, 20);
+        QCOMPARE(r.rect.width, 5);
+        QCOMPARE(r.rect.height, 7);
+    }
+
+    void test_decode_byRecordNames()
+    {
+        QSqlQuery q(m_db.db());
+        QVERIFY(q.exec("SELECT area, height, width, top, left, penwidth, penstyle, pen_id, id "
+                       "FROM rectangle WHERE id = 3;"));
+
+        RectRowDecoder decoder(q.record(), PenPalette::loadColors(m_db.db()));
+        QVERIFY(decoder.isValid());
+        QCOMPARE(decoder.column(rectschema::Id), 8);
+        QCOMPARE(decoder.column(rectschema::Height), 1);
+
+        QVERIFY(q.next());
+        const RectRow r = decoder.decode(q);
+        QCOMPARE(r.id, qint64(3));
+        QCOMPARE(r.rect.penWidth, 3);
+        QCOMPARE(r.rect.left, 20);
+        QCOMPARE(r.rect.penColor, QColor(Qt::red));
+
+        QSqlQuery partial(m_db.db());
+        QVERIFY(partial.exec("SELECT id, left FROM rectangle;"));
+        RectRowDecoder bad(partial.record(), {});
+        QVERIFY(!bad.isValid());
+        QVERIFY(bad.missingColumns().contains("pen_id"));
+        QVERIFY(!bad.missingColumns().contains("left"));
+    }
+
+    void test_fetch_batches()
+    {
+        QSqlQuery q(m_db.db());
+        q.setForwardOnly(true);
+        QVERIFY(q.exec(QString(rectschema::kSelectValuesSql) + " ORDER BY id;"));
+
+        RectRowDecoder decoder;
+        QVector<RectRow> batch;
+        QList<int> sizes;
+        qint64 lastId = 0;
+        while (decoder.fetch(q, batch, 4) > 0) {
+            sizes << batch.size();
+            for (const RectRow& r : batch) {
+                QCOMPARE(r.id, lastId + 1);
+                lastId = r.id;
+            }
+        }
+        QCOMPARE(sizes, QList<int>({ 4, 4, 2 }));
+        QCOMPARE(lastId, qint64(kRows));
+        QVERIFY(batch.isEmpty());
+    }
+
+    void test_parseColor_matchesQColor()
+    {
+        const QStringList samples = { "#ff0000", "#00FF7f", "#123abc", "red", "#fff", "#zzzzzz", "" };
+        for (const QString& s : samples)
+            QCOMPARE(RectRowDecoder::parseColor(s), QColor(s));
+    }
+};
+
+QTEST_MAIN(TestRectRowDecoder)
+#include "test_rectrowdecoder.moc"
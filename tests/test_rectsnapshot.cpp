@@ -0,0 +1,170 @@
+#include <QtTest/QtTest>
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include "penpalette.h"
+#include "rectsnapshot.h"
+#include "snapshotrefresher.h"
+#include "snapshottablemodel.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты колоночного снимка таблицы (RectSnapshot, SnapshotTableModel, SnapshotRefresher).
+ *
+ * Проверяем:
+ *  - запись снимка и чтение строк/колонок через отображение в память
+ *  - сводку analytics() без SQL
+ *  - отказ открывать повреждённый файл
+ *  - модель только для чтения с теми же колонками, что у таблицы
+ *  - фоновую запись в собственном соединении
+ *  - замену существующего снимка одним rename (временный файл исчезает)
+ */
+class TestRectSnapshot : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestDb m_db { "snapshot_conn", "snap.sqlite" };
+
+    bool insert(const QString& color, int style, int penWidth, int l, int t, int w, int h)
+    {
+        QSqlQuery q(m_db.db());
+        q.prepare("INSERT INTO rectangle (pen_id, penstyle, penwidth, left, top, width, height) "
+                  "VALUES (?,?,?,?,?,?,?);");
+        const int penId = PenPalette(m_db.db()).idFor(QColor(color));
+        for (const QVariant& v : { QVariant(penId), QVariant(style), QVariant(penWidth),
+                                   QVariant(l), QVariant(t), QVariant(w), QVariant(h) })
+            q.addBindValue(v);
+        if (!q.exec()) {
+            qWarning() << q.lastError().text();
+            return false;
+        }
+        return true;
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+
+        QVERIFY(insert("#ff0000", 1, 3, 10, 20, 60, 60));
+        QVERIFY(insert("#00ff00", 2, 1, -5, 0, 20, 10));
+        QVERIFY(insert("#0000ff", 3, 2, 100, 50, 10, 40));
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_writeAndOpen_roundTrip()
+    {
+        const QString path = m_db.filePath("rect.snapshot");
+        QString err;
+        QVERIFY2(RectSnapshot::write(m_db.db(), path, &err), qPrintable(err));
+
+        RectSnapshot snap;
+        QVERIFY2(snap.open(path, &err), qPrintable(err));
+        QCOMPARE(snap.rowCount(), qint64(3));
+        QCOMPARE(snap.sourceSeq(), qint64(3)); // три вставки в журнале изменений
+
+        const RectRow r = snap.row(1);
+        QCOMPARE(r.id, qint64(2));
+        QCOMPARE(r.rect.penColor, QColor("#00ff00"));
+        QCOMPARE(r.rect.penStyle, Qt::DashLine);
+        QCOMPARE(r.rect.left, -5);
+        QCOMPARE(r.rect.height, 10);
+
+        QCOMPARE(snap.intColumn(RectSnapshot::Width)[2], 10);
+    }
+
+    void test_analytics_computedFromColumns()
+    {
+        const QString path = m_db.filePath("rect.snapshot");
+        QVERIFY(RectSnapshot::write(m_db.db(), path));
+
+        RectSnapshot snap;
+        QVERIFY(snap.open(path));
+        const RectAnalytics a = snap.analytics();
+
+        QCOMPARE(a.rows, qint64(3));
+        QCOMPARE(a.bounds(), QRect(QPoint(-5, 0), QSize(115, 90)));
+        QCOMPARE(a.totalArea, qint64(60 * 60 + 20 * 10 + 10 * 40));
+        QCOMPARE(a.meanPenWidth(), 2.0);
+    }
+
+    void test_open_rejectsCorruptFile()
+    {
+        const QString path = m_db.filePath("bad.snapshot");
+        QFile f(path);
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        f.write(QByteArray(RectSnapshot::kHeaderSize, 'x'));
+        f.close();
+
+        RectSnapshot snap;
+        QString err;
+        QVERIFY(!snap.open(path, &err));
+        QVERIFY(!err.isEmpty());
+        QVERIFY(!snap.isOpen());
+    }
+
+    void test_model_readOnlyWithTableColumns()
+    {
+        const QString path = m_db.filePath("rect.snapshot");
+        QVERIFY(RectSnapshot::write(m_db.db(), path));
+
+        SnapshotTableModel model;
+        QVERIFY(model.load(path));
+        QCOMPARE(model.rowCount(), 3);
+        QCOMPARE(model.columnCount(), 8);
+        QCOMPARE(model.headerData(1, Qt::Horizontal).toString(), QString("Color"));
+        QCOMPARE(model.data(model.index(0, 1)).toString(), QString("#ff0000"));
+        QCOMPARE(model.data(model.index(2, 5)).toInt(), 50);
+        QVERIFY(!(model.flags(model.index(0, 3)) & Qt::ItemIsEditable));
+
+        model.unload();
+        QCOMPARE(model.rowCount(), 0);
+    }
+
+    void test_replaceFile_overExistingSnapshot()
+    {
+        const QString path = m_db.filePath("rect.snapshot");
+        const QString tmp = path + ".tmp";
+        QVERIFY(RectSnapshot::write(m_db.db(), path));
+        QVERIFY(m_db.exec("DELETE FROM rectangle WHERE id = 1;"));
+        QVERIFY(RectSnapshot::write(m_db.db(), tmp));
+
+        QVERIFY(RectSnapshot::replaceFile(tmp, path));
+        QVERIFY(!QFile::exists(tmp));
+
+        RectSnapshot snap;
+        QVERIFY(snap.open(path));
+        QCOMPARE(snap.rowCount(), qint64(2));
+    }
+
+    void test_refresher_writesInBackground()
+    {
+        const QString path = m_db.filePath("rect.snapshot");
+        SnapshotRefresher refresher(m_db.db().databaseName(), path);
+        QSignalSpy spy(&refresher, &SnapshotRefresher::finished);
+
+        QVERIFY(refresher.start());
+        QVERIFY(spy.wait(10000));
+        QCOMPARE(spy.at(0).at(0).toBool(), true);
+
+        const QString tmp = spy.at(0).at(1).toString();
+        QVERIFY(RectSnapshot::replaceFile(tmp, path));
+
+        RectSnapshot snap;
+        QVERIFY(snap.open(path));
+        QCOMPARE(snap.rowCount(), qint64(3));
+    }
+};
+
+QTEST_MAIN(TestRectSnapshot)
+#include "test_rectsnapshot.moc"
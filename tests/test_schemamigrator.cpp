@@ -0,0 +1,386 @@
+#include <QtTest/QtTest>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+
+#include "busyretry.h"
+#include "schemamigrator.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты для SchemaMigrator.
+ *
+ * Проверяем:
+ *  - создание схемы с нуля и запись PRAGMA user_version
+ *  - "усыновление" БД, созданной до миграций (данные сохраняются)
+ *  - перестройку таблицы порциями: смена типа + новая колонка, прогресс, сохранность данных
+ *  - продолжение прерванной перестройки без дублей
+ *  - правки и удаления старой таблицы во время копирования порциями не теряются
+ *  - счётчик AUTOINCREMENT (sqlite_sequence) сохраняется после перестройки
+ *  - v5: строки цвета заменяются ссылками на словарь pen_palette, журнал хранит текст цвета
+ *  - v5: новые цвета строк, вставленных или изменённых после v4 и во время копирования, попадают в словарь
+ *  - откат миграции с ошибкой (версия не меняется)
+ *  - COMMIT миграции, упёршийся в блокировку читателя, повторяется через BusyRetry
+ */
+class TestSchemaMigrator : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestDb m_db { "migrator_conn", "migrate.sqlite" };
+
+    void insertRows(int n)
+    {
+        QSqlQuery q(m_db.db());
+        q.prepare("INSERT INTO rectangle (pencolor, penstyle, penwidth, left, top, width, height) "
+                  "VALUES ('#112233', 1, ?, 1, 2, 3, 4)");
+        for (int i = 0; i < n; ++i) {
+            q.bindValue(0, i);
+            QVERIFY2(q.exec(), qPrintable(q.lastError().text()));
+        }
+    }
+
+    /// v2: penwidth VARCHAR -> REAL и новая колонка label (перестройка таблицы).
+    static SchemaMigrator::Migration rebuildMigration()
+    {
+        SchemaMigrator::Migration m;
+        m.version = 2;
+        m.description = "penwidth as REAL, add label";
+        m.rebuild.table = "rectangle";
+        m.rebuild.createSql = "CREATE TABLE %1 ("
+                              " id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                              " pencolor VARCHAR, penstyle INTEGER, penwidth REAL,"
+                              " left INTEGER, top INTEGER, width INTEGER, height INTEGER,"
+                              " label TEXT DEFAULT 'none');";
+        m.rebuild.targetColumns = "id, pencolor, penstyle, penwidth, left, top, width, height";
+        m.rebuild.sourceExpressions = "id, pencolor, penstyle, CAST(penwidth AS REAL), left, top, width, height";
+        m.statements << "CREATE INDEX idx_rectangle_penwidth ON rectangle(penwidth);";
+        return m;
+    }
+
+    static QVector<SchemaMigrator::Migration> withRebuild()
+    {
+        auto list = SchemaMigrator::builtinMigrations().mid(0, 1);
+        list << rebuildMigration();
+        return list;
+    }
+
+private slots:
+    void init()
+    {
+        // Без миграций: тесты сами проверяют путь от пустой/старой схемы.
+        QVERIFY2(m_db.open(false), qPrintable(m_db.lastError()));
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_freshDatabase_createsSchemaAndSetsVersion()
+    {
+        SchemaMigrator m(m_db.db());
+        QCOMPARE(m.currentVersion(), 0);
+
+        QVERIFY2(m.migrate(), qPrintable(m.lastError()));
+
+        QCOMPARE(m.currentVersion(), SchemaMigrator::latestVersion());
+        QVERIFY(m_db.db().tables().contains("rectangle"));
+
+        // Повторный запуск — ничего не делает.
+        QVERIFY(m.migrate());
+        QCOMPARE(m.currentVersion(), SchemaMigrator::latestVersion());
+    }
+
+    void test_legacyDatabase_isAdoptedWithoutDataLoss()
+    {
+        QSqlQuery q(m_db.db());
+        QVERIFY(q.exec("CREATE TABLE rectangle (id INTEGER PRIMARY KEY AUTOINCREMENT, pencolor VARCHAR,"
+                       " penstyle INTEGER, penwidth INTEGER, left INTEGER, top INTEGER,"
+                       " width INTEGER, height INTEGER);"));
+        insertRows(5);
+
+        SchemaMigrator m(m_db.db());
+        QVERIFY2(m.migrate(), qPrintable(m.lastError()));
+
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), qint64(5));
+        QCOMPARE(m.currentVersion(), SchemaMigrator::latestVersion());
+    }
+
+    /**
+     * @brief v3: вычисляемые колонки геометрии, индексы по ним и восстановленные триггеры журнала.
+     */
+    void test_v3_generatedColumnsAreIndexed()
+    {
+        SchemaMigrator m(m_db.db());
+        QVERIFY(m.migrate(2));
+        insertRows(20);
+
+        QVERIFY2(m.migrate(3), qPrintable(m.lastError()));
+        QCOMPARE(m.currentVersion(), 3);
+
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), qint64(20));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle WHERE right <> left + width"
+                        " OR bottom <> top + height OR area <> width * height;"), qint64(0));
+
+        // Запрос по диапазону использует индекс, а не полный перебор.
+        QSqlQuery plan(m_db.db());
+        QVERIFY(plan.exec("EXPLAIN QUERY PLAN SELECT id FROM rectangle WHERE area > 100;"));
+        QString detail;
+        while (plan.next())
+            detail += plan.value(3).toString();
+        QVERIFY2(detail.contains("rectangle_area_idx"), qPrintable(detail));
+
+        // Триггеры журнала удалены вместе со старой таблицей и созданы заново.
+        const qint64 before = m_db.scalar("SELECT COUNT(*) FROM rectangle_changes;");
+        QVERIFY(QSqlQuery(m_db.db()).exec("UPDATE rectangle SET width = width + 1 WHERE id = 1;"));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle_changes;"), before + 1);
+    }
+
+    /**
+     * @brief v4/v5: цвет пера хранится как id в словаре pen_palette.
+     *
+     * @details
+     * Цвета в разном регистре сводятся к одной записи словаря; журнал изменений
+     * по-прежнему получает текстовый цвет (его читает ChangeExporter).
+     */
+    void test_v5_paletteReplacesColorStrings()
+    {
+        SchemaMigrator m(m_db.db());
+        QVERIFY(m.migrate(3));
+        insertRows(10);
+        QVERIFY(QSqlQuery(m_db.db()).exec("UPDATE rectangle SET pencolor = '#FF0000' WHERE id <= 3;"));
+        QVERIFY(QSqlQuery(m_db.db()).exec("UPDATE rectangle SET pencolor = '#ff0000' WHERE id = 4;"));
+
+        QVERIFY2(m.migrate(), qPrintable(m.lastError()));
+        QCOMPARE(m.currentVersion(), SchemaMigrator::latestVersion());
+
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), qint64(10));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM pen_palette;"), qint64(2));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle r JOIN pen_palette p ON p.id = r.pen_id"
+                        " WHERE p.color = '#ff0000';"), qint64(4));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle WHERE pen_id IS NULL;"), qint64(0));
+        QVERIFY(!m_db.db().record("rectangle").contains("pencolor"));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM sqlite_master WHERE name = 'rectangle_pen_idx';"), qint64(1));
+
+        // Триггеры журнала разворачивают pen_id обратно в строку цвета.
+        QVERIFY(QSqlQuery(m_db.db()).exec("UPDATE rectangle SET width = 99 WHERE id = 1;"));
+        QSqlQuery q(m_db.db());
+        QVERIFY(q.exec("SELECT pencolor FROM rectangle_changes ORDER BY seq DESC LIMIT 1;"));
+        QVERIFY(q.next());
+        QCOMPARE(q.value(0).toString(), QString("#ff0000"));
+    }
+
+    void test_rebuild_copiesInBatchesWithProgress()
+    {
+        SchemaMigrator m(m_db.db(), withRebuild());
+        QVERIFY(m.migrate(1));
+        insertRows(50);
+
+        m.setBatchSize(7);
+        int calls = 0;
+        qint64 lastDone = -1;
+        QVERIFY2(m.migrate(-1, [&](int version, qint64 done, qint64 total) {
+                     QCOMPARE(version, 2);
+                     QCOMPARE(total, qint64(50));
+                     QVERIFY(done >= lastDone);
+                     lastDone = done;
+                     ++calls;
+                 }),
+                 qPrintable(m.lastError()));
+
+        QCOMPARE(m.currentVersion(), 2);
+        QVERIFY(calls >= 50 / 7);
+        QCOMPARE(lastDone, qint64(50));
+
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), qint64(50));
+        QCOMPARE(m_db.scalar("SELECT SUM(penwidth) FROM rectangle;"), qint64(49 * 50 / 2));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle WHERE label = 'none';"), qint64(50));
+        QCOMPARE(m_db.db().record("rectangle").field("penwidth").type(), QVariant::Double);
+        QVERIFY(!m_db.db().tables().contains(QString("rectangle") + SchemaMigrator::kRebuildSuffix));
+    }
+
+    /**
+     * @brief Прерванная перестройка продолжается с места остановки.
+     *
+     * @details
+     * Имитируем обрыв: временная таблица и таблица отметок уже есть, в копии первые 10 строк.
+     */
+    void test_rebuild_resumesInterruptedCopy()
+    {
+        SchemaMigrator m(m_db.db(), withRebuild());
+        QVERIFY(m.migrate(1));
+        insertRows(30);
+
+        const SchemaMigrator::Migration v2 = rebuildMigration();
+        const QString tmp = QString("rectangle") + SchemaMigrator::kRebuildSuffix;
+        {
+            QSqlQuery q(m_db.db());
+            QVERIFY(q.exec(v2.rebuild.createSql.arg(tmp)));
+            QVERIFY(q.exec(QString("CREATE TABLE %1%2 (row_id INTEGER PRIMARY KEY);")
+                           .arg(tmp, SchemaMigrator::kRebuildLogSuffix)));
+            QVERIFY2(q.exec(QString("INSERT INTO %1 (%2) SELECT %3 FROM rectangle WHERE id <= 10;")
+                            .arg(tmp, v2.rebuild.targetColumns, v2.rebuild.sourceExpressions)),
+                     qPrintable(q.lastError().text()));
+        }
+
+        qint64 firstDone = -1;
+        QVERIFY2(m.migrate(-1, [&](int, qint64 done, qint64) {
+                     if (firstDone < 0) firstDone = done;
+                 }),
+                 qPrintable(m.lastError()));
+        QCOMPARE(firstDone, qint64(10));
+
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), qint64(30));
+        QCOMPARE(m_db.scalar("SELECT COUNT(DISTINCT id) FROM rectangle;"), qint64(30));
+    }
+
+    /**
+     * @brief Правки старой таблицы между порциями копирования попадают в новую таблицу.
+     *
+     * @details
+     * После второй порции (скопированы id 1..14) меняем и удаляем уже скопированные строки,
+     * меняем ещё не скопированную и вставляем новую.
+     */
+    void test_rebuild_capturesChangesDuringCopy()
+    {
+        SchemaMigrator m(m_db.db(), withRebuild());
+        QVERIFY(m.migrate(1));
+        insertRows(50);
+
+        m.setBatchSize(7);
+        bool changed = false;
+        QVERIFY2(m.migrate(-1, [&](int, qint64 done, qint64) {
+                     if (changed || done < 14)
+                         return;
+                     changed = true;
+                     QVERIFY(m_db.exec("UPDATE rectangle SET penwidth = 1000 WHERE id = 3;"));
+                     QVERIFY(m_db.exec("UPDATE rectangle SET id = 100 WHERE id = 4;"));
+                     QVERIFY(m_db.exec("DELETE FROM rectangle WHERE id = 5;"));
+                     QVERIFY(m_db.exec("UPDATE rectangle SET width = 77 WHERE id = 40;"));
+                     QVERIFY(m_db.exec("INSERT INTO rectangle (pencolor, penstyle, penwidth, left, top, width, height)"
+                                       " VALUES ('#445566', 1, 7, 1, 2, 3, 4);"));
+                 }),
+                 qPrintable(m.lastError()));
+        QVERIFY(changed);
+
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), qint64(50));
+        QCOMPARE(m_db.scalar("SELECT penwidth FROM rectangle WHERE id = 3;"), qint64(1000));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle WHERE id IN (4, 5);"), qint64(0));
+        QCOMPARE(m_db.scalar("SELECT penwidth FROM rectangle WHERE id = 100;"), qint64(3));
+        QCOMPARE(m_db.scalar("SELECT width FROM rectangle WHERE id = 40;"), qint64(77));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle WHERE pencolor = '#445566';"), qint64(1));
+
+        // Таблица отметок и её триггеры удалены.
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM sqlite_master WHERE instr(name, '__migrating') > 0;"),
+                 qint64(0));
+    }
+
+    /// Цвета, которых не было в словаре на момент v4, не теряются при перестройке v5 порциями.
+    void test_v5_newColorsDuringRebuild_addedToPalette()
+    {
+        SchemaMigrator m(m_db.db());
+        QVERIFY2(m.migrate(4), qPrintable(m.lastError()));
+        insertRows(30);
+        // После v4, до перестройки (другой процесс): попадает в одну из порций.
+        QVERIFY(m_db.exec("INSERT INTO rectangle (pencolor, penstyle, penwidth, left, top, width, height)"
+                          " VALUES ('#AABBCC', 1, 1, 1, 2, 3, 4);"));
+
+        m.setBatchSize(7);
+        bool changed = false;
+        QVERIFY2(m.migrate(5, [&](int, qint64 done, qint64) {
+                     if (changed || done < 14)
+                         return;
+                     changed = true;
+                     QVERIFY(m_db.exec("UPDATE rectangle SET pencolor = '#0a0b0c' WHERE id = 3;"));
+                     QVERIFY(m_db.exec("INSERT INTO rectangle (pencolor, penstyle, penwidth, left, top, width, height)"
+                                       " VALUES ('#ddeeff', 1, 1, 1, 2, 3, 4);"));
+                 }),
+                 qPrintable(m.lastError()));
+        QVERIFY(changed);
+
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle;"), qint64(32));
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM rectangle WHERE pen_id IS NULL;"), qint64(0));
+        const auto countColor = [this](const char* color) {
+            return m_db.scalar(QString("SELECT COUNT(*) FROM rectangle r JOIN pen_palette p ON p.id = r.pen_id"
+                                       " WHERE p.color = '%1';").arg(color));
+        };
+        QCOMPARE(countColor("#aabbcc"), qint64(1));
+        QCOMPARE(countColor("#0a0b0c"), qint64(1));
+        QCOMPARE(countColor("#ddeeff"), qint64(1));
+        QCOMPARE(countColor("#112233"), qint64(29));
+    }
+
+    /// Счётчик AUTOINCREMENT переживает перестройку: id удалённых последних строк не выдаются снова.
+    void test_rebuild_keepsAutoincrementSequence()
+    {
+        SchemaMigrator m(m_db.db(), withRebuild());
+        QVERIFY(m.migrate(1));
+        insertRows(10);
+        QVERIFY(m_db.exec("DELETE FROM rectangle WHERE id > 7;"));
+
+        QVERIFY2(m.migrate(), qPrintable(m.lastError()));
+        QCOMPARE(m_db.scalar("SELECT seq FROM sqlite_sequence WHERE name = 'rectangle';"), qint64(10));
+
+        insertRows(1);
+        QCOMPARE(m_db.scalar("SELECT MAX(id) FROM rectangle;"), qint64(11));
+    }
+
+    void test_failingMigration_rollsBackVersion()
+    {
+        auto list = SchemaMigrator::builtinMigrations().mid(0, 1);
+        SchemaMigrator::Migration bad;
+        bad.version = 2;
+        bad.description = "broken";
+        bad.statements << "CREATE INDEX idx_ok ON rectangle(left);"
+                       << "THIS IS NOT SQL;";
+        list << bad;
+
+        SchemaMigrator m(m_db.db(), list);
+        QVERIFY(!m.migrate());
+        QVERIFY(!m.lastError().isEmpty());
+
+        QCOMPARE(m.currentVersion(), 1);
+        QCOMPARE(m_db.scalar("SELECT COUNT(*) FROM sqlite_master WHERE name = 'idx_ok';"), qint64(0));
+    }
+
+    void test_migrate_commitRetriedWhileReaderHoldsLock()
+    {
+        static constexpr const char* kReader = "migrator_reader";
+        {
+            QSqlDatabase reader = QSqlDatabase::addDatabase("QSQLITE", kReader);
+            reader.setDatabaseName(m_db.path());
+            QVERIFY(reader.open());
+            QSqlQuery q(reader);
+            QVERIFY(reader.transaction());
+            QVERIFY(q.exec("SELECT COUNT(*) FROM sqlite_master;") && q.next());
+        }
+
+        BusyRetry::Policy p;
+        p.busyTimeoutMs = 0;
+        p.maxRetries = 5;
+        p.baseDelayMs = 1;
+        p.maxDelayMs = 1;
+        BusyRetry retry(p);
+        QVERIFY(retry.applyBusyTimeout(m_db.db()));
+        retry.setSleeper([](int) { QSqlDatabase::database(kReader, false).commit(); });
+
+        SchemaMigrator m(m_db.db());
+        m.setBusyRetry(&retry);
+        const bool ok = m.migrate();
+
+        QSqlDatabase::database(kReader, false).close();
+        QSqlDatabase::removeDatabase(kReader);
+
+        QVERIFY2(ok, qPrintable(m.lastError()));
+        QCOMPARE(m.currentVersion(), SchemaMigrator::latestVersion());
+        QVERIFY(retry.stats().retries >= 1);
+        QCOMPARE(retry.stats().failures, qint64(0));
+    }
+};
+
+QTEST_MAIN(TestSchemaMigrator)
+#include "test_schemamigrator.moc"
@@ -0,0 +1,174 @@
+#include <QtTest/QtTest>
+
+#include <QFile>
+#include <QImage>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include "penpalette.h"
+#include "rectsnapshot.h"
+#include "tilepyramid.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты TilePyramid (экспорт пирамиды PNG-тайлов).
+ *
+ * Проверяем:
+ *  - уровни и раскладку <z>/<x>/<y>.png, манифест
+ *  - цвет пера в тайлах нижнего уровня; внутренние тайлы большого контура не пишутся
+ *  - повторный экспорт без изменений ничего не перерисовывает
+ *  - после правки перерисовываются только затронутые тайлы, ставшие пустыми — удаляются
+ */
+class TestTilePyramid : public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr int kTileSize = 64;
+
+    TestDb m_db { "tiles_conn", "tiles.sqlite" };
+
+    QString tilesDir() const { return m_db.filePath("tiles"); }
+    QString tileFile(int z, int x, int y) const { return tilesDir() + "/" + TilePyramid::tilePath(z, x, y); }
+
+    bool insert(const QString& color, int style, int penWidth, int l, int t, int w, int h)
+    {
+        QSqlQuery q(m_db.db());
+        q.prepare("INSERT INTO rectangle (pen_id, penstyle, penwidth, left, top, width, height) "
+                  "VALUES (?,?,?,?,?,?,?);");
+        const int penId = PenPalette(m_db.db()).idFor(QColor(color));
+        for (const QVariant& v : { QVariant(penId), QVariant(style), QVariant(penWidth),
+                                   QVariant(l), QVariant(t), QVariant(w), QVariant(h) })
+            q.addBindValue(v);
+        if (!q.exec()) {
+            qWarning() << q.lastError().text();
+            return false;
+        }
+        return true;
+    }
+
+    /// Пишет снимок таблицы и экспортирует его.
+    TilePyramid::Stats exportTiles()
+    {
+        const QString path = m_db.filePath("rect.snapshot");
+        QString err;
+        if (!RectSnapshot::write(m_db.db(), path, &err)) {
+            TilePyramid::Stats st;
+            st.error = err;
+            return st;
+        }
+        RectSnapshot snap;
+        if (!snap.open(path, &err)) {
+            TilePyramid::Stats st;
+            st.error = err;
+            return st;
+        }
+
+        TilePyramid pyramid(tilesDir(), 3);
+        pyramid.setTileSize(kTileSize);
+        pyramid.setMaxLevel(6);
+        return pyramid.exportSnapshot(snap);
+    }
+
+    /// Есть ли в тайле непрозрачный пиксель, близкий к цвету c.
+    static bool hasColor(const QString& file, const QColor& c)
+    {
+        const QImage img = QImage(file).convertToFormat(QImage::Format_ARGB32);
+        for (int y = 0; y < img.height(); ++y) {
+            for (int x = 0; x < img.width(); ++x) {
+                const QRgb p = img.pixel(x, y);
+                if (qAlpha(p) == 255 && qAbs(qRed(p) - c.red()) < 40 && qAbs(qGreen(p) - c.green()) < 40
+                        && qAbs(qBlue(p) - c.blue()) < 40)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+
+        // Охват 0..1000, перо до 3: сторона области 1005, нижний уровень 4 (16 x 16 тайлов по ~62.8).
+        QVERIFY(insert("#ff0000", Qt::SolidLine, 3, 100, 100, 100, 100));
+        QVERIFY(insert("#0000ff", Qt::DashLine, 1, 900, 900, 50, 50));
+        QVERIFY(insert("#00ff00", Qt::SolidLine, 1, 0, 0, 1000, 1000));
+        QVERIFY(insert("#ffff00", Qt::NoPen, 1, 500, 500, 10, 10));
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_export_levelsTilesAndManifest()
+    {
+        const TilePyramid::Stats st = exportTiles();
+        QVERIFY2(st.ok, qPrintable(st.error));
+        QCOMPARE(st.levels, 5);
+        QCOMPARE(st.rows, qint64(3));
+        QVERIFY(st.tilesRendered > st.levels);
+        QCOMPARE(st.tilesSkipped, qint64(0));
+
+        QCOMPARE(QImage(tileFile(0, 0, 0)).size(), QSize(kTileSize, kTileSize));
+        QVERIFY(hasColor(tileFile(4, 1, 2), QColor("#ff0000")));
+        QVERIFY(hasColor(tileFile(4, 14, 14), QColor("#0000ff")));
+        QVERIFY(hasColor(tileFile(4, 0, 8), QColor("#00ff00")));
+        // Внутри большого контура нет сторон — тайл не пишется (NoPen-строка тоже не рисуется).
+        QVERIFY(!QFile::exists(tileFile(4, 8, 8)));
+
+        QFile f(tilesDir() + "/" + TilePyramid::kManifestFile);
+        QVERIFY(f.open(QIODevice::ReadOnly));
+        const QJsonObject manifest = QJsonDocument::fromJson(f.readAll()).object();
+        QCOMPARE(manifest.value("tileSize").toInt(), kTileSize);
+        QCOMPARE(manifest.value("levels").toInt(), 5);
+        QCOMPARE(qint64(manifest.value("tiles").toObject().size()), st.tilesRendered);
+    }
+
+    void test_reexport_unchanged_skipsAll()
+    {
+        const TilePyramid::Stats first = exportTiles();
+        QVERIFY2(first.ok, qPrintable(first.error));
+
+        const TilePyramid::Stats second = exportTiles();
+        QVERIFY2(second.ok, qPrintable(second.error));
+        QCOMPARE(second.tilesRendered, qint64(0));
+        QCOMPARE(second.tilesSkipped, first.tilesRendered);
+        QCOMPARE(second.tilesRemoved, qint64(0));
+
+        // Удалённый файл рисуется заново, даже если хеш совпадает.
+        QVERIFY(QFile::remove(tileFile(4, 1, 2)));
+        const TilePyramid::Stats third = exportTiles();
+        QVERIFY2(third.ok, qPrintable(third.error));
+        QCOMPARE(third.tilesRendered, qint64(1));
+        QVERIFY(QFile::exists(tileFile(4, 1, 2)));
+    }
+
+    void test_reexport_changedRow_onlyAffectedTiles()
+    {
+        const TilePyramid::Stats first = exportTiles();
+        QVERIFY2(first.ok, qPrintable(first.error));
+
+        // Синий прямоугольник переезжает: его старые тайлы пустеют, остальное не меняется.
+        QSqlQuery q(m_db.db());
+        QVERIFY(q.exec("UPDATE rectangle SET left = 600 WHERE id = 2;"));
+
+        const TilePyramid::Stats second = exportTiles();
+        QVERIFY2(second.ok, qPrintable(second.error));
+        QVERIFY(second.tilesRendered > 0);
+        QVERIFY(second.tilesRendered < first.tilesRendered / 2);
+        QVERIFY(second.tilesSkipped > 0);
+        QVERIFY(second.tilesRemoved > 0);
+        QVERIFY(!QFile::exists(tileFile(4, 14, 14)));
+        QVERIFY(hasColor(tileFile(4, 9, 14), QColor("#0000ff")));
+        QVERIFY(hasColor(tileFile(4, 1, 2), QColor("#ff0000")));
+    }
+};
+
+QTEST_MAIN(TestTilePyramid)
+#include "test_tilepyramid.moc"
@@ -0,0 +1,159 @@
+#include <QtTest/QtTest>
+
+#include <QPointer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlTableModel>
+
+#include "memorybudget.h"
+#include "rectangletablemodel.h"
+#include "schemamigrator.h"
+#include "warmmodelcache.h"
+
+#include "testdb.h"
+
+/**
+ * @brief Тесты WarmModelCache (тёплые модели для Model -> Select table).
+ *
+ * Проверяем:
+ *  - take() возвращает ту же модель с подгруженными строками и состоянием вида
+ *  - переполнение вытесняет самую давнюю модель
+ *  - бюджет памяти удаляет холодные модели, модели с правками не паркуются
+ *  - compatibleTables() находит таблицы основной и присоединённой БД
+ */
+class TestWarmModelCache : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestDb m_db { "warm_conn", "warm.sqlite" };
+
+    /// Модель таблицы rectangle с полностью загруженными строками.
+    QSqlTableModel* loadedModel()
+    {
+        auto* model = new QSqlTableModel(nullptr, m_db.db());
+        model->setTable("rectangle");
+        model->setEditStrategy(QSqlTableModel::OnManualSubmit);
+        if (!model->select())
+            qWarning() << model->lastError().text();
+        while (model->canFetchMore())
+            model->fetchMore();
+        return model;
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY2(m_db.open(), qPrintable(m_db.lastError()));
+        QSqlDatabase d = m_db.db();
+
+        QSqlQuery q(d);
+        QVERIFY(q.exec("INSERT INTO rectangle (penstyle, penwidth, left, top, width, height) "
+                       "VALUES (1, 1, 0, 0, 10, 10), (1, 2, 5, 5, 20, 20), (2, 3, 9, 9, 1, 1);"));
+    }
+
+    void cleanup()
+    {
+        m_db.close();
+    }
+
+    void test_parkAndTake_returnsSameModelAndState()
+    {
+        WarmModelCache cache;
+        QSqlTableModel* model = loadedModel();
+
+        WarmModelCache::ViewState state;
+        state.verticalScroll = 2;
+        state.currentRow = 1;
+        state.sortColumn = 3;
+        state.sortOrder = Qt::DescendingOrder;
+        QVERIFY(cache.park("rectangle", model, state));
+        QVERIFY(cache.contains("rectangle"));
+        QCOMPARE(cache.tables(), QStringList({ "rectangle" }));
+
+        QCOMPARE(cache.take("missing").model, static_cast<QSqlTableModel*>(nullptr));
+
+        const WarmModelCache::Entry e = cache.take("rectangle");
+        QCOMPARE(e.model, model);
+        QCOMPARE(e.model->rowCount(), 3);
+        QCOMPARE(e.state.verticalScroll, 2);
+        QCOMPARE(e.state.currentRow, 1);
+        QCOMPARE(e.state.sortColumn, 3);
+        QCOMPARE(e.state.sortOrder, Qt::DescendingOrder);
+        QVERIFY(!cache.contains("rectangle"));
+        QCOMPARE(cache.hits(), quint64(1));
+        QCOMPARE(cache.misses(), quint64(1));
+
+        delete e.model;
+    }
+
+    void test_capacity_dropsLeastRecent()
+    {
+        WarmModelCache cache(nullptr, 2);
+        QPointer<QSqlTableModel> a = loadedModel();
+        QPointer<QSqlTableModel> b = loadedModel();
+        QPointer<QSqlTableModel> c = loadedModel();
+
+        QVERIFY(cache.park("a", a, {}));
+        QVERIFY(cache.park("b", b, {}));
+        QVERIFY(cache.park("c", c, {}));
+
+        QCOMPARE(cache.tables(), QStringList({ "c", "b" }));
+        QVERIFY(a.isNull());
+        QVERIFY(!b.isNull());
+
+        cache.clear();
+        QVERIFY(b.isNull());
+        QVERIFY(c.isNull());
+    }
+
+    void test_budget_evictsColdModelsAndSkipsDirty()
+    {
+        MemoryBudget budget(0); // пока без вытеснения
+        WarmModelCache cache(&budget);
+
+        QSqlTableModel* dirty = loadedModel();
+        QVERIFY(dirty->setData(dirty->index(0, 3), 77));
+        QVERIFY(!cache.park("dirty", dirty, {}));
+        delete dirty;
+
+        QPointer<QSqlTableModel> cold = loadedModel();
+        QVERIFY(cache.park("rectangle", cold, {}));
+        const qint64 bytes = MemoryBudget::estimateRowCacheBytes(cold->rowCount(), cold->columnCount());
+        QCOMPARE(budget.totalBytes(), bytes);
+
+        budget.setLimitBytes(1);
+        QCOMPARE(budget.enforce(), bytes);
+        QVERIFY(cold.isNull());
+        QCOMPARE(budget.totalBytes(), qint64(0));
+        QVERIFY(!cache.contains("rectangle"));
+        QCOMPARE(cache.take("rectangle").model, static_cast<QSqlTableModel*>(nullptr));
+        QCOMPARE(budget.usage().size(), 0);
+    }
+
+    void test_compatibleTables_mainAndAttached()
+    {
+        const QString other = m_db.filePath("other.sqlite");
+        {
+            QSqlDatabase d = QSqlDatabase::addDatabase("QSQLITE", "warm_other");
+            d.setDatabaseName(other);
+            QVERIFY(d.open());
+            SchemaMigrator migrator(d);
+            QVERIFY2(migrator.migrate(), qPrintable(migrator.lastError()));
+            d.close();
+        }
+        QSqlDatabase::removeDatabase("warm_other");
+
+        QSqlQuery q(m_db.db());
+        QVERIFY2(q.exec(QString("ATTACH DATABASE '%1' AS aux;").arg(other)), qPrintable(q.lastError().text()));
+
+        const QStringList tables = RectangleTableModel::compatibleTables(m_db.db());
+        QCOMPARE(tables, QStringList({ "rectangle", "aux.rectangle" }));
+        QCOMPARE(RectangleTableModel::schemaOf("aux.rectangle"), QString("aux"));
+        QCOMPARE(RectangleTableModel::schemaOf("rectangle"), QString());
+    }
+};
+
+QTEST_MAIN(TestWarmModelCache)
+#include "test_warmmodelcache.moc"
@@ -0,0 +1,124 @@
+#ifndef TESTDB_H
+#define TESTDB_H
+
+#include <QDebug>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QString>
+#include <QTemporaryDir>
+
+#include <memory>
+
+#include "schemamigrator.h"
+
+/**
+ * @brief Временная БД SQLite для тестов: файл во временном каталоге, именованное соединение.
+ *
+ * Общая заготовка init()/cleanup() тестов, работающих с БД:
+ * @code
+ * TestDb m_db { "cdc_conn" };
+ * void init()    { QVERIFY2(m_db.open(), qPrintable(m_db.lastError())); }
+ * void cleanup() { m_db.close(); }
+ * @endcode
+ * open() по умолчанию приводит схему к последней версии (SchemaMigrator).
+ * close() закрывает соединение, удаляет его и временный каталог; вызывается и из деструктора.
+ *
+ * @note removeDatabase() требует, чтобы живых QSqlQuery/моделей на соединении не осталось:
+ *       тест уничтожает их до cleanup().
+ */
+class TestDb
+{
+public:
+    explicit TestDb(const char* connection, const char* fileName = "test.sqlite")
+        : m_connection(connection)
+        , m_fileName(fileName)
+    {
+    }
+
+    ~TestDb() { close(); }
+
+    TestDb(const TestDb&) = delete;
+    TestDb& operator=(const TestDb&) = delete;
+
+    /// Создаёт каталог и соединение; migrate — привести схему к последней версии.
+    bool open(bool migrate = true)
+    {
+        close();
+        m_dir.reset(new QTemporaryDir());
+        if (!m_dir->isValid()) {
+            m_error = "QTemporaryDir is invalid";
+            return false;
+        }
+
+        QSqlDatabase d = QSqlDatabase::addDatabase("QSQLITE", m_connection);
+        d.setDatabaseName(path());
+        if (!d.open()) {
+            m_error = d.lastError().text();
+            return false;
+        }
+        if (migrate) {
+            SchemaMigrator migrator(d);
+            if (!migrator.migrate()) {
+                m_error = migrator.lastError();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (!m_dir)
+            return;
+        {
+            QSqlDatabase d = QSqlDatabase::database(m_connection, false);
+            if (d.isOpen()) d.close();
+        }
+        QSqlDatabase::removeDatabase(m_connection);
+        m_dir.reset();
+    }
+
+    /// Соединение (без переоткрытия).
+    QSqlDatabase db() const { return QSqlDatabase::database(m_connection, false); }
+
+    QString connectionName() const { return m_connection; }
+
+    /// Путь к файлу БД.
+    QString path() const { return filePath(m_fileName); }
+
+    /// Путь к файлу во временном каталоге теста.
+    QString filePath(const QString& name) const { return m_dir ? m_dir->filePath(name) : QString(); }
+
+    /// Первая колонка первой строки запроса; -1 при ошибке.
+    qint64 scalar(const QString& sql) const
+    {
+        QSqlQuery q(db());
+        if (!q.exec(sql) || !q.next()) {
+            qWarning() << sql << q.lastError().text();
+            return -1;
+        }
+        return q.value(0).toLongLong();
+    }
+
+    /// Выполняет запрос; ошибка — в qWarning.
+    bool exec(const QString& sql) const
+    {
+        QSqlQuery q(db());
+        if (!q.exec(sql)) {
+            qWarning() << sql << q.lastError().text();
+            return false;
+        }
+        return true;
+    }
+
+    QString lastError() const { return m_error; }
+
+private:
+    QString m_connection;
+    QString m_fileName;
+    QString m_error;
+    std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+#endif // TESTDB_H